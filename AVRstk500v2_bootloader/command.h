@@ -42,6 +42,10 @@
 #define CMD_READ_OSCCAL_ISP                 0x1C
 #define CMD_SPI_MULTI                       0x1D
 
+// *****************[ Bootloader extension command constants ]****************
+
+#define CMD_READ_FLASH_CRC_ISP              0x1E        // CRC16 (XMODEM) for each flash page
+
 // *****************[ STK PP command constants ]*******************************
 
 #define CMD_ENTER_PROGMODE_PP               0x20
@@ -107,6 +111,7 @@
 #define PARAM_DATA                          0x9D
 #define PARAM_RESET_POLARITY                0x9E
 #define PARAM_CONTROLLER_INIT               0x9F
+#define PARAM_BAUD_RATE                     0xA0        // bootloader extension, baud rate / 100, 16 bit
 
 // *****************[ STK answer constants ]***************************
 
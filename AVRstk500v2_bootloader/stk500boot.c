@@ -40,7 +40,8 @@ USAGE:
 Note:
     Erasing the device without flashing, through AVRISP GUI button "Erase Device"
     is not implemented, due to AVRStudio limitations.
-    Flash is always erased before programming.
+    Flash pages whose content hasn't changed are skipped. A page that has changed
+    is always erased before it is written.
 
 	AVRdude:
 	Please uncomment #define REMOVE_CMD_SPI_MULTI when using AVRdude.
@@ -87,6 +88,9 @@ LICENSE:
 //*	Jan  1,	2012	<MLS> Issue 543: CMD_CHIP_ERASE_ISP now returns STATUS_CMD_FAILED instead of STATUS_CMD_OK
 //*	Jan  1,	2012	<MLS> Issue 543: Write EEPROM now does something (NOT TESTED)
 //*	Jan  1,	2012	<MLS> Issue 544: stk500v2 bootloader doesn't support reading fuses
+//*	Oct 18,	2026	Skip flash pages that haven't changed, erase and write the rest
+//*	Oct 18,	2026	Added CMD_READ_FLASH_CRC_ISP, so a host can skip sending unchanged pages
+//*	Oct 18,	2026	Added PARAM_BAUD_RATE, so a host can negotiate a higher baud rate
 //************************************************************************
 
 //************************************************************************
@@ -110,6 +114,7 @@ LICENSE:
 #include	<util/delay.h>
 #include	<avr/eeprom.h>
 #include	<avr/common.h>
+#include	<util/crc16.h>
 
 #include	"command.h"
 #include	"avr_cpunames.h"
@@ -141,6 +146,8 @@ LICENSE:
 //#define	REMOVE_PROGRAM_LOCK_BIT_SUPPORT	// disable program lock bits
 //#define	REMOVE_BOOTLOADER_LED			// no LED to show active bootloader
 //#define	REMOVE_CMD_SPI_MULTI			// disable processing of SPI_MULTI commands, Remark this line for AVRDUDE <Worapoht>
+//#define	REMOVE_CMD_READ_FLASH_CRC		// disable the per page flash CRC command
+//#define	REMOVE_BAUD_RATE_SUPPORT		// disable changing the baud rate with PARAM_BAUD_RATE
 //
 
 
@@ -257,6 +264,13 @@ LICENSE:
 	#define BAUDRATE 115200
 #endif
 
+/*
+ * Largest error, in percent, accepted for a baud rate asked for with PARAM_BAUD_RATE
+ */
+#ifndef UART_BAUD_TOLERANCE
+	#define UART_BAUD_TOLERANCE 3
+#endif
+
 /*
  *  Enable (1) or disable (0) USART double speed operation
  */
@@ -438,6 +452,15 @@ LICENSE:
 	#define UART_BAUD_SELECT(baudRate,xtalCpu) ((xtalCpu + baudRate / 8) / (baudRate * 16) - 1)
 #endif
 
+/*
+ * Macro to calculate the baudrate actually given by an UBBR value
+ */
+#if UART_BAUDRATE_DOUBLE_SPEED
+	#define UART_BAUD_ACTUAL(baudSelect,xtalCpu) ((xtalCpu) / 8 / ((baudSelect) + 1))
+#else
+	#define UART_BAUD_ACTUAL(baudSelect,xtalCpu) ((xtalCpu) / 16 / ((baudSelect) + 1))
+#endif
+
 /*
  * States used in the receive state machine
  */
@@ -586,7 +609,6 @@ int main(void) __attribute__ ((OS_main));
 int main(void)
 {
 	address_t		address			=	0;
-	address_t		eraseAddress	=	0;
 	uint8_t	msgParseState;
 	uint16_t	ii				=	0;
 	uint8_t	checksum		=	0;
@@ -596,6 +618,10 @@ int main(void)
 	uint8_t	c;
 	uint8_t   *p;
 	uint8_t   isLeave = 0;
+#ifndef REMOVE_BAUD_RATE_SUPPORT
+	uint8_t	baudChange		=	0;
+	uint8_t	baudSelect		=	0;
+#endif
 
 	uint32_t	boot_timeout;
 	uint32_t	boot_timer;
@@ -999,12 +1025,44 @@ int main(void)
 					isLeave	=	1;
 					//*	fall through
 
-				case CMD_SET_PARAMETER:
 				case CMD_ENTER_PROGMODE_ISP:
 					msgLength		=	2;
 					msgBuffer[1]	=	STATUS_CMD_OK;
 					break;
 
+				case CMD_SET_PARAMETER:
+				#ifndef REMOVE_BAUD_RATE_SUPPORT
+					//*	the baud rate is changed once the answer has been sent at the old rate,
+					//*	and only if it can be made within UART_BAUD_TOLERANCE percent.
+					if ( msgBuffer[1] == PARAM_BAUD_RATE )
+					{
+						uint32_t	baudRate	=	(((uint16_t)msgBuffer[2] << 8) | msgBuffer[3]) * 100UL;
+						uint32_t	baudSelectNew;
+						uint32_t	baudActual;
+
+						msgBuffer[1]	=	STATUS_CMD_FAILED;
+						if ( baudRate != 0 )
+						{
+							baudSelectNew	=	UART_BAUD_SELECT(baudRate, F_CPU);
+							if ( baudSelectNew <= 0xFF )
+							{
+								baudActual	=	UART_BAUD_ACTUAL(baudSelectNew, F_CPU);
+								if ( (baudActual > baudRate ? baudActual - baudRate : baudRate - baudActual) * 100 <= baudRate * UART_BAUD_TOLERANCE )
+								{
+									baudSelect		=	baudSelectNew;
+									baudChange		=	1;
+									msgBuffer[1]	=	STATUS_CMD_OK;
+								}
+							}
+						}
+						msgLength		=	2;
+						break;
+					}
+				#endif
+					msgLength		=	2;
+					msgBuffer[1]	=	STATUS_CMD_OK;
+					break;
+
 				case CMD_READ_SIGNATURE_ISP:
 					{
 						uint8_t signatureIndex	=	msgBuffer[4];
@@ -1069,7 +1127,6 @@ int main(void)
 					break;
 	#endif
 				case CMD_CHIP_ERASE_ISP:
-					eraseAddress	=	0;
 					msgLength		=	2;
 				//	msgBuffer[1]	=	STATUS_CMD_OK;
 					msgBuffer[1]	=	STATUS_CMD_FAILED;	//*	issue 543, return FAILED instead of OK
@@ -1097,29 +1154,58 @@ int main(void)
 
 						if ( msgBuffer[0] == CMD_PROGRAM_FLASH_ISP )
 						{
-							// erase only main section (bootloader protection)
-							if (eraseAddress < APP_END )
-							{
-								boot_page_erase(eraseAddress);	// Perform page erase
-								boot_spm_busy_wait();		// Wait until the memory is erased.
-								eraseAddress += SPM_PAGESIZE;	// point to next page to be erase
-							}
+							uint16_t	flashData;
+							uint8_t		needWrite	=	0;
 
-							/* Write FLASH */
+							//*	compare with the page already in flash. A page that hasn't changed
+							//*	isn't erased or written at all.
 							do {
 								lowByte		=	*p++;
 								highByte 	=	*p++;
 
 								data		=	(highByte << 8) | lowByte;
-								boot_page_fill(address,data);
+							#if (FLASHEND > 0x10000)
+								flashData	=	pgm_read_word_far(address);
+							#else
+								flashData	=	pgm_read_word_near(address);
+							#endif
+								if ( flashData != data )
+								{
+									needWrite	=	1;
+								}
 
 								address	=	address + 2;	// Select next word in memory
-								size	-=	2;				// Reduce number of bytes to write by two
-							} while (size);					// Loop until all bytes written
+								size	-=	2;				// Reduce number of bytes to compare by two
+							} while (size);					// Loop until all bytes compared
 
-							boot_page_write(tempaddress);
-							boot_spm_busy_wait();
-							boot_rww_enable();				// Re-enable the RWW section
+							if ( needWrite )
+							{
+								// erase only main section (bootloader protection)
+								if ( tempaddress < APP_END )
+								{
+									boot_page_erase(tempaddress);	// Perform page erase
+									boot_spm_busy_wait();		// Wait until the memory is erased.
+								}
+
+								/* Write FLASH */
+								size	=	((msgBuffer[1])<<8) | msgBuffer[2];
+								p		=	msgBuffer+10;
+								address	=	tempaddress;
+								do {
+									lowByte		=	*p++;
+									highByte 	=	*p++;
+
+									data		=	(highByte << 8) | lowByte;
+									boot_page_fill(address,data);
+
+									address	=	address + 2;	// Select next word in memory
+									size	-=	2;				// Reduce number of bytes to write by two
+								} while (size);					// Loop until all bytes written
+
+								boot_page_write(tempaddress);
+								boot_spm_busy_wait();
+								boot_rww_enable();				// Re-enable the RWW section
+							}
 						}
 						else
 						{
@@ -1188,6 +1274,46 @@ int main(void)
 					}
 					break;
 
+	#ifndef REMOVE_CMD_READ_FLASH_CRC
+				case CMD_READ_FLASH_CRC_ISP:
+					{
+						//*	one CRC16 (XMODEM), MSB first, for each SPM_PAGESIZE bytes from the loaded address,
+						//*	so a host can skip sending the pages that it already knows are in flash.
+						uint16_t	size	=	((msgBuffer[1])<<8) | msgBuffer[2];
+						uint8_t	*p		=	msgBuffer+1;
+						uint16_t	crc;
+						uint16_t	count;
+
+						if ( (size == 0) || (size > ((sizeof(msgBuffer) - 3) / 2) * SPM_PAGESIZE) )
+						{
+							msgLength		=	2;
+							msgBuffer[1]	=	STATUS_CMD_FAILED;
+						}
+						else
+						{
+							*p++	=	STATUS_CMD_OK;
+							do {
+								crc		=	0;
+								count	=	SPM_PAGESIZE;
+								do {
+								#if (FLASHEND > 0x10000)
+									crc		=	_crc_xmodem_update(crc, pgm_read_byte_far(address));
+								#else
+									crc		=	_crc_xmodem_update(crc, pgm_read_byte_near(address));
+								#endif
+									address++;
+									size--;
+								} while (--count && size);
+								*p++	=	(uint8_t)(crc >> 8);
+								*p++	=	(uint8_t)crc;
+							} while (size);
+							*p++	=	STATUS_CMD_OK;
+							msgLength	=	p - msgBuffer;
+						}
+					}
+					break;
+	#endif
+
 				default:
 					msgLength		=	2;
 					msgBuffer[1]	=	STATUS_CMD_FAILED;
@@ -1235,6 +1361,15 @@ int main(void)
 			sendchar(checksum);
 			seqNum++;
 
+		#ifndef REMOVE_BAUD_RATE_SUPPORT
+			//*	the answer has been sent (sendchar() waits for it), so now change the baud rate
+			if ( baudChange )
+			{
+				UART_BAUD_RATE_LOW	=	baudSelect;
+				baudChange			=	0;
+			}
+		#endif
+
 		#ifndef REMOVE_BOOTLOADER_LED
 			//*	<MLS>	toggle the LED
 			PROGLED_PORT	^=	_BV(PROGLED_PIN);	// active high LED ON
@@ -0,0 +1,105 @@
+/*
+
+Title:			life.h
+Purpose:		Conway's Life on the 25x25 LED array, a row at a time
+Application:	Conway's Life, for peggy2.c
+
+Distributed under the terms of the GNU General Public License, see peggy2.c.
+
+The generation step on its own, so it can be built and checked off target too.
+Each row of the array is a uint32_t, with the cell in column y at bit y.
+
+*/
+
+#ifndef LIFE_H
+#define LIFE_H
+
+#include <stdint.h>
+
+#define CELLS_X 25
+#define CELLS_Y 25
+
+#define CELLS_MASK	( ((uint32_t) 1 << CELLS_Y) - 1 )	// the cells in each row, the rest are don't care.
+
+/////////////////////////////////////////////////////////////////////////
+
+
+// Sum the eight neighbours of all the cells in a row at once, one bit of each cell per bitwise
+// operation, with full adders. Neighbours wrap around the edges, top to bottom and side to side.
+// A cell lives with three neighbours, or with two if it is alive, and otherwise dies.
+
+static inline uint32_t next_row(uint32_t above, uint32_t row, uint32_t below)
+{
+	uint32_t left, right;
+	uint32_t above_sum, above_carry, below_sum, below_carry, row_sum, row_carry;
+	uint32_t sum, carry, twos, fours;
+
+	// Only the bits below CELLS_Y wrap, so bits above it are garbage, and are masked off at the end.
+
+	left = (above << 1) | (above >> (CELLS_Y - 1));
+	right = (above >> 1) | (above << (CELLS_Y - 1));
+	above_sum = left ^ above ^ right;
+	above_carry = (left & above) | (right & (left ^ above));
+
+	left = (below << 1) | (below >> (CELLS_Y - 1));
+	right = (below >> 1) | (below << (CELLS_Y - 1));
+	below_sum = left ^ below ^ right;
+	below_carry = (left & below) | (right & (left ^ below));
+
+	left = (row << 1) | (row >> (CELLS_Y - 1));
+	right = (row >> 1) | (row << (CELLS_Y - 1));
+	row_sum = left ^ right;
+	row_carry = left & right;
+
+	// Neighbours = sum + 2 * (above_carry + below_carry + row_carry + carry).
+
+	sum = above_sum ^ below_sum ^ row_sum;
+	carry = (above_sum & below_sum) | (row_sum & (above_sum ^ below_sum));
+
+	twos = above_carry ^ below_carry ^ row_carry ^ carry;
+	fours = (above_carry & below_carry) | (row_carry & carry) | ((above_carry ^ below_carry) & (row_carry ^ carry));
+
+	// Two or three neighbours have exactly one two, and no fours.
+
+	return twos & ~fours & (sum | row) & CELLS_MASK;
+}
+
+/////////////////////////////////////////////////////////////////////////
+
+
+// Step the whole array one generation, in place, keeping the rows above and below as they were.
+// Returns the number of cells that changed, and the number of cells alive in total.
+
+static inline uint16_t next_generation(uint32_t cells[], uint16_t * total)
+{
+	uint32_t first = cells[0] & CELLS_MASK;
+	uint32_t above = cells[CELLS_X - 1] & CELLS_MASK;
+	uint32_t row = first;
+	uint32_t below;
+	uint32_t next;
+
+	uint16_t changes = 0;
+
+	*total = 0;
+
+	for(uint8_t x=0; x < CELLS_X; x++)
+	{
+		if(x == CELLS_X - 1)
+			below = first;
+		else
+			below = cells[x + 1] & CELLS_MASK;
+
+		next = next_row(above, row, below);
+
+		changes += __builtin_popcountl(next ^ row);
+		*total += __builtin_popcountl(next);
+
+		cells[x] = next;
+
+		above = row;
+		row = below;
+	}
+	return changes;
+}
+
+#endif // LIFE_H
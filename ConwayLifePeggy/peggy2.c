@@ -39,14 +39,13 @@ Portions Copyright David Gustafik, 2007
 #include <avr/io.h>
 #include <avr/eeprom.h>
 
+#include "life.h"
 
-#define CELLS_X 25
-#define CELLS_Y 25
+#define GENERATION_REFRESHES	(CELLS_X * CELLS_Y)		// display refreshes per generation, which sets the pace of life.
 
 
 /////////////////////////////////////////////////////////////////////////
 
-uint32_t current_generation[CELLS_X];
 uint32_t old_generation[CELLS_X];
 
 volatile uint32_t d[25];
@@ -82,23 +81,6 @@ inline uint8_t get_cell(uint32_t from[],  int8_t x, int8_t y)
 
 /////////////////////////////////////////////////////////////////////////
 
-uint16_t get_total(uint32_t from[])
-{
-	uint16_t total = 0;
-
-	for(uint8_t x=0; x < CELLS_X; x++)
-	{
-		for(uint8_t y=0; y < CELLS_Y; y++)
-		{
-			if(get_cell(from,x,y)) total++;
-		}
-	}
-	return total;
-}
-
- /////////////////////////////////////////////////////////////////////////
-
-
 void set_cell(uint32_t to[], int8_t x, int8_t y, uint8_t value)
 {
 	if(value)
@@ -160,71 +142,6 @@ void clear_data(uint32_t to[])
 
 
 
-void copy_old_new(uint32_t old_gen[], uint32_t new_gen[])
-{
-	for(uint8_t temp = 0; temp < CELLS_X; temp++)
-		old_generation[temp] = current_generation[temp];
-	return;
-}
-
-/////////////////////////////////////////////////////////////////////////
-
-
-
-uint8_t get_neighbours(uint32_t from[], int8_t x, int8_t y)
-{
-	uint8_t out = 0;
-
-	if(get_cell(from,x-1,y-1))
-		out++;
-
-	if(get_cell(from,x-1,y))
-		out++;
-
-	if(get_cell(from,x-1,y+1))
-		out++;
-
-	if(get_cell(from,x,y-1))
-		out++;
-
-	if(get_cell(from,x,y+1))
-		out++;
-
-	if(get_cell(from,x+1,y-1))
-		out++;
-
-	if(get_cell(from,x+1,y))
-		out++;
-
-	if(get_cell(from,x+1,y+1))
-		out++;
-
-	return out;
-}
-
-/////////////////////////////////////////////////////////////////////////
-
-
-
-uint8_t get_difference(uint32_t a[],uint32_t b[])
-{
-	uint8_t diff=0;
-
-	for(uint8_t  x=0; x < CELLS_X; x++)
-	{
-		for(uint8_t  y=0; y < CELLS_Y; y++)
-		{
-			if((get_cell(a,x,y) && !get_cell(b,x,y)) || (!get_cell(a,x,y) && get_cell(b,x,y)))
-			    diff++;
-		}
-	}
-	return diff;
-}
-
-/////////////////////////////////////////////////////////////////////////
-
-
-
 void display(uint32_t from[])
 {
 
@@ -233,15 +150,7 @@ void display(uint32_t from[])
 	for(uint8_t x=0; x < CELLS_X; x++)
 		{
 
-		longtemp = 0;
-
-
-		for(uint8_t y=0; y < CELLS_Y; y++)
-			{
-
-				if(get_cell(from,x,y))
-					longtemp |= (uint32_t) 1 << y;
-			 }
+		longtemp = from[x] & CELLS_MASK;
 
 		//		longtemp |=  (uint32_t) 1 << 8;   // Optional grid lines
 		//		longtemp |=  (uint32_t) 1 << 16;  // Optional grid lines
@@ -339,6 +248,7 @@ void main(void) __attribute__ ((OS_main));
 void main(void)
 {
 	uint16_t generations=0;
+	uint16_t changes, total;
 
 	uint8_t out1,out2,out3,out4;
 	uint32_t dtemp;
@@ -406,7 +316,7 @@ while(1)    //Main Loop
 				temp = get_cell(old_generation,yCursor,xCursor);
 
 
-			set_cell(current_generation, yCursor, xCursor, !temp ); // Invert Cell
+			set_cell(old_generation, yCursor, xCursor, !temp ); // Invert Cell
 
 		}
 		}
@@ -463,7 +373,7 @@ while(1)    //Main Loop
 			{
 			generations = 0;								// Postpone mutations for a while.
 
-			//	clear_data(current_generation);				//Clear screen when entering edit mode
+			//	clear_data(old_generation);					//Clear screen when entering edit mode
 															// Quite optional to enable this!
 			}
 
@@ -531,52 +441,33 @@ while(1)    //Main Loop
 	else
 	{
 
-			for(uint8_t x=0; x < CELLS_X; x++)
-			{
+			changes = next_generation(old_generation, &total);
 
-				for(uint8_t y=0; y < CELLS_Y; y++)		// Inner loop; should be made quick as possible.
-				{
-					temp = get_neighbours(old_generation, x, y);
-
-					if(temp < 2)
-						clear_cell(current_generation, x, y);
-
-					if(temp == 3)
-						fill_cell(current_generation, x, y);
-
-					if(temp > 3)
-						clear_cell(current_generation, x, y);
-
-					DisplayLEDs();
-				}
-
-			}
-//
-			DisplayLEDs();
+			for(uint16_t refresh = 0; refresh < GENERATION_REFRESHES; refresh++)
+				DisplayLEDs();
 
 	/*		if( generations++ == 200 )
 			{
-				current_generation[0] = rand() & 0xFF;
-				current_generation[23] = rand() & 0xFF;
-				current_generation[24] = rand() & 0xFF;
+				old_generation[0] = rand() & 0xFF;
+				old_generation[23] = rand() & 0xFF;
+				old_generation[24] = rand() & 0xFF;
 				generations = 0;
 			}
 
 	*/
 
 			//Alternative boringness detector:
-			if( generations++ > 511 || get_difference(current_generation,old_generation) < 8 || get_total(current_generation) < 6)
+			if( generations++ > 511 || changes < 8 || total < 6)
 			{
-				current_generation[7] = rand() & 0xFF;
-				current_generation[8] = rand() & 0xFF;
-				current_generation[9] = rand() & 0xFF;
+				old_generation[7] = rand() & 0xFF;
+				old_generation[8] = rand() & 0xFF;
+				old_generation[9] = rand() & 0xFF;
 				generations = 0;
 			}
 
 
 	}
 
-		copy_old_new(old_generation, current_generation);
 		DisplayLEDs ();
 
 	}
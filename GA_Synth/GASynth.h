@@ -94,6 +94,9 @@ extern "C" {
 
 #define NOTES			12
 
+#define ADSR_RATE_SCALE	(SAMPLE_RATE / 12000)		// the attack and release tables are stepped once every ADSR_RATE_SCALE samples,
+#define ADSR_SAMPLES	(0x0800 * ADSR_RATE_SCALE)	// so that they take the same time as they did at 12kHz.
+
 #define VCO1_BUTTON		(_BV(PIND5))
 #define VCO2_BUTTON		(_BV(PIND6))
 #define LFO_BUTTON		(_BV(PIND7))
@@ -181,10 +184,13 @@ static void AudioCodec_ADC(uint16_t * _mod0value, uint16_t * _mod1value) __attri
 static void shieldDButtonInit(debouncer * portDebounce, uint8_t buttons, uint8_t pulledUpButtons ); // initialise the Shield Buttons
 static uint8_t shieldPhysicalIO(uint8_t button) __attribute__((hot, flatten));
 
-void synthesizer( uint16_t * ch_A, uint16_t * ch_B) __attribute__ ((hot, flatten));
-	// the DSP function for the Synthesiser, and called from the reconstruction sampling interrupt.
-	// needs to at least provide *ch_A and *ch_B
-	// within Timer0/1 interrupt routine - time critical I/O. Keep it short and punchy!
+void oscillator( vco_t * vco, int16_t * wave, int16_t const * mod0, int16_t const * mod1, uint8_t samples ) __attribute__ ((hot, flatten));
+	// render a block of an oscillator wave, with its phase modulated by the mod0 and mod1 blocks (or NULL).
+
+void synthesizer( uint16_t * ch_A, uint16_t * ch_B, uint8_t samples) __attribute__ ((hot, flatten));
+	// the block DSP function for the Synthesiser, called from the audio block task.
+	// needs to provide the samples of ch_A[] and ch_B[]
+	// within the time of a block, less the Timer0/1 sample interrupts.
 
 // get a line from the console
 static void get_line (uint8_t *buff, uint8_t len);
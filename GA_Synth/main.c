@@ -42,6 +42,10 @@
 /* Gameduino 2 include file. */
 #include "FT_Platform.h"
 
+/* Render the audio in blocks, from the Analogue task, rather than sample by sample in the sample interrupt. */
+#define AUDIO_BLOCK_SIZE	32		// samples in each block, played while the next block is being rendered.
+#define SAMPLE_RATE			24000	// exact multiples of 2000Hz are ok with 8 bit Timer0.
+
 /* Goldilocks Analogue and other DAC functions include file. */
 #include "DAC.h"
 
@@ -65,14 +69,20 @@ synth_t synth;
 /* This is a structure for holding the IIR filter coefficients and state variables */
 filter_t filter;
 
+/* Display list segments for the parts of the GUI that seldom change, retained at the top of RAM_G */
+FT_API_Segment_t guiLabels = { RAM_G + 0x3E000, 0x1000 };
+FT_API_Segment_t guiKeyboard = { RAM_G + 0x3F000, 0x1000 };
+
 // EEPROM to save the current synth settings.
 synth_t EEMEM synth_store;
 
 uint8_t * delayDataPtr;			// pointer to the delay buffer data location
 ringBuffer_t delayBuffer;		// ring buffer control structure for delay buffer
 
-uint16_t ch_A_out; // storage for the sample values to be written to MCP4822 DAC
-uint16_t ch_B_out;
+int16_t lfoBlock[AUDIO_BLOCK_SIZE];	// storage for the blocks of samples as they're rendered
+int16_t vco1Block[AUDIO_BLOCK_SIZE];
+int16_t vco2Block[AUDIO_BLOCK_SIZE];
+int16_t xmodBlock[AUDIO_BLOCK_SIZE];
 
 uint8_t * LineBuffer = (void *)0;	// put line buffer for monitor on heap later with pvPortMalloc.
 
@@ -165,7 +175,7 @@ int main(void)
 		,  (const portCHAR *)"WriteLCD"
 		,  400
 		,  NULL
-		,  3
+		,  2
 		,  NULL ); // */
 
    xTaskCreate(
@@ -179,9 +189,9 @@ int main(void)
    xTaskCreate(
 		TaskAnalogue
 		,  (const portCHAR *) "Analogue"
-		,  96
+		,  128
 		,  NULL
-		,  1
+		,  3
 		,  NULL ); // */
 
 	avrSerialPrintf_P(PSTR("\r\nFree Heap Size: %u\r\n"), xPortGetFreeHeapSize() ); // needs heap_1, heap_2 or heap_4 for this function to succeed.
@@ -358,44 +368,31 @@ static void TaskAnalogue(void *pvParameters) // Prepare the DAC
 //	AudioCodec_Timer1_init(SAMPLE_RATE);	// xxx set up the sampling Timer1 to 44100Hz (or odd rates), runs at audio sampling rate in Hz.
 //	xSerialPrintf_P(PSTR(" be"));
 
-	AudioCodec_setHandler( synthesizer, &ch_A_out, &ch_B_out );		// Set the call back function to do the audio processing.
-																	//	Done this way so that we can change the audio handling depending on what we want to achieve.
-
 //	xSerialPrintf_P(PSTR(" done."));
 
 //	xSerialPrintf_P(PSTR("\r\nFree Heap Size: %u"),xPortGetMinimumEverFreeHeapSize() ); // needs heap_1.c, heap_2.c or heap_4.c
 //	xSerialPrintf_P(PSTR("\r\nAudio HighWater: %u\r\n"), uxTaskGetStackHighWaterMark(NULL));
 
-	vTaskSuspend(NULL);						// Well, we're pretty much done here.
-//	vTaskEndScheduler();					// Rely on Timer0/1 Interrupt for regular output.
-
-	for(;;);
+	AudioCodec_blockTask( (void *)synthesizer );	// From here on, render the audio blocks as the Timer0/1 Interrupt plays them.
+													//	Done this way so that we can change the audio handling depending on what we want to achieve.
 }
 
 /*-----------------------------------------------------------*/
 /* static functions */
 /*-----------------------------------------------------------*/
 
-void synthesizer( uint16_t * ch_A,  uint16_t * ch_B) // Voltage controlled oscillator
+void oscillator( vco_t * vco, int16_t * wave, int16_t const * mod0, int16_t const * mod1, uint8_t samples ) // Voltage controlled oscillator
 {
 	// create some temporary variables
+	uint32_t phase = vco->phase;
 	uint16_t currentPhase;
 	uint8_t frac;
 
-	DAC_value_t temp0; // this is a int16_t that can be called as either byte.
-
-	int16_t temp1 = 0;
-	int16_t temp2 = 0;
-	int16_t temp3 = 0;
+	int16_t temp1;
+	int16_t temp2;
+	int16_t temp3;
 
-	uint16_t buffCount;
-
-	int16_t outXMOD;
-	int16_t outVCO1;
-	int16_t outVCO2;
-	int16_t outLFO;
-
-	// create a variable frequency and amplitude wave of size.
+	// create a variable frequency wave of size.
 	// since we will be moving through the lookup table with 4096 values
 	// at a variable frequency, we won't always land directly
 	// on a single sample.  so we will average between the
@@ -409,305 +406,271 @@ void synthesizer( uint16_t * ch_A,  uint16_t * ch_B) // Voltage controlled oscil
 	// That is, the lower 8 bits are assumed to be fractional.
 	// They are used for the interpolation process, and to ensure accuracy.
 
-	// Remember our DAC only has 12 bits, so we have 4 LSB spare the low end too.
+	// The phase is kept in registers for the whole block, and written back at the end.
 
-	// only play if we're in the adsr envelope.
-	if(synth.adsr != off)
+	for (uint8_t i = 0; i < samples; ++i)
 	{
-		////////////// First do the LFO ///////////////
-
-		// This will later modulate by the VCO1 and VCO2 phase,
-		// so we need it first.
-		if( synth.lfo.toggle )
-		{
-			// increment the phase (index into LUT) by the calculated phase increment.
-			synth.lfo.phase += synth.lfo.phase_increment;
-
-			// if we've gone over the LUT boundary -> loop back
-			synth.lfo.phase &= 0x000fffff; // this is a faster way doing the table
-											// wrap around, which is possible
-											// because our table is a multiple of 2^n.
-											// Remember the lowest 0xff are fractions of LUT steps.
-
-			currentPhase = (uint16_t)(synth.lfo.phase >> 8);
-
-			// get first sample from the LUT and store it in temp1
-			temp1 = pgm_read_word(synth.lfo.wave_table_ptr + currentPhase);
-
-			++currentPhase; // go to next sample
-			currentPhase &= 0x0fff;	// check if we've gone over the boundary.
-									// we can do this because it is a multiple of 2^n.
-
-			// get second sample from the LUT and put it in temp2
-			temp2 = pgm_read_word(synth.lfo.wave_table_ptr + currentPhase);
-
-			// interpolate between samples
-			// multiply each sample by the fractional distance
-			// to the actual location value
-			frac = (uint8_t)(synth.lfo.phase & 0x000000ff); // fetch the lower 8b
-			MultiSU16X8toH16Round(temp3, temp2, frac);
-			// scaled sample 2 is now in temp3, and since we are done with
-			// temp2, we can reuse it for the next result
-			MultiSU16X8toH16Round(temp2, temp1, 0xff - frac);
-			// temp2 now has the scaled sample 1
-			temp2 += temp3; // add samples together to get an average
-			// our resultant wave is now in temp2
-
-			// set amplitude with volume
-			// multiply our wave by the volume value
-			MultiSU16X16toH16Round(outLFO, temp2, synth.lfo.volume);
-			// our LFO wave is now in outLFO
-		}
-		else // LFO is turned off.
-			outLFO = 0;
-
-		////////////// Now do the VCO2 ///////////////
-
-		// This will later modulate the VCO1 phase (depending on the XMOD intensity),
-		// so we need it first.
-		if( synth.vco2.toggle )
-		{
-			// increment the phase (index into LUT) by the calculated phase increment.
-			synth.vco2.phase += synth.vco2.phase_increment;
+		// increment the phase (index into LUT) by the calculated phase increment.
+		phase += vco->phase_increment;
+
+		// modulate the phase increment, with the LFO or XMOD outputs, if they're turned on.
+		if (mod0 != NULL)
+			phase += mod0[i]; // increment on the fractional component 8.8.
+
+		if (mod1 != NULL)
+			phase += mod1[i];
+
+		// if we've gone over the LUT boundary -> loop back
+		phase &= 0x000fffff;	// this is a faster way doing the table
+								// wrap around, which is possible
+								// because our table is a multiple of 2^n.
+								// Remember the lowest 0xff are fractions of LUT steps.
+
+		currentPhase = (uint16_t)(phase >> 8);
+
+		// get first sample from the LUT and store it in temp1
+		temp1 = pgm_read_word(vco->wave_table_ptr + currentPhase);
+
+		++currentPhase; // go to next sample
+		currentPhase &= 0x0fff;	// check if we've gone over the boundary.
+								// we can do this because it is a multiple of 2^n.
+
+		// get second sample from the LUT and put it in temp2
+		temp2 = pgm_read_word(vco->wave_table_ptr + currentPhase);
+
+		// interpolate between samples
+		// multiply each sample by the fractional distance
+		// to the actual location value
+		frac = (uint8_t)(phase & 0x000000ff); // fetch the lower 8b
+		MultiSU16X8toH16Round(temp3, temp2, frac);
+		// scaled sample 2 is now in temp3, and since we are done with
+		// temp2, we can reuse it for the next result
+		MultiSU16X8toH16Round(temp2, temp1, 0xff - frac);
+		// temp2 now has the scaled sample 1
+		temp2 += temp3; // add samples together to get an average
+		// our resultant wave is now in temp2
+
+		wave[i] = temp2;
+	}
 
-			// calculate how much the LFO affects the VCO2 phase increment
-			if (synth.lfo.toggle)
-			{
-				// increment the phase (index into LUT) by the calculated phase increment including the LFO output.
-				synth.vco2.phase += outLFO; // increment on the fractional component 8.8.
-			}
+	vco->phase = phase;
+}
 
-			// if we've gone over the LUT boundary -> loop back
-			synth.vco2.phase &= 0x000fffff; // this is a faster way doing the table
-											// wrap around, which is possible
-											// because our table is a multiple of 2^n.
-											// Remember the lowest 0xff are fractions of LUT steps.
+void synthesizer( uint16_t * ch_A,  uint16_t * ch_B, uint8_t samples) // Render a block of samples
+{
+	// create some temporary variables
+	uint16_t currentPhase;
+	uint8_t i;
 
-			currentPhase = (uint16_t)(synth.vco2.phase >> 8);
+	DAC_value_t temp0; // this is a int16_t that can be called as either byte.
 
-			// get first sample from the LUT and store it in temp1
-			temp1 = pgm_read_word(synth.vco2.wave_table_ptr + currentPhase);
+	int16_t temp1;
+	int16_t temp2;
 
-			++currentPhase; // go to next sample
-			currentPhase &= 0x0fff;	// check if we've gone over the boundary.
-									// we can do this because it is a multiple of 2^n.
+	uint16_t buffCount;
 
-			// get second sample from the LUT and put it in temp2
-			temp2 = pgm_read_word(synth.vco2.wave_table_ptr + currentPhase);
+	int16_t outVCO1;
+	int16_t outVCO2;
 
-			// interpolate between samples
-			// multiply each sample by the fractional distance
-			// to the actual location value
-			frac = (uint8_t)(synth.vco2.phase & 0x000000ff); // fetch the lower 8b
-			MultiSU16X8toH16Round(temp3, temp2, frac);
-			// scaled sample 2 is now in temp3, and since we are done with
-			// temp2, we can reuse it for the next result
-			MultiSU16X8toH16Round(temp2, temp1, 0xff - frac);
-			// temp2 now has the scaled sample 1
-			temp2 += temp3; // add samples together to get an average
-			// our resultant wave is now in temp2
+	// Remember our DAC only has 12 bits, so we have 4 LSB spare the low end too.
 
-			// set amplitude with volume
-			// multiply our wave by the volume value
-			MultiSU16X16toH16Round(outVCO2, temp2, synth.vco2.volume);
-			// our VCO2 wave is now in outVCO2
+	// The oscillators are gated by the adsr envelope at the start of the block.
+	uint8_t playLFO  = (synth.adsr != off) && synth.lfo.toggle;
+	uint8_t playVCO2 = (synth.adsr != off) && synth.vco2.toggle;
+	uint8_t playVCO1 = (synth.adsr != off) && synth.vco1.toggle;
 
-			// And now calculate the XMOD intensity to apply to the VCO1
-			MultiSU16X16toH16Round(outXMOD, temp2, synth.xmod);
-		}
-		else // VCO2 is turned off.
-			outXMOD = outVCO2 = 0;
+	////////////// First do the LFO ///////////////
 
-		///////////// Now do the VCO1 ////////////////////
+	// This will later modulate by the VCO1 and VCO2 phase,
+	// so we need it first.
+	if( playLFO )
+	{
+		oscillator( &synth.lfo, lfoBlock, NULL, NULL, samples );
 
-		// This will be modulated by the VCO2 value (depending on the XMOD intensity).
-		if( synth.vco1.toggle )
+		// set amplitude with volume
+		// multiply our wave by the volume value
+		for (i = 0; i < samples; ++i)
 		{
+			MultiSU16X16toH16Round(temp2, lfoBlock[i], synth.lfo.volume);
+			lfoBlock[i] = temp2;
+		}
+		// our LFO wave is now in lfoBlock
+	}
 
-			// increment the phase (index into LUT) by the calculated phase increment.
-			synth.vco1.phase += synth.vco1.phase_increment;
-
-			// calculate how much the LFO affects the VCO1 phase increment
-			if (synth.lfo.toggle)
-			{
-				// increment the phase (index into LUT) by the calculated phase increment including the LFO output.
-				synth.vco1.phase += (uint32_t)outLFO; // increment on the fractional component 8.8.
-			}
-
-			// calculate how much the VCO2 XMOD affects the VCO1 phase increment
-			if (synth.vco2.toggle)
-			{
-				// increment the phase (index into LUT) by the calculated phase increment including the LFO output.
-				synth.vco1.phase += (uint32_t)outXMOD; // increment on the fractional component 8.8.
-			}
-
-			// if we've gone over the LUT boundary -> loop back
-			synth.vco1.phase &= 0x000fffff; // this is a faster way doing the table
-											// wrap around, which is possible
-											// because our table is a multiple of 2^n.
-											// Remember the lowest 0xff are fractions of LUT steps.
+	////////////// Now do the VCO2 ///////////////
 
-			currentPhase = (uint16_t)(synth.vco1.phase >> 8);
+	// This will later modulate the VCO1 phase (depending on the XMOD intensity),
+	// so we need it first.
+	if( playVCO2 )
+	{
+		oscillator( &synth.vco2, vco2Block, playLFO ? lfoBlock : NULL, NULL, samples );
 
-			// get first sample from the LUT and store it in temp1
-			temp1 = pgm_read_word(synth.vco1.wave_table_ptr + currentPhase);
+		for (i = 0; i < samples; ++i)
+		{
+			// calculate the XMOD intensity to apply to the VCO1
+			MultiSU16X16toH16Round(temp2, vco2Block[i], synth.xmod);
+			xmodBlock[i] = temp2;
 
-			++currentPhase; // go to next sample
-			currentPhase &= 0x0fff;	// check if we've gone over the boundary.
-									// we can do this because it is a multiple of 2^n.
+			// set amplitude with volume
+			MultiSU16X16toH16Round(temp2, vco2Block[i], synth.vco2.volume);
+			vco2Block[i] = temp2;
+		}
+		// our VCO2 wave is now in vco2Block, and the XMOD in xmodBlock
+	}
 
-			// get second sample from the LUT and put it in temp2
-			temp2 = pgm_read_word(synth.vco1.wave_table_ptr + currentPhase);
+	///////////// Now do the VCO1 ////////////////////
 
-			// interpolate between samples
-			// multiply each sample by the fractional distance
-			// to the actual location value
-			frac = (uint8_t)(synth.vco1.phase & 0x000000ff); // fetch the lower 8b
-			MultiSU16X8toH16Round(temp3, temp2, frac);
-			// scaled sample 2 is now in temp3, and since we are done with
-			// temp2, we can reuse it for the next result
-			MultiSU16X8toH16Round(temp2, temp1, 0xff - frac);
-			// temp2 now has the scaled sample 1
-			temp2 += temp3; // add samples together to get an average
-			// our resultant wave is now in temp2
+	// This will be modulated by the VCO2 value (depending on the XMOD intensity).
+	if( playVCO1 )
+	{
+		oscillator( &synth.vco1, vco1Block, playLFO ? lfoBlock : NULL, playVCO2 ? xmodBlock : NULL, samples );
 
+		for (i = 0; i < samples; ++i)
+		{
 			// set amplitude with volume
-			// multiply our wave by the volume value
-			MultiSU16X16toH16Round(outVCO1, temp2, synth.vco1.volume);
-			// our VCO1 wave is now in outVCO1
+			MultiSU16X16toH16Round(temp2, vco1Block[i], synth.vco1.volume);
+			vco1Block[i] = temp2;
 		}
-		else // VCO1 is turned off;
-			outVCO1 = 0;
+		// our VCO1 wave is now in vco1Block
 	}
-	else // we're in off state, and no notes are playing.
-		outVCO1 = outVCO2 = 0;
-
 
-	////////////// mix the two oscillators //////////////////
+	for (i = 0; i < samples; ++i)
+	{
+		outVCO1 = playVCO1 ? vco1Block[i] : 0;
+		outVCO2 = playVCO2 ? vco2Block[i] : 0;
 
-	// irrespective of whether a note is playing or not.
-	// combine the outputs
-	temp2 = (outVCO1 >> 1) + (outVCO2 >>1);
+		////////////// mix the two oscillators //////////////////
 
+		// irrespective of whether a note is playing or not.
+		// combine the outputs
+		temp2 = (outVCO1 >> 1) + (outVCO2 >>1);
+		temp1 = 0;
 
-	///////////////// calculate the adsr /////////////////////
+		///////////////// calculate the adsr /////////////////////
 
-	switch (synth.adsr)
-	{
-	case off: // wait for a note to be played
-		if ( synth.note == FT_FALSE )
-		{	// if there is no note being played, then reset the VCO increments.
-			synth.vco1.phase = \
-			synth.vco2.phase = \
-			synth.lfo.phase  = \
-			temp1 			 = 0x00;
-		}
-		else
-		{	// set the adsr to attack and start producing sounds
-			synth.adsr = attack;
-			synth.adsr_phase = 0x00;
-		}
-		break;
+		switch (synth.adsr)
+		{
+		case off: // wait for a note to be played
+			if ( synth.note == FT_FALSE )
+			{	// if there is no note being played, then reset the VCO increments.
+				synth.vco1.phase = \
+				synth.vco2.phase = \
+				synth.lfo.phase  = \
+				temp1 			 = 0x00;
+			}
+			else
+			{	// set the adsr to attack and start producing sounds
+				synth.adsr = attack;
+				synth.adsr_phase = 0x00;
+			}
+			break;
 
-	case attack:
-		currentPhase = pgm_read_word(synth.adsr_table_ptr + synth.adsr_phase);
-		MultiSU16X16toH16Round( temp1, temp2, currentPhase );
+		case attack:
+			currentPhase = pgm_read_word(synth.adsr_table_ptr + synth.adsr_phase / ADSR_RATE_SCALE);
+			MultiSU16X16toH16Round( temp1, temp2, currentPhase );
 
-		if ( ++synth.adsr_phase > 0x07ff ) // attack state is for 2047 samples.
-		{
-			synth.adsr = decay;
-			synth.adsr_phase = 0x0000;
-		}
-		break;
+			if ( ++synth.adsr_phase > ADSR_SAMPLES - 1 ) // attack state is for 2047 table steps.
+			{
+				synth.adsr = decay;
+				synth.adsr_phase = 0x0000;
+			}
+			break;
 
-	case decay:
-		temp1 = temp2;
-		if (synth.note == FT_FALSE)
-		{
-			synth.adsr = release;
-			synth.adsr_phase = 0x0000;
-		}
-		else
-		{
-			synth.adsr = sustain;
-			synth.adsr_phase = 0x0000;
-		}
-		break;
+		case decay:
+			temp1 = temp2;
+			if (synth.note == FT_FALSE)
+			{
+				synth.adsr = release;
+				synth.adsr_phase = 0x0000;
+			}
+			else
+			{
+				synth.adsr = sustain;
+				synth.adsr_phase = 0x0000;
+			}
+			break;
 
-	case sustain:
-		temp1 = temp2;
-		if ( synth.note == FT_FALSE )
-		{
-			synth.adsr = release;
-			synth.adsr_phase = 0x0000;
-		}
-		break;
+		case sustain:
+			temp1 = temp2;
+			if ( synth.note == FT_FALSE )
+			{
+				synth.adsr = release;
+				synth.adsr_phase = 0x0000;
+			}
+			break;
 
-	case release:
-		currentPhase = pgm_read_word(synth.adsr_table_ptr + synth.adsr_phase);
-		MultiSU16X16toH16Round( temp1, temp2, UINT16_MAX - currentPhase );
+		case release:
+			currentPhase = pgm_read_word(synth.adsr_table_ptr + synth.adsr_phase / ADSR_RATE_SCALE);
+			MultiSU16X16toH16Round( temp1, temp2, UINT16_MAX - currentPhase );
 
-		if ( ++synth.adsr_phase > 0x07ff) // release state is for 2047 samples.
-		{
-			synth.adsr = off;
-			synth.adsr_phase = 0x0000;
-		}
-		else if ( synth.note != FT_FALSE )
-		{
-			synth.adsr = attack;
-			synth.adsr_phase = 0x0000;
+			if ( ++synth.adsr_phase > ADSR_SAMPLES - 1 ) // release state is for 2047 table steps.
+			{
+				synth.adsr = off;
+				synth.adsr_phase = 0x0000;
+			}
+			else if ( synth.note != FT_FALSE )
+			{
+				synth.adsr = attack;
+				synth.adsr_phase = 0x0000;
+			}
+			break;
 		}
-		break;
-	}
 
+		vco1Block[i] = temp1; // reuse the VCO1 block for the enveloped mix.
+	}
 
 	////////////////// do the IIR LPF ///////////////////////
 
-	IIRFilter( &filter, &temp1 );
+	IIRFilterBlock( &filter, vco1Block, samples );
 
 	/////////// now do the space delay function /////////////
 
 	// Get the number of buffer items we have, which is the delay.
 	MultiU16X16toH16Round( buffCount, (uint16_t)(sizeof(int16_t) * DELAY_BUFFER), synth.delay_time);
 
-	// Get a sample back from the delay buffer, some time later,
-	if( ringBuffer_GetCount(&delayBuffer) >= buffCount )
-	{
-		temp0.u8[1] = ringBuffer_Pop(&delayBuffer);
-		temp0.u8[0] = ringBuffer_Pop(&delayBuffer);
-	}
-	else // or else wait until we have samples available.
+	for (i = 0; i < samples; ++i)
 	{
-		temp0.i16 = 0;
-	}
+		temp1 = vco1Block[i];
 
-	if (synth.delay_time) // If the delay time is set to be non zero,
-	{
-		// do the space delay function, irrespective of whether a note is playing or not,
-		// and combine the output sample with the delayed sample.
-		temp1 += temp0.i16;
+		// Get a sample back from the delay buffer, some time later,
+		if( ringBuffer_GetCount(&delayBuffer) >= buffCount )
+		{
+			temp0.u8[1] = ringBuffer_Pop(&delayBuffer);
+			temp0.u8[0] = ringBuffer_Pop(&delayBuffer);
+		}
+		else // or else wait until we have samples available.
+		{
+			temp0.i16 = 0;
+		}
 
-		// multiply our sample by the feedback value
-		MultiSU16X16toH16Round(temp0.i16, temp1, synth.delay_feedback);
-	}
-	else
-		ringBuffer_Flush(&delayBuffer);	// otherwise flush the buffer if the delay is set to zero.
+		if (synth.delay_time) // If the delay time is set to be non zero,
+		{
+			// do the space delay function, irrespective of whether a note is playing or not,
+			// and combine the output sample with the delayed sample.
+			temp1 += temp0.i16;
 
-	// and push it into the delay buffer if buffer space is available
-	if( ringBuffer_GetCount(&delayBuffer) <= buffCount )
-	{
-		ringBuffer_Poke(&delayBuffer, temp0.u8[1]);
-		ringBuffer_Poke(&delayBuffer, temp0.u8[0]);
-	}
-	// else drop the space delay sample (probably because the delay has been reduced).
+			// multiply our sample by the feedback value
+			MultiSU16X16toH16Round(temp0.i16, temp1, synth.delay_feedback);
+		}
+		else
+			ringBuffer_Flush(&delayBuffer);	// otherwise flush the buffer if the delay is set to zero.
+
+		// and push it into the delay buffer if buffer space is available
+		if( ringBuffer_GetCount(&delayBuffer) <= buffCount )
+		{
+			ringBuffer_Poke(&delayBuffer, temp0.u8[1]);
+			ringBuffer_Poke(&delayBuffer, temp0.u8[0]);
+		}
+		// else drop the space delay sample (probably because the delay has been reduced).
 
-	////////////// Finally, set the output volume //////////////////
+		////////////// Finally, set the output volume //////////////////
 
-	// multiply our wave by the volume value
-	MultiSU16X16toH16Round(temp2, temp1, synth.master);
+		// multiply our wave by the volume value
+		MultiSU16X16toH16Round(temp2, temp1, synth.master);
 
-	// and output wave on both A & B channel, shifted to (+)ve values only because this is what the DAC needs.
-	*ch_A = *ch_B = temp2 + 0x7fff;
+		// and output wave on both A & B channel, shifted to (+)ve values only because this is what the DAC needs.
+		ch_A[i] = ch_B[i] = temp2 + 0x7fff;
+	}
 
 	// sample the MIDI Shield potentiometers to provide a physical control interface.
 	AudioCodec_ADC(&mod0Value, &mod1Value);
@@ -724,29 +687,36 @@ void FT_GUI()
 	FT_API_Write_CoCmd(CLEAR(1,1,1));
 
 	FT_API_Write_CoCmd(SAVE_CONTEXT());
-	FT_API_Write_CoCmd(COLOR_RGB(255,255,255));
-	FT_GPU_CoCmd_Text_P(phost,   4,  8, 27, OPT_CENTERY, PSTR("VCO 1"));
-	FT_GPU_CoCmd_Text_P(phost,   4,100, 27, OPT_CENTERY, PSTR("VCO 2"));
-	FT_GPU_CoCmd_Text_P(phost,   4,194, 27, OPT_CENTERY, PSTR("LFO"));
-	FT_GPU_CoCmd_Text_P(phost, 103, 18, 26, OPT_CENTER, PSTR("OCTAVE"));
-	FT_GPU_CoCmd_Text_P(phost, 103,111, 26, OPT_CENTER, PSTR("PITCH"));
-	FT_GPU_CoCmd_Text_P(phost, 103,204, 26, OPT_CENTER, PSTR("PITCH"));
-
-	FT_GPU_CoCmd_Text_P(phost, 203,  8, 27, OPT_CENTER, PSTR("MIXER"));
-	FT_GPU_CoCmd_Text_P(phost, 170, 25, 26, OPT_CENTER, PSTR("VCO 1"));
-	FT_GPU_CoCmd_Text_P(phost, 235, 25, 26, OPT_CENTER, PSTR("VCO 2"));
-	FT_GPU_CoCmd_Text_P(phost, 170, 95, 26, OPT_CENTER, PSTR("LFO"));
-	FT_GPU_CoCmd_Text_P(phost, 235, 95, 26, OPT_CENTER, PSTR("X MOD"));
 
-	FT_GPU_CoCmd_Text_P(phost, 300,  8, 27, OPT_CENTER, PSTR("VCF"));
-	FT_GPU_CoCmd_Text_P(phost, 300, 25, 26, OPT_CENTER, PSTR("CUTOFF"));
-	FT_GPU_CoCmd_Text_P(phost, 300, 95, 26, OPT_CENTER, PSTR("PEAK"));
-
-	FT_GPU_CoCmd_Text_P(phost, 365,  8, 27, OPT_CENTER, PSTR("DELAY"));
-	FT_GPU_CoCmd_Text_P(phost, 365, 25, 26, OPT_CENTER, PSTR("TIME"));
-	FT_GPU_CoCmd_Text_P(phost, 365, 95, 26, OPT_CENTER, PSTR("FEEDBACK"));
-
-	FT_GPU_CoCmd_Text_P(phost, 440,  8, 27, OPT_CENTER, PSTR("MASTER"));
+	/* The labels never change, so they're recorded once and then appended */
+	if( FT_API_Segment_Begin(&guiLabels, NULL, 0) )
+	{
+		FT_API_Write_CoCmd(COLOR_RGB(255,255,255));
+		FT_GPU_CoCmd_Text_P(phost,   4,  8, 27, OPT_CENTERY, PSTR("VCO 1"));
+		FT_GPU_CoCmd_Text_P(phost,   4,100, 27, OPT_CENTERY, PSTR("VCO 2"));
+		FT_GPU_CoCmd_Text_P(phost,   4,194, 27, OPT_CENTERY, PSTR("LFO"));
+		FT_GPU_CoCmd_Text_P(phost, 103, 18, 26, OPT_CENTER, PSTR("OCTAVE"));
+		FT_GPU_CoCmd_Text_P(phost, 103,111, 26, OPT_CENTER, PSTR("PITCH"));
+		FT_GPU_CoCmd_Text_P(phost, 103,204, 26, OPT_CENTER, PSTR("PITCH"));
+
+		FT_GPU_CoCmd_Text_P(phost, 203,  8, 27, OPT_CENTER, PSTR("MIXER"));
+		FT_GPU_CoCmd_Text_P(phost, 170, 25, 26, OPT_CENTER, PSTR("VCO 1"));
+		FT_GPU_CoCmd_Text_P(phost, 235, 25, 26, OPT_CENTER, PSTR("VCO 2"));
+		FT_GPU_CoCmd_Text_P(phost, 170, 95, 26, OPT_CENTER, PSTR("LFO"));
+		FT_GPU_CoCmd_Text_P(phost, 235, 95, 26, OPT_CENTER, PSTR("X MOD"));
+
+		FT_GPU_CoCmd_Text_P(phost, 300,  8, 27, OPT_CENTER, PSTR("VCF"));
+		FT_GPU_CoCmd_Text_P(phost, 300, 25, 26, OPT_CENTER, PSTR("CUTOFF"));
+		FT_GPU_CoCmd_Text_P(phost, 300, 95, 26, OPT_CENTER, PSTR("PEAK"));
+
+		FT_GPU_CoCmd_Text_P(phost, 365,  8, 27, OPT_CENTER, PSTR("DELAY"));
+		FT_GPU_CoCmd_Text_P(phost, 365, 25, 26, OPT_CENTER, PSTR("TIME"));
+		FT_GPU_CoCmd_Text_P(phost, 365, 95, 26, OPT_CENTER, PSTR("FEEDBACK"));
+
+		FT_GPU_CoCmd_Text_P(phost, 440,  8, 27, OPT_CENTER, PSTR("MASTER"));
+
+		FT_API_Segment_End(&guiLabels);
+	}
 
 	/* Now we have active widgets, so turn on the touch mask */
 	FT_API_Write_CoCmd(TAG_MASK(FT_TRUE));		// turn on the TAG_MASK Because these things have touch
@@ -845,29 +815,37 @@ void FT_GUI()
 	FT_GPU_CoCmd_Dial(phost, 440,55,26, OPT_3D, synth.master); // MASTER
 
 
-	/* Display the Keyboard */
+	/* Display the Keyboard, recorded again only when a different note is pressed */
 
-	FT_API_Write_CoCmd(COLOR_RGB(0xff,0xfa,0xe0));
-	FT_GPU_CoCmd_FgColor(phost, 0xfffae0);
-	FT_GPU_CoCmd_GradColor(phost, 0x1a1a1a);
+	if( FT_API_Segment_Begin(&guiKeyboard, &synth.note, sizeof(synth.note)) )
+	{
+		FT_API_Write_CoCmd(COLOR_RGB(0xff,0xfa,0xe0));
+		FT_GPU_CoCmd_FgColor(phost, 0xfffae0);
+		FT_GPU_CoCmd_GradColor(phost, 0x1a1a1a);
 
-	// no need to write touch tags for keys, because the TAG is set to the ASCII code for the key.
-	FT_GPU_CoCmd_Keys_P(phost, 137,160,340,110, 27, synth.note | OPT_3D, PSTR("CDEFGAB"));
+		// no need to write touch tags for keys, because the TAG is set to the ASCII code for the key.
+		FT_GPU_CoCmd_Keys_P(phost, 137,160,340,110, 27, synth.note | OPT_3D, PSTR("CDEFGAB"));
 
-	FT_API_Write_CoCmd(COLOR_RGB(0x1f,0x1f,0x1f));
-	FT_GPU_CoCmd_FgColor(phost, 0x1a1a1a);
-	FT_GPU_CoCmd_GradColor(phost, 0xffffff);
+		FT_API_Write_CoCmd(COLOR_RGB(0x1f,0x1f,0x1f));
+		FT_GPU_CoCmd_FgColor(phost, 0x1a1a1a);
+		FT_GPU_CoCmd_GradColor(phost, 0xffffff);
 
-	// no need to write touch tags for keys, because the TAG is set to the ASCII code for the key.
-	FT_GPU_CoCmd_Keys_P(phost, 169,160,30,45, 27, synth.note | OPT_3D, PSTR("c"));
-	FT_GPU_CoCmd_Keys_P(phost, 219,160,30,45, 27, synth.note | OPT_3D, PSTR("d"));
-	FT_GPU_CoCmd_Keys_P(phost, 316,160,30,45, 27, synth.note | OPT_3D, PSTR("f"));
-	FT_GPU_CoCmd_Keys_P(phost, 365,160,30,45, 27, synth.note | OPT_3D, PSTR("g"));
-	FT_GPU_CoCmd_Keys_P(phost, 414,160,30,45, 27, synth.note | OPT_3D, PSTR("a"));
+		// no need to write touch tags for keys, because the TAG is set to the ASCII code for the key.
+		FT_GPU_CoCmd_Keys_P(phost, 169,160,30,45, 27, synth.note | OPT_3D, PSTR("c"));
+		FT_GPU_CoCmd_Keys_P(phost, 219,160,30,45, 27, synth.note | OPT_3D, PSTR("d"));
+		FT_GPU_CoCmd_Keys_P(phost, 316,160,30,45, 27, synth.note | OPT_3D, PSTR("f"));
+		FT_GPU_CoCmd_Keys_P(phost, 365,160,30,45, 27, synth.note | OPT_3D, PSTR("g"));
+		FT_GPU_CoCmd_Keys_P(phost, 414,160,30,45, 27, synth.note | OPT_3D, PSTR("a"));
+
+		FT_API_Segment_End(&guiKeyboard);
+	}
 
 	/* Display a Button */
 
 	FT_API_Write_CoCmd(COLOR_RGB(0x1a,0x1a,0x1a));
+	FT_GPU_CoCmd_FgColor(phost, 0x1a1a1a);		// the co-processor colours aren't set by an appended keyboard.
+	FT_GPU_CoCmd_GradColor(phost, 0xffffff);
+
 	FT_API_Write_CoCmd(TAG(SETTINGS));
 	if (synth.settings_loaded)
 		FT_GPU_CoCmd_Button_P(phost, 415,95, 50,20, 26, OPT_3D, PSTR("STO"));
@@ -1265,8 +1243,7 @@ void get_line (uint8_t *buff, uint8_t len)
 	uint8_t i = 0;
 
 	for (;;) {
-		while ( ! xSerialGetChar( &xSerialPort, &c ))
-			vTaskDelay( 1 );
+		xSerialReadUntil( &xSerialPort, &c, 1, '\r', portMAX_DELAY ); // sleep until the next character arrives.
 
 		if (c == '\r') break;
 		if ((c == '\b') && i) {
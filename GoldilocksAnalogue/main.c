@@ -474,18 +474,18 @@ void audioCodec_dsp( uint16_t * ch_A,  uint16_t * ch_B)
 
 	/* Get the next character from the ring buffer. */
 
-	if( ringBuffer_IsEmpty( (ringBuffer_t*) &(xSerialPort.xRxedChars) ) )
+	if( ringBufferSPSC_IsEmpty( &(xSerialPort.xRxedChars) ) )
 	{
 		cn = 0x80 ^ 0x55; // put A-Law nulled signal on the output.
 	}
-	else if (ringBuffer_GetCount( &(xSerialPort.xRxedChars) ) > (portSERIAL_BUFFER_RX>>1) ) // if the buffer is more than half full.
+	else if (ringBufferSPSC_GetCount( &(xSerialPort.xRxedChars) ) > (portSERIAL_BUFFER_RX>>1) ) // if the buffer is more than half full.
 	{
-		cn = ringBuffer_Pop( (ringBuffer_t*) &(xSerialPort.xRxedChars) ); // pop two samples to catch up, discard first one.
-		cn = ringBuffer_Pop( (ringBuffer_t*) &(xSerialPort.xRxedChars) );
+		cn = ringBufferSPSC_Pop( &(xSerialPort.xRxedChars) ); // pop two samples to catch up, discard first one.
+		cn = ringBufferSPSC_Pop( &(xSerialPort.xRxedChars) );
 	}
 	else
 	{
-		cn = ringBuffer_Pop( (ringBuffer_t*) &(xSerialPort.xRxedChars) ); // pop a sample
+		cn = ringBufferSPSC_Pop( &(xSerialPort.xRxedChars) ); // pop a sample
 	}
 
 	alaw_expand1(&cn, &xn);	// expand the A-Law compression
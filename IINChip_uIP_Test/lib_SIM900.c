@@ -314,13 +314,13 @@ int8_t SIM900PowerOn(SIM900StateHandlePtr SIM900_State_Ptr, eCOMPort ePort, uint
 	{
 	case USART0:
 	    // turn on the serial port for communicating with the Arduino GSM Shield SIM900.
-		xSerialPort = xSerialPortInitMinimal( USART1, SIM900_RATE, command_buffer_size, packet_buffer_size); //  serial port: USART, WantedBaud, TxQueueLength, RxQueueLength (8n1)
+		xSerialPort = xSerialPortInitMinimal( USART1, SIM900_RATE, command_buffer_size, SIM900_BUFFER_SERIAL); //  serial port: USART, WantedBaud, TxQueueLength, RxQueueLength (8n1)
 		SIM900_State_Ptr->SIM900SerialPortPtr = &xSerialPort; // must point to xSerialPort, because the USART0 interrupt points there.
 		break;
 	case USART1:
 	default:
     // turn on the other serial port for communicating with the Arduino GSM Shield SIM900.
-	xSerial1Port = xSerialPortInitMinimal( USART1, SIM900_RATE, command_buffer_size, packet_buffer_size); //  serial port: USART, WantedBaud, TxQueueLength, RxQueueLength (8n1)
+	xSerial1Port = xSerialPortInitMinimal( USART1, SIM900_RATE, command_buffer_size, SIM900_BUFFER_SERIAL); //  serial port: USART, WantedBaud, TxQueueLength, RxQueueLength (8n1)
 	SIM900_State_Ptr->SIM900SerialPortPtr = &xSerial1Port; // must point to xSerial1Port, because the USART1 interrupt points there.
 		break;
 	}
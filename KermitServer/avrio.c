@@ -40,6 +40,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #ifndef O_WRONLY
 #ifdef X_OK
@@ -57,10 +58,10 @@ UCHAR i_buf[IBUFLEN+8];			/* File input buffer */
 int errno;
 
 /*
-  In this example, the output file is unbuffered to ensure that every
-  output byte is committed.  The input file, however, is buffered for speed.
-  This is just one of many possible implementation choices, invisible to the
-  Kermit protocol module.
+  In this example, both files are double buffered, and the buffers are read
+  ahead and written behind by a file task (below), so the serial link is not
+  stalled while the SD card is busy.  This is just one of many possible
+  implementation choices, invisible to the Kermit protocol module.
 */
 
 extern xComPortHandle xSerial1Port; /* Create a handle for the serial port. tty file device */
@@ -74,6 +75,9 @@ static FIL * ifile = (FIL *)0;	/* and pointers */
 static FATFS fat_fs;			// defining the structure for the filesystem
 static FIL file;				// this will be the file structure. only need one,
 								// as we'll either be reading or writing data to file, but not simultaneously.
+#ifdef F_SCAN
+static FIL scan_file;			// the file type scan, done by fileinfo() while the input file is open.
+#endif /* F_SCAN */
 
 /* Debugging */
 
@@ -155,7 +159,7 @@ dodebug(int fc, UCHAR * label, UCHAR * sval, long nval) {
 int
 devopen(char *device) {
 	// turn on the Serial 1 port to connect to the HP-48.
-	xSerial1Port = xSerialPortInitMinimal( USART1, 9600, IBUFLEN+8, OBUFLEN+8);
+	xSerial1Port = xSerialPortInitMinimal( USART1, 9600, TTYBUFLEN, TTYBUFLEN);
 	//  (serial port number, WantedBaud, TxQueueLength, RxQueueLength (8n1))
     return(1);
 }
@@ -242,18 +246,21 @@ inchk(struct k_data * k) {
 
 int
 readpkt(struct k_data * k, UCHAR *p, int len) {
+    ringBufferSPSC_t * rx = &(xSerial1Port.xRxedChars);
+    TickType_t timo;
+    uint16_t span, i;
+    uint8_t * s;
     uint8_t flag;
     int n;
 
     UCHAR x;
     UCHAR c;
 /*
-  Timeout not implemented in this sample.
-  It should not be needed.  All non-embedded Kermits that are capable of
-  making connections are also capable of timing out, and only one Kermit
-  needs to time out.  NOTE: This simple example waits for SOH and then
-  reads everything up to the negotiated packet terminator.  A more robust
-  version might be driven by the value of the packet-length field.
+  The bytes are scanned where the Rx interrupt put them, in the serial ring
+  buffer, and only the packet itself is copied out.  Between scans the task
+  sleeps until the Rx interrupt sees the packet terminator, so it wakes once
+  for each packet rather than for each byte.  If nothing arrives for the
+  negotiated timeout, return 0 so the Kermit module can NAK or resend.
 */
 #ifdef DEBUG
     char * p2;
@@ -269,47 +276,58 @@ readpkt(struct k_data * k, UCHAR *p, int len) {
 	return(-1);
     }
     flag = n = 0;                       /* Init local variables */
+    timo = (k->r_timo > 0) ? (TickType_t)(k->r_timo * configTICK_RATE_HZ) : portMAX_DELAY;
 
 #ifdef DEBUG
     p2 = (char *)p;
 #endif	/* DEBUG */
 
     while (1) {
-        //x = getchar();                  /* Replace this with real i/o */
-        xSerialGetChar( &xSerial1Port, &x );
-        c = (k->parity) ? x & 0x7f : x & 0xff; /* Strip parity */
+	while ((span = ringBufferSPSC_GetLinearSpan(rx, &s))) {
+	    for (i = 0; i < span; ) {
+		x = s[i++];
+		c = (k->parity) ? x & 0x7f : x & 0xff; /* Strip parity */
 
 #ifdef F_CTRLC
-	/* In remote mode only: three consecutive ^C's to quit */
-        if (k->remote && c == (UCHAR) 3) {
-            if (++ccn > 2) {
-		debug(DB_MSG,"readpkt ^C^C^C",0,0);
-		return(-1);
-	    }
-        } else {
-	    ccn = 0;
-	}
+		/* In remote mode only: three consecutive ^C's to quit */
+		if (k->remote && c == (UCHAR) 3) {
+		    if (++ccn > 2) {
+			ringBufferSPSC_Discard(rx, i);
+			debug(DB_MSG,"readpkt ^C^C^C",0,0);
+			return(-1);
+		    }
+		} else {
+		    ccn = 0;
+		}
 #endif /* F_CTRLC */
 
-        if (!flag && c != k->r_soh)	/* No start of packet yet */
-          continue;                     /* so discard these bytes. */
-        if (c == k->r_soh) {		/* Start of packet */
-            flag = 1;                   /* Remember */
-            continue;                   /* But discard. */
-        } else if (c == k->r_eom	/* Packet terminator */
-		   || c == '\012'	/* 1.3: For HyperTerminal */
-		   ) {
+		if (c == k->r_soh) {	/* Start of packet */
+		    flag = 1;		/* Remember */
+		    n = 0;		/* and start again */
+		} else if (!flag) {	/* No start of packet yet */
+		    continue;		/* so discard these bytes. */
+		} else if (c == k->r_eom	/* Packet terminator */
+			   || c == '\012'	/* 1.3: For HyperTerminal */
+			   ) {
+		    ringBufferSPSC_Discard(rx, i);
 #ifdef DEBUG
-            *p = NUL;                   /* Terminate for printing */
-	    debug(DB_PKT,"RPKT",p2,n);
+		    p[n] = NUL;		/* Terminate for printing */
+		    debug(DB_PKT,"RPKT",p2,n);
 #endif /* DEBUG */
-            return(n);
-        } else {                        /* Contents of packet */
-            if (n++ > k->r_maxlen)	/* Check length */
-              return(0);
-            else
-              *p++ = x & 0xff;
-        }
+		    return(n);
+		} else if (n > k->r_maxlen || n >= len) { /* Check length */
+		    ringBufferSPSC_Discard(rx, i);
+		    return(0);
+		} else {		/* Contents of packet */
+		    p[n++] = x & 0xff;
+		}
+	    }
+	    ringBufferSPSC_Discard(rx, span);
+	}
+	if (!xSerialWaitChar(&xSerial1Port, (uint16_t)(len - n), k->r_eom, timo)) {
+	    debug(DB_MSG,"readpkt timeout",0,0);
+	    return(0);
+	}
     }
     debug(DB_MSG,"READPKT FAIL (end)",0,0);
     return(-1);
@@ -329,13 +347,183 @@ int
 tx_data(struct k_data * k, UCHAR *p, int n) {
 
     uint16_t i = 0;
-	while(i < n)
-		if( !xSerialPutChar( &xSerial1Port, p[i++]) )
-				return(X_ERROR);        /* Failure */
+	while(i < n) {
+		i += xSerialPutBlock( &xSerial1Port, p + i, n - i ); // as much as fits in the Tx ring buffer,
+		if(i < n)
+			vTaskDelay( 1 );				// and wait for the rest of the window to drain.
+	}
     debug(DB_MSG,"tx_data write",0,n);
     return(X_OK);                       /* Success */
 }
 
+/*  F I L E   T A S K  --  Read ahead and write behind  */
+/*
+  The SD card is driven from its own task, so that file i/o and the serial
+  link are busy at the same time.  Each direction has two buffers.  While
+  Kermit packetises one input buffer, the file task reads the next one
+  ahead, and while Kermit decodes packets into one output buffer, the file
+  task writes the last one behind.  Buffers go to the file task on one queue
+  and come back, in the same order, on another.  Text mode line ends are
+  converted by the file task too.  Reading ahead starts at the first
+  readfile(), after sattr() has settled text or binary for the file.
+*/
+#define FIO_READ  1
+#define FIO_WRITE 2
+
+struct fio {				/* A buffer for the file task */
+    UCHAR op;				/* FIO_READ or FIO_WRITE */
+    UCHAR text;				/* Text mode, convert line ends */
+    UCHAR * buf;			/* Buffer */
+    int len;				/* Bytes to do, then bytes done or -1 */
+};
+
+static QueueHandle_t fioreq = NULL;	/* Buffers to the file task */
+static QueueHandle_t fiodone = NULL;	/* and back again */
+static TaskHandle_t fiotask = NULL;	/* The file task */
+static UCHAR * i_buf2;			/* Second file input buffer */
+static UCHAR * o_buf2;			/* Second file output buffer */
+static UCHAR * zinheld = (UCHAR *)0;	/* Input buffer Kermit is reading */
+static uint8_t fiopending = 0;		/* Buffers with the file task */
+static uint8_t fiostart = 0;		/* Input file open, not yet read */
+static int fioerror = X_OK;		/* I/O error, returned until close */
+
+static struct {				/* Pipeline statistics for one file */
+    uint16_t buffers;			/* Buffers through the file task */
+    uint16_t ready;			/* Done before Kermit wanted them */
+    uint16_t waits;			/* Kermit had to wait for the card */
+    TickType_t ticks;			/* Ticks Kermit spent waiting */
+    ULONG bytes;			/* Bytes read or written */
+} fiostat;
+
+static int
+fioread(UCHAR * buf, int len, UCHAR text) {
+    uint16_t cnt, i, n;
+    UCHAR * s, c;
+
+    if (!text) {			/* Binary - just read raw buffers */
+	if (f_read(ifile, buf, len, &cnt) != FR_OK)
+	  return(-1);
+	return(cnt);
+    }
+    s = buf + len / 2;			/* Text - read into the top half */
+    if (f_read(ifile, s, len / 2, &cnt) != FR_OK)
+      return(-1);
+    for (i = n = 0; i < cnt; i++) {	/* and expand down, CR before LF */
+	c = s[i];
+	if (c == '\n')
+	  buf[n++] = '\r';
+	buf[n++] = c;
+    }
+    return(n);
+}
+
+static int
+fiowrite(UCHAR * buf, int len, UCHAR text) {
+    uint16_t cnt, i, n;
+
+    if (text) {				/* Text mode, skip CRs */
+	for (i = n = 0; i < len; i++)
+	  if (buf[i] != (UCHAR)13)
+	    buf[n++] = buf[i];
+	len = n;
+    }
+    if (f_write(ofile, buf, len, &cnt) != FR_OK || cnt != len)
+      return(-1);
+    return(cnt);
+}
+
+static void
+fioloop(void * pv) {
+    struct fio x;
+
+    (void)pv;
+    for (;;) {
+	xQueueReceive(fioreq, &x, portMAX_DELAY);
+	if (x.op == FIO_READ)
+	  x.len = fioread(x.buf, x.len, x.text);
+	else
+	  x.len = fiowrite(x.buf, x.len, x.text);
+	xQueueSend(fiodone, &x, portMAX_DELAY);
+    }
+}
+
+/* Start the file task on first use, and clear the statistics for a file */
+
+static int
+fioinit(void) {
+    memset(&fiostat, 0, sizeof(fiostat));
+    fioerror = X_OK;
+    fiostart = 0;
+    zinheld = (UCHAR *)0;
+    if (fiotask)
+      return(X_OK);
+    if (!i_buf2 && !(i_buf2 = (UCHAR *)pvPortMalloc(IBUFLEN+8)))
+      return(X_ERROR);
+    if (!o_buf2 && !(o_buf2 = (UCHAR *)pvPortMalloc(OBUFLEN+8)))
+      return(X_ERROR);
+    if (!fioreq && !(fioreq = xQueueCreate(2, sizeof(struct fio))))
+      return(X_ERROR);
+    if (!fiodone && !(fiodone = xQueueCreate(2, sizeof(struct fio))))
+      return(X_ERROR);
+    if (xTaskCreate(fioloop, (const portCHAR *)"KermitIO", 256, NULL,
+		    uxTaskPriorityGet(NULL), &fiotask) != pdPASS) {
+	fiotask = NULL;
+	return(X_ERROR);
+    }
+    return(X_OK);
+}
+
+static void
+fiopost(UCHAR op, UCHAR * buf, int len, UCHAR text) {
+    struct fio x;
+
+    x.op = op;
+    x.text = text;
+    x.buf = buf;
+    x.len = len;
+    xQueueSend(fioreq, &x, portMAX_DELAY);
+    fiopending++;
+}
+
+/* Take back the oldest buffer from the file task, waiting if need be */
+
+static void
+fiowait(struct fio * x) {
+    TickType_t t;
+
+    if (xQueueReceive(fiodone, x, 0) == pdTRUE) {
+	fiostat.ready++;
+    } else {
+	fiostat.waits++;
+	t = xTaskGetTickCount();
+	xQueueReceive(fiodone, x, portMAX_DELAY);
+	fiostat.ticks += xTaskGetTickCount() - t;
+    }
+    fiopending--;
+    fiostat.buffers++;
+    if (x->len > 0)
+      fiostat.bytes += x->len;
+    else if (x->len < 0)
+      fioerror = X_ERROR;
+}
+
+/* Wait for the file task to finish, then report how the pipeline kept up */
+
+static void
+fiodrain(struct k_data * k, const char * what) {
+    struct fio x;
+
+    while (fiopending)
+      fiowait(&x);
+    debug(DB_LOG,"fio buffers",0,fiostat.buffers);
+    debug(DB_LOG,"fio ready",0,fiostat.ready);
+    debug(DB_LOG,"fio waits",0,fiostat.waits);
+    debug(DB_LOG,"fio ticks",0,fiostat.ticks);
+    xSerialPrintf_P(PSTR("\r\n%s %s: %lu bytes, %u buffers, %u ready, %u waited %u ticks\r\n"),
+		    what, k->filename ? (char *)k->filename : "", fiostat.bytes,
+		    fiostat.buffers, fiostat.ready, fiostat.waits, fiostat.ticks);
+}
+
 /*  O P E N F I L E  --  Open output file  */
 /*
   Call with:
@@ -353,21 +541,25 @@ openfile(struct k_data * k, UCHAR * s, int mode) {
     switch (mode) {
       case 1:					/* Read */
     	ifile = &file;
-		if (! f_open(ifile, s, FA_READ)) {
+		if (fioinit() != X_OK || f_open(ifile, s, FA_READ) != FR_OK) {
 			debug(DB_LOG,"openfile read error",s,0);
+			ifile = (FIL *)0;
 			return(X_ERROR);
 		}
 		k->s_first   = 1;			/* Set up for getkpt */
+		k->zinbuf    = i_buf;
 		k->zinbuf[0] = '\0';		/* Initialize buffer */
 		k->zinptr    = k->zinbuf;	/* Set up buffer pointer */
 		k->zincnt    = 0;			/* and count */
+		fiostart     = 1;			/* Read ahead from readfile() */
 		debug(DB_LOG,"openfile read ok",s,0);
 		return(X_OK);
 
       case 2:					/* Write (create) */
       	ofile = &file;
-		if (! f_open(ofile, s, FA_WRITE | FA_OPEN_ALWAYS)) {
+		if (fioinit() != X_OK || f_open(ofile, s, FA_WRITE | FA_OPEN_ALWAYS) != FR_OK) {
 			debug(DB_LOG,"openfile write error",s,0);
+			ofile = (FIL *)0;
 			return(X_ERROR);
 		}
 		debug(DB_LOG,"openfile write ok",s,0);
@@ -415,7 +607,7 @@ openfile(struct k_data * k, UCHAR * s, int mode) {
     Type set to 0 (text) or 1 (binary) if mode == 0.
 */
 #ifdef F_SCAN
-#define SCANBUF 1024
+#define SCANBUF 64				/* Static, the Kermit task stack is small */
 #define SCANSIZ 49152
 #endif /* F_SCAN */
 
@@ -427,7 +619,7 @@ fileinfo(struct k_data * k,
 
 #ifdef F_SCAN
     FIL * fp;				/* File scan pointer */
-    char inbuf[SCANBUF];		/* and buffer */
+    static char inbuf[SCANBUF];		/* and buffer */
 #endif /* F_SCAN */
 
     if (!buf)
@@ -435,9 +627,9 @@ fileinfo(struct k_data * k,
     buf[0] = '\0';
     if (buflen < 18)
       return(X_ERROR);
-    if ( !f_stat(filename, &statbuf) )
+    if (f_stat(filename, &statbuf) != FR_OK)
       return(X_ERROR);
-    fatfs_system(statbuf.ftime, statbuf.ftime, &timestamp);
+    fatfs_system(statbuf.fdate, statbuf.ftime, &timestamp);
     snprintf((char *)buf, buflen, "%04d%02d%02d %02d:%02d:%02d",
 	    timestamp.tm_year + 2000,
             timestamp.tm_mon,
@@ -460,21 +652,21 @@ fileinfo(struct k_data * k,
     if (!mode) {			/* File type determination requested */
 	int isbinary = 1;
 
-	fp = &file;
-	if (! f_open(fp, filename, FA_READ)) {/* Open the file for scanning */
+	fp = &scan_file;
+	if (f_open(fp, filename, FA_READ) != FR_OK) {/* Open the file for scanning */
 		debug(DB_LOG,"fileinfo read error", filename ,0 );
 		return(X_ERROR);
 	}
 	if (fp) {
-	    int n = 0, count = 0;
+	    UINT n = 0;
+	    ULONG count = 0;
 	    char c, * p;
 
 	    debug(DB_LOG,"fileinfo scan ", filename, 0);
 
 	    isbinary = 0;
 	    while (count < SCANSIZ && !isbinary) { /* Scan this much */
-		f_read(fp, &n,1 ,SCANBUF);
-		if (n == EOF || n == 0)
+		if (f_read(fp, inbuf, SCANBUF, &n) != FR_OK || n == 0)
 		  break;
 		count += n;
 		p = inbuf;
@@ -503,41 +695,45 @@ fileinfo(struct k_data * k,
 
 
 /*  R E A D F I L E  --  Read data from a file  */
+/*
+  Returns the next byte, -1 at end of file, or Z_ERROR if the file task
+  couldn't read it.
+*/
 
 int
 readfile(struct k_data * k) {
-	uint16_t cnt = 0;
+    struct fio x;
+
     if (!k->zinptr) {
 #ifdef DEBUG
 	f_printf(dp,(UCHAR *)"readfile ZINPTR NOT SET\n");
 #endif /* DEBUG */
 	return(X_ERROR);
     }
-    if (k->zincnt < 1) {		/* Nothing in buffer - must refill */
-	if (k->binary) {		/* Binary - just read raw buffers */
-	    k->dummy = 0;
-	    if(! f_read(ifile, k->zinbuf, k->zinlen, (uint16_t *)&(k->zincnt) ))
-	    	debug(DB_LOG,"readfile binary ok zincnt",0,k->zincnt);
-
-	} else {			/* Text mode needs LF/CRLF handling */
-	    int c;			/* Current character */
-	    for (k->zincnt = 0; (k->zincnt < (k->zinlen - 2)); (k->zincnt)++) {
-		f_read(ifile, &c, 1, &cnt);
-		if (c  == EOF || cnt == 0)
-		  break;
-		if (c == '\n')		/* Have newline? */
-		  k->zinbuf[(k->zincnt)++] = '\r'; /* Insert CR */
-		k->zinbuf[k->zincnt] = c;
-	    }
-#ifdef DEBUG
-	    k->zinbuf[k->zincnt] = '\0';
-	    debug(DB_LOG,"readfile text ok zincnt",0,k->zincnt);
-#endif /* DEBUG */
+    if (k->zincnt < 1) {		/* Nothing in buffer - take the next */
+	if (fioerror != X_OK)		/* Once a read has failed */
+	  return(Z_ERROR);		/* the file can't be finished */
+	if (fiostart) {			/* First time - read ahead into both */
+	    fiostart = 0;		/* now sattr() has set k->binary */
+	    fiopost(FIO_READ, i_buf, k->zinlen, !k->binary);
+	    fiopost(FIO_READ, i_buf2, k->zinlen, !k->binary);
+	} else if (zinheld) {		/* or read ahead into this one */
+	    fiopost(FIO_READ, zinheld, k->zinlen, !k->binary);
+	    zinheld = (UCHAR *)0;
 	}
-	k->zinbuf[k->zincnt] = '\0';	/* Terminate. */
-	if (k->zincnt == 0)		/* Check for EOF */
+	if (!fiopending)		/* Already at EOF */
 	  return(-1);
+	fiowait(&x);
+	if (x.len < 1) {		/* EOF or read error */
+	    k->zincnt = 0;
+	    return((x.len < 0) ? Z_ERROR : -1);
+	}
+	zinheld = x.buf;
+	k->zinbuf = x.buf;
+	k->zincnt = x.len;
+	k->zinbuf[k->zincnt] = '\0';	/* Terminate. */
 	k->zinptr = k->zinbuf;		/* Not EOF - reset pointer */
+	debug(DB_LOG,"readfile zincnt",0,k->zincnt);
     }
     (k->zincnt)--;			/* Return first byte. */
 
@@ -556,37 +752,28 @@ readfile(struct k_data * k) {
   Returns:
     X_OK on success
     X_ERROR on failure, such as i/o error, space used up, etc
+
+  The buffer is handed to the file task to be written behind, and Kermit
+  carries on decoding into the other output buffer.  So a write error is
+  returned on a later call, or by closefile().
 */
 int
 writefile(struct k_data * k, UCHAR * s, int n) {
-    uint16_t rc;
-    uint16_t cnt;
-    rc = X_OK;
+    struct fio x;
 
     debug(DB_LOG,"writefile binary",0,k->binary);
 
-    if (k->binary) {			/* Binary mode, just write it */
-		if (! f_write(ofile, s, n, &cnt))
-			debug(DB_LOG,"writefile binary ok zoutcnt", 0, cnt);
-		if( cnt != n) rc = X_ERROR;
-    } else {				/* Text mode, skip CRs */
-		UCHAR * p, * q;
-		uint16_t i;
-		q = s;
-
-		while (1)
-		{
-			for (p = q, i = 0; ((*p) && (*p != (UCHAR)13)); p++, i++) ;
-			if (i > 0)
-				if ( !f_write(ofile, q, i, &cnt))
-					debug(DB_LOG,"writefile text ok zoutcnt", 0, cnt);
-			if (cnt != i) rc = X_ERROR;
-			if (!*p)
-				break;
-			q = p+1;
-		}
+    if (n > 0)
+      fiopost(FIO_WRITE, s, n, !k->binary);
+    if (s == k->obuf) {			/* Swap to the other buffer */
+	k->obuf = (s == o_buf) ? o_buf2 : o_buf;
+	while (fiopending > 1)		/* once it has been written */
+	  fiowait(&x);
+    } else {				/* Not ours, write it now */
+	while (fiopending)
+	  fiowait(&x);
     }
-    return(rc);
+    return(fioerror);
 }
 
 /*  C L O S E F I L E  --  Close output file  */
@@ -608,8 +795,10 @@ closefile(struct k_data * k, UCHAR c, int mode) {
 		if ( !ifile )		/* If not not open */
 		  break;			/* do nothing but succeed */
 		debug(DB_LOG,"closefile (input)",k->filename,0);
-		if (! f_close(ifile))
+		fiodrain(k, "Read ahead");	/* Let the file task finish */
+		if (f_close(ifile) != FR_OK || fioerror != X_OK)
 		  rc = X_ERROR;
+		ifile = (FIL *)0;
 		break;
       case 2:				/* Closing output file */
       case 3:
@@ -617,7 +806,8 @@ closefile(struct k_data * k, UCHAR c, int mode) {
 		  break;			/* do nothing but succeed */
 		debug(DB_LOG,"closefile (output) name",k->filename,0);
 		debug(DB_LOG,"closefile (output) keep",0,k->ikeep);
-		if (!f_close(ofile)) {		/* Try to close */
+		fiodrain(k, "Write behind");	/* Let the file task finish */
+		if (f_close(ofile) != FR_OK || fioerror != X_OK) { /* Try to close */
 			rc = X_ERROR;
 		} else if ((k->ikeep == 0) &&	/* Don't keep incomplete files */
 			   (c == 'D')) {	/* This file was incomplete */
@@ -626,6 +816,7 @@ closefile(struct k_data * k, UCHAR c, int mode) {
 			f_unlink(k->filename);	/* Delete it. */
 			}
 		}
+		ofile = (FIL *)0;
 		break;
       default:
 		rc = X_ERROR;
@@ -85,6 +85,16 @@ void STATIC decstr(UCHAR *, struct k_data *, struct k_response *);
 void STATIC encode(int, int, struct k_data *);
 int STATIC nxtpkt(struct k_data *);
 int STATIC resend(struct k_data *);
+int STATIC kproc(short, struct k_data *, short, int, char *, struct k_response *);
+#ifdef F_TSW
+int STATIC rstash(struct k_data *, short, short, int, UCHAR *);
+#ifndef RECVONLY
+int STATIC swindow(struct k_data *, struct k_response *, short, char);
+int STATIC sfill(struct k_data *, struct k_response *);
+void STATIC sdrop(struct k_data *);
+int STATIC rslot(struct k_data *, short);
+#endif /* RECVONLY */
+#endif /* F_TSW */
 #ifdef DEBUG
 int xerror(void);
 #endif /* DEBUG */
@@ -97,6 +107,28 @@ kermit(short f,				/* Function code */
        char *msg,			/* Message for error packet */
        struct k_response *r) {		/* Response struct */
 
+    int rc;
+
+    rc = kproc(f,k,r_slot,len,msg,r);
+#ifdef F_TSW
+/*
+  Packets that arrived ahead of a missing one were kept in their window
+  slots.  Now that the one we wanted has been handled, handle any that follow
+  it, in order, as if they had just arrived.
+*/
+    while (f == K_RUN && rc == X_OK && k->what == W_RECV &&
+	   (r_slot = k->r_pw[k->r_seq]) > -1) {
+	k->r_pw[k->r_seq] = -1;
+	rc = kproc(K_RUN,k,r_slot,k->ipktinfo[r_slot].len,msg,r);
+    }
+#endif /* F_TSW */
+    return(rc);
+}
+
+STATIC int
+kproc(short f, struct k_data *k, short r_slot, int len, char *msg,
+      struct k_response *r) {
+
     int i, j, rc;			/* Workers */
     int datalen;            /* Length of packet data field */
     UCHAR *p;               /* Pointer to packet data field */
@@ -133,6 +165,8 @@ kermit(short f,				/* Function code */
 	    k->r_pw[i] = -1;		/* initialized to "no packets yet" */
 	    k->s_pw[i] = -1;		/* initialized to "no packets yet" */
 	}
+	k->r_acked = 0;
+	k->s_eof = 0;
 #endif /* F_TSW */
 
 /* Initialize the k_data structure */
@@ -259,6 +293,24 @@ kermit(short f,				/* Function code */
     else
       k->ipktinfo[r_slot].len = len;	/* Copy packet length to ipktinfo. */
 
+    if (k->what == W_RECV) {		/* If we're sending ACKs */
+	switch(k->cancel) {		/* Get cancellation code if any */
+	  case 0: s = (UCHAR *)0;   break;
+	  case 1: s = (UCHAR *)"X"; break;
+	  case 2: s = (UCHAR *)"Z"; break;
+	}
+    }
+#ifdef F_TSW
+    if ((k->r_acked = k->ipktinfo[r_slot].flg)) { /* Kept from the window */
+	k->ipktinfo[r_slot].flg = 0;	/* already checked and ACKd */
+	p = k->ipktinfo[r_slot].dat;
+	seq = k->ipktinfo[r_slot].seq;
+	t = k->ipktinfo[r_slot].typ;
+	datalen = len;
+	goto inorder;
+    }
+#endif /* F_TSW */
+
     if (len < 4) {			/* Packet obviously no good? */
 #ifdef RECVONLY
 	return(nak(k,k->r_seq,r_slot)); /* Send NAK for the packet we want */
@@ -272,14 +324,7 @@ kermit(short f,				/* Function code */
 
 /* Parse the packet */
 
-    if (k->what == W_RECV) {		/* If we're sending ACKs */
-	switch(k->cancel) {		/* Get cancellation code if any */
-	  case 0: s = (UCHAR *)0;   break;
-	  case 1: s = (UCHAR *)"X"; break;
-	  case 2: s = (UCHAR *)"Z"; break;
-	}
-    }
-    p = &(k->ipktbuf[0][r_slot]);	/* Point to it */
+    p = k->ipktbuf + r_slot * P_SLOTLEN; /* Point to it */
 
     q = p;                              /* Pointer to data to be checked */
     k->ipktinfo[r_slot].len = xunchar(*p++); /* Length field */
@@ -448,6 +493,20 @@ kermit(short f,				/* Function code */
     if (t == 'E')			/* (AND CLOSE FILES?) */
       return(X_ERROR);
 
+#ifdef F_TSW
+#ifndef RECVONLY
+    if (k->what == W_SEND && k->state == S_DATA && k->wslots > 1) {
+	if (t == 'Y' && (k->cancel || *p == 'X' || *p == 'Z')) {
+	    sdrop(k);			/* Forget the rest of the window */
+	    k->r_seq = seq;		/* and cancel below */
+	} else {
+	    freerslot(k,r_slot);
+	    return(swindow(k,r,seq,t));	/* ACK or NAK within the window */
+	}
+    }
+#endif /* RECVONLY */
+  inorder:
+#endif /* F_TSW */
     prev = k->r_seq - 1;		/* Get sequence of previous packet */
     if (prev < 0)
       prev = 63;
@@ -457,6 +516,17 @@ kermit(short f,				/* Function code */
 
     if (seq == k->r_seq) {		/* Is this the packet we want? */
 	k->ipktinfo[r_slot].rtr = 0;	/* Yes */
+#ifdef F_TSW
+    } else if (t == 'D' && k->what == W_RECV && k->wslots > 1 &&
+	       ((seq - k->r_seq) & 63) < k->wslots) { /* Ahead, in the window */
+	return(rstash(k,r_slot,seq,datalen,s));
+    } else if (t == 'D' && k->what == W_RECV && k->wslots > 1 &&
+	       ((k->r_seq - seq) & 63) <= k->wslots) { /* Already handled */
+	freerslot(k,r_slot);
+	if (k->opktbuf[2] == tochar(seq) && k->opktbuf[3] == 'Y')
+	  return(resend(k));		/* Our last ACK was lost */
+	return(spkt('Y',seq,0,(UCHAR *)0,k)); /* ACK it again */
+#endif /* F_TSW */
     } else {
         freerslot(k,r_slot);		/* No, discard it. */
 
@@ -565,13 +635,15 @@ kermit(short f,				/* Function code */
 	    r->status = S_ATTR;
 	} else
 #endif /* F_AT */
-	  if (sdata(k,r) == 0) {	/* No A packets - send first data */
+	  if ((rc = sdata(k,r)) == 0) {	/* No A packets - send first data */
 	    /* File is empty so send EOF packet */
 	    if ((rc = spkt('Z',k->s_seq,0,(UCHAR *)0,k)) != X_OK)
 	      return(rc);
 	    k->closef(k,*p,1);		/* Close input file*/
 	    k->state = S_EOF;		/* Wait for ACK to EOF */
 	    r->status = S_EOF;
+	} else if (rc < 0) {		/* Read or i/o error */
+	    return(rc);
 	} else {			/* Sent some data */
 	    k->state = S_DATA;		/* Wait for ACK to first data */
 	    r->status = S_DATA;
@@ -593,6 +665,8 @@ kermit(short f,				/* Function code */
 	debug(DB_LOG,"Seq",0,(k->s_seq));
 	debug(DB_LOG,"sdata()",0,rc);
 
+	if (rc < 0)			/* Read or i/o error */
+	  return(rc);
 	if (rc == 0) {			/* If there was no data to send */
 	    if ((rc = spkt('Z',k->s_seq,0,(UCHAR *)0,k)) != X_OK)
 	      return(rc);		/* Send EOF */
@@ -755,14 +829,14 @@ getrslot(struct k_data *k, short *n) {   /* Find a free packet buffer */
   indicates that the other Kermit got our ACK for THIS packet.
 */
     for (i = 0; i < P_WSLOTS; i++) {    /* Search */
-        if (k->ipktinfo[i].len < 1) {
+        if (k->ipktinfo[i].len < 1 && !k->ipktinfo[i].flg) {
             *n = i;                     /* Slot number */
             k->ipktinfo[i].len = -1;	/* Mark it as allocated but not used */
             k->ipktinfo[i].seq = -1;
             k->ipktinfo[i].typ = SPC;
             /* k->ipktinfo[i].rtr =  0; */  /* (see comment above) */
             k->ipktinfo[i].dat = (UCHAR *)0;
-            return(&(k->ipktbuf[0][i]));
+            return(k->ipktbuf + i * P_SLOTLEN);
         }
     }
     *n = -1;
@@ -772,17 +846,17 @@ getrslot(struct k_data *k, short *n) {   /* Find a free packet buffer */
 void					/* Initialize a window slot */
 freerslot(struct k_data *k, short n) {
     k->ipktinfo[n].len = 0;		/* Packet length */
+    k->ipktinfo[n].flg = 0;		/* Flags */
 #ifdef COMMENT
     k->ipktinfo[n].seq = 0;		/* Sequence number */
     k->ipktinfo[n].typ = (char)0;	/* Type */
     k->ipktinfo[n].rtr = 0;		/* Retry count */
-    k->ipktinfo[n].flg = 0;		/* Flags */
 #endif /* COMMENT */
 }
 
 UCHAR *
 getsslot(struct k_data *k, short *n) {   /* Find a free packet buffer */
-#ifdef COMMENT
+#ifdef F_TSW
     register int i;
     for (i = 0; i < P_WSLOTS; i++) {    /* Search */
         if (k->opktinfo[i].len < 1) {
@@ -792,7 +866,7 @@ getsslot(struct k_data *k, short *n) {   /* Find a free packet buffer */
             k->opktinfo[i].typ = SPC;
             k->opktinfo[i].rtr =  0;
             k->opktinfo[i].dat = (UCHAR *)0;
-            return(&(k->opktbuf[0][i]));
+            return(k->opktwin + i * P_SLOTLEN);
         }
     }
     *n = -1;
@@ -800,7 +874,7 @@ getsslot(struct k_data *k, short *n) {   /* Find a free packet buffer */
 #else
     *n = 0;
     return(k->opktbuf);
-#endif /* COMMENT */
+#endif /* F_TSW */
 }
 
 void                                    /* Initialize a window slot */
@@ -867,6 +941,7 @@ spkt(char typ, short seq, int len, UCHAR * data, struct k_data * k) {
 
     unsigned int crc;                   /* For building CRC */
     int i, j, lenpos, m, n, x;		/* Workers */
+    short slot = -1;			/* Window slot, if any */
     UCHAR * s, * buf;
 
     debug(DB_LOG,"spkt len 1",0,len);
@@ -876,7 +951,14 @@ spkt(char typ, short seq, int len, UCHAR * data, struct k_data * k) {
 	while (*s++) len++;
     }
     debug(DB_LOG,"spkt len 2",0,len);
-    buf = k->opktbuf;			/* Where to put packet (FOR NOW) */
+#ifdef F_TSW
+    if (typ == 'D' && k->wslots > 1) {	/* Data packets keep their own */
+	if (!(buf = getsslot(k,&slot)))	/* window slot until ACKd */
+	  return(X_ERROR);
+	k->s_pw[seq] = slot;
+    } else
+#endif /* F_TSW */
+    buf = k->opktbuf;			/* Where to put packet */
 
     i = 0;                              /* Packet buffer position */
     buf[i++] = k->s_soh;		/* SOH */
@@ -949,8 +1031,16 @@ spkt(char typ, short seq, int len, UCHAR * data, struct k_data * k) {
     buf[i++] = k->s_eom;		/* Packet terminator */
     buf[i] = '\0';			/* String terminator */
     k->s_seq = seq;                     /* Remember sequence number */
+    len = i;				/* Length to send */
 
-    k->opktlen = i;			/* Remember length for retransmit */
+#ifdef F_TSW
+    if (slot > -1) {			/* Remember slot for retransmit */
+	k->opktinfo[slot].len = len;
+	k->opktinfo[slot].seq = seq;
+	k->opktinfo[slot].typ = typ;
+    } else
+#endif /* F_TSW */
+    k->opktlen = len;			/* Remember length for retransmit */
 
 #ifdef DEBUG
 /* CORRUPT THE PACKET SENT BUT NOT THE ONE WE SAVE */
@@ -962,12 +1052,12 @@ spkt(char typ, short seq, int len, UCHAR * data, struct k_data * k) {
 	    break;
 	p[i-2] = 'X';
 	debug(DB_PKT,"XPKT",(char *)&p[1],0);
-	return((*(k->txd))(k,p,k->opktlen)); /* Send it. */
+	return((*(k->txd))(k,p,len)); /* Send it. */
     }
     debug(DB_PKT,"SPKT",(char *)&buf[1],0);
 #endif /* DEBUG */
 
-    return((*(k->txd))(k,buf,k->opktlen)); /* Send it. */
+    return((*(k->txd))(k,buf,len)); /* Send it. */
 }
 
 /*  N A K  --  Send a NAK (negative acknowledgement)  */
@@ -986,6 +1076,13 @@ nak(struct k_data * k, short seq, short slot) {
 STATIC int
 ack(struct k_data * k, short seq, UCHAR * text) {
     int len, rc;
+#ifdef F_TSW
+    if (k->r_acked) {			/* Already ACKd when it arrived */
+	k->r_acked = 0;
+	k->r_seq = (k->r_seq + 1) % 64;	/* so just bump the packet number */
+	return(X_OK);
+    }
+#endif /* F_TSW */
     len = 0;
     if (text) {                         /* Get length of data */
         UCHAR *p;
@@ -1105,6 +1202,9 @@ spar(struct k_data * k, UCHAR *s, int datalen) {
             if (k->window > 1)
               if (k->window > k->retry)   /* Retry limit must be greater */
                 k->retry = k->window + 1; /* than window size. */
+#ifdef F_TSW
+            k->wslots = k->window;	/* Use the whole window */
+#endif /* F_TSW */
         }
     }
 #endif /* F_SW */
@@ -1452,7 +1552,8 @@ getpkt(struct k_data *k, struct k_response *r) { /* Fill a packet from file */
 	if (c < 0) {			/* Watch out for empty file. */
 	    debug(DB_CHR,"getpkt first c",0,c);
 	    k->s_first = -1;
-	    return(k->size = 0);
+	    k->size = 0;
+	    return((c == Z_ERROR) ? X_ERROR : 0); /* or a read error */
 	}
 	r->sofar++;
 	debug(DB_LOG,"getpkt first c",0,c);
@@ -1481,7 +1582,12 @@ getpkt(struct k_data *k, struct k_response *r) { /* Fill a packet from file */
 	    if (k->dummy) debug(DB_LOG,"DUMMY CLOBBERED B",0,k->dummy);
 #endif /* DEBUG */
 	}
-	if (next < 0) {			/* If none, we're at EOF. */
+	if (next == Z_ERROR) {		/* Read error, not EOF, */
+	    k->s_first = -1;		/* so don't send a short file */
+	    k->s_remain[0] = '\0';
+	    k->size = 0;
+	    return(X_ERROR);
+	} else if (next < 0) {		/* If none, we're at EOF. */
 	    k->s_first = -1;
 	} else {			/* Otherwise */
 	    r->sofar++;			/* count this byte */
@@ -1517,6 +1623,11 @@ sdata(struct k_data *k,struct k_response *r) { /* Send a data packet */
     }
     len = getpkt(k,r);			/* Fill data field from input file */
     debug(DB_LOG,"sdata getpkt",0,len);
+    if (len < 0) {			/* Read error */
+	epkt("File read error",k);	/* Tell the receiver, so it */
+	k->closef(k,0,1);		/* doesn't keep a short file */
+	return(X_ERROR);
+    }
     if (len < 1)
       return(0);
     rc = spkt('D',k->s_seq,len,k->xdata,k); /* Send the packet */
@@ -1614,9 +1725,148 @@ nxtpkt(struct k_data * k) {		/* Get next packet to send */
 STATIC int
 resend(struct k_data * k) {
     UCHAR * buf;
+#ifdef F_TSW
+#ifndef RECVONLY
+    short x;
+    if (k->what == W_SEND && (x = k->s_pw[k->r_seq]) > -1)
+      return(rslot(k,x));		/* Oldest data packet not ACKd */
+#endif /* RECVONLY */
+#endif /* F_TSW */
     if (!k->opktlen)			/* Nothing to resend */
       return(X_OK);
     buf = k->opktbuf;
     debug(DB_PKT,">PKT",&buf[1],k->opktlen);
     return((*(k->txd))(k,buf,k->opktlen));
 }
+
+#ifdef F_TSW
+/*  R S T A S H  --  Keep a packet that arrived ahead of the one we want  */
+/*
+  The packet is ACKd and kept in its slot, and the packets missing before it
+  are NAKd, back to the last one that was kept.  kermit() handles the kept
+  packets in order once the missing ones arrive.
+*/
+STATIC int
+rstash(struct k_data * k, short r_slot, short seq, int datalen, UCHAR * s) {
+    short n;
+    int rc, len;
+
+    if (k->r_pw[seq] > -1) {		/* Already have it, */
+	freerslot(k,r_slot);		/* so our ACK was lost. */
+	return(spkt('Y',seq,0,(UCHAR *)0,k));
+    }
+    k->r_pw[seq] = r_slot;		/* Keep it */
+    k->ipktinfo[r_slot].len = datalen;
+    k->ipktinfo[r_slot].flg = 1;
+
+    len = 0;				/* ACK it, with any cancellation */
+    if (s)
+      for ( ; s[len]; len++) ;
+    if ((rc = spkt('Y',seq,len,s,k)) != X_OK)
+      return(rc);
+
+    n = seq;
+    do {				/* NAK the missing ones */
+	n = (n - 1) & 63;
+	if (k->r_pw[n] > -1)
+	  break;
+	if ((rc = spkt('N',n,0,(UCHAR *)0,k)) != X_OK)
+	  return(rc);
+    } while (n != k->r_seq);
+    debug(DB_LOG,"rstash seq",0,seq);
+    return(X_OK);
+}
+
+#ifndef RECVONLY
+/*  S W I N D O W  --  Handle an ACK or NAK for a window of data packets  */
+/*
+  k->r_seq is the oldest data packet not yet ACKd, and k->s_seq the newest
+  sent.  An ACK frees its packet's slot and slides the window past any that
+  are ACKd, a NAK resends just that packet, and the window is then refilled.
+*/
+STATIC int
+swindow(struct k_data * k, struct k_response * r, short seq, char t) {
+    short n, x;
+
+    n = (k->s_seq - k->r_seq + 1) & 63;	/* Packets outstanding */
+
+    if (t == 'N') {
+	if (((seq - k->r_seq) & 63) < n && (x = k->s_pw[seq]) > -1)
+	  return(rslot(k,x));		/* Resend the one NAKd */
+	if (seq != ((k->s_seq + 1) & 63)) /* A NAK for the next one */
+	  return(X_OK);			/* is an ACK for all the others */
+	sdrop(k);
+    } else if (t == 'Y') {
+	if (((seq - k->r_seq) & 63) >= n || (x = k->s_pw[seq]) < 0)
+	  return(X_OK);			/* Not outstanding, ignore */
+	freesslot(k,x);
+	k->s_pw[seq] = -1;
+	while (k->r_seq != ((k->s_seq + 1) & 63) && k->s_pw[k->r_seq] < 0)
+	  k->r_seq = (k->r_seq + 1) & 63; /* Slide the window */
+    } else {
+	return(resend(k));
+    }
+    return(sfill(k,r));
+}
+
+/*  S F I L L  --  Send data packets until the window is full  */
+/*
+  At the end of the file, the EOF packet waits until every data packet
+  has been ACKd.
+*/
+STATIC int
+sfill(struct k_data * k, struct k_response * r) {
+    int rc;
+
+    while (!k->s_eof && ((k->s_seq - k->r_seq + 1) & 63) < k->wslots) {
+	nxtpkt(k);
+	if ((rc = sdata(k,r)) < 0)
+	  return(rc);
+	if (rc == 0) {			/* No more data */
+	    k->s_seq = (k->s_seq - 1) & 63;
+	    k->s_eof = 1;
+	}
+    }
+    if (k->s_eof && k->r_seq == ((k->s_seq + 1) & 63)) { /* All ACKd */
+	k->s_eof = 0;
+	nxtpkt(k);
+	if ((rc = spkt('Z',k->s_seq,0,(UCHAR *)0,k)) != X_OK)
+	  return(rc);			/* Send EOF */
+	k->closef(k,0,1);		/* Close input file */
+	k->state = S_EOF;		/* And wait for ACK */
+	r->status = S_EOF;
+	k->r_seq = k->s_seq;
+    }
+    return(X_OK);
+}
+
+/*  S D R O P  --  Free the slots of all outstanding data packets  */
+
+STATIC void
+sdrop(struct k_data * k) {
+    short x;
+
+    for ( ; k->r_seq != ((k->s_seq + 1) & 63); k->r_seq = (k->r_seq + 1) & 63)
+      if ((x = k->s_pw[k->r_seq]) > -1) {
+	  freesslot(k,x);
+	  k->s_pw[k->r_seq] = -1;
+      }
+    k->s_eof = 0;
+}
+
+/*  R S L O T  --  Resend the data packet in a window slot  */
+
+STATIC int
+rslot(struct k_data * k, short n) {
+    UCHAR * buf;
+
+    if (k->opktinfo[n].rtr++ > k->retry) {
+	epkt("Too many retries", k);
+	return(X_ERROR);
+    }
+    buf = k->opktwin + n * P_SLOTLEN;
+    debug(DB_PKT,">PKT",&buf[1],k->opktinfo[n].len);
+    return((*(k->txd))(k,buf,k->opktinfo[n].len));
+}
+#endif /* RECVONLY */
+#endif /* F_TSW */
@@ -63,6 +63,7 @@
 #define NO_LP
 #define NO_AT
 #define NO_CTRLC
+#define NO_TSW
 #define NO_SSW
 #define NO_CRC
 #define NO_SCAN
@@ -81,9 +82,13 @@
 #define F_CTRLC              /* 3 consecutive Ctrl-C's to quit */
 #endif	/* NO_CTRLC */
 
+#ifndef NO_TSW
+#define F_TSW				/* True sliding windows */
+#else
 #ifndef NO_SSW
 #define F_SSW				/* Simulated sliding windows */
 #endif	/* NO_SSW */
+#endif	/* NO_TSW */
 
 #ifndef NO_SCAN
 #define F_SCAN				/* Scan files for text/binary */
@@ -98,6 +103,11 @@
   really don't.  This allows the sender to send to us in a steady stream, and
   works just fine except that error recovery is via go-back-to-n rather than
   selective repeat.
+
+  F_TSW is selective repeat.  Packets that arrive ahead of a missing one are
+  ACKd and kept in their window slots, and only the missing ones are NAKd.
+  When sending, each data packet keeps its slot until it is ACKd, and only NAKd
+  or timed out packets are sent again.  Only data packets are windowed.
 */
 
 #ifdef COMMENT                          /* None of the following ... */
@@ -106,7 +116,6 @@
   - = Partially implemented but doesn't work
   0 = Not implemented
 */
-  #define F_TSW                         /* - True sliding windows */
   #define F_LS                          /* 0 Locking shifts */
   #define F_RS                          /* 0 Recovery */
 
@@ -174,11 +183,7 @@
 
 #ifndef P_WSLOTS
 #ifdef F_SW                 /* Window slots */
-#ifdef F_TSW				/* True window slots */
-#define P_WSLOTS    4		/* Max is 4 */
-#else
-#define P_WSLOTS   31		/* Simulated max is 31 */
-#endif /* F_TSW */
+#define P_WSLOTS   31		/* Max is 31 */
 #else
 #define P_WSLOTS    1
 #endif /* F_SW */
@@ -192,6 +197,8 @@
 #endif /* F_LP */
 #endif /* P_PKTLEN */
 
+#define P_SLOTLEN (P_PKTLEN+8)		/* Length of each packet window slot */
+
 /* Generic On/Off values */
 
 #define OFF         0
@@ -279,6 +286,10 @@
 #define X_DONE      3                   /* Done */
 #define X_STATUS    4                   /* Status report */
 
+/* readf() returns a byte, -1 at end of file, or */
+
+#define Z_ERROR    -2                   /* File read error */
+
 /* Interruption codes */
 
 #define I_FILE      1					/* Cancel file */
@@ -336,20 +347,19 @@ struct k_data {                         /* The Kermit data structure */
     USHORT crctb[16];					/* CRC generation table B */
 #endif /* F_CRC */
     UCHAR s_remain[6];			 		/* Send data leftovers */
-    UCHAR ipktbuf[P_PKTLEN+8][P_WSLOTS]; /* Buffers for incoming packets */
+    UCHAR * ipktbuf;				/* P_WSLOTS slots for incoming packets */
     struct packet ipktinfo[P_WSLOTS];    /* Incoming packet info */
-#ifdef COMMENT
-    UCHAR opktbuf[P_PKTLEN+8][P_WSLOTS]; /* Buffers for outbound packets */
-#else
     UCHAR opktbuf[P_PKTLEN+8];		/* Outbound packet buffer */
     int opktlen;					/* Outbound packet length */
     UCHAR xdatabuf[P_PKTLEN+2];		/* Buffer for building data field */
-#endif /* COMMENT */
     struct packet opktinfo[P_WSLOTS];	/* Outbound packet info */
     UCHAR * xdata;					/* Pointer to data field of outpkt */
 #ifdef F_TSW
+    UCHAR * opktwin;				/* P_WSLOTS slots for outbound data packets */
     short r_pw[64];					/* Packet Seq.No. to window-slot map */
     short s_pw[64];					/* Packet Seq.No. to window-slot map */
+    short r_acked;					/* Packet being handled was ACKd on arrival */
+    short s_eof;					/* No more data, send EOF when window drains */
 #endif /* F_TSW */
     UCHAR ack_s[IDATALEN];			/* Our own init parameter string */
     UCHAR * obuf;
@@ -368,6 +368,19 @@ void TaskKermit(void *pvParameters) // Operate the Kermit Server
     k.obuflen = OBUFLEN;		/* File output buffer length */
     k.obufpos = 0;			    /* File output buffer position */
 
+/*
+  The packet window slots are on the heap, which puts them in XRAM where
+  there is XRAM, so the window can be as large as P_WSLOTS allows.
+*/
+    k.ipktbuf = (UCHAR *)pvPortMalloc( P_WSLOTS * P_SLOTLEN ); /* Incoming packets */
+    if (!k.ipktbuf)
+      doexit(FAILURE);
+#ifdef F_TSW
+    k.opktwin = (UCHAR *)pvPortMalloc( P_WSLOTS * P_SLOTLEN ); /* Outbound data packets */
+    if (!k.opktwin)
+      doexit(FAILURE);
+#endif /* F_TSW */
+
 /* Fill in function pointers */
 
     k.rxd    = readpkt;			/* for reading packets */
@@ -419,7 +432,7 @@ void TaskKermit(void *pvParameters) // Operate the Kermit Server
 */
         inbuf = getrslot(&k,&r_slot);	/* Allocate a window slot */
         rx_len = k.rxd(&k,inbuf,P_PKTLEN); /* Try to read a packet */
-        debug(DB_PKT,"main packet",&(k.ipktbuf[0][r_slot]),rx_len);
+        debug(DB_PKT,"main packet",inbuf,rx_len);
 /*
   For simplicity, kermit() ACKs the packet immediately after verifying it was
   received correctly.  If, afterwards, the control program fails to handle the
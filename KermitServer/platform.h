@@ -24,7 +24,9 @@
 #define OBUFLEN 180
 
 #define P_PKTLEN 128
-#define P_WSLOTS  4			/* Max is 4 Sliding Window Slots*/
+#define P_WSLOTS  4			/* Sliding Window Slots, on the heap in internal SRAM */
+
+#define TTYBUFLEN 256		/* Serial ring buffers, a power of two */
 #endif
 
 
@@ -40,8 +42,12 @@
 #define OBUFLEN  4096       // File output buffer size
 #endif /* OBUFLEN */
 
+#ifndef TTYBUFLEN			// to be the size of the serial ring buffers, a power of two.
+#define TTYBUFLEN 1024		// Serial Tx and Rx ring buffer size, holding several whole packets
+#endif /* TTYBUFLEN */
+
 #ifndef FN_MAX 				// to be the maximum length for a filename.
-#define FN_MAX   _MAX_LFN
+#define FN_MAX   FF_MAX_LFN
 #endif /* FN_MAX */
 
 #ifndef	P_PKTLEN 			// to override the default maximum packet length.
@@ -49,6 +55,10 @@
 #endif /* P_PKTLEN */
 
 #ifndef P_WSLOTS 			//to override the default maximum window slots.
-#define P_WSLOTS 1
+#if defined(portEXT_RAM) && !defined(portEXT_RAMFS)
+#define P_WSLOTS 31			// window slots are on the heap, in XRAM, so use the largest window.
+#else
+#define P_WSLOTS 4
+#endif
 #endif /* P_WSLOTS */
 
@@ -228,94 +228,27 @@ static void TaskWebServer (void *pvParameters) // Web Server
 {
     (void) pvParameters;
 
-	SOCKET ch;
-	uint16_t len;
-
 	vTaskSuspend( NULL );	// suspend ourselves, until we have IP address, etc.
 							// vTaskResume() found in DHCP task.
 
-	// Initialise the HTTPD socket on the w5200
-	if(!init_HTTP(HTTP_PREFERRED_SOCKET)) // initialise the socket for HTTP service
+	// Initialise the HTTPD sockets on the w5x00, so several clients can be served concurrently.
+	if(!init_HTTP_server(HTTP_MAX_SOCKETS)) // initialise the sockets for HTTP service
 		xSerialPrint_P(PSTR("HTTPD socket assignment or buffer malloc failed..!\r\n"));
 
-	ch = get_HTTP_socket();
+	// initialise the SD card, and move to the http root directory.
+	// The volume stays mounted, so the FatFs window and current directory remain valid between requests.
+	put_rc(f_mount(&Fatfs[HTTP_FS], (const TCHAR *)"", 1));
+	put_rc(f_chdir((const TCHAR *)HTTP_PATH) );
 
 //    eeprom_update_dword(&pagesServed, 0);	// reset (zero) the non-volatile counter for the pages served
 
 	while (1)
 	{
+		if( !serve_HTTP() )	// serve any requests waiting on each of the sockets,
+			wait_HTTP(  HTTP_POLL_PERIOD / portTICK_PERIOD_MS );	// and only wait when no socket was busy, until a socket event.
+		else
+			xSerialPrintf_P(PSTR("Pages:%u\r\n"), eeprom_read_dword(&pagesServed) );
 
-		switch(getSn_SR(ch))
-		{
-		case SOCK_LISTEN:
-#ifdef WEB_DEBUG
-//			xSerialPrintf_P(PSTR("HTTP_SOCK_LISTEN : %d\r\n"),ch);	// listen on the current port. very noisy
-#endif
-			vTaskDelay(  32 / portTICK_PERIOD_MS );
-			break;
-
-		case SOCK_ESTABLISHED:
-#ifdef WEB_DEBUG
-			xSerialPrintf_P(PSTR("HTTP_SOCK_ESTABLISHED %d : Connected by %s(%u)\r\n"),ch,inet_ntoa(GetDestAddr(ch)),GetDestPort(ch));
-#endif
-			if ((len = getSn_RX_RSR(ch)) > 0)
-			{
-#ifdef WEB_DEBUG
-				xSerialPrintf_P(PSTR("HTTP_SOCK_ESTABLISHED %d : Connected by %s(%u)\r\n"),ch,inet_ntoa(GetDestAddr(ch)),GetDestPort(ch));
-				xSerialPrintf_P(PSTR("HTTP_REQUEST Length %u\r\n"), len);
-#endif
-
-				if (len > MAX_URI_SIZE) len = MAX_URI_SIZE;
-				len = recv(ch, (uint8_t*)pHTTPRequest, len);
-				*(((uint8_t*)pHTTPRequest)+len) = 0;
-
-				xSerialPrintf_P(PSTR("HTTP_REQUEST Data Received Length %u from %s(%u)\r\n"), len, inet_ntoa(GetDestAddr(ch)), GetDestPort(ch));
-
-				// initialise the SD card, and move to the http root directory.
-				put_rc(f_mount(&Fatfs[HTTP_FS], (const TCHAR *)"", 1));
-				put_rc(f_chdir((const TCHAR *)HTTP_PATH) );
-
-				vTaskSuspend( xTaskDHCP );	// suspend DHCP, until we process the web page.
-
-				process_HTTP(ch, (uint8_t*)pHTTPRequest, len);	// request is processed
-
-				vTaskResume( xTaskDHCP );   // resume the DHCP task.
-
-				put_rc(f_mount(NULL, (const TCHAR *)"", 1));
-				disconnect(ch);
-
-				xSerialPrintf_P(PSTR("Pages:%u\r\n"), eeprom_read_dword(&pagesServed) );
-			}
-			break;
-
-
-		case SOCK_CLOSE_WAIT:
-			disconnect(ch);
-#ifdef WEB_DEBUG
-			xSerialPrintf_P(PSTR("HTTP_SOCK_CLOSE_WAIT : %u\r\n"),ch);	// if a peer requests to close the current connection
-#endif
-			break;
-
-		case SOCK_INIT:
-			listen(ch);
-#ifdef WEB_DEBUG
-			xSerialPrintf_P(PSTR("HTTP_SOCK_INIT : %u\r\n"),ch);	// if we want to wait for a peer to establish a new connection
-#endif
-			break;
-
-		case SOCK_CLOSED:
-			if( !socket(ch,Sn_MR_TCP,IP_PORT_HTTP,0x00) )    // reinitialize the socket
-			{
-				xSerialPrintf_P(PSTR("HTTP_SOCK : %u : Failed to create socket.\r\n"),ch);
-			} else {
-				xSerialPrintf_P(PSTR("HTTP_SOCK : %u : Web Server Started.\r\n"),ch);
-			}
-			break;
-
-		default:
-			break;
-
-		}	// end of switch
 //		xSerialPrintf_P(PSTR("Web Server HighWater @ %u\r\n"), uxTaskGetStackHighWaterMark(NULL));
 //		xSerialPrintf_P(PSTR("Free Heap Size: %u\r\n"),xPortGetFreeHeapSize() ); // needs heap_1, heap_2, or heap_4 for this function to succeed.
 	}
@@ -348,6 +281,10 @@ static void TaskDHCP(void *pvParameters) // DHCP Client
 	// Initialise the W5100 & SPI bus
 	init_DHCP_client(DHCP_PREFERRED_SOCKET,0,0);
 
+	// Deliver the socket events from the INTn service task, above the DHCP and WebServer tasks that wait for them.
+	if( !socket_event_init( 3 ) )
+		xSerialPrint_P(PSTR("\r\nSocket events failed..!\r\n"));
+
 	// Get DHCP IP assignment
 	while( !getIP_DHCPS())
 	{
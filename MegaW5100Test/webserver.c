@@ -49,8 +49,9 @@ static uint16_t replace_sys_env_value(uint8_t* base, uint16_t len);	// Replace H
 
 /**
  @brief	Analyse HTTP request and then services WEB.
+ @return 1 if the whole response was sent, or 0 if it fell short, so a persistent connection can't be kept.
 */
-void process_HTTP(
+uint8_t process_HTTP(
 	SOCKET s, 			/**< http server socket */
 	uint8_t * buffer, 	/**< buffer pointer included http request */
 	uint16_t length		/**< length of http request */
@@ -58,6 +59,8 @@ void process_HTTP(
 {
 	uint8_t * name;
 	uint16_t bytes_read;
+	uint32_t bytes_sent = 0;
+	uint8_t complete = 0;
 	TickType_t wait_send;
 	FIL source_file;	/* File object for the source file */
 
@@ -94,16 +97,16 @@ void process_HTTP(
 				xSerialPrintf_P(PSTR("HTTP Response...\r\n%s\r\nResponse Size: %u \r\n"), pHTTPResponse, strlen_P(ERROR_HTML_PAGE));
 #endif
 
-				send( s, (const uint8_t*)pHTTPResponse, strlen_P(ERROR_HTML_PAGE));
+				complete = ( send( s, (const uint8_t*)pHTTPResponse, strlen_P(ERROR_HTML_PAGE)) == strlen_P(ERROR_HTML_PAGE) );
 
 			}
 			else
 			{	// if file open success
 
-				make_HTTP_response_header( pHTTPResponse, pHTTPRequest->TYPE, source_file.fsize);
+				make_HTTP_response_header( pHTTPResponse, pHTTPRequest->TYPE, f_size(&source_file));
 
 #ifdef WEB_DEBUG
-				xSerialPrintf_P(PSTR("HTTP Opened file: %s  Source Size: %u \r\n"), name, source_file.fsize);
+				xSerialPrintf_P(PSTR("HTTP Opened file: %s  Source Size: %lu \r\n"), name, (uint32_t)f_size(&source_file));
 				xSerialPrintf_P(PSTR("HTTP Response Header...\r\n%s\r\nResponse Header Size: %u \r\n"), pHTTPResponse, strlen((char*)pHTTPResponse ));
 #endif
 
@@ -124,7 +127,19 @@ void process_HTTP(
 					vTaskDelay( 0 ); // yield until next tick.
 				}
 
-				for (;;)
+#if FF_USE_FORWARD
+				if (pHTTPRequest->METHOD != METHOD_HEAD && pHTTPRequest->TYPE != PTYPE_HTML)
+				{	// nothing to substitute, so stream the file straight from the sector window into the Tx buffer.
+					if ((bytes_sent = sendfile(s, &source_file, f_size(&source_file))) != f_size(&source_file))
+					{
+#ifdef WEB_DEBUG
+						xSerialPrint_P(PSTR("HTTP Response body send fail\r\n"));
+#endif
+					}
+				}
+				else
+#endif
+				while (pHTTPRequest->METHOD != METHOD_HEAD)	// HEAD gets the header only, so a persistent connection stays in step.
 				{
 					if ( f_read(&source_file, pHTTPResponse, (sizeof(uint8_t)*(FILE_BUFFER_SIZE) ), &bytes_read) || bytes_read == 0 )
 						break;   // read error or reached end of file
@@ -138,6 +153,8 @@ void process_HTTP(
 					if (send(s, (const uint8_t*)pHTTPResponse, bytes_read) != bytes_read)
 						break;  // TCP/IP send error
 
+					bytes_sent += bytes_read;	// short of the chunk read, if a stray $ cut it off.
+
 					wait_send = xTaskGetTickCount();
 
 					while(getSn_TX_FSR(s)!= WIZCHIP_getTxMAX(s))
@@ -153,6 +170,8 @@ void process_HTTP(
 						vTaskDelay( 0 ); // yield until next tick.
 					}
 				}
+				complete = ( pHTTPRequest->METHOD == METHOD_HEAD || bytes_sent == f_size(&source_file) );	// all of the Content-Length.
+
 				f_close(&source_file);
 
 				eeprom_busy_wait();
@@ -169,13 +188,15 @@ void process_HTTP(
 			xSerialPrintf_P(PSTR("HTTP Response...\r\n%s\r\nResponse Size: %u \r\n"), pHTTPResponse, strlen_P(ERROR_REQUEST_PAGE));
 #endif
 
-			send( s, (const uint8_t*)pHTTPResponse, strlen_P(ERROR_REQUEST_PAGE));
+			complete = ( send( s, (const uint8_t*)pHTTPResponse, strlen_P(ERROR_REQUEST_PAGE)) == strlen_P(ERROR_REQUEST_PAGE) );
 
 			break;
 
 		default :
 			break;
 	}
+
+	return complete;
 }
 
 /**
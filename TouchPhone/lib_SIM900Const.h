@@ -14,6 +14,7 @@
 
 #define SIM900_BUFFER_CMD		64		// command response buffer
 #define SIM900_BUFFER_PACKET	1500	// packet receive or transmit (if not otherwise defined), 1460 bytes maximum MTR
+#define SIM900_BUFFER_SERIAL	2048	// serial receive ring buffer, a power of two holding a whole packet
 #define	SIM900_RATE				115200	// baud rate
 #define SIM900_MAX_TIME_OUT		2000	// milli seconds timeout
 
@@ -66,6 +66,23 @@
  *
  * Note 0x80000000 is the lower address so appears in the array first.
  *
+ * Tiers:
+ *
+ * The first (lowest address) region is the fast tier, and any later regions
+ * are the bulk tier.  On the ATmega, internal SRAM is below XRAM, so the first
+ * region is the internal SRAM that is quicker to access.
+ *
+ * pvPortMallocFast() takes a block from the fast tier, and pvPortMallocBulk()
+ * from the bulk tier, each falling back to the other tier if its own is full.
+ * pvPortMalloc() treats requests smaller than configHEAP_BULK_THRESHOLD as
+ * fast, so kernel objects (TCBs, queues) stay in internal SRAM, and larger
+ * buffers go to XRAM.
+ *
+ * Where XRAM holds the heap (portEXT_RAM without portEXT_RAMFS) the regions
+ * are defined automatically on first use, as configFAST_HEAP_SIZE bytes of
+ * internal SRAM and configTOTAL_HEAP_SIZE bytes in the .ext_ram_heap section,
+ * if vPortDefineHeapRegions() has not been called.
+ *
  */
 #include <stdlib.h>
 
@@ -89,6 +106,23 @@ task.h is included from an application file. */
 /* Assumes 8bit bytes! */
 #define heapBITS_PER_BYTE		( ( size_t ) 8 )
 
+/* Requests to pvPortMalloc() of this size and larger are taken from the bulk
+tier first. */
+#ifndef configHEAP_BULK_THRESHOLD
+	#define configHEAP_BULK_THRESHOLD	( ( size_t ) 128 )
+#endif
+
+/* The tier a block is taken from. */
+#define heapTIER_ANY			( ( BaseType_t ) 0 )
+#define heapTIER_FAST			( ( BaseType_t ) 1 )
+#define heapTIER_BULK			( ( BaseType_t ) 2 )
+
+/* Allocate the memory for the default regions. */
+#if ( defined(portEXT_RAM) && !defined(portEXT_RAMFS) )
+	static uint8_t ucHeapFast[ configFAST_HEAP_SIZE ];
+	static uint8_t ucHeapBulk[ configTOTAL_HEAP_SIZE ]  __attribute__((section(".ext_ram_heap"))); // Added this section to get heap to go to the ext memory.
+#endif
+
 /* Define the linked list structure.  This is used to link free blocks in order
 of their memory address. */
 typedef struct A_BLOCK_LINK
@@ -107,6 +141,18 @@ typedef struct A_BLOCK_LINK
  */
 static void prvInsertBlockIntoFreeList( BlockLink_t *pxBlockToInsert );
 
+/*
+ * Finds the first free block of at least xWantedSize bytes in the tier, and
+ * the block before it in the list of free blocks.  Returns NULL if none.
+ */
+static BlockLink_t *prvFindFreeBlock( size_t xWantedSize, BaseType_t xTier, BlockLink_t **ppxPreviousBlock );
+
+/*
+ * The allocation common to pvPortMalloc(), pvPortMallocFast() and
+ * pvPortMallocBulk(), preferring the tier given.
+ */
+static void *prvHeapMalloc( size_t xWantedSize, BaseType_t xTier );
+
 /*-----------------------------------------------------------*/
 
 /* The size of the structure placed at the beginning of each allocated memory
@@ -116,6 +162,10 @@ static const size_t xHeapStructSize	= ( sizeof( BlockLink_t ) + ( ( size_t ) ( p
 /* Create a couple of list links to mark the start and end of the list. */
 static BlockLink_t xStart, *pxEnd = NULL;
 
+/* The end of the first region.  Blocks below this address are in the fast
+tier. */
+static uint8_t *pucFastHeapEnd = NULL;
+
 /* Keeps track of the number of free bytes remaining, but says nothing about
 fragmentation. */
 static size_t xFreeBytesRemaining = 0U;
@@ -130,10 +180,48 @@ static size_t xBlockAllocatedBit = 0;
 /*-----------------------------------------------------------*/
 
 void *pvPortMalloc( size_t xWantedSize )
+{
+	return prvHeapMalloc( xWantedSize, ( xWantedSize < configHEAP_BULK_THRESHOLD ) ? heapTIER_FAST : heapTIER_BULK );
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMallocFast( size_t xWantedSize )
+{
+	return prvHeapMalloc( xWantedSize, heapTIER_FAST );
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMallocBulk( size_t xWantedSize )
+{
+	return prvHeapMalloc( xWantedSize, heapTIER_BULK );
+}
+/*-----------------------------------------------------------*/
+
+static void *prvHeapMalloc( size_t xWantedSize, BaseType_t xTier )
 {
 BlockLink_t *pxBlock, *pxPreviousBlock, *pxNewBlockLink;
 void *pvReturn = NULL;
 
+	#if ( defined(portEXT_RAM) && !defined(portEXT_RAMFS) )
+	{
+		if( pxEnd == NULL )
+		{
+			HeapRegion_t xHeapRegions[] =
+			{
+				{ ucHeapFast, sizeof( ucHeapFast ) },
+				{ ucHeapBulk, sizeof( ucHeapBulk ) },
+				{ NULL, 0 }
+			};
+
+			vPortDefineHeapRegions( xHeapRegions );
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+
 	/* The heap must be initialised before the first call to
 	prvPortMalloc(). */
 	configASSERT( pxEnd );
@@ -171,19 +259,20 @@ void *pvReturn = NULL;
 
 			if( ( xWantedSize > 0 ) && ( xWantedSize <= xFreeBytesRemaining ) )
 			{
-				/* Traverse the list from the start	(lowest address) block until
-				one	of adequate size is found. */
-				pxPreviousBlock = &xStart;
-				pxBlock = xStart.pxNextFreeBlock;
-				while( ( pxBlock->xBlockSize < xWantedSize ) && ( pxBlock->pxNextFreeBlock != NULL ) )
+				/* Look for a block of adequate size in the preferred tier, and
+				then anywhere if that tier is full. */
+				pxBlock = prvFindFreeBlock( xWantedSize, xTier, &pxPreviousBlock );
+
+				if( ( pxBlock == NULL ) && ( xTier != heapTIER_ANY ) )
+				{
+					pxBlock = prvFindFreeBlock( xWantedSize, heapTIER_ANY, &pxPreviousBlock );
+				}
+				else
 				{
-					pxPreviousBlock = pxBlock;
-					pxBlock = pxBlock->pxNextFreeBlock;
+					mtCOVERAGE_TEST_MARKER();
 				}
 
-				/* If the end marker was reached then a block of adequate size
-				was	not found. */
-				if( pxBlock != pxEnd )
+				if( pxBlock != NULL )
 				{
 					/* Return the memory space pointed to - jumping over the
 					BlockLink_t structure at its start. */
@@ -329,6 +418,38 @@ size_t xPortGetMinimumEverFreeHeapSize( void )
 }
 /*-----------------------------------------------------------*/
 
+static BlockLink_t *prvFindFreeBlock( size_t xWantedSize, BaseType_t xTier, BlockLink_t **ppxPreviousBlock )
+{
+BlockLink_t *pxBlock, *pxPreviousBlock, *pxFound = NULL;
+
+	/* Traverse the list from the start	(lowest address) block until one of
+	adequate size is found in the tier. */
+	pxPreviousBlock = &xStart;
+	pxBlock = xStart.pxNextFreeBlock;
+
+	while( pxBlock != pxEnd )
+	{
+		if( ( xTier == heapTIER_FAST ) && ( ( uint8_t * ) pxBlock >= pucFastHeapEnd ) )
+		{
+			/* The list is in address order, so no more blocks are fast. */
+			break;
+		}
+
+		if( ( pxBlock->xBlockSize >= xWantedSize ) && ( ( xTier != heapTIER_BULK ) || ( ( uint8_t * ) pxBlock >= pucFastHeapEnd ) ) )
+		{
+			*ppxPreviousBlock = pxPreviousBlock;
+			pxFound = pxBlock;
+			break;
+		}
+
+		pxPreviousBlock = pxBlock;
+		pxBlock = pxBlock->pxNextFreeBlock;
+	}
+
+	return pxFound;
+}
+/*-----------------------------------------------------------*/
+
 static void prvInsertBlockIntoFreeList( BlockLink_t *pxBlockToInsert )
 {
 BlockLink_t *pxIterator;
@@ -452,6 +573,12 @@ const HeapRegion_t *pxHeapRegion;
 		pxEnd->xBlockSize = 0;
 		pxEnd->pxNextFreeBlock = NULL;
 
+		/* The first region is the fast tier. */
+		if( xDefinedRegions == 0 )
+		{
+			pucFastHeapEnd = ( uint8_t * ) pxEnd;
+		}
+
 		/* To start with there is a single free block in this region that is
 		sized to take up the entire heap region minus the space taken by the
 		free block structure. */
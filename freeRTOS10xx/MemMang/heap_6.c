@@ -0,0 +1,680 @@
+/*
+ * FreeRTOS Kernel V10.1.1
+ * Copyright (C) 2018 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * http://www.FreeRTOS.org
+ * http://aws.amazon.com/freertos
+ *
+ * 1 tab == 4 spaces!
+ */
+
+/*
+ * A sample implementation of pvPortMalloc() and vPortFree() that keeps the
+ * free blocks in segregated size class lists, and so finds a block and
+ * coalesces a freed block in a bounded time, independent of how many blocks
+ * are on the heap.
+ *
+ * The size classes are two level (as TLSF).  The first level is the power of
+ * two of the block size, and the second level divides each power of two into
+ * heapSL_INDEX_COUNT linear steps.  A bitmap over each level finds the first
+ * non-empty list that is certain to fit the request, without walking a list.
+ * Only when no such list has a block is the request's own class searched, as
+ * it may still hold a block large enough.
+ *
+ * Each block records the block physically before it, so a freed block is
+ * merged with both its neighbours without searching for them.
+ *
+ * The heap is the same ucHeap[ configTOTAL_HEAP_SIZE ] array as heap_4.c, and
+ * is placed in XRAM in the same way.
+ *
+ * See heap_1.c, heap_2.c, heap_3.c, heap_4.c and heap_5.c for alternative
+ * implementations, and the memory management pages of http://www.FreeRTOS.org
+ * for more information.
+ */
+#include <stdlib.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( configSUPPORT_DYNAMIC_ALLOCATION == 0 )
+	#error This file must not be used if configSUPPORT_DYNAMIC_ALLOCATION is 0
+#endif
+
+/* Assumes 8bit bytes! */
+#define heapBITS_PER_BYTE		( ( size_t ) 8 )
+
+/* Each power of two is divided into 1 << heapSL_INDEX_BITS size classes. */
+#define heapSL_INDEX_BITS		( 2 )
+#define heapSL_INDEX_COUNT		( 1 << heapSL_INDEX_BITS )
+
+/* Free blocks must hold the whole BlockLink_t, so no class is needed below the
+power of two of its size, which is 8 bytes with 16 bit pointers. */
+#define heapFL_INDEX_SHIFT		( 3 )
+
+/* The top bit of the block size marks an allocated block, so the largest block
+is in the power of two below it. */
+#define heapFL_INDEX_COUNT		( ( ( sizeof( size_t ) * heapBITS_PER_BYTE ) - 1 ) - heapFL_INDEX_SHIFT )
+
+/* The position of the highest and lowest set bit of a non-zero value. */
+#define heapMSB( x )			( ( UBaseType_t ) ( ( ( sizeof( unsigned long ) * heapBITS_PER_BYTE ) - 1 ) - __builtin_clzl( ( unsigned long ) ( x ) ) ) )
+#define heapLSB( x )			( ( UBaseType_t ) __builtin_ctzl( ( unsigned long ) ( x ) ) )
+
+/* Allocate the memory for the heap. */
+#if( configAPPLICATION_ALLOCATED_HEAP == 1 )
+	/* The application writer has already defined the array used for the RTOS
+	heap - probably so it can be placed in a special segment or address. */
+	extern uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#elif ( defined(portEXT_RAM) && !defined(portEXT_RAMFS) )
+	static uint8_t ucHeap[ configTOTAL_HEAP_SIZE ]  __attribute__((section(".ext_ram_heap"))); // Added this section to get heap to go to the ext memory.
+#else
+	static uint8_t ucHeap[ configTOTAL_HEAP_SIZE ];
+#endif /* configAPPLICATION_ALLOCATED_HEAP */
+
+/* Define the block header.  Every block starts with the physical link and the
+size.  Only a free block has the free list links, which lie in the space that
+is returned to the application when the block is allocated. */
+typedef struct A_BLOCK_LINK
+{
+	struct A_BLOCK_LINK *pxPrevPhysBlock;	/*<< The block immediately below this one in memory, or NULL. */
+	size_t xBlockSize;						/*<< The size of the block, including this header. */
+	struct A_BLOCK_LINK *pxNextFreeBlock;	/*<< The next free block in the same size class. */
+	struct A_BLOCK_LINK *pxPrevFreeBlock;	/*<< The previous free block in the same size class. */
+} BlockLink_t;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Finds the size class lists for a block size.
+ */
+static void prvMapSize( size_t xSize, UBaseType_t *puxFL, UBaseType_t *puxSL );
+
+/*
+ * Adds a free block to the head of the list for its size class, or removes a
+ * free block from its list.
+ */
+static void prvInsertFreeBlock( BlockLink_t *pxBlock );
+static void prvRemoveFreeBlock( BlockLink_t *pxBlock );
+
+/*
+ * Removes and returns a free block of at least xWantedSize bytes, or NULL.
+ */
+static BlockLink_t *prvTakeFreeBlock( size_t xWantedSize );
+
+/*
+ * Called automatically to setup the required heap structures the first time
+ * pvPortMalloc() is called.
+ */
+static void prvHeapInit( void );
+
+/*-----------------------------------------------------------*/
+
+/* The header kept on an allocated block is only the physical link and the
+size.  It must be correctly byte aligned. */
+static const size_t xHeapStructSize	= ( sizeof( struct A_BLOCK_LINK * ) + sizeof( size_t ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/* Block sizes must not get too small, as the free list links have to fit. */
+static const size_t xMinimumBlockSize = ( sizeof( BlockLink_t ) + ( ( size_t ) ( portBYTE_ALIGNMENT - 1 ) ) ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+
+/* The free lists, and a bitmap of the non-empty lists at each level. */
+static BlockLink_t *pxFreeLists[ heapFL_INDEX_COUNT ][ heapSL_INDEX_COUNT ];
+static size_t xFLBitmap = 0U;
+static uint8_t ucSLBitmap[ heapFL_INDEX_COUNT ];
+
+/* Marks the end of the heap.  It is an allocated block of zero size, so the
+last real block is never merged past it. */
+static BlockLink_t *pxEnd = NULL;
+
+/* Keeps track of the number of free bytes remaining, but says nothing about
+fragmentation. */
+static size_t xFreeBytesRemaining = 0U;
+static size_t xMinimumEverFreeBytesRemaining = 0U;
+static size_t xNumberOfSuccessfulAllocations = 0U;
+static size_t xNumberOfSuccessfulFrees = 0U;
+
+/* Gets set to the top bit of an size_t type.  When this bit in the xBlockSize
+member of an BlockLink_t structure is set then the block belongs to the
+application.  When the bit is free the block is still part of the free heap
+space. */
+static size_t xBlockAllocatedBit = 0;
+
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+BlockLink_t *pxBlock, *pxNewBlockLink, *pxNextBlock;
+void *pvReturn = NULL;
+
+	vTaskSuspendAll();
+	{
+		/* If this is the first call to malloc then the heap will require
+		initialisation to setup the lists of free blocks. */
+		if( pxEnd == NULL )
+		{
+			prvHeapInit();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		/* Check the requested block size is not so large that the top bit is
+		set, once the header is added.  The top bit of the block size is used
+		to determine who owns the block - the application or the kernel, so it
+		must be free. */
+		if( ( xWantedSize > 0 ) && ( ( xWantedSize & xBlockAllocatedBit ) == 0 ) &&
+			( ( ( xWantedSize + xHeapStructSize + portBYTE_ALIGNMENT_MASK ) & xBlockAllocatedBit ) == 0 ) )
+		{
+			/* The wanted size is increased so it can contain the block header
+			in addition to the requested amount of bytes. */
+			xWantedSize += xHeapStructSize;
+
+			/* Ensure that blocks are always aligned to the required number
+			of bytes. */
+			if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0x00 )
+			{
+				/* Byte alignment required. */
+				xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+				configASSERT( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) == 0 );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			/* The block must be able to hold the free list links when it is
+			returned. */
+			if( xWantedSize < xMinimumBlockSize )
+			{
+				xWantedSize = xMinimumBlockSize;
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+
+			if( xWantedSize <= xFreeBytesRemaining )
+			{
+				pxBlock = prvTakeFreeBlock( xWantedSize );
+
+				if( pxBlock != NULL )
+				{
+					/* If the block is larger than required it can be split into
+					two, and the remainder returned to its size class. */
+					if( ( pxBlock->xBlockSize - xWantedSize ) >= xMinimumBlockSize )
+					{
+						pxNewBlockLink = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xWantedSize );
+						configASSERT( ( ( ( size_t ) pxNewBlockLink ) & portBYTE_ALIGNMENT_MASK ) == 0 );
+
+						pxNewBlockLink->xBlockSize = pxBlock->xBlockSize - xWantedSize;
+						pxNewBlockLink->pxPrevPhysBlock = pxBlock;
+						pxBlock->xBlockSize = xWantedSize;
+
+						pxNextBlock = ( void * ) ( ( ( uint8_t * ) pxNewBlockLink ) + pxNewBlockLink->xBlockSize );
+						pxNextBlock->pxPrevPhysBlock = pxNewBlockLink;
+
+						prvInsertFreeBlock( pxNewBlockLink );
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+
+					xFreeBytesRemaining -= pxBlock->xBlockSize;
+
+					if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+					{
+						xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+					}
+					else
+					{
+						mtCOVERAGE_TEST_MARKER();
+					}
+
+					/* The block is being returned - it is allocated and owned
+					by the application. */
+					pxBlock->xBlockSize |= xBlockAllocatedBit;
+					xNumberOfSuccessfulAllocations++;
+
+					pvReturn = ( void * ) ( ( ( uint8_t * ) pxBlock ) + xHeapStructSize );
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		traceMALLOC( pvReturn, xWantedSize );
+	}
+	( void ) xTaskResumeAll();
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	#endif
+
+	configASSERT( ( ( ( size_t ) pvReturn ) & ( size_t ) portBYTE_ALIGNMENT_MASK ) == 0 );
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+uint8_t *puc = ( uint8_t * ) pv;
+BlockLink_t *pxLink, *pxNeighbour;
+
+	if( pv != NULL )
+	{
+		/* The memory being freed will have the block header immediately
+		before it. */
+		puc -= xHeapStructSize;
+
+		/* This casting is to keep the compiler from issuing warnings. */
+		pxLink = ( void * ) puc;
+
+		/* Check the block is actually allocated. */
+		configASSERT( ( pxLink->xBlockSize & xBlockAllocatedBit ) != 0 );
+
+		if( ( pxLink->xBlockSize & xBlockAllocatedBit ) != 0 )
+		{
+			vTaskSuspendAll();
+			{
+				/* The block is being returned to the heap - it is no longer
+				allocated. */
+				pxLink->xBlockSize &= ~xBlockAllocatedBit;
+
+				xFreeBytesRemaining += pxLink->xBlockSize;
+				xNumberOfSuccessfulFrees++;
+				traceFREE( pv, pxLink->xBlockSize );
+
+				/* Merge with the block above, if it is free.  The end marker
+				is allocated, so this never runs off the heap. */
+				pxNeighbour = ( void * ) ( ( ( uint8_t * ) pxLink ) + pxLink->xBlockSize );
+				if( ( pxNeighbour->xBlockSize & xBlockAllocatedBit ) == 0 )
+				{
+					prvRemoveFreeBlock( pxNeighbour );
+					pxLink->xBlockSize += pxNeighbour->xBlockSize;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				/* Merge with the block below, if it is free. */
+				pxNeighbour = pxLink->pxPrevPhysBlock;
+				if( ( pxNeighbour != NULL ) && ( ( pxNeighbour->xBlockSize & xBlockAllocatedBit ) == 0 ) )
+				{
+					prvRemoveFreeBlock( pxNeighbour );
+					pxNeighbour->xBlockSize += pxLink->xBlockSize;
+					pxLink = pxNeighbour;
+				}
+				else
+				{
+					mtCOVERAGE_TEST_MARKER();
+				}
+
+				/* The block above now follows the merged block. */
+				pxNeighbour = ( void * ) ( ( ( uint8_t * ) pxLink ) + pxLink->xBlockSize );
+				pxNeighbour->pxPrevPhysBlock = pxLink;
+
+				prvInsertFreeBlock( pxLink );
+			}
+			( void ) xTaskResumeAll();
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetLargestFreeBlockSize( void )
+{
+BlockLink_t *pxBlock;
+UBaseType_t uxFL, uxSL;
+size_t xLargest = 0U;
+
+	vTaskSuspendAll();
+	{
+		/* The largest block is in the highest non-empty size class, so only
+		that one list needs to be looked at. */
+		if( xFLBitmap != 0U )
+		{
+			uxFL = heapMSB( xFLBitmap );
+			uxSL = heapMSB( ucSLBitmap[ uxFL ] );
+
+			for( pxBlock = pxFreeLists[ uxFL ][ uxSL ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFreeBlock )
+			{
+				if( pxBlock->xBlockSize > xLargest )
+				{
+					xLargest = pxBlock->xBlockSize;
+				}
+			}
+		}
+	}
+	( void ) xTaskResumeAll();
+
+	/* The header is not available to the application. */
+	return ( xLargest > xHeapStructSize ) ? ( xLargest - xHeapStructSize ) : 0U;
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapStats( HeapStats_t *pxHeapStats )
+{
+BlockLink_t *pxBlock;
+UBaseType_t uxFL, uxSL;
+size_t xBlocks = 0U, xMaxSize = 0U, xMinSize = ( size_t ) -1;
+
+	vTaskSuspendAll();
+	{
+		/* This walks every free block, so it is for diagnostics rather than
+		for use on every allocation. */
+		for( uxFL = 0; uxFL < heapFL_INDEX_COUNT; uxFL++ )
+		{
+			for( uxSL = 0; uxSL < heapSL_INDEX_COUNT; uxSL++ )
+			{
+				for( pxBlock = pxFreeLists[ uxFL ][ uxSL ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFreeBlock )
+				{
+					xBlocks++;
+
+					if( pxBlock->xBlockSize > xMaxSize )
+					{
+						xMaxSize = pxBlock->xBlockSize;
+					}
+
+					if( pxBlock->xBlockSize < xMinSize )
+					{
+						xMinSize = pxBlock->xBlockSize;
+					}
+				}
+			}
+		}
+
+		pxHeapStats->xAvailableHeapSpaceInBytes = xFreeBytesRemaining;
+		pxHeapStats->xMinimumEverFreeBytesRemaining = xMinimumEverFreeBytesRemaining;
+		pxHeapStats->xNumberOfSuccessfulAllocations = xNumberOfSuccessfulAllocations;
+		pxHeapStats->xNumberOfSuccessfulFrees = xNumberOfSuccessfulFrees;
+	}
+	( void ) xTaskResumeAll();
+
+	/* As xPortGetLargestFreeBlockSize(), the sizes the application could
+	have, without the headers. */
+	pxHeapStats->xSizeOfLargestFreeBlockInBytes = ( xBlocks != 0U ) ? ( xMaxSize - xHeapStructSize ) : 0U;
+	pxHeapStats->xSizeOfSmallestFreeBlockInBytes = ( xBlocks != 0U ) ? ( xMinSize - xHeapStructSize ) : 0U;
+	pxHeapStats->xNumberOfFreeBlocks = xBlocks;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* This just exists to keep the linker quiet. */
+}
+/*-----------------------------------------------------------*/
+
+static void prvMapSize( size_t xSize, UBaseType_t *puxFL, UBaseType_t *puxSL )
+{
+UBaseType_t uxMSB;
+
+	/* The first level is the power of two, and the second level is the next
+	heapSL_INDEX_BITS bits below it. */
+	uxMSB = heapMSB( xSize );
+
+	*puxFL = uxMSB - heapFL_INDEX_SHIFT;
+	*puxSL = ( UBaseType_t ) ( ( xSize >> ( uxMSB - heapSL_INDEX_BITS ) ) & ( heapSL_INDEX_COUNT - 1 ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertFreeBlock( BlockLink_t *pxBlock )
+{
+UBaseType_t uxFL, uxSL;
+
+	prvMapSize( pxBlock->xBlockSize, &uxFL, &uxSL );
+
+	pxBlock->pxPrevFreeBlock = NULL;
+	pxBlock->pxNextFreeBlock = pxFreeLists[ uxFL ][ uxSL ];
+
+	if( pxBlock->pxNextFreeBlock != NULL )
+	{
+		pxBlock->pxNextFreeBlock->pxPrevFreeBlock = pxBlock;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	pxFreeLists[ uxFL ][ uxSL ] = pxBlock;
+
+	xFLBitmap |= ( ( size_t ) 1 ) << uxFL;
+	ucSLBitmap[ uxFL ] |= ( uint8_t ) ( 1 << uxSL );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveFreeBlock( BlockLink_t *pxBlock )
+{
+UBaseType_t uxFL, uxSL;
+
+	prvMapSize( pxBlock->xBlockSize, &uxFL, &uxSL );
+
+	if( pxBlock->pxNextFreeBlock != NULL )
+	{
+		pxBlock->pxNextFreeBlock->pxPrevFreeBlock = pxBlock->pxPrevFreeBlock;
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( pxBlock->pxPrevFreeBlock != NULL )
+	{
+		pxBlock->pxPrevFreeBlock->pxNextFreeBlock = pxBlock->pxNextFreeBlock;
+	}
+	else
+	{
+		/* The block was at the head of its list. */
+		pxFreeLists[ uxFL ][ uxSL ] = pxBlock->pxNextFreeBlock;
+
+		if( pxFreeLists[ uxFL ][ uxSL ] == NULL )
+		{
+			ucSLBitmap[ uxFL ] &= ( uint8_t ) ~( 1 << uxSL );
+
+			if( ucSLBitmap[ uxFL ] == 0 )
+			{
+				xFLBitmap &= ~( ( ( size_t ) 1 ) << uxFL );
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static BlockLink_t *prvTakeFreeBlock( size_t xWantedSize )
+{
+BlockLink_t *pxBlock = NULL;
+UBaseType_t uxFL, uxSL, uxMSB;
+size_t xSearchSize, xBitmap;
+
+	/* Round the size up to the next class boundary, so that any block in the
+	class found is large enough, and the list need not be walked. */
+	uxMSB = heapMSB( xWantedSize );
+	xSearchSize = xWantedSize + ( ( ( size_t ) 1 ) << ( uxMSB - heapSL_INDEX_BITS ) ) - 1;
+
+	if( ( xSearchSize & xBlockAllocatedBit ) == 0 )
+	{
+		prvMapSize( xSearchSize, &uxFL, &uxSL );
+
+		/* Look first in the larger classes of the same power of two, and
+		then in the smallest class of the next larger power of two. */
+		xBitmap = ucSLBitmap[ uxFL ] & ( uint8_t ) ( 0xff << uxSL );
+
+		if( xBitmap == 0U )
+		{
+			xBitmap = xFLBitmap & ( ( ~( size_t ) 0 ) << ( uxFL + 1 ) );
+
+			if( xBitmap != 0U )
+			{
+				uxFL = heapLSB( xBitmap );
+				xBitmap = ucSLBitmap[ uxFL ];
+			}
+			else
+			{
+				mtCOVERAGE_TEST_MARKER();
+			}
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+
+		if( xBitmap != 0U )
+		{
+			uxSL = heapLSB( xBitmap );
+			pxBlock = pxFreeLists[ uxFL ][ uxSL ];
+		}
+		else
+		{
+			mtCOVERAGE_TEST_MARKER();
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( pxBlock == NULL )
+	{
+		/* No class above the request has a block, or rounding a request near
+		the largest block size passed the top class.  A block that fits may
+		still be in the request's own class, so that one list is searched. */
+		prvMapSize( xWantedSize, &uxFL, &uxSL );
+
+		for( pxBlock = pxFreeLists[ uxFL ][ uxSL ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFreeBlock )
+		{
+			if( pxBlock->xBlockSize >= xWantedSize )
+			{
+				break;
+			}
+		}
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	if( pxBlock != NULL )
+	{
+		prvRemoveFreeBlock( pxBlock );
+	}
+	else
+	{
+		mtCOVERAGE_TEST_MARKER();
+	}
+
+	return pxBlock;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void )
+{
+BlockLink_t *pxFirstFreeBlock;
+uint8_t *pucAlignedHeap;
+size_t uxAddress;
+size_t xTotalHeapSize = configTOTAL_HEAP_SIZE;
+
+	/* Work out the position of the top bit in a size_t variable. */
+	xBlockAllocatedBit = ( ( size_t ) 1 ) << ( ( sizeof( size_t ) * heapBITS_PER_BYTE ) - 1 );
+
+	/* Ensure the heap starts on a correctly aligned boundary. */
+	uxAddress = ( size_t ) ucHeap;
+
+	if( ( uxAddress & portBYTE_ALIGNMENT_MASK ) != 0 )
+	{
+		uxAddress += ( portBYTE_ALIGNMENT - 1 );
+		uxAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+		xTotalHeapSize -= uxAddress - ( size_t ) ucHeap;
+	}
+
+	pucAlignedHeap = ( uint8_t * ) uxAddress;
+
+	/* pxEnd is used to mark the end of the heap.  Only its physical link and
+	size are ever used. */
+	uxAddress = ( ( size_t ) pucAlignedHeap ) + xTotalHeapSize;
+	uxAddress -= xHeapStructSize;
+	uxAddress &= ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+	pxEnd = ( void * ) uxAddress;
+
+	/* To start with there is a single free block that is sized to take up the
+	entire heap space, minus the space taken by pxEnd. */
+	pxFirstFreeBlock = ( void * ) pucAlignedHeap;
+	pxFirstFreeBlock->xBlockSize = uxAddress - ( size_t ) pxFirstFreeBlock;
+	pxFirstFreeBlock->pxPrevPhysBlock = NULL;
+
+	pxEnd->xBlockSize = xBlockAllocatedBit;
+	pxEnd->pxPrevPhysBlock = pxFirstFreeBlock;
+
+	prvInsertFreeBlock( pxFirstFreeBlock );
+
+	/* Only one block exists - and it covers the entire usable heap space. */
+	xMinimumEverFreeBytesRemaining = pxFirstFreeBlock->xBlockSize;
+	xFreeBytesRemaining = pxFirstFreeBlock->xBlockSize;
+}
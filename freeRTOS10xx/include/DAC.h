@@ -9,6 +9,7 @@
 #include <avr/pgmspace.h>
 
 #include "FreeRTOS.h"
+#include "task.h"
 #include "spi.h"
 
 #include "mult16x16.h"
@@ -37,6 +38,15 @@ extern "C" {
  */
 // #define DEBUG_PING
 
+/*
+ * XXX Define to render the audio in blocks of AUDIO_BLOCK_SIZE samples, in a high priority task running
+ * AudioCodec_blockTask(), rather than one sample at a time in the sample interrupt.
+ * The interrupt then only outputs precomputed samples from one half of a ping-pong buffer,
+ * and wakes the task to render the next block into the other half.
+ * Define it before including DAC.h. Up to 255 samples.
+ */
+// #define AUDIO_BLOCK_SIZE	32
+
 /*
  * Bytes used to control the MCP4822 DAC
  */
@@ -107,6 +117,14 @@ typedef struct __attribute__ ((packed)) _DAC_command_t {
 
 typedef void (audioCodec_DSP)( uint16_t* ch_A, uint16_t* ch_B);
 
+/*
+ * Prototype for the block audio DSP function to be implemented, when AUDIO_BLOCK_SIZE is defined.
+ * Needs to provide samples values in ch_A[] and ch_B[].
+ * Runs within the audio block task, so it has the time of a whole block, less the sample interrupts.
+ */
+
+typedef void (audioCodec_blockDSP)( uint16_t* ch_A, uint16_t* ch_B, uint8_t samples);
+
 //==================================================
 //****************** IIR Filter ******************//
 //==================================================
@@ -134,6 +152,23 @@ static audioCodec_DSP * audioHandler;
 uint16_t* ch_A_ptr;
 uint16_t* ch_B_ptr;
 
+#if defined(AUDIO_BLOCK_SIZE)
+
+// ping-pong buffers of the values to be written to MCP4822.
+// The sample interrupt plays one half, while the audio block task renders the other half.
+uint16_t audioBlock_A[2][AUDIO_BLOCK_SIZE];
+uint16_t audioBlock_B[2][AUDIO_BLOCK_SIZE];
+
+static volatile uint8_t audioBlockPlaying;		// the half being played by the sample interrupt.
+static uint8_t audioBlockSample;				// the next sample to be played from that half.
+static volatile uint8_t audioBlockReady = 1;	// the other half has been rendered, initially with silence.
+
+volatile uint16_t audioBlockUnderruns;			// the number of blocks not rendered in time, and so played twice.
+
+static TaskHandle_t audioBlockTask;
+
+#endif // defined(AUDIO_BLOCK_SIZE)
+
 #endif //defined(portANALOGUE) || defined(portANALOGSHIELD)
 
 /*--------------------------------------------------*/
@@ -179,6 +214,10 @@ void AudioCodec_Timer1_init(uint16_t samplesSecond);	// set up the sampling Time
 
 void AudioCodec_setHandler(audioCodec_DSP* handler, uint16_t* ch_A, uint16_t* ch_B);	// set up the DSP processing to prepare the samples.
 
+void AudioCodec_blockTask(void *pvParameters);			// the audio block task, when AUDIO_BLOCK_SIZE is defined. Never returns.
+														// pvParameters is the audioCodec_blockDSP function to render the blocks.
+														// Create it (or call it from a task) at the highest priority.
+
 void DAC_init(void);									// initialise the SPI or MSPIM bus specifically for DAC use.
 
 // Assumes that the DAC SPI has already been selected, as the selection process is quite time consuming.
@@ -223,6 +262,9 @@ void setIIRFilterHPF( filter_t *filter ); // High Pass
 // returns y(n) filtered by the biquad IIR process in place of x(n)
 void IIRFilter( filter_t *filter, int16_t * xn ) __attribute__ ((hot, flatten));
 
+// returns a block of y(n) filtered by the biquad IIR process in place of the block of x(n)
+void IIRFilterBlock( filter_t *filter, int16_t * xn, uint8_t samples ) __attribute__ ((hot, flatten));
+
 
 /*--------------------------------------------------*/
 /*---------------Public Functions-------------------*/
@@ -346,6 +388,63 @@ void AudioCodec_setHandler(audioCodec_DSP * handler, uint16_t *ch_A, uint16_t *c
 	ch_B_ptr = ch_B;
 }
 
+#if defined(AUDIO_BLOCK_SIZE)
+/**
+ * The audio block task.
+ * Waits for the sample interrupt to start playing a block, and then renders the next block into the other half.
+ *
+ */
+void AudioCodec_blockTask(void *pvParameters)
+{
+	audioCodec_blockDSP * blockHandler = (audioCodec_blockDSP *)pvParameters;
+	uint8_t half;
+
+	audioBlockTask = xTaskGetCurrentTaskHandle();
+
+	for(;;)
+	{
+		ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+		half = audioBlockPlaying ^ 0x01;
+		blockHandler( audioBlock_A[half], audioBlock_B[half], AUDIO_BLOCK_SIZE );
+
+		audioBlockReady = 1;
+	}
+}
+
+/**
+ * Called from the sample interrupt at the end of each block.
+ * Swaps to the newly rendered half, and wakes the audio block task to render the next one.
+ * If the task has not finished, plays the same half again rather than the half being rendered.
+ *
+ */
+static inline void AudioCodec_blockNext(void) __attribute__ ((hot, always_inline));
+static inline void AudioCodec_blockNext(void)
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	audioBlockSample = 0;
+
+	if( audioBlockReady )
+	{
+		audioBlockPlaying ^= 0x01;
+		audioBlockReady = 0;
+
+		if( audioBlockTask != NULL )
+		{
+			vTaskNotifyGiveFromISR( audioBlockTask, &xHigherPriorityTaskWoken );
+
+			if( xHigherPriorityTaskWoken )
+				taskYIELD();
+		}
+	}
+	else
+	{
+		++audioBlockUnderruns;
+	}
+}
+#endif // defined(AUDIO_BLOCK_SIZE)
+
 #endif // #if defined(portANALOGUE) || defined(portANALOGSHIELD)
 
 
@@ -476,6 +575,50 @@ void IIRFilter( filter_t *filter, int16_t * xn )
     *xn = filter->yn_1; // being 16 bit yn, so that's what we return.
 }
 
+// Coefficients in 8.8 format
+// interim values in 24.8 format
+// returns the block of y(n) in place of the block of x(n)
+// The same as IIRFilter(), but with the coefficients and state variables kept in registers across the block.
+void IIRFilterBlock( filter_t *filter, int16_t * xn, uint8_t samples )
+{
+    int32_t yn;			// current output
+    int32_t  accum;		// temporary accumulator
+
+    int16_t b0 = filter->b0, b1 = filter->b1, b2 = filter->b2;
+    int16_t a1 = filter->a1, a2 = filter->a2;
+    int16_t xn_1 = filter->xn_1, xn_2 = filter->xn_2;
+    int16_t yn_1 = filter->yn_1, yn_2 = filter->yn_2;
+
+    while( samples-- )
+    {
+        MultiS16X16to32(yn,xn_2,b2);
+        xn_2 = xn_1;
+
+        MultiS16X16to32(accum,xn_1,b1);
+        yn += accum;
+        xn_1 = *xn;
+
+        MultiS16X16to32(accum,*xn,b0);
+        yn += accum;
+
+        MultiS16X16to32(accum,yn_2,a2);
+        yn -= accum;
+        yn_2 = yn_1;
+
+        MultiS16X16to32(accum,yn_1,a1);
+        yn -= accum;
+
+        yn_1 = yn >> (IIRSCALEFACTORSHIFT + 8); // divide by a(0) = 32 & shift to 16.0 bit outcome from 24.8 interim steps
+
+        *xn++ = yn_1;
+    }
+
+    filter->xn_1 = xn_1;
+    filter->xn_2 = xn_2;
+    filter->yn_1 = yn_1;
+    filter->yn_2 = yn_2;
+}
+
 
 
 /*--------------------------------------------------*/
@@ -790,6 +933,15 @@ ISR(TIMER1_COMPA_vect)
 	PORTD |=  _BV(PORTD7);				// Ping IO line.
 #endif
 
+#if defined(AUDIO_BLOCK_SIZE)
+	// MCP4822 data transfer routine, from the half of the block being played.
+	DAC_out( &audioBlock_A[audioBlockPlaying][audioBlockSample], &audioBlock_B[audioBlockPlaying][audioBlockSample] );
+
+	// at the end of the block swap halves, and wake the audio block task to render the next block.
+	if( ++audioBlockSample == AUDIO_BLOCK_SIZE )
+		AudioCodec_blockNext();
+
+#else
 	// MCP4822 data transfer routine
 	// move data to the MCP4822 - done first for regularity (reduced jitter).
 	// &'s are necessary on data_in variables
@@ -800,6 +952,7 @@ ISR(TIMER1_COMPA_vect)
 	// Fire the global audio handler.
 	if (audioHandler!=NULL)
 		audioHandler(ch_A_ptr, ch_B_ptr);
+#endif
 
 #if defined(DEBUG_PING)
 	// end mark - check for end of interrupt - for debugging only
@@ -815,6 +968,15 @@ ISR(TIMER0_COMPA_vect)
 	PORTD |=  _BV(PORTD7);				// Ping IO line.
 #endif
 
+#if defined(AUDIO_BLOCK_SIZE)
+	// MCP4822 data transfer routine, from the half of the block being played.
+	DAC_out( &audioBlock_A[audioBlockPlaying][audioBlockSample], &audioBlock_B[audioBlockPlaying][audioBlockSample] );
+
+	// at the end of the block swap halves, and wake the audio block task to render the next block.
+	if( ++audioBlockSample == AUDIO_BLOCK_SIZE )
+		AudioCodec_blockNext();
+
+#else
 	// MCP4822 data transfer routine
 	// move data to the MCP4822 - done first for regularity (reduced jitter).
 	// &'s are necessary on data_in variables
@@ -825,6 +987,7 @@ ISR(TIMER0_COMPA_vect)
 	// Fire the global audio handler, if set.
 	if (audioHandler!=NULL)
 		audioHandler(ch_A_ptr, ch_B_ptr);
+#endif
 
 #if defined(DEBUG_PING)
 	// end mark - check for end of interrupt - for debugging only
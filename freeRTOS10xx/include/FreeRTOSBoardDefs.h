@@ -121,12 +121,14 @@ extern "C" {
 #if defined (portMEGA_RAM) || (defined (portQUAD_RAM) && !defined (portEXT_RAMFS))
     // XRAM banks enabled. We have to set the linker to move the heap to XRAM. -> DON'T FORGET TO ADD THESE LINK OPTIONS
     #define configTOTAL_HEAP_SIZE    ( (size_t ) (XRAMEND - 0x8000))    // Should be 0xffff - 0x8000 = 32767 for (non malloc) heap in XRAM.
-                                                                        // Used for heap_1.c, heap2.c, and heap4.c only, and maximum Array size possible for Heap is 32767.
+                                                                        // Used for heap_1.c, heap2.c, heap4.c and heap_6.c only, and maximum Array size possible for Heap is 32767.
+                                                                        // Used for the XRAM (bulk) region of heap_5.c.
+    #define configFAST_HEAP_SIZE     ( (size_t ) 0x0800 )               // Internal SRAM (fast) region of heap_5.c, for TCBs, queues and other small objects.
 #else
     // There is no XRAM available for the heap.
     #define configTOTAL_HEAP_SIZE    ( (size_t ) 0x1200 )
-//  #define configTOTAL_HEAP_SIZE    ( (size_t ) 0x1800 )               // 0x1800 = 6144 used for heap_1.c, heap2.c, and heap4.c only, where heap is NOT in XRAM.
-                                                                        // Used for heap_1.c, heap2.c, and heap4.c only, and maximum Array size possible for Heap is 32767.
+//  #define configTOTAL_HEAP_SIZE    ( (size_t ) 0x1800 )               // 0x1800 = 6144 used for heap_1.c, heap2.c, heap4.c and heap_6.c only, where heap is NOT in XRAM.
+                                                                        // Used for heap_1.c, heap2.c, heap4.c and heap_6.c only, and maximum Array size possible for Heap is 32767.
 #endif
 
 /**
@@ -134,17 +136,20 @@ extern "C" {
  * You should select one, \b 5100, \b 5200 ,\b 5500 or etc.
  */
     #define _WIZCHIP_                      5500     // 5100, 5200, 5500
+//  #define portWIZCHIP_INT                         // Wiznet INTn on D2 wakes the socket event tasks. Only with the INT jumper fitted on the EtherMega, else sockets are polled.
 
 //  #define portHD44780_LCD                         // define the use of the Freetronics HD44780 LCD (or other). Check include hd44780.h for (flexible) pin assignments.
     #define portSD_CARD                             // define the use of the SD Card for Arduino Mega2560 and Freetronics EtherMega
 //  #define portRTC_DEFINED                         // RTC DS1307 / DS3231 implemented, therefore define.
 
-    #define portSERIAL_BUFFER_RX    255             // Define the size of the serial receive buffer.
-    #define portSERIAL_BUFFER_TX    255             // Define the size of the serial transmit buffer, only as long as the longest line of text.
+    #define portSERIAL_BUFFER_RX    256             // Define the size of the serial receive buffer, a power of two.
+    #define portSERIAL_BUFFER_TX    256             // Define the size of the serial transmit buffer, only as long as the longest line of text.
     #define portSERIAL_BUFFER       portSERIAL_BUFFER_TX // just for compatibility with older programmes.
 
 //  #define portUSE_TIMER1_PWM                      // Define which Timer to use as the PWM Timer (not the tick timer).
 
+    #define portUSE_TIMER5_STATS                    // Define which 16 bit Timer to use as the run time stats and trace timebase (not the tick or PWM timer).
+
 
 #elif defined(__AVR_ATmega1284P__) || defined(__AVR_ATmega1284PA__) // Goldilocks with 1284p
 
@@ -186,14 +191,15 @@ extern "C" {
 #endif
 
 
-//  #define configTOTAL_HEAP_SIZE    ( (size_t )  15699  )  // used for heap_1.c and heap2.c, and heap_4.c only (measured for GA Synth)
-    #define configTOTAL_HEAP_SIZE    ( (size_t )  12699  )  // used for heap_1.c and heap2.c, and heap_4.c only
+//  #define configTOTAL_HEAP_SIZE    ( (size_t )  15699  )  // used for heap_1.c, heap2.c, heap_4.c and heap_6.c only (measured for GA Synth)
+    #define configTOTAL_HEAP_SIZE    ( (size_t )  12699  )  // used for heap_1.c, heap2.c, heap_4.c and heap_6.c only
 
 /**
  * Select WIZCHIP.
  * You should select one, \b 5100, \b 5200 ,\b 5500 or etc. \n\n
  */
     #define _WIZCHIP_               5500                    // 5100, 5200, 5500
+//  #define portWIZCHIP_INT                                 // Wiznet INTn on D2 wakes the socket event tasks.
 
 //  #define portHD44780_LCD                                 // define the use of the Freetronics HD44780 LCD (or other). Check include hd44780.h for (flexible) pin assignments.
     #define portSD_CARD                                     // define the use of the SD Card for Goldilocks 1284p
@@ -201,13 +207,15 @@ extern "C" {
 //  #define portANALOGUE                                    // Goldilocks Analogue Capabilities
 //  #define portANALOGSHIELD                                // Digilent Analog Shield (only DAC implemented)
 
-    #define portSERIAL_BUFFER_RX    255                     // Define the size of the serial receive buffer.
-    #define portSERIAL_BUFFER_TX    255                     // Define the size of the serial transmit buffer, only as long as the longest text.
+    #define portSERIAL_BUFFER_RX    256                     // Define the size of the serial receive buffer, a power of two.
+    #define portSERIAL_BUFFER_TX    256                     // Define the size of the serial transmit buffer, only as long as the longest text.
     #define portSERIAL_BUFFER       portSERIAL_BUFFER_TX    // just for compatibility with older programmes.
 
 //  #define portUSE_TIMER1_PWM                              // Define which Timer to use as the PWM Timer (not the tick timer).
                                                             // though it is better to use Pololu functions, as they support 8x multiplexed servos.
 
+    #define portUSE_TIMER3_STATS                            // Define which 16 bit Timer to use as the run time stats and trace timebase (not the tick or PWM timer).
+
 #elif defined(__AVR_ATmega32U2__) || defined(__AVR_ATmega16U2__) || defined(__AVR_ATmega8U2__)
 // Arduino Serial I/O MCU Compatible notation.
 #ifndef _U2DUINO_
@@ -244,9 +252,9 @@ extern "C" {
     // Greater than 100% memory usage. Subtle fail.
     // Less than 96%. Typically every byte counts for 32u2.
     // Watch for the stack overflowing, if you use interrupts. Use configCHECK_FOR_STACK_OVERFLOW
-    #define configTOTAL_HEAP_SIZE   ( (size_t ) 830 )       // used for heap_1.c, heap_2.c, and heap_4.c only
+    #define configTOTAL_HEAP_SIZE   ( (size_t ) 830 )       // used for heap_1.c, heap_2.c, heap_4.c and heap_6.c only
 
-    #define portSERIAL_BUFFER_RX     16                     // Define the size of the serial receive buffer.
+    #define portSERIAL_BUFFER_RX     16                     // Define the size of the serial receive buffer, a power of two.
     #define portSERIAL_BUFFER_TX     128                    // Define the size of the serial transmit buffer, only as long as the longest line of text.
     #define portSERIAL_BUFFER        portSERIAL_BUFFER_TX
 
@@ -297,7 +305,7 @@ extern "C" {
     // Greater than 100% memory usage. Subtle fail.
     // Less than 96%. Typically every byte counts for 328p.
     // Watch for the stack overflowing, if you use interrupts. Use configCHECK_FOR_STACK_OVERFLOW
-    #define configTOTAL_HEAP_SIZE   ( (size_t ) 1530 )      // used for heap_1.c, heap_2.c, and heap_4.c only
+    #define configTOTAL_HEAP_SIZE   ( (size_t ) 1530 )      // used for heap_1.c, heap_2.c, heap_4.c and heap_6.c only
 
 //  #define portEXT_RAMFS                                   // XRAM Memory is available for 16x 328p ArduSat (Uno) clients as 16 banks of 32kByte from a 2560.
 
@@ -306,11 +314,12 @@ extern "C" {
  * You should select one, \b 5100, \b 5200 ,\b 5500 or etc.
  */
     #define _WIZCHIP_               5200    // 5100, 5200, 5500
+//  #define portWIZCHIP_INT                 // Wiznet INTn on D2 wakes the socket event tasks.
 
 //  #define portHD44780_LCD                                 // define the use of the Freetronics HD44780 LCD (or other). Check include hd44780.h for (flexible) pin assignments.
 //  #define portRTC_DEFINED                                 // RTC DS1307 / DS3231 implemented, therefore define.
 
-    #define portSERIAL_BUFFER_RX    32                      // Define the size of the serial receive buffer.
+    #define portSERIAL_BUFFER_RX    32                      // Define the size of the serial receive buffer, a power of two.
     #define portSERIAL_BUFFER_TX    128                     // Define the size of the serial transmit buffer, only as long as the longest line of text.
     #define portSERIAL_BUFFER       portSERIAL_BUFFER_TX    // Set the default serial buffer to be the Tx size.
 
@@ -53,6 +53,9 @@
 #define configUSE_TRACE_FACILITY            0
 #define configUSE_16_BIT_TICKS              1
 #define configIDLE_SHOULD_YIELD             1
+#define configUSE_TICKLESS_IDLE             0           // 1 to stop the tick while idle, and sleep in power save. Needs portUSE_TIMER2.
+#define configGENERATE_RUN_TIME_STATS       0           // 1 to count task run time on a free running timer. Needs portUSE_TIMERn_STATS.
+#define configUSE_TRACE_RECORDER            0           // 1 to record task switches and interrupts, see trace.h. Needs run time stats and trace facility.
 
 #define configUSE_MUTEXES                   1
 #define configUSE_RECURSIVE_MUTEXES         1
@@ -95,9 +98,18 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelay                      1
 #define INCLUDE_xTaskGetSchedulerState          0
 #define INCLUDE_xTaskGetIdleTaskHandle          0 // create an idle task handle.
-#define INCLUDE_xTaskGetCurrentTaskHandle       0
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
 #define INCLUDE_uxTaskGetStackHighWaterMark     1
 
+/* Trace recorder hooks, time stamped task switches and interrupts streamed to a serial port. See trace.h. */
+#if ( configUSE_TRACE_RECORDER == 1 )
+    #include "trace.h"
+    #define traceTASK_SWITCHED_OUT()            vTraceRecord( TRACE_EVENT_TASK_SWITCHED_OUT, (uint8_t) pxCurrentTCB->uxTCBNumber )
+    #define traceTASK_SWITCHED_IN()             vTraceRecord( TRACE_EVENT_TASK_SWITCHED_IN, (uint8_t) pxCurrentTCB->uxTCBNumber )
+    #define traceISR_ENTER( ucIsrId )           vTraceRecord( TRACE_EVENT_ISR_ENTER, (ucIsrId) )
+    #define traceISR_EXIT( ucIsrId )            vTraceRecord( TRACE_EVENT_ISR_EXIT, (ucIsrId) )
+#endif
+
 #define configMAX(a,b)  ({ __typeof__ (a) _a = (a); __typeof__ (b) _b = (b); _a > _b ? _a : _b; })
 #define configMIN(a,b)  ({ __typeof__ (a) _a = (a); __typeof__ (b) _b = (b); _a < _b ? _a : _b; })
 
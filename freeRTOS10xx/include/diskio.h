@@ -12,6 +12,8 @@ extern "C" {
 #include "ffinteger.h"
 
 #define SD_SPI_DIVIDER 	SPI_CLOCK_DIV2 // xxx single point to control SPI speed when using SD cards
+#define SD_CACHE_SECTORS	0				// xxx number of sectors (1..255) in the write back cache between FatFs and SD card. 0 to disable
+#define SD_DATA_CRC		1				// xxx set to 0 to run SD cards in CRC off mode, and skip the data block CRC16 calculation
 
 /* Status of Disk Functions */
 typedef BYTE	DSTATUS;
@@ -53,6 +55,7 @@ typedef enum {
 #define CTRL_LOCK			6	/* Lock/Unlock media removal */
 #define CTRL_EJECT			7	/* Eject media */
 #define CTRL_FORMAT			8	/* Create physical format on the media */
+#define CTRL_CACHE_STATS	9	/* Get sector cache statistics (DCACHE_STATS) */
 
 /* MMC/SDC specific ioctl command */
 #define MMC_GET_TYPE		10	/* Get card type */
@@ -80,6 +83,14 @@ typedef enum {
 #define CT_BLOCK			0x08		/* Block addressing */
 
 
+/* Sector cache statistics (CTRL_CACHE_STATS) */
+typedef struct {
+	DWORD hits;				/* Sectors read or written in the cache */
+	DWORD misses;			/* Sectors read from the card, into the cache */
+	DWORD writebacks;		/* Dirty sectors written to the card */
+} DCACHE_STATS;
+
+
 /*---------------------------------------
  *
  * Prototypes for public disk control functions
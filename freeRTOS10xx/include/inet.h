@@ -76,6 +76,13 @@ extern uint8_t src_mac_addr[];					// Local MAC address, defined in main program
 #define HTTP_FS				1		// Drive number for HTTP - see _FS_LOCK  and _VOLUMES in ffconfig.h
 #define HTTP_PATH				"/http" // directory for web server. Files placed here will be seen in http root.
 #define MAX_URI_SIZE			1024 	// Length of the requested file URI.
+#define HTTP_MAX_SOCKETS		(_WIZCHIP_MAX_SOC_NUM_ - 2)	// Listening sockets for the HTTP server, leaving sockets for DHCP and NTP.
+#define HTTP_KEEPALIVE_TIMEOUT	5000	// Close an idle persistent connection after this many milliseconds.
+#ifdef __DEF_WIZCHIP_INT__
+#define HTTP_POLL_PERIOD		256		// Milliseconds between polls of the HTTP sockets, when none are busy. Socket events wake the server sooner.
+#else
+#define HTTP_POLL_PERIOD		32		// Milliseconds between polls of the HTTP sockets, when none are busy.
+#endif
 
 
 /* DHCP state machine. */
@@ -156,8 +163,8 @@ extern uint8_t src_mac_addr[];					// Local MAC address, defined in main program
 #define		MAX_INT_STR		80
 
 /* HTML Doc. for ERROR */
-#define ERROR_HTML_PAGE PSTR("HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 95\r\n\r\n<HTML>\r\n<BODY>\r\nDoh! The page you requested was not found.\r\n</BODY>\r\n</HTML>\r\n\0")
-#define ERROR_REQUEST_PAGE PSTR("HTTP/1.1 400 OK\r\nContent-Type: text/html\r\nContent-Length: 93\r\n\r\n<HTML>\r\n<BODY>\r\nDoh! Invalid request.\r\n</BODY>\r\n</HTML>\r\n\0")
+#define ERROR_HTML_PAGE PSTR("HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: 78\r\n\r\n<HTML>\r\n<BODY>\r\nDoh! The page you requested was not found.\r\n</BODY>\r\n</HTML>\r\n\0")
+#define ERROR_REQUEST_PAGE PSTR("HTTP/1.1 400 OK\r\nContent-Type: text/html\r\nContent-Length: 57\r\n\r\n<HTML>\r\n<BODY>\r\nDoh! Invalid request.\r\n</BODY>\r\n</HTML>\r\n\0")
 
 /* Response header for HTML*/
 #define RES_HTMLHEAD_OK	PSTR("HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: ")
@@ -452,8 +459,12 @@ void	check_NTP (SOCKET s);					// Check system_time against NTP time
 uint8_t init_HTTP(SOCKET s);				// Initialise the socket & buffers for HTTP server
 SOCKET	get_HTTP_socket(void);				// Get the socket assigned for HTTPD
 
+uint8_t init_HTTP_server(uint8_t count);	// Initialise up to count listening sockets & buffers for HTTP server
+uint8_t serve_HTTP(void);					// Service each HTTP server socket once, returns the number of busy sockets
+uint8_t wait_HTTP(TickType_t timeout);		// Wait for events on the HTTP server sockets, for when serve_HTTP() found none busy
+
 /* http service */
-void process_HTTP(SOCKET s, uint8_t *buf, uint16_t len);		// processing HTTP
+uint8_t process_HTTP(SOCKET s, uint8_t *buf, uint16_t len);	// processing HTTP, returns 0 if the whole response didn't go out
 
 void unescape_HTTP_URL(uint8_t *url);								/* convert escape character to ascii */
 void parse_HTTP_request(HTTP_REQUEST *request, uint8_t *buf);		/* parse request from peer */
@@ -461,6 +472,7 @@ void find_HTTP_URI_type(uint8_t *type, uint8_t *buf);				/* find MIME type of a
 void make_HTTP_response_header(uint8_t *buf, uint8_t type, uint32_t len);	/* make response header */
 uint8_t* get_HTTP_param_value(uint8_t *uri, uint8_t *param_name);	/* get the user-specific parameter value */
 uint8_t* get_HTTP_URI_name(uint8_t *uri);
+uint8_t get_HTTP_keep_alive(uint8_t *buf);							/* check whether the peer wants a persistent connection */
 
 
 #ifdef __cplusplus
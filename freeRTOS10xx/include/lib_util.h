@@ -15,6 +15,12 @@ uint8_t crc8( const uint8_t *data, uint16_t number_of_bytes_in_data ) __attribut
 
 uint16_t crc16( const uint8_t *data, uint16_t number_of_bytes_in_data, uint16_t init ) __attribute__ ((hot, flatten));
 
+/* Streaming versions, to continue a CRC across chunks of data as they arrive. */
+
+uint8_t crc8_update( uint8_t crc, const uint8_t *data, uint16_t number_of_bytes_in_data ) __attribute__ ((hot, flatten));
+
+uint16_t crc16_update( uint16_t crc, const uint8_t *data, uint16_t number_of_bytes_in_data ) __attribute__ ((hot, flatten));
+
 #define crc16_calc	crc16
 
 #define CRC16XMODEM_INIT 0x0000
@@ -110,6 +110,29 @@ typedef unsigned char UBaseType_t;
 extern void vPortYield( void )          __attribute__ ( ( naked ) );
 #define portYIELD()                     vPortYield()
 
+/* Tickless idle. */
+#if ( configUSE_TICKLESS_IDLE == 1 )
+extern void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+#endif
+
+/* Run time stats, from a free running 16 bit timer extended to 32 bits. */
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+extern void vPortConfigureTimerForRunTimeStats( void );
+extern uint32_t ulPortGetRunTimeCounterValue( void );
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    vPortConfigureTimerForRunTimeStats()
+#define portGET_RUN_TIME_COUNTER_VALUE()            ulPortGetRunTimeCounterValue()
+#endif
+
+/* Interrupt entry and exit trace hooks, defined in FreeRTOSConfig.h when the trace recorder is used. */
+#ifndef traceISR_ENTER
+    #define traceISR_ENTER( ucIsrId )
+#endif
+
+#ifndef traceISR_EXIT
+    #define traceISR_EXIT( ucIsrId )
+#endif
+
 /*-----------------------------------------------------------*/
 
 #if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega2561__)
@@ -57,6 +57,8 @@ extern "C" {
 
 #define configTOTAL_RAMFS_SIZE 		XRAMEND - XRAMSTART		// and continue for (32k -1)Byte.  XRAMEND is a system define on 2560 & 2561
 
+#define configRAMFS_MAX_BLOCKS		16				// Number of allocated and free blocks tracked by vRAMFSMalloc(), 4 Bytes each of Client RAM.
+
 #define HIGH_BITS					(uint8_t) 0xFF	// All bits set to one.
 
 //#define ARDUSAT_HARDWARE					// if we have full 16x clients rather than just 8x found on the analogue pins.
@@ -86,7 +88,8 @@ typedef enum {
 	Disk_Read = 6,		// read from the remote disk
 	Disk_Write = 7,		// write to the remote disk
 	Disk_IOCtl = 8,		// do some IO control on the disk.
-	Test 				// do something else, to be determined
+	Test, 				// do something else, to be determined
+	Batch = 10			// a vector of Read / Write / Swap operations in one SS session
 } RAMFSCommand; // from point of view of the client (Arduino 328p)
 
 
@@ -101,6 +104,23 @@ typedef struct						/* structure to hold the RAMFS info */
 } xRAMFSarray, * pRAMFSarray;
 
 
+typedef struct						/* structure to hold one operation of a Batch */
+{
+	RAMFSCommand	ram_cmd;		// Read / Write / Swap
+	size_t   		ram_addr;		// Address of first byte of RAM in a RAMFS (greater than RAM_START_ADDR)
+	uint16_t   		ram_size;		// Size of RAM block in RAMFS (greater than 0, and less than RAM_COUNT or 32kByte)
+} xRAMFSop, * pRAMFSop;
+
+/*
+ * Batch protocol, in one SS session.
+ *
+ * The Client sends an xRAMFSarray with ram_cmd Batch, ram_addr XRAMSTART and ram_size the number of operations.
+ * Then for each operation, the Client sends its xRAMFSop, followed directly by the data transfer for that operation.
+ * There is only one check byte (0xA5 / 0x5A) at the end of the session, rather than one for each operation.
+ * If the Supervisor finds a phony operation it releases the SS line, and the whole Batch fails.
+ */
+
+
 #if defined(__AVR_ATmega640__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega1281__) || defined(__AVR_ATmega2560__) || defined(__AVR_ATmega2561__)
 
 /*
@@ -122,14 +142,21 @@ void init16PCINTpins(void) __attribute__ ((flatten));
  */
 uint8_t ramfs_transfer_block(pRAMFSarray pRAMFS_block, uint8_t *data);
 
+/** Returns 0 if all count operations of the Batch are successful, 1 if failed.
+    Each operation transfers between the RAMFS and its own local data[] buffer.
+ */
+uint8_t ramfs_transfer_batch(pRAMFSop pRAMFS_ops, uint8_t * const data[], uint8_t count);
+
 /*
  * Memory management routines required for RAMFS.
  *
  */
-size_t vRAMFSMalloc( size_t xSize );
-void vRAMFSFree( size_t v );
-void vRAMFSInitialiseBlocks( void );
-size_t xRAMFSGetFreeSize( void );
+size_t vRAMFSMalloc( size_t xSize );			// Returns the remote address of the block, or 0 if failed.
+void vRAMFSFree( size_t v );					// Returns the block to the RAMFS, merging it with free neighbours.
+void vRAMFSInitialiseBlocks( void );			// Forgets all blocks, leaving the whole window free.
+void vRAMFSSetQuota( size_t xQuota );			// Limits the bytes this Client may have allocated from the RAMFS.
+size_t xRAMFSGetFreeSize( void );				// Total free bytes available to this Client.
+size_t xRAMFSGetLargestFreeBlock( void );		// Largest single block that could be allocated now.
 
 /*
  *	NOTE:
@@ -81,6 +81,9 @@
 #ifndef __RING_BUFFER_H__
 #define __RING_BUFFER_H__
 
+#include <string.h>
+#include <util/atomic.h>
+
 #include "FreeRTOS.h"
 
 /* Enable C linkage for C++ Compilers: */
@@ -369,6 +372,343 @@ ringBuffer_Peek(ringBuffer_t* const buffer)
 	return *buffer->out;
 }
 
+/************************** SPSC Ring Buffer: ***************************/
+/** \brief Single Producer / Single Consumer Ring Buffer Management Structure.
+ *
+ *  Type define for a lock free ring buffer object, for use where exactly one execution thread
+ *  (a task or an ISR) inserts and exactly one execution thread removes. There is no shared count.
+ *  The producer only ever writes the \c in index, and the consumer only ever writes the \c out index.
+ *  Both indices are free running, and are masked into the underlying storage array, so the size must
+ *  be a power of two. Buffers should be initialized via a call to \ref ringBufferSPSC_InitBuffer() before use.
+ *
+ *  The AVR can't load or store a 16 bit index in one instruction, so each index is snapshot or
+ *  published with interrupts held off for just that two byte move. There is never a read-modify-write
+ *  of shared state, and the bulk functions publish each index only once per call.
+ */
+typedef struct
+{
+	volatile uint16_t in;		/**< Free running storage index, only written by the producer. */
+	volatile uint16_t out;		/**< Free running retrieval index, only written by the consumer. */
+	uint8_t* start;				/**< Pointer to the start of the buffer's underlying storage array. */
+	uint16_t mask;				/**< Size of the buffer's underlying storage array, less one. */
+	uint16_t size;				/**< Size of the buffer's underlying storage array, a power of two. */
+} ringBufferSPSC_t, * ringBufferSPSCPtr_t;
+
+/** Initializes a SPSC ring buffer ready for use. The size must be a power of two, and this is checked with
+ *  \c configASSERT(). Without \c configASSERT() defined, only the largest power of two that fits within the
+ *  underlying storage array will be used, so the rest of the array is wasted.
+ *
+ *  \param[out] buffer   Pointer to a ring buffer structure to initialize.
+ *  \param[out] dataPtr  Pointer to a global array that will hold the data stored into the ring buffer.
+ *  \param[out] size     Maximum number of bytes that can be stored in the underlying data array.
+ */
+inline void
+ringBufferSPSC_InitBuffer(	ringBufferSPSC_t* buffer,
+							uint8_t* const dataPtr,
+							const uint16_t size) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2) ATTR_ALWAYS_INLINE;
+
+/** Flushes the contents of a SPSC ring buffer. Only the consumer may flush the buffer,
+ *  or the producer when the consumer is known to be stopped (eg. Tx interrupt disabled).
+ *
+ *  \param[out] buffer   Pointer to a ring buffer structure to flush out.
+ */
+inline void
+ringBufferSPSC_Flush(ringBufferSPSC_t* const buffer) ATTR_NON_NULL_PTR_ARG(1) ATTR_ALWAYS_INLINE;
+
+/** Retrieves the current number of bytes stored in a particular buffer. As with \ref ringBuffer_GetCount()
+ *  the consumer sees the minimum, and the producer sees the maximum, number of bytes stored.
+ *
+ *  \param[in] buffer  Pointer to a ring buffer structure whose count is to be computed.
+ *
+ *  \return Number of bytes currently stored in the buffer.
+ */
+inline uint16_t
+ringBufferSPSC_GetCount(ringBufferSPSC_t* const buffer) ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(1) ATTR_ALWAYS_INLINE;
+
+/** Retrieves the free space in a particular buffer.
+ *
+ *  \param[in] buffer  Pointer to a ring buffer structure whose free count is to be computed.
+ *
+ *  \return Number of free bytes in the buffer.
+ */
+inline uint16_t
+ringBufferSPSC_GetFreeCount(ringBufferSPSC_t* const buffer) ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(1) ATTR_ALWAYS_INLINE;
+
+/** Determines if the specified ring buffer contains any data.
+ *
+ *  \param[in,out] buffer  Pointer to a ring buffer structure to test.
+ *
+ *  \return Boolean \c true if the buffer contains no data, \c false otherwise.
+ */
+inline uint8_t
+ringBufferSPSC_IsEmpty(ringBufferSPSC_t* const buffer) ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(1) ATTR_ALWAYS_INLINE;
+
+/** Determines if the specified ring buffer contains any free space.
+ *
+ *  \param[in,out] buffer  Pointer to a ring buffer structure to test.
+ *
+ *  \return Boolean \c true if the buffer contains no free space, \c false otherwise.
+ */
+inline uint8_t
+ringBufferSPSC_IsFull(ringBufferSPSC_t* const buffer) ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(1) ATTR_ALWAYS_INLINE;
+
+/** Inserts an element into the ring buffer. The producer must have checked there is free space.
+ *
+ *  \param[in,out] buffer  Pointer to a ring buffer structure to insert into.
+ *  \param[in]     data    Data element to insert into the buffer.
+ */
+inline void
+ringBufferSPSC_Poke(ringBufferSPSC_t* buffer, const uint8_t data) ATTR_NON_NULL_PTR_ARG(1) ATTR_ALWAYS_INLINE;
+
+/** Removes an element from the ring buffer. The consumer must have checked there is data available.
+ *
+ *  \param[in,out] buffer  Pointer to a ring buffer structure to retrieve from.
+ *
+ *  \return Next data element stored in the buffer.
+ */
+inline uint8_t
+ringBufferSPSC_Pop(ringBufferSPSC_t* buffer) ATTR_NON_NULL_PTR_ARG(1) ATTR_ALWAYS_INLINE;
+
+/** Returns the next element stored in the ring buffer, without removing it.
+ *
+ *  \param[in,out] buffer  Pointer to a ring buffer structure to retrieve from.
+ *
+ *  \return Next data element stored in the buffer.
+ */
+inline uint8_t
+ringBufferSPSC_Peek(ringBufferSPSC_t* const buffer) ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(1) ATTR_ALWAYS_INLINE;
+
+/** Inserts as many elements as will fit into the ring buffer, using at most two memcpy().
+ *
+ *  \param[in,out] buffer  Pointer to a ring buffer structure to insert into.
+ *  \param[in]     dataPtr Pointer to the elements to insert.
+ *  \param[in]     length  Number of elements to insert.
+ *
+ *  \return Number of elements actually inserted.
+ */
+inline uint16_t
+ringBufferSPSC_PokeN(ringBufferSPSC_t* buffer, const uint8_t * dataPtr, uint16_t length) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2) ATTR_ALWAYS_INLINE;
+
+/** Removes as many elements as are available (up to length) from the ring buffer, using at most two memcpy().
+ *
+ *  \param[in,out] buffer  Pointer to a ring buffer structure to retrieve from.
+ *  \param[out]    dataPtr Pointer to the destination for the removed elements.
+ *  \param[in]     length  Maximum number of elements to remove.
+ *
+ *  \return Number of elements actually removed.
+ */
+inline uint16_t
+ringBufferSPSC_PopN(ringBufferSPSC_t* buffer, uint8_t * dataPtr, uint16_t length) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2) ATTR_ALWAYS_INLINE;
+
+/** Finds the stored elements which are contiguous in the underlying storage array, starting at the next
+ *  element to be removed, so that the consumer can use them in place. Once used, they are removed with
+ *  \ref ringBufferSPSC_Discard().
+ *
+ *  \param[in]  buffer   Pointer to a ring buffer structure to inspect.
+ *  \param[out] spanPtr  Set to point to the next element stored in the buffer.
+ *
+ *  \return Number of contiguous elements available at spanPtr.
+ */
+inline uint16_t
+ringBufferSPSC_GetLinearSpan(ringBufferSPSC_t* const buffer, uint8_t ** spanPtr) ATTR_WARN_UNUSED_RESULT ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2) ATTR_ALWAYS_INLINE;
+
+/** Removes elements from the ring buffer without reading them, typically after \ref ringBufferSPSC_GetLinearSpan().
+ *
+ *  \param[in,out] buffer  Pointer to a ring buffer structure to discard from.
+ *  \param[in]     length  Number of elements to discard, no more than are stored.
+ */
+inline void
+ringBufferSPSC_Discard(ringBufferSPSC_t* buffer, const uint16_t length) ATTR_NON_NULL_PTR_ARG(1) ATTR_ALWAYS_INLINE;
+
+
+/* Snapshot and publish a free running index, which is written from another thread of execution. */
+inline uint16_t
+ringBufferSPSC_LoadIndex(volatile uint16_t * const index) ATTR_ALWAYS_INLINE;
+
+inline void
+ringBufferSPSC_StoreIndex(volatile uint16_t * const index, const uint16_t value) ATTR_ALWAYS_INLINE;
+
+
+inline uint16_t
+ringBufferSPSC_LoadIndex(volatile uint16_t * const index)
+{
+	uint16_t value;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		value = *index;
+	}
+	return value;
+}
+
+inline void
+ringBufferSPSC_StoreIndex(volatile uint16_t * const index, const uint16_t value)
+{
+	GCC_MEMORY_BARRIER();	// data must be in (or out of) the array, before the index moves.
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		*index = value;
+	}
+}
+
+inline void
+ringBufferSPSC_InitBuffer(	ringBufferSPSC_t* buffer,
+							uint8_t* const dataPtr,
+							uint16_t const size)
+{
+	uint16_t pow2 = 0x8000;
+
+	GCC_FORCE_POINTER_ACCESS(buffer);
+
+	configASSERT( (size != 0) && ((size & (size - 1)) == 0) );	// the masking needs a power of two.
+
+	while( pow2 > size )		// use the largest power of two that fits the storage array.
+		pow2 >>= 1;
+
+	portENTER_CRITICAL();
+	{
+		buffer->in     = 0;
+		buffer->out    = 0;
+		buffer->start  = dataPtr;
+		buffer->mask   = pow2 - 1;
+		buffer->size   = pow2;
+	}
+	portEXIT_CRITICAL();
+}
+
+inline void
+ringBufferSPSC_Flush(ringBufferSPSC_t* const buffer)
+{
+	ringBufferSPSC_StoreIndex( &buffer->out, ringBufferSPSC_LoadIndex( &buffer->in ) );
+}
+
+inline uint16_t
+ringBufferSPSC_GetCount(ringBufferSPSC_t* const buffer)
+{
+	return (uint16_t)(ringBufferSPSC_LoadIndex( &buffer->in ) - ringBufferSPSC_LoadIndex( &buffer->out ));
+}
+
+inline uint16_t
+ringBufferSPSC_GetFreeCount(ringBufferSPSC_t* const buffer)
+{
+	return (buffer->size - ringBufferSPSC_GetCount(buffer));
+}
+
+inline uint8_t
+ringBufferSPSC_IsEmpty(ringBufferSPSC_t* const buffer)
+{
+	return (ringBufferSPSC_GetCount(buffer) == 0);
+}
+
+inline uint8_t
+ringBufferSPSC_IsFull(ringBufferSPSC_t* const buffer)
+{
+	return (ringBufferSPSC_GetCount(buffer) == buffer->size);
+}
+
+inline void
+ringBufferSPSC_Poke(ringBufferSPSC_t* buffer, uint8_t const data)
+{
+	GCC_FORCE_POINTER_ACCESS(buffer);
+
+	uint16_t in = buffer->in;	// only the producer writes in, so no snapshot is needed.
+
+	buffer->start[in & buffer->mask] = data;
+
+	ringBufferSPSC_StoreIndex( &buffer->in, in + 1 );
+}
+
+inline uint8_t
+ringBufferSPSC_Pop(ringBufferSPSC_t* buffer)
+{
+	GCC_FORCE_POINTER_ACCESS(buffer);
+
+	uint16_t out = buffer->out;	// only the consumer writes out, so no snapshot is needed.
+
+	uint8_t data = buffer->start[out & buffer->mask];
+
+	ringBufferSPSC_StoreIndex( &buffer->out, out + 1 );
+
+	return data;
+}
+
+inline uint8_t
+ringBufferSPSC_Peek(ringBufferSPSC_t* const buffer)
+{
+	return buffer->start[buffer->out & buffer->mask];
+}
+
+inline uint16_t
+ringBufferSPSC_GetLinearSpan(ringBufferSPSC_t* const buffer, uint8_t ** spanPtr)
+{
+	uint16_t count = ringBufferSPSC_GetCount(buffer);
+	uint16_t offset = buffer->out & buffer->mask;
+
+	*spanPtr = &buffer->start[offset];
+
+	if( count > buffer->size - offset )
+		count = buffer->size - offset;
+
+	return count;
+}
+
+inline void
+ringBufferSPSC_Discard(ringBufferSPSC_t* buffer, const uint16_t length)
+{
+	ringBufferSPSC_StoreIndex( &buffer->out, buffer->out + length );
+}
+
+inline uint16_t
+ringBufferSPSC_PokeN(ringBufferSPSC_t* buffer, const uint8_t * dataPtr, uint16_t length)
+{
+	GCC_FORCE_POINTER_ACCESS(buffer);
+
+	uint16_t in = buffer->in;
+	uint16_t space = buffer->size - (uint16_t)(in - ringBufferSPSC_LoadIndex( &buffer->out ));
+	uint16_t offset = in & buffer->mask;
+	uint16_t first;
+
+	if( length > space )
+		length = space;
+
+	first = buffer->size - offset;		// space to the end of the storage array.
+	if( first > length )
+		first = length;
+
+	memcpy( &buffer->start[offset], dataPtr, first );
+	memcpy( buffer->start, dataPtr + first, length - first );
+
+	ringBufferSPSC_StoreIndex( &buffer->in, in + length );
+
+	return length;
+}
+
+inline uint16_t
+ringBufferSPSC_PopN(ringBufferSPSC_t* buffer, uint8_t * dataPtr, uint16_t length)
+{
+	GCC_FORCE_POINTER_ACCESS(buffer);
+
+	uint16_t out = buffer->out;
+	uint16_t count = (uint16_t)(ringBufferSPSC_LoadIndex( &buffer->in ) - out);
+	uint16_t offset = out & buffer->mask;
+	uint16_t first;
+
+	if( length > count )
+		length = count;
+
+	first = buffer->size - offset;		// elements to the end of the storage array.
+	if( first > length )
+		first = length;
+
+	memcpy( dataPtr, &buffer->start[offset], first );
+	memcpy( dataPtr + first, buffer->start, length - first );
+
+	ringBufferSPSC_StoreIndex( &buffer->out, out + length );
+
+	return length;
+}
+
 /* Disable C linkage for C++ Compilers: */
 #if defined(__cplusplus)
 }
@@ -14,6 +14,7 @@
 #include <avr/pgmspace.h>
 
 #include "FreeRTOS.h"
+#include "task.h"
 #include "queue.h"
 #include "portable.h"
 
@@ -41,11 +42,25 @@ typedef enum
 	ENGAGED
 } binary;
 
+typedef struct
+{
+	const uint8_t * volatile data;	// next byte of a borrowed block to transmit, or NULL if there is no block pending.
+	volatile uint16_t length;		// number of bytes of the block remaining to transmit.
+	uint16_t mark;					// xCharsForTx index at which the block is spliced into the transmitted stream.
+	void (*complete)(void * context);	// called from the UDRE ISR once the last byte of the block is in UDR.
+	void * context;					// passed to the completion callback.
+} xSerialTxBlock;
+
 typedef struct
 {
 	eCOMPort usart;
-	ringBuffer_t xRxedChars;
-	ringBuffer_t xCharsForTx;
+	ringBufferSPSC_t xRxedChars;	// filled by the Rx ISR, emptied by a single consumer task.
+	ringBufferSPSC_t xCharsForTx;	// filled by a single producer task, emptied by the UDRE ISR.
+	xSerialTxBlock xTxBlock;		// a borrowed block, transmitted directly by the UDRE ISR.
+	TaskHandle_t xTxWaitingTask;	// task sleeping until the borrowed block, or the work buffer, is released, or NULL.
+	TaskHandle_t xRxWaitingTask;	// task blocked in xSerialReadUntil(), to be notified by the Rx ISR, or NULL.
+	uint16_t rxWakeCount;			// notify the waiting task once this many characters are available,
+	int16_t rxWakeDelimiter;		// or once this character is received (-1 for none).
 	uint8_t *serialWorkBuffer;		// create a working buffer pointer, to later be malloc() on the heap.
 	uint16_t serialWorkBufferSize;	// size of working buffer as created on the heap.
 	binary	serialWorkBufferInUse;	// flag to prevent overwriting by multiple tasks using the same USART.
@@ -78,6 +93,7 @@ extern xComPortHandle xSerial3Port;
 
 /*----------------------------------------------------------*/
 
+// The Tx and Rx queue lengths are the sizes of the ring buffers, and must each be a power of two.
 xComPortHandle xSerialPortInitMinimal( eCOMPort ePort, uint32_t ulWantedBaud, uint16_t uxTxQueueLength, uint16_t uxRxQueueLength );
 // xComPortHandle xSerialPortInit( eCOMPort ePort, eBaud eWantedBaud, eParity eWantedParity, eDataBits eWantedDataBits, eStopBits eWantedStopBits, unsigned portBASE_TYPE uxBufferLength );
 
@@ -95,6 +111,7 @@ void vSerialClose( const xComPortHandlePtr oldComPortPtr );
  * overhead to build this semaphore into the print functions themselves.
  *
  * This is now alleviated by using xSerialPort.serialWorkBufferInUse in xSerialPrintf(_P)();
+ * A task finding the work buffer in use sleeps until the UDRE ISR has transmitted it.
  */
 
 /**
@@ -136,6 +153,36 @@ uint16_t xSerialAvailableChar( const xComPortHandlePtr pxPort ) __attribute__ ((
 
 UBaseType_t xSerialGetChar( const xComPortHandlePtr pxPort, UBaseType_t *pcRxedChar ) __attribute__ ((hot, flatten));
 UBaseType_t xSerialPutChar( const xComPortHandlePtr pxPort, const UBaseType_t cOutChar ) __attribute__ ((hot, flatten));
+
+/**
+ * Block routines, which move a whole span through the ring buffers with memcpy().
+ * Each returns the number of characters actually moved, which may be less than uxLength.
+ */
+uint16_t xSerialGetBlock( const xComPortHandlePtr pxPort, uint8_t * pxBuffer, const uint16_t uxLength ) __attribute__ ((hot, flatten));
+uint16_t xSerialPutBlock( const xComPortHandlePtr pxPort, const uint8_t * pxBuffer, const uint16_t uxLength ) __attribute__ ((hot, flatten));
+
+/**
+ * Blocking receive. Read up to uxMaximum characters into pxBuffer, returning once uxMaximum are read,
+ * or once xDelimiter (which is stored) is read, or once the line has been idle for xIdleTimeout ticks.
+ * The calling task sleeps on a direct to task notification from the Rx ISR, rather than polling.
+ * Pass -1 as xDelimiter for no delimiter, and portMAX_DELAY to wait without an idle timeout.
+ * Only one task may wait on each port. Returns the number of characters read.
+ */
+uint16_t xSerialReadUntil( const xComPortHandlePtr pxPort, uint8_t * pxBuffer, const uint16_t uxMaximum, const int16_t xDelimiter, const TickType_t xIdleTimeout );
+
+/**
+ * Sleep, without taking any characters, until uxCount characters are available, or xDelimiter is received,
+ * or xTimeout ticks pass. For tasks that scan the Rx ring buffer in place. Returns the number of characters available.
+ */
+uint16_t xSerialWaitChar( const xComPortHandlePtr pxPort, const uint16_t uxCount, const int16_t xDelimiter, const TickType_t xTimeout );
+
+/**
+ * Zero copy transmit. The buffer is borrowed, not copied, and is sent directly by the UDRE ISR
+ * in order with any characters already put on the Tx ring buffer. The buffer must not be changed
+ * until vComplete (which may be NULL) is called from the ISR, with pvContext, after its last byte.
+ * Only one block may be pending per port, so this sleeps until any previous block has been sent.
+ */
+void xSerialWrite( const xComPortHandlePtr pxPort, const uint8_t * pxBuffer, const uint16_t uxLength, void (*vComplete)(void * pvContext), void * pvContext );
 /*-----------------------------------------------------------*/
 
 // Polling write and read routines, for use before freeRTOS vTaskStartScheduler
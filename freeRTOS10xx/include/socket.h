@@ -21,6 +21,10 @@
 
 #endif
 
+#include "ff.h"
+
+#define RECVFILE_CHUNK_SIZE	64		// Stack buffer used by recvfile() to pass received data to f_write()
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -39,6 +43,19 @@ uint16_t recvfrom(SOCKET s,     uint8_t * buf, uint16_t len, uint8_t * addr, uin
 uint16_t macraw_send( uint8_t * buf, uint16_t len); // Send data (MAC RAW) - Only SOCKET 0 supported by hardware
 uint16_t macraw_recv( uint8_t * buf, uint16_t len); // Receive data (MAC RAW) - Only SOCKET 0 supported by hardware
 
+uint8_t  socket_event_init(UBaseType_t uxPriority); // Start delivering socket events, from the INTn service task if __DEF_WIZCHIP_INT__
+uint8_t  socket_event_wait(SOCKET s, uint8_t events, TickType_t timeout); // Wait for any of the Sn_IR events, returns those that occurred
+uint8_t  socket_event_wait_any(uint8_t sockets, TickType_t timeout); // Wait for CON, DISCON, RECV or TIMEOUT on any of the sockets, returns those sockets
+uint16_t send_async(SOCKET s, const uint8_t * buf, uint16_t len); // Send data (TCP) without waiting for SEND_OK, 0 if busy
+uint16_t recv_wait(SOCKET s, uint8_t * buf, uint16_t len, TickType_t timeout); // Receive data (TCP), blocking until some arrives
+
+#if FF_USE_FORWARD
+uint32_t sendfile(SOCKET s, FIL * fp, uint32_t len); // Send data (TCP) from a file, via the FatFs sector window
+#endif
+#if !FF_FS_READONLY
+uint32_t recvfile(SOCKET s, FIL * fp, uint32_t len, TickType_t timeout); // Receive data (TCP) into a file
+#endif
+
 /******************************** Utility Functions ************************************/
 
 uint16_t htons(uint16_t hostshort);			/* converts a uint16_t from host to TCP/IP network byte order (which is big-endian).*/
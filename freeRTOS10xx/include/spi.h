@@ -55,6 +55,35 @@ typedef enum {
 					/* Add additional SS lines as necessary, and to spi.c */
 } SPI_SLAVE_SELECT;
 
+/*
+ * Device registry.
+ *
+ * Each device is registered once, with its data mode, clock divider and bit order.
+ * spiSelect() then applies those settings only when the bus changes to a different device,
+ * so drivers no longer need to set up the SPI control registers on every access.
+ *
+ * The bus is waited for on xSPISemaphore, a mutex, so pending spiSelect() calls are served
+ * in priority order (and in order of arrival at each priority), and a low priority task holding
+ * the bus (e.g. during a multi-sector SD write) inherits the priority of the task waiting for it.
+ *
+ * The time each device waits for the bus is counted, in ticks, to tune the task priorities.
+ */
+
+typedef struct
+{
+	SPI_MODE_t mode;				// data mode.
+	SPI_CLOCK_DIV_t rate;			// clock divider.
+	uint8_t bitOrder;				// SPI_MSBFIRST or SPI_LSBFIRST.
+	uint8_t registered;				// settings are applied by spiSelect().
+	uint16_t selects;				// number of times the device has been selected.
+	uint32_t waitTicks;				// total ticks spent waiting for the bus.
+	uint16_t maxWaitTicks;			// longest wait for the bus, in ticks.
+} spiDevice_t;
+
+void spiRegisterDevice(SPI_SLAVE_SELECT SS_pin, SPI_MODE_t mode, SPI_CLOCK_DIV_t rate, uint8_t bitOrder);
+const spiDevice_t * spiGetDevice(SPI_SLAVE_SELECT SS_pin);
+void spiResetDeviceStats(SPI_SLAVE_SELECT SS_pin);
+
 void spiSetClockDivider(SPI_CLOCK_DIV_t rate) __attribute__ ((flatten));
 void spiSetBitOrder(uint8_t bitOrder) __attribute__ ((flatten));
 void spiSetDataMode(SPI_MODE_t mode) __attribute__ ((flatten));
@@ -90,6 +119,34 @@ uint8_t spiMultiByteRx(uint8_t *data, const uint16_t length) __attribute__ ((hot
 
 uint8_t spiMultiByteTransfer(uint8_t *data, const uint16_t length) __attribute__ ((hot, flatten));
 
+/*
+ * Interrupt driven SPI transaction engine.
+ *
+ * A transaction selects the device, sets its data mode and clock divider, and then
+ * the SPI STC interrupt advances the bytes of the transaction (and of any transactions chained
+ * on next, which share the device and its settings), while the calling task sleeps on a
+ * direct to task notification until the transaction is complete. Other tasks run meanwhile.
+ *
+ * Transactions wait for the SPI bus on xSPISemaphore, so they are served in priority order
+ * (and in order of arrival at each priority) along with other spiSelect() users.
+ *
+ * At SPI_CLOCK_DIV8 and faster, a byte takes less time than the interrupt prologue and epilogue,
+ * so those transactions are transferred by polling instead. Nothing is saved by sleeping.
+ */
+
+typedef struct spiTransaction
+{
+	SPI_SLAVE_SELECT ss;			// device to select, for the first transaction of a chain.
+	SPI_MODE_t mode;				// data mode, for the first transaction of a chain.
+	SPI_CLOCK_DIV_t rate;			// clock divider, for the first transaction of a chain.
+	const uint8_t * txData;			// bytes to transmit, or NULL to transmit 0xFF.
+	uint8_t * rxData;				// buffer for received bytes, or NULL to discard them.
+	uint16_t length;				// number of bytes to transfer.
+	struct spiTransaction * next;	// next transaction, transferred with the device still selected, or NULL.
+} spiTransaction_t;
+
+uint8_t spiTransact(spiTransaction_t * transaction);	/* 1:Successful, 0:Timeout */
+
 #ifdef __cplusplus
 }
 #endif
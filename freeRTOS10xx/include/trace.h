@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2018 Phillip Stevens  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ *
+ * This file is NOT part of the FreeRTOS distribution.
+ *
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * Trace recorder. Time stamped task switch and interrupt records are put on a ring buffer
+ * by the kernel trace hooks (with configUSE_TRACE_RECORDER 1 in FreeRTOSConfig.h), and are
+ * streamed out of a serial port by vTraceStreamTask(), while the system runs.
+ *
+ * Stream format. Every record is TRACE_RECORD_SIZE (7) bytes:
+ *
+ *     0   TRACE_SYNC (0xA5), to find the record boundary when joining a stream.
+ *     1   event, TRACE_EVENT_xxx.
+ *     2   id, the task number (xTaskNumber from uxTaskGetSystemState()) or the TRACE_ISR_xxx number.
+ *     3-6 value, 32 bits little endian. The run time counter value, except where noted.
+ *
+ * The run time counter counts configCPU_CLOCK_HZ / 8 per second, and wraps at 32 bits.
+ * Every TRACE_NAME_PERIOD ticks the stream task also puts a TRACE_EVENT_TIMEBASE record,
+ * and TRACE_EVENT_TASK_NAME records for each task, so a host can join the stream at any time.
+ *
+ * From these a host can build a task timeline, CPU load per task, and interrupt service times.
+ * test/trace_decode.c is such a decoder, eg. make -C freeRTOS10xx/test trace_decode, then
+ * trace_decode < /dev/ttyUSB1 for the load of each task, the context switch rate, and a
+ * histogram of the service times of each interrupt.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_SYNC						0xA5
+#define TRACE_RECORD_SIZE				7
+
+#define TRACE_EVENT_TASK_SWITCHED_IN	0x01	// id is the task number.
+#define TRACE_EVENT_TASK_SWITCHED_OUT	0x02	// id is the task number.
+#define TRACE_EVENT_ISR_ENTER			0x03	// id is the TRACE_ISR_xxx number.
+#define TRACE_EVENT_ISR_EXIT			0x04	// id is the TRACE_ISR_xxx number.
+#define TRACE_EVENT_OVERFLOW			0x05	// id is the number of records lost (saturating at 255) before this one.
+#define TRACE_EVENT_TIMEBASE			0x06	// value is the run time counter rate in Hz, not a time stamp.
+#define TRACE_EVENT_TASK_NAME			0x10	// 0x10 to 0x1F, value is four characters of the task name, from
+												// the (event - 0x10) * 4 character. Names are padded with NUL.
+
+#define TRACE_ISR_TICK					0		// the scheduler tick, from portable/port.c.
+#define TRACE_ISR_USART0_RX				1		// the serial Rx interrupts, from lib_io/serial.c.
+#define TRACE_ISR_USART1_RX				2
+#define TRACE_ISR_USART2_RX				3
+#define TRACE_ISR_USART3_RX				4
+#define TRACE_ISR_USER					16		// first number for application interrupts using traceISR_ENTER().
+
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE				512		// bytes of record buffer, a power of two.
+#endif
+
+#ifndef TRACE_NAME_PERIOD
+#define TRACE_NAME_PERIOD				( 2 * configTICK_RATE_HZ )	// ticks between the timebase and task name records.
+#endif
+
+/*
+ * Put a time stamped record on the trace buffer. Callable from tasks and interrupts.
+ * Where the buffer is full, the record is counted and dropped, and reported with the next record that fits.
+ */
+void vTraceRecord( uint8_t ucEvent, uint8_t ucId ) __attribute__ ((hot));
+
+/*
+ * Trace stream task. pvParameters is the xComPortHandlePtr of the serial port to stream to,
+ * which should not be used for anything else. Create it at a low priority, after the port is initialised.
+ */
+void vTraceStreamTask( void *pvParameters );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H */
@@ -38,9 +38,9 @@ extern "C" {
 #define __DEF_WIZCHIP_MAP_RXBUF__ (COMMON_BASE + 0xC000) /* Internal Rx buffer address of the W5200 */
 
 #ifdef __DEF_WIZCHIP_INT__
-  // W5100 use external interrupt 4
-  #define WIZCHIP_ISR_DISABLE()	(EIMSK &= ~(0x10))
-  #define WIZCHIP_ISR_ENABLE()	(EIMSK |= 0x10)
+  // Wiznet INTn uses external interrupt WIZCHIP_INT, defined in wizchip_conf.h
+  #define WIZCHIP_ISR_DISABLE()	(EIMSK &= ~_BV(WIZCHIP_INT))
+  #define WIZCHIP_ISR_ENABLE()	(EIMSK |= _BV(WIZCHIP_INT))
   #define WIZCHIP_ISR_GET(X)		(X = EIMSK)
   #define WIZCHIP_ISR_SET(X)		(EIMSK = X)
 #else // leave the interrupts empty.
@@ -352,8 +352,6 @@ extern "C" {
 
 void	WIZCHIP_init(void); // reset W5200 - First call to make
 void	WIZCHIP_sysinit(uint8_t * tx_size, uint8_t * rx_size); // setting tx/rx buf size
-uint8_t	WIZCHIP_getISR(uint8_t s);
-void	WIZCHIP_putISR(uint8_t s, uint8_t val);
 
 uint8_t	 WIZCHIP_read(uint16_t addr) __attribute__ ((hot));
 uint8_t  WIZCHIP_write(uint16_t addr, uint8_t data) __attribute__ ((hot));
@@ -370,6 +368,8 @@ void	setRTR(uint16_t timeout); // set retry duration for data transmission, conn
 void	setRCR(uint8_t retry); // set retry count (above the value, assert timeout interrupt)
 void	setIMR(uint8_t mask); // set interrupt mask.
 uint8_t	getIR( void );
+void	setSIMR(uint8_t mask); // set socket interrupt mask.
+uint8_t	getSIR( void ); // get sockets with interrupt pending.
 void	setSn_MSS(SOCKET s, uint16_t Sn_MSSR); // set maximum segment size
 void	setSn_PROTO(SOCKET s, uint8_t proto); // set IP Protocol value using IP-Raw mode
 uint8_t  getSn_IR(SOCKET s); // get socket interrupt status
@@ -74,11 +74,26 @@
 
 // #define __DEF_WIZCHIP_DBG__ 	/* involve debug code in driver (in socket.c) */
 // #define __DEF_WIZCHIP_DBG2__ /* involve debug other code in driver (in socket.c) */
-// #define __DEF_WIZCHIP_INT__ 	/* involve interrupt service routine (in socket.c) */
+#if defined(portWIZCHIP_INT)			/* board option, in FreeRTOSBoardDefs.h */
+#define __DEF_WIZCHIP_INT__ 	/* involve interrupt service routine (in socket.c) */
+#endif
 // #define __DEF_WIZCHIP_PPP__ 	/* involve pppoe routine (in socket.c) */
                             	/* If it is defined, the source files(md5.h,md5.c) must be included in your project.
                                	   Otherwise, the source files must be removed in your project. */
 
+/* With __DEF_WIZCHIP_INT__ the Wiznet INTn must be connected to Arduino D2 (fit the INT jumper on the EtherMega).
+ * INTn is active low, and is used falling edge triggered. The socket events are delivered by socket_event_init().
+ * Without the jumper the service task still polls the sockets every 32ms, so the events are only delayed. */
+#if defined(__AVR_ATmega640__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega1281__) || defined(__AVR_ATmega2560__) || defined(__AVR_ATmega2561__)
+#define WIZCHIP_INT_vect			INT4_vect	// Arduino D2 is PE4, INT4 on the Mega
+#define WIZCHIP_INT					INT4
+#define WIZCHIP_INT_SETUP()			{ DDRE &= ~_BV(DDE4); PORTE |= _BV(PORTE4); EICRB = (EICRB & ~(_BV(ISC41) | _BV(ISC40))) | _BV(ISC41); EIFR = _BV(INTF4); }
+#elif defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__) || defined(__AVR_ATmega1284P__)
+#define WIZCHIP_INT_vect			INT0_vect	// Arduino D2 is PD2, INT0 on the Uno and Goldilocks
+#define WIZCHIP_INT					INT0
+#define WIZCHIP_INT_SETUP()			{ DDRD &= ~_BV(DDD2); PORTD |= _BV(PORTD2); EICRA = (EICRA & ~(_BV(ISC01) | _BV(ISC00))) | _BV(ISC01); EIFR = _BV(INTF0); }
+#endif
+
 
 #define _WIZCHIP_IO_MODE_NONE_         0x0000
 #define _WIZCHIP_IO_MODE_BUS_          0x0100 /**< Bus interface mode */
@@ -34,6 +34,7 @@ extern SemaphoreHandle_t xSPISemaphore;
 
 int8_t eefs_avrspi_begin(void)
 {
+	spiRegisterDevice(Default, SPI_MODE0, SPI_CLOCK_DIV2, SPI_MSBFIRST);	// register the RAM chips, for spiSelect(Default) users
 	spiSetDataMode(SPI_MODE0);			// Enable SPI function in mode 0
 	spiSetClockDivider(SPI_CLOCK_DIV2);	// SPI at maximum speed
 	spiBegin(Default);
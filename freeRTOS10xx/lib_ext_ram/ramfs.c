@@ -77,8 +77,29 @@ void init16PCINTpins(void)
 
 /******************** FUNCTIONS FOR CLIENT TASKS ***********************/
 
-/* Count how much memory is allocated in the RAMFS by vRAMFSMalloc() */
-static size_t xNextFreeRAMFSByte = ( size_t ) 0;
+/* The remote RAMFS heap can't hold its own block links, as every access to the
+Supervisor RAM is an SPI transaction. So, as in heap_4.c, the blocks are kept in
+address order with adjacent free blocks merged, but the list is held here in the
+Client RAM, as a table of the remote blocks covering the whole RAMFS window. */
+typedef struct A_RAMFS_BLOCK
+{
+	size_t xBlockAddress;					/*<< The remote address of the block. */
+	size_t xBlockSize;						/*<< The size of the block, with xBlockAllocatedBit set if allocated. */
+} RAMFSBlock_t;
+
+static RAMFSBlock_t xRAMFSBlocks[ configRAMFS_MAX_BLOCKS ];
+static uint8_t uxRAMFSBlocks = 0;			/* Number of blocks in the table, 0 until initialised. */
+
+/* Free bytes, the quota of bytes this Client may allocate, and the bytes it has allocated. */
+static size_t xRAMFSFreeBytesRemaining = ( size_t ) 0;
+static size_t xRAMFSQuota = ( size_t ) ( configTOTAL_RAMFS_SIZE );
+static size_t xRAMFSAllocatedBytes = ( size_t ) 0;
+
+/* The top bit of the block size marks allocated blocks, as in heap_4.c. The window is only 32kByte. */
+#define xBlockAllocatedBit					( ( size_t ) 1 << ( ( sizeof( size_t ) * 8 ) - 1 ) )
+
+/* Free remainders smaller than this are left in the allocated block, rather than split off. */
+#define ramfsMINIMUM_BLOCK_SIZE				( ( size_t ) 8 )
 
 /*-----------------Private Functions ----------------------------*/
 
@@ -328,24 +349,168 @@ uint8_t ramfs_transfer_block(pRAMFSarray pRAMFS_block, uint8_t *data)
 
 /*-----------------------------------------------------------*/
 
-size_t vRAMFSMalloc( size_t xWantedSize )
+static uint8_t ramfs_slave_stream(const uint8_t *tx, uint8_t *rx, uint16_t size, uint8_t next) __attribute__ ((hot, flatten));
+
+static uint8_t ramfs_slave_stream(const uint8_t *tx, uint8_t *rx, uint16_t size, uint8_t next)
 {
-size_t vReturn = 0;
+	// SPDR is already loaded with the first byte to transmit (tx[0], or 0xFF if tx is NULL).
+	// Transfer size bytes, and leave the next byte loaded in SPDR, to begin the following phase of a Batch.
+	// Returns 1 if the Supervisor has released our SS line.
+
+	uint16_t index;
+	uint8_t TxByte, RxByte;
+
+	for( index = 0; index < size; ++index )
+	{
+		if( index < size - 1 )
+			TxByte = tx ? tx[ index + 1 ] : 0xFF;	// pre-load the byte to be transmitted
+		else
+			TxByte = next;
+
+		if( CHECK_FOR_MY_SS ) return 1;
+		while( WAIT_FOR_SPIF );
+
+		RxByte = SPDR;								// copy received byte
+		SPDR = TxByte;								// Continue transmission
+		if( rx ) rx[ index ] = RxByte;				// store the byte that was read, while transferring
+	}
+	return 0;
+}
+
+static inline uint8_t ramfs_slave_first(RAMFSCommand cmd, const uint8_t *data)
+{
+	return (cmd == Read) ? 0xFF : data[0];			// first byte of a data transfer, to pre-load.
+}
+
+uint8_t ramfs_transfer_batch(pRAMFSop pRAMFS_ops, uint8_t * const data[], uint8_t count)
+{
+	uint16_t index;
+	uint8_t TxRxByte;
+	uint8_t RxByte = 0x00;
+	uint8_t lost;
+	xRAMFSarray xRAMFS_block;			// this is just an array for XRAMFS info.
+
+	if( count == 0 ) return 0;
+
+	for( index = 0; index < count; ++index )	// check the operations, before calling the Supervisor.
+		if( (pRAMFS_ops[index].ram_cmd < Read) || (pRAMFS_ops[index].ram_cmd > Swap) || (pRAMFS_ops[index].ram_size == 0) )
+			return 1;
+
+	xRAMFS_block.ram_cmd  = Batch;
+	xRAMFS_block.ram_addr = (size_t) XRAMSTART;	// Set to a valid address, not used.
+	xRAMFS_block.ram_size = (uint16_t) count;	// number of operations in the Batch.
+
+	ramfs_transaction_init();	// set up the SPI bus for the RAMFS transaction.
+								// this is VERY time critical, so we do it in a MACRO to ensure there is no loss of time.
+								// Note unpaired in this function: taskENTER_CRITICAL();
 
+	SPDR = ((uint8_t *)&xRAMFS_block)[0];		// Begin transmission of the command structure (serialised)
 
-	/* Check there is enough room left for the allocation. */
-	if( ( ( xNextFreeRAMFSByte + xWantedSize ) < configTOTAL_RAMFS_SIZE ) &&
-		( ( xNextFreeRAMFSByte + xWantedSize ) > xNextFreeRAMFSByte )	)/* Check for overflow. */
+	lost = ramfs_slave_stream( (uint8_t *)&xRAMFS_block, NULL, sizeof(xRAMFSarray), ((uint8_t *)pRAMFS_ops)[0] );
+
+	for( index = 0; !lost && (index < count); ++index )
+	{
+		// send the operation, pre-loading the first byte of its data transfer.
+		lost = ramfs_slave_stream( (uint8_t *)&pRAMFS_ops[index], NULL, sizeof(xRAMFSop),
+									ramfs_slave_first( pRAMFS_ops[index].ram_cmd, data[index] ) );
+		if( lost ) break;
+
+		// transfer the data, pre-loading the first byte of the next operation, or the check byte.
+		TxRxByte = (index < count - 1) ? ((uint8_t *)&pRAMFS_ops[index + 1])[0] : 0xA5;
+
+		lost = ramfs_slave_stream( (pRAMFS_ops[index].ram_cmd == Read) ? NULL : data[index],
+									(pRAMFS_ops[index].ram_cmd == Write) ? NULL : data[index],
+									pRAMFS_ops[index].ram_size, TxRxByte );
+	}
+
+	if( !lost )
+		ramfs_slave_stream( NULL, &RxByte, 1, 0xFF );	// store the check byte
+
+	spiSlaveEnd();										// clean up the SPI bus for other Clients.
+	taskEXIT_CRITICAL();								// turn on interrupts
+
+	if( RxByte == 0x5A) 								// compare if the returned check byte is as expected?
+		return 0;										// return success!
+
+	return 1;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvRAMFSRemoveBlock( uint8_t uxBlock )
+{
+	for( --uxRAMFSBlocks; uxBlock < uxRAMFSBlocks; ++uxBlock )
+		xRAMFSBlocks[ uxBlock ] = xRAMFSBlocks[ uxBlock + 1 ];
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvRAMFSAllocate( size_t xWantedSize, BaseType_t xWithinQuota )
+{
+size_t vReturn = 0;
+uint8_t uxBlock;
+
+	vTaskSuspendAll();
 	{
-		/* Return the next free byte then increment the index past this
-		block. */
-		vReturn = (size_t) XRAMSTART + xNextFreeRAMFSByte;
-		xNextFreeRAMFSByte += xWantedSize;
+		/* If this is the first call to malloc then the block table will require
+		initialisation to setup the single free block covering the window. */
+		if( uxRAMFSBlocks == 0 )
+			vRAMFSInitialiseBlocks();
+
+		/* Check the requested block size is valid, and within the quota if it applies. */
+		if( ( xWantedSize > 0 ) && ( ( xWantedSize & xBlockAllocatedBit ) == 0 ) &&
+			( xWantedSize <= xRAMFSFreeBytesRemaining ) && 
+			( !xWithinQuota || ( ( xRAMFSAllocatedBytes <= xRAMFSQuota ) && ( xWantedSize <= xRAMFSQuota - xRAMFSAllocatedBytes ) ) ) )
+		{
+			/* Blocks are stored in address order, so traverse the table from the
+			start (lowest address) until a large enough free block is found. */
+			for( uxBlock = 0; uxBlock < uxRAMFSBlocks; ++uxBlock )
+			{
+				if( !( xRAMFSBlocks[ uxBlock ].xBlockSize & xBlockAllocatedBit ) && ( xRAMFSBlocks[ uxBlock ].xBlockSize >= xWantedSize ) )
+				{
+					/* If the block is larger than required it can be split into two,
+					provided there is a table entry for the remainder. */
+					if( ( ( xRAMFSBlocks[ uxBlock ].xBlockSize - xWantedSize ) >= ramfsMINIMUM_BLOCK_SIZE ) && ( uxRAMFSBlocks < configRAMFS_MAX_BLOCKS ) )
+					{
+						for( uint8_t uxMove = uxRAMFSBlocks++; uxMove > uxBlock + 1; --uxMove )
+							xRAMFSBlocks[ uxMove ] = xRAMFSBlocks[ uxMove - 1 ];
+
+						xRAMFSBlocks[ uxBlock + 1 ].xBlockAddress = xRAMFSBlocks[ uxBlock ].xBlockAddress + xWantedSize;
+						xRAMFSBlocks[ uxBlock + 1 ].xBlockSize = xRAMFSBlocks[ uxBlock ].xBlockSize - xWantedSize;
+						xRAMFSBlocks[ uxBlock ].xBlockSize = xWantedSize;
+					}
+
+					xRAMFSFreeBytesRemaining -= xRAMFSBlocks[ uxBlock ].xBlockSize;
+					xRAMFSAllocatedBytes += xRAMFSBlocks[ uxBlock ].xBlockSize;
+
+					/* The block is being returned - it is allocated and owned by the application. */
+					xRAMFSBlocks[ uxBlock ].xBlockSize |= xBlockAllocatedBit;
+					vReturn = xRAMFSBlocks[ uxBlock ].xBlockAddress;
+					break;
+				}
+			}
+		}
 	}
+	( void ) xTaskResumeAll();
+
+	return vReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvRAMFSGetScratch( size_t xWantedSize )
+{
+	/* Allocate a scratch block for the Supervisor to carry a disk transfer through, outside the
+	quota, as it is only held until the transfer completes. Freed with vRAMFSFree(). */
+	return prvRAMFSAllocate( xWantedSize, pdFALSE );
+}
+/*-----------------------------------------------------------*/
+
+size_t vRAMFSMalloc( size_t xWantedSize )
+{
+size_t vReturn = prvRAMFSAllocate( xWantedSize, pdTRUE );
 
 	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
 	{
-		if( pvReturn == NULL )
+		if( vReturn == 0 )
 		{
 			extern void vApplicationMallocFailedHook( void );
 			vApplicationMallocFailedHook();
@@ -359,24 +524,105 @@ size_t vReturn = 0;
 
 void vRAMFSFree( size_t v )
 {
-	/* Memory cannot be freed using this scheme. */
-	v = 0;
+uint8_t uxBlock;
+
+	if( v == 0 ) return;
+
+	vTaskSuspendAll();
+	{
+		for( uxBlock = 0; uxBlock < uxRAMFSBlocks; ++uxBlock )
+			if( xRAMFSBlocks[ uxBlock ].xBlockAddress == v )
+				break;
+
+		/* Check the block is actually allocated. */
+		configASSERT( ( uxBlock < uxRAMFSBlocks ) && ( xRAMFSBlocks[ uxBlock ].xBlockSize & xBlockAllocatedBit ) );
+
+		if( ( uxBlock < uxRAMFSBlocks ) && ( xRAMFSBlocks[ uxBlock ].xBlockSize & xBlockAllocatedBit ) )
+		{
+			/* The block is being returned to the heap - it is no longer allocated. */
+			xRAMFSBlocks[ uxBlock ].xBlockSize &= ~xBlockAllocatedBit;
+			xRAMFSFreeBytesRemaining += xRAMFSBlocks[ uxBlock ].xBlockSize;
+			xRAMFSAllocatedBytes -= xRAMFSBlocks[ uxBlock ].xBlockSize;
+
+			/* Merge with the block after, if it is free. */
+			if( ( uxBlock + 1 < uxRAMFSBlocks ) && !( xRAMFSBlocks[ uxBlock + 1 ].xBlockSize & xBlockAllocatedBit ) )
+			{
+				xRAMFSBlocks[ uxBlock ].xBlockSize += xRAMFSBlocks[ uxBlock + 1 ].xBlockSize;
+				prvRAMFSRemoveBlock( uxBlock + 1 );
+			}
 
-	/* Force an assert as it is invalid to call this function. */
-	configASSERT( pv == NULL );
+			/* Merge with the block before, if it is free. */
+			if( ( uxBlock > 0 ) && !( xRAMFSBlocks[ uxBlock - 1 ].xBlockSize & xBlockAllocatedBit ) )
+			{
+				xRAMFSBlocks[ uxBlock - 1 ].xBlockSize += xRAMFSBlocks[ uxBlock ].xBlockSize;
+				prvRAMFSRemoveBlock( uxBlock );
+			}
+		}
+	}
+	( void ) xTaskResumeAll();
 }
 /*-----------------------------------------------------------*/
 
 void vRAMFSInitialiseBlocks( void )
 {
-	/* Only required when static memory is not cleared. */
-	xNextFreeRAMFSByte = ( size_t ) 0;
+	/* One free block covering the whole remote RAMFS window. Any allocations are forgotten. */
+	xRAMFSBlocks[ 0 ].xBlockAddress = ( size_t ) XRAMSTART;
+	xRAMFSBlocks[ 0 ].xBlockSize = ( size_t ) ( configTOTAL_RAMFS_SIZE );
+	uxRAMFSBlocks = 1;
+
+	xRAMFSFreeBytesRemaining = ( size_t ) ( configTOTAL_RAMFS_SIZE );
+	xRAMFSAllocatedBytes = ( size_t ) 0;
+}
+/*-----------------------------------------------------------*/
+
+void vRAMFSSetQuota( size_t xQuota )
+{
+	xRAMFSQuota = xQuota;
 }
 /*-----------------------------------------------------------*/
 
 size_t xRAMFSGetFreeSize( void )
 {
-	return ( configTOTAL_RAMFS_SIZE - xNextFreeRAMFSByte );
+size_t xFree;
+
+	/* Free bytes available to this Client, being the lesser of its free window and its remaining quota. */
+	if( uxRAMFSBlocks == 0 )
+		xFree = ( size_t ) ( configTOTAL_RAMFS_SIZE );
+	else
+		xFree = xRAMFSFreeBytesRemaining;
+
+	if( xRAMFSAllocatedBytes >= xRAMFSQuota )
+		xFree = 0;							// a scratch transfer block may take the Client past its quota.
+	else if( xRAMFSQuota - xRAMFSAllocatedBytes < xFree )
+		xFree = xRAMFSQuota - xRAMFSAllocatedBytes;
+
+	return xFree;
+}
+/*-----------------------------------------------------------*/
+
+size_t xRAMFSGetLargestFreeBlock( void )
+{
+size_t xLargest = 0;
+uint8_t uxBlock;
+
+	/* Compared with xRAMFSGetFreeSize(), this shows how fragmented the window is. */
+	vTaskSuspendAll();
+	{
+		if( uxRAMFSBlocks == 0 )
+			vRAMFSInitialiseBlocks();
+
+		for( uxBlock = 0; uxBlock < uxRAMFSBlocks; ++uxBlock )
+			if( !( xRAMFSBlocks[ uxBlock ].xBlockSize & xBlockAllocatedBit ) && ( xRAMFSBlocks[ uxBlock ].xBlockSize > xLargest ) )
+				xLargest = xRAMFSBlocks[ uxBlock ].xBlockSize;
+	}
+	( void ) xTaskResumeAll();
+
+	if( xRAMFSAllocatedBytes >= xRAMFSQuota )
+		xLargest = 0;							// a scratch transfer block may take the Client past its quota.
+	else if( xRAMFSQuota - xRAMFSAllocatedBytes < xLargest )
+		xLargest = xRAMFSQuota - xRAMFSAllocatedBytes;
+
+	return xLargest;
 }
 /*-----------------------------------------------------------*/
 
@@ -397,7 +643,7 @@ DSTATUS disk_status (uint8_t pdrv)
 	if (pdrv) return STA_NOINIT;		// Supports only single drive, drive 0.
 
 	xRAMFS_block.ram_cmd  = Disk_Status;
-	xRAMFS_block.ram_addr = (size_t) (XRAMSTART + xNextFreeRAMFSByte); // Set to a valid address, not used.
+	xRAMFS_block.ram_addr = (size_t) XRAMSTART; // Set to a valid address, not used.
 	xRAMFS_block.ram_size = (uint16_t) 1;	// Set to a valid size, not used.
 
 	pRAM = (uint8_t *) &xRAMFS_block;	// make this cast to serialise the Command structure.
@@ -477,7 +723,7 @@ DSTATUS disk_initialize (uint8_t pdrv)
 	if (pdrv) return STA_NOINIT;		// Supports only single drive, drive 0.
 
 	xRAMFS_block.ram_cmd  = Disk_Init;
-	xRAMFS_block.ram_addr = (size_t) (XRAMSTART + xNextFreeRAMFSByte); // Set to a valid address, not used.
+	xRAMFS_block.ram_addr = (size_t) XRAMSTART; // Set to a valid address, not used.
 	xRAMFS_block.ram_size = (uint16_t) 1;	// Set to a valid size, not used.
 
 	pRAM = (uint8_t *) &xRAMFS_block; 	// make this cast to serialise the Command structure.
@@ -545,22 +791,13 @@ DSTATUS disk_initialize (uint8_t pdrv)
 }
 
 
-DRESULT disk_read (uint8_t pdrv, uint8_t* buff, uint32_t sector, uint8_t count)
+static DRESULT prvRAMFSDiskRead (const xRAMFSarray * pxRAMFS_block, uint8_t* buff)
 {
 	uint16_t index;
 	uint8_t TxRxByte;
-	xRAMFSarray xRAMFS_block;			// this is just an array for XRAMFS info.
-	uint8_t * pRAM;
-
-	if (pdrv || !count) return RES_PARERR;	// Supports only single drive, drive 0.
-
-	xRAMFS_block.ram_cmd  = Disk_Read;
-	xRAMFS_block.ram_addr = (size_t) (XRAMSTART + xNextFreeRAMFSByte); // Set to a valid address
-	xRAMFS_block.ram_size = count * 512;	// Set to a valid size
-	xRAMFS_block.disk_sector = sector;
-	xRAMFS_block.disk_sector_count = count;
+	const uint8_t * pRAM;
 
-	pRAM = (uint8_t *) &xRAMFS_block;	// make this cast to serialise the Command structure.
+	pRAM = (const uint8_t *) pxRAMFS_block;	// make this cast to serialise the Command structure.
 
 
 	do {
@@ -646,7 +883,7 @@ DRESULT disk_read (uint8_t pdrv, uint8_t* buff, uint32_t sector, uint8_t count)
 	}while (TxRxByte != RES_PENDING);
 
 	SPDR  = 0xFF;								// prepare a dummy byte.
-	while( index < xRAMFS_block.ram_size - 1 )
+	while( index < pxRAMFS_block->ram_size - 1 )
 	{
 		if( CHECK_FOR_MY_SS )
 		{
@@ -693,22 +930,33 @@ DRESULT disk_read (uint8_t pdrv, uint8_t* buff, uint32_t sector, uint8_t count)
 	return RES_ERROR;
 }
 
-DRESULT disk_write (uint8_t pdrv, const uint8_t* buff, uint32_t sector, uint8_t count)
+DRESULT disk_read (uint8_t pdrv, uint8_t* buff, uint32_t sector, uint8_t count)
 {
-	uint16_t index;
-	uint8_t TxRxByte;
+	DRESULT res;
 	xRAMFSarray xRAMFS_block;			// this is just an array for XRAMFS info.
-	uint8_t * pRAM;
 
 	if (pdrv || !count) return RES_PARERR;	// Supports only single drive, drive 0.
 
-	xRAMFS_block.ram_cmd  = Disk_Write;
-	xRAMFS_block.ram_addr = (size_t) (XRAMSTART + xNextFreeRAMFSByte); // Set to a valid address
+	xRAMFS_block.ram_cmd  = Disk_Read;
 	xRAMFS_block.ram_size = count * 512;	// Set to a valid size
+	xRAMFS_block.ram_addr = prvRAMFSGetScratch( xRAMFS_block.ram_size ); // Set to a valid free address
+	if (!xRAMFS_block.ram_addr) return RES_ERROR;	// No free block in the RAMFS to carry the sectors.
 	xRAMFS_block.disk_sector = sector;
 	xRAMFS_block.disk_sector_count = count;
 
-	pRAM = (uint8_t *) &xRAMFS_block;	// make this cast to serialise the Command structure.
+	res = prvRAMFSDiskRead( &xRAMFS_block, buff );
+	vRAMFSFree( xRAMFS_block.ram_addr );	// the scratch block is only held for the transfer.
+
+	return res;
+}
+
+static DRESULT prvRAMFSDiskWrite (const xRAMFSarray * pxRAMFS_block, const uint8_t* buff)
+{
+	uint16_t index;
+	uint8_t TxRxByte;
+	const uint8_t * pRAM;
+
+	pRAM = (const uint8_t *) pxRAMFS_block;	// make this cast to serialise the Command structure.
 
 	ramfs_transaction_init();	// set up the SPI bus for the RAMFS transaction.
 								// this is VERY time critical, so we do it in a MACRO to ensure there is no loss of time.
@@ -743,7 +991,7 @@ DRESULT disk_write (uint8_t pdrv, const uint8_t* buff, uint32_t sector, uint8_t
 	// now we have sent the command structure, the Supervisor will know what to do with the data.
 
 	SPDR = buff[ index++ ]; 					// Begin transmission
-	while( index < xRAMFS_block.ram_size )
+	while( index < pxRAMFS_block->ram_size )
 	{
 		TxRxByte = buff[ index++ ]; 				// pre-load the byte to be transmitted
 		if( CHECK_FOR_MY_SS ) return RES_ERROR;
@@ -769,70 +1017,33 @@ DRESULT disk_write (uint8_t pdrv, const uint8_t* buff, uint32_t sector, uint8_t
 	return RES_ERROR;
 }
 
-DRESULT disk_ioctl (uint8_t pdrv, uint8_t cmd, void* buff)
+DRESULT disk_write (uint8_t pdrv, const uint8_t* buff, uint32_t sector, uint8_t count)
 {
-	uint16_t index;
-	uint8_t TxRxByte;
+	DRESULT res;
 	xRAMFSarray xRAMFS_block;			// this is just an array for XRAMFS info.
-	uint8_t* pRAM;
-
-	if (pdrv) return RES_PARERR;		// Supports only single drive, drive 0.
-
-	xRAMFS_block.ram_cmd  = Disk_IOCtl;
-	xRAMFS_block.ram_addr = (size_t) (XRAMSTART + xNextFreeRAMFSByte); // Set to a valid address
-	xRAMFS_block.disk_sector_count = cmd;		// note REUSE of the disk_sector_count for carrying the specific IOCtl command.
-
-	switch (cmd) {				/* Set the response size based on the type of cmd we're executing */
-
-	case CTRL_POWER :			/* No Response Needed, Supervisor looks after the SD card. */
-	case CTRL_ERASE_SECTOR :	/* No Response Needed, don't bother implement this. It is slow and unnecessary. */
-
-		return RES_OK;
-		break;
-
-	case CTRL_SYNC :			/* No Response provided, so we're just going to set this to small as possible */
-
-		xRAMFS_block.ram_size = sizeof(uint8_t);	// Set to a valid size of uint8_t
-		break;
-
-	case GET_SECTOR_SIZE :		/* Get R/W sector size (uint16_t) */
-
-		xRAMFS_block.ram_size = sizeof(uint16_t);	// Set to a valid size of uint16_t
-		break;
-
-	case GET_SECTOR_COUNT :		/* Get number of sectors on the disk (uint32_t) */
-	case GET_BLOCK_SIZE :		/* Get erase block size in unit of sector (uint32_t) */
-
-		xRAMFS_block.ram_size = sizeof(uint32_t);	// Set to a valid size of uint32_t
-		break;
-
-	case MMC_GET_TYPE :			/* Get card type flags (1 byte) */
-
-		xRAMFS_block.ram_size = sizeof(uint8_t);	// Set to a valid size of uint8_t
-		break;
-
-	case MMC_GET_CSD :			/* Receive CSD as a data block (16 bytes) */
-	case MMC_GET_CID :			/* Receive CID as a data block (16 bytes) */
-
-		xRAMFS_block.ram_size = 16 * sizeof(uint8_t);	// Set to a valid size of 16 bytes
-		break;
 
-	case MMC_GET_OCR :			/* Receive OCR as an R3 response (4 bytes) */
+	if (pdrv || !count) return RES_PARERR;	// Supports only single drive, drive 0.
 
-		xRAMFS_block.ram_size = 4 * sizeof(uint8_t);	// Set to a valid size of 4 bytes
-		break;
+	xRAMFS_block.ram_cmd  = Disk_Write;
+	xRAMFS_block.ram_size = count * 512;	// Set to a valid size
+	xRAMFS_block.ram_addr = prvRAMFSGetScratch( xRAMFS_block.ram_size ); // Set to a valid free address
+	if (!xRAMFS_block.ram_addr) return RES_ERROR;	// No free block in the RAMFS to carry the sectors.
+	xRAMFS_block.disk_sector = sector;
+	xRAMFS_block.disk_sector_count = count;
 
-	case MMC_GET_SDSTAT :		/* Receive SD status as a data block (64 bytes) */
+	res = prvRAMFSDiskWrite( &xRAMFS_block, buff );
+	vRAMFSFree( xRAMFS_block.ram_addr );	// the scratch block is only held for the transfer.
 
-		xRAMFS_block.ram_size = 64 * sizeof(uint8_t);	// Set to a valid size of 64 bytes
-		break;
+	return res;
+}
 
-	default:
-		return RES_PARERR;
-		break;
-	}
+static DRESULT prvRAMFSDiskIOCtl (const xRAMFSarray * pxRAMFS_block, void* buff)
+{
+	uint16_t index;
+	uint8_t TxRxByte;
+	const uint8_t* pRAM;
 
-	pRAM = (uint8_t *) &xRAMFS_block;			// make this cast to serialise the Command structure.
+	pRAM = (const uint8_t *) pxRAMFS_block;			// make this cast to serialise the Command structure.
 
 	do {
 		ramfs_transaction_init();	// set up the SPI bus for the RAMFS transaction.
@@ -918,7 +1129,7 @@ DRESULT disk_ioctl (uint8_t pdrv, uint8_t cmd, void* buff)
 	}while (TxRxByte != RES_PENDING);
 
 	SPDR  = 0xFF;								// prepare a dummy byte.
-	while( index < xRAMFS_block.ram_size - 1 )
+	while( index < pxRAMFS_block->ram_size - 1 )
 	{
 		if( CHECK_FOR_MY_SS )
 		{
@@ -965,6 +1176,75 @@ DRESULT disk_ioctl (uint8_t pdrv, uint8_t cmd, void* buff)
 	return RES_ERROR;
 }
 
+DRESULT disk_ioctl (uint8_t pdrv, uint8_t cmd, void* buff)
+{
+	DRESULT res;
+	xRAMFSarray xRAMFS_block;			// this is just an array for XRAMFS info.
+
+	if (pdrv) return RES_PARERR;		// Supports only single drive, drive 0.
+
+	xRAMFS_block.ram_cmd  = Disk_IOCtl;
+	xRAMFS_block.disk_sector_count = cmd;		// note REUSE of the disk_sector_count for carrying the specific IOCtl command.
+
+	switch (cmd) {				/* Set the response size based on the type of cmd we're executing */
+
+	case CTRL_POWER :			/* No Response Needed, Supervisor looks after the SD card. */
+	case CTRL_ERASE_SECTOR :	/* No Response Needed, don't bother implement this. It is slow and unnecessary. */
+
+		return RES_OK;
+		break;
+
+	case CTRL_SYNC :			/* No Response provided, so we're just going to set this to small as possible */
+
+		xRAMFS_block.ram_size = sizeof(uint8_t);	// Set to a valid size of uint8_t
+		break;
+
+	case GET_SECTOR_SIZE :		/* Get R/W sector size (uint16_t) */
+
+		xRAMFS_block.ram_size = sizeof(uint16_t);	// Set to a valid size of uint16_t
+		break;
+
+	case GET_SECTOR_COUNT :		/* Get number of sectors on the disk (uint32_t) */
+	case GET_BLOCK_SIZE :		/* Get erase block size in unit of sector (uint32_t) */
+
+		xRAMFS_block.ram_size = sizeof(uint32_t);	// Set to a valid size of uint32_t
+		break;
+
+	case MMC_GET_TYPE :			/* Get card type flags (1 byte) */
+
+		xRAMFS_block.ram_size = sizeof(uint8_t);	// Set to a valid size of uint8_t
+		break;
+
+	case MMC_GET_CSD :			/* Receive CSD as a data block (16 bytes) */
+	case MMC_GET_CID :			/* Receive CID as a data block (16 bytes) */
+
+		xRAMFS_block.ram_size = 16 * sizeof(uint8_t);	// Set to a valid size of 16 bytes
+		break;
+
+	case MMC_GET_OCR :			/* Receive OCR as an R3 response (4 bytes) */
+
+		xRAMFS_block.ram_size = 4 * sizeof(uint8_t);	// Set to a valid size of 4 bytes
+		break;
+
+	case MMC_GET_SDSTAT :		/* Receive SD status as a data block (64 bytes) */
+
+		xRAMFS_block.ram_size = 64 * sizeof(uint8_t);	// Set to a valid size of 64 bytes
+		break;
+
+	default:
+		return RES_PARERR;
+		break;
+	}
+
+	xRAMFS_block.ram_addr = prvRAMFSGetScratch( xRAMFS_block.ram_size ); // Set to a valid free address
+	if (!xRAMFS_block.ram_addr) return RES_ERROR;	// No free block in the RAMFS to carry the response.
+
+	res = prvRAMFSDiskIOCtl( &xRAMFS_block, buff );
+	vRAMFSFree( xRAMFS_block.ram_addr );	// the scratch block is only held for the transfer.
+
+	return res;
+}
+
 /*-----------------------------------------------------------*/
 
 // */
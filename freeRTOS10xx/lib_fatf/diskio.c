@@ -9,6 +9,8 @@
 #include <util/delay.h>
 #include <util/crc16.h>
 
+#include <string.h>
+
 #include "FreeRTOS.h"
 #include "task.h"
 #include "spi.h"
@@ -108,12 +110,46 @@ DSTATUS Stat = STA_NOINIT;	/* Disk status */
 static
 uint8_t CardType;			/* Card type flags */
 
+static
+uint8_t Streaming;			/* CMD25 WRITE_MULTIPLE is left open, for more sequential sectors or a STOP_TRAN token */
+
+static
+uint32_t NextSector;		/* Sector (or byte) address following the last sector written */
+
+#if SD_CACHE_SECTORS
+
+#define CACHE_VALID		0x01	/* Cache line holds a sector */
+#define CACHE_DIRTY		0x02	/* Cache line is newer than the sector on the card */
+
+typedef struct
+  {
+	  DWORD sector;			/* Sector number (LBA) held */
+	  uint8_t age;			/* Cache accesses since last used (saturating), 0 for most recently used */
+	  uint8_t flags;		/* CACHE_VALID, CACHE_DIRTY */
+  } cacheLine;
+
+static
+cacheLine CacheLine[SD_CACHE_SECTORS];
+
+#if defined(portEXT_RAM) && !defined(portEXT_RAMFS)
+static
+uint8_t CacheData[SD_CACHE_SECTORS][512] __attribute__((section(".ext_ram_heap"))); // Added this section to get the cache to go to the ext memory.
+#else
+static
+uint8_t CacheData[SD_CACHE_SECTORS][512];
+#endif
+
+static
+DCACHE_STATS CacheStats;
+
+#endif
+
 typedef struct
   {
 	  uint8_t cmd;
 	  uint32_t arg;
 	  uint8_t crc;
-  } sdCommand;
+  } __attribute__ ((packed)) sdCommand;	/* Sent as the 6 byte command frame, as it is laid out */
 
 
 /*-----------------------------------------------------------------------*/
@@ -140,11 +176,8 @@ void power_on (void)
 	/* Delay at power on */
 	vTaskDelay( 64 / portTICK_PERIOD_MS ); // wait 50mS at power on.
 
-	/* Enable SPI function in mode 0 */
-	spiSetDataMode(SPI_MODE0);
-
-	/* SPI at maximum speed */
-	spiSetClockDivider(SD_SPI_DIVIDER);
+	/* Register SPI function in mode 0, at maximum speed. Applied by spiSelect() */
+	spiRegisterDevice(SDCard, SPI_MODE0, SD_SPI_DIVIDER, SPI_MSBFIRST);
 
 	spiBegin(SDCard);
 }
@@ -156,6 +189,7 @@ void power_off (void)
 	/* Disable SPI function */
 	spiEnd();
 	Stat |= STA_NOINIT;
+	Streaming = 0;
 }
 
 
@@ -188,7 +222,11 @@ static uint8_t rcvr_datablock (
 	crc = spiTransfer(0xFF) << 8;									// Capture CRC bits, being 16 bits.
 	crc |= spiTransfer(0xFF);
 
+#if SD_DATA_CRC
 	return crc == crc16(buff, btr, CRC_INIT);						/* Return with success if CRC16 is correct */
+#else
+	return 1;														/* CRC off mode, so the card doesn't check, and neither do we */
+#endif
 }
 
 
@@ -197,20 +235,31 @@ static uint8_t rcvr_datablock (
 /* Send a data packet to MMC                                             */
 /*-----------------------------------------------------------------------*/
 
+static inline uint16_t xmit_datablock_crc (
+	const uint8_t *buff		/* 512 byte data block to be transmitted */
+)
+{
+#if SD_DATA_CRC
+	return crc16(buff, 512, CRC_INIT);								// prepare a CRC16 on the data.
+#else
+	(void)buff;
+	return 0xFFFF;													// CRC off mode, so the card ignores the CRC16.
+#endif
+}
+
 static uint8_t xmit_datablock (
 	const uint8_t *buff,	/* 512 byte data block to be transmitted */
-	uint8_t token			/* Data/Stop token */
+	uint8_t token,			/* Data/Stop token */
+	uint16_t crc			/* CRC16 of the data block, prepared while the card was busy */
 ) __attribute__ ((flatten));
 
 static uint8_t xmit_datablock (
 	const uint8_t *buff,	/* 512 byte data block to be transmitted */
-	uint8_t token			/* Data/Stop token */
+	uint8_t token,			/* Data/Stop token */
+	uint16_t crc			/* CRC16 of the data block, prepared while the card was busy */
 )
 {
 	uint16_t i = 0;
-	uint16_t crc;
-
-	crc = crc16(buff, 512, CRC_INIT);								// prepare a CRC16 on the data.
 
 	while ( (--i != 0) && (spiTransfer(0xFF) == 0x00) )				// Long wait while SD busy (0x00 signal).
 		vTaskDelay( 0 );											// It is finishing up a prior command, so swap out till next tick.
@@ -225,10 +274,54 @@ static uint8_t xmit_datablock (
 
 		return (spiTransfer(0xFF) & DATA_RES_MASK);					/* Receive data response. If accepted then xxx00101 */
 	}
+	spiTransfer(0xFF);												/* Skip the stuff byte, before the card signals busy */
 	return DATA_RES_ACCEPTED;										/* STOP_TRAN_TOKEN received so return with success */
 }
 
 
+/*-----------------------------------------------------------------------*/
+/* Send a stream of data packets to MMC, within CMD25 WRITE_MULTIPLE     */
+/*-----------------------------------------------------------------------*/
+
+static uint8_t xmit_datastream (
+	const uint8_t *buff,	/* 512 byte data blocks to be transmitted */
+	uint8_t count			/* Number of data blocks (1..255) */
+)
+{
+	uint16_t crc;
+	uint8_t resp;
+
+	crc = xmit_datablock_crc(buff);
+
+	do {
+		if ( (resp = (xmit_datablock(buff, WRITE_MULTIPLE_TOKEN, crc) & DATA_RES_MASK)) != DATA_RES_ACCEPTED )
+			break;
+
+		buff += 512;
+
+		if (count > 1)												/* The card is busy programming the block just sent, */
+			crc = xmit_datablock_crc(buff);							/* so prepare the CRC16 of the next block meanwhile. */
+
+	} while (--count);
+
+	return resp;
+}
+
+
+/*-----------------------------------------------------------------------*/
+/* Close an open CMD25 WRITE_MULTIPLE stream  (SD card must be selected) */
+/*-----------------------------------------------------------------------*/
+
+static void stop_datastream (void)
+{
+	if (Streaming)
+	{
+		xmit_datablock(NULL, STOP_TRAN_TOKEN, 0);					/* Send STOP_TRAN token. Busy is waited out by the next command. */
+		Streaming = 0;
+	}
+}
+
+
 
 /*-----------------------------------------------------------------------*/
 /* Send a command packet to MMC                                          */
@@ -336,6 +429,10 @@ DSTATUS disk_initialize (
 	uint16_t resp;
 
 	Stat = STA_NOINIT;								// Set uninitialised, initially.
+	Streaming = 0;									// CMD0 will abandon any open write stream.
+#if SD_CACHE_SECTORS
+	memset(CacheLine, 0, sizeof(CacheLine));		// Forget cached sectors, as the card may have been changed.
+#endif
 
 	if (drv)
 		return Stat;								// Supports only single drive
@@ -353,6 +450,7 @@ DSTATUS disk_initialize (
 
 	power_on();										// Force socket power on
 
+	spiRegisterDevice(SDCard, SPI_MODE0, SPI_CLOCK_DIV128, SPI_MSBFIRST);	// Select with slow clock, until initialised.
 	spiSetDataMode(SPI_MODE0);						// Set Mode 0
 	spiSetClockDivider(SPI_CLOCK_DIV128);			// Slow clock down to between 100kHz and 400kHz (125kHz @ 16MHz)
 
@@ -372,7 +470,11 @@ DSTATUS disk_initialize (
 	if ( resp == R1_IDLE_STATE)
 	{			/* Entered Idle state */
 
+#if SD_DATA_CRC
 		send_cmd(CMD59, CRC_ON);				// Set the Card to use the command CRC7 and data CRC16 capability.
+#else
+		send_cmd(CMD59, CRC_OFF);				// Set the Card to ignore CRC, other than for CMD0 and CMD8.
+#endif
 
 		if ( (resp = send_cmd(CMD8, 0x01AA)) == R1_IDLE_STATE) // 0x01 is 2.7-3.6V supply. 0xAA is to provide echo source.
 		{	/* SDv2 */
@@ -430,6 +532,7 @@ DSTATUS disk_initialize (
 
 	CardType = type;
 
+	spiRegisterDevice(SDCard, SPI_MODE0, SD_SPI_DIVIDER, SPI_MSBFIRST);	// Select with maximum speed clock from now on.
 	spiSetClockDivider(SD_SPI_DIVIDER);	// Reset maximum speed clock, for maximum performance.
 	spiTransfer(0xFF);					/* Give SD Card 8 Clocks to complete command. */
 	spiDeselect(SDCard);				// Deselect the SD card (before power_off(), if card not initialised).
@@ -472,7 +575,8 @@ DSTATUS disk_status (
 /* Read Sector(s)                                                        */
 /*-----------------------------------------------------------------------*/
 
-DRESULT disk_read (
+static
+DRESULT mmc_disk_read (
 	BYTE drv,			/* Physical drive number (0) */
 	BYTE *buff,			/* Pointer to the data buffer to store read data */
 	DWORD sector,		/* Start sector number (LBA) */
@@ -493,9 +597,8 @@ DRESULT disk_read (
 		uint8_t lcount = count;				/* Local sector count (1..255) */
 
 		if (!spiSelect(SDCard)) return RES_NOTRDY;
-		spiSetDataMode(SPI_MODE0);			// Enable SPI function in mode 0
-		spiSetClockDivider(SD_SPI_DIVIDER);	// SPI at maximum speed
 
+		stop_datastream();					/* Close any open write stream, before reading */
 
 		if (lcount == 1)					/* Single block read */
 		{
@@ -549,7 +652,8 @@ DRESULT disk_read (
 /* Write Sector(s)                                                       */
 /*-----------------------------------------------------------------------*/
 
-DRESULT disk_write (
+static
+DRESULT mmc_disk_write (
 	BYTE drv,			/* Physical drive number (0) */
 	BYTE const *buff,	/* Pointer to the data to be written */
 	DWORD sector,		/* Start sector number (LBA) */
@@ -573,40 +677,50 @@ DRESULT disk_write (
 		uint8_t lcount = count;				/* Local sector count (1..255) */
 
 		if (!spiSelect(SDCard)) return RES_NOTRDY;
-		spiSetDataMode(SPI_MODE0);			// Enable SPI function in mode 0
-		spiSetClockDivider(SD_SPI_DIVIDER);	// SPI at maximum speed
 
-		if (lcount == 1)
+		if (Streaming && (lsector != NextSector))
+			stop_datastream();										/* Not sequential, so close the open write stream */
+
+		if (!Streaming && (CardType & CT_SDC) && (multiWrite == 1) && ((lcount > 1) || (lsector == NextSector)))
+		{	/* Open a write stream, for multiple or sequential sectors (a data logger) */
+
+			send_cmd(ACMD23, lcount);								// pre-erase with the number of sectors known now, for SDC.
+
+			if( send_cmd(CMD25, lsector) == R1_READY_STATE )		/* Send WRITE_MULTIPLE_BLOCK, and leave it open */
+				Streaming = 1;
+		}
+
+		if (Streaming)
+		{	/* Stream the sectors into the open WRITE_MULTIPLE_BLOCK */
+
+			if ( (resp = xmit_datastream(lbuff, lcount)) != DATA_RES_ACCEPTED )
+			{
+				send_cmd(CMD12, 0x00);								/* STOP_TRANSMISSION there's an error */
+				Streaming = 0;
+				if (resp == DATA_RES_WRITE_ERROR)					/* SD card is not capable of CMD25, multiple sector write */
+					multiWrite = 0;
+			}
+
+		} else if (lcount == 1)
 		{	/* Single block write */
 
 			if (( send_cmd(CMD24, lsector) == R1_READY_STATE))		/* WRITE_BLOCK */
-				resp = (xmit_datablock(lbuff, DATA_START_BLOCK) & DATA_RES_MASK);
+				resp = (xmit_datablock(lbuff, DATA_START_BLOCK, xmit_datablock_crc(lbuff)) & DATA_RES_MASK);
 
 		} else { /* Multiple block write */
 
-			if ( multiWrite == 1)									/* WRITE_MULTIPLE_BLOCK */
+			if ( (multiWrite == 1) && (CardType & CT_MMC) )		/* WRITE_MULTIPLE_BLOCK */
 			{
-				if (CardType & CT_MMC)
-					send_cmd(CMD23, lcount);						// prepare with the size of the data to be written for MMC.
+				send_cmd(CMD23, lcount);							// prepare with the size of the data to be written for MMC.
 
-				if (CardType & CT_SDC)
-					send_cmd(ACMD23, lcount);						// prepare with the size of the data to be erased for SDC.
-
-				if( send_cmd(CMD25, lsector) == R1_READY_STATE )	/* Send WRITE_MULTIPLE_BLOCK */
+				if( send_cmd(CMD25, lsector) == R1_READY_STATE )	/* Send WRITE_MULTIPLE_BLOCK, which stops itself after CMD23 sectors */
 				{
-					do {
-						if ( (resp = (xmit_datablock(lbuff, WRITE_MULTIPLE_TOKEN) & DATA_RES_MASK)) != DATA_RES_ACCEPTED )
-						{
-							send_cmd(CMD12, 0x00);					/* STOP_TRANSMISSION there's an error */
-							if (resp == DATA_RES_WRITE_ERROR)		/* SD card is not capable of CMD25, multiple sector write */
-								multiWrite = 0;
-							break;
-						}
-						lbuff += 512;
-					} while (--lcount);
-
-					if ( (CardType & CT_SDC) && resp == DATA_RES_ACCEPTED)
-						xmit_datablock(NULL, STOP_TRAN_TOKEN);		/* Send STOP_TRAN token for SD cards. */
+					if ( (resp = xmit_datastream(lbuff, lcount)) != DATA_RES_ACCEPTED )
+					{
+						send_cmd(CMD12, 0x00);						/* STOP_TRANSMISSION there's an error */
+						if (resp == DATA_RES_WRITE_ERROR)			/* MMC card is not capable of CMD25, multiple sector write */
+							multiWrite = 0;
+					}
 				}
 
 			} else { 												/* Multiple Single block writes */
@@ -614,7 +728,7 @@ DRESULT disk_write (
 				do {/* Send WRITE_BLOCK */
 					if ( send_cmd(CMD24, lsector) != R1_READY_STATE ) break;
 
-					if ( (resp = (xmit_datablock(lbuff, DATA_START_BLOCK) & DATA_RES_MASK)) != DATA_RES_ACCEPTED ) break;
+					if ( (resp = (xmit_datablock(lbuff, DATA_START_BLOCK, xmit_datablock_crc(lbuff)) & DATA_RES_MASK)) != DATA_RES_ACCEPTED ) break;
 					spiTransfer(0xFF);								/* Give SD Card 8 Clocks to complete command. */
 
 					if (!(CardType & CT_BLOCK)) lsector += 512;		/* increment to sector byte address if needed */
@@ -626,7 +740,10 @@ DRESULT disk_write (
 		}
 
 		if (resp == DATA_RES_ACCEPTED)
+		{
+			NextSector = sector + ((CardType & CT_BLOCK) ? count : (uint32_t)count * 512);	/* Where a sequential write would continue */
 			count = 0;
+		}
 
 		spiTransfer(0xFF);											/* Give SD Card 8 Clocks to complete command. */
 		spiDeselect(SDCard);
@@ -644,7 +761,8 @@ DRESULT disk_write (
 /* Miscellaneous Functions                                               */
 /*-----------------------------------------------------------------------*/
 
-DRESULT disk_ioctl (
+static
+DRESULT mmc_disk_ioctl (
 	BYTE drv,		/* Physical drive number (0) */
 	BYTE ctrl,	    /* Control code */
 	void *buff		/* Buffer to send/receive control data */
@@ -680,8 +798,7 @@ DRESULT disk_ioctl (
 
 		if (!spiSelect(SDCard)) return RES_NOTRDY;
 
-		spiSetDataMode(SPI_MODE0);			// Enable SPI function in mode 0
-		spiSetClockDivider(SD_SPI_DIVIDER);	// SPI at maximum speed
+		stop_datastream();		/* Close any open write stream, so its sectors are programmed before CTRL_SYNC, or another command */
 
 		switch (ctrl)
 		{
@@ -794,6 +911,277 @@ DRESULT disk_ioctl (
 	return resp;
 }
 
+
+
+/*-----------------------------------------------------------------------*/
+/* Sector Cache  (between FatFs and the SD card)                        */
+/*-----------------------------------------------------------------------*/
+/* With FF_FS_TINY all files share one sector window, so alternating     */
+/* between files re-reads the FAT and data sectors. Single sectors are   */
+/* held in a small LRU cache, and written back on CTRL_SYNC (f_sync,     */
+/* f_close) or when their cache line is reused. Multiple sectors are     */
+/* transferred directly, keeping the cache coherent.                     */
+
+#if SD_CACHE_SECTORS
+
+static
+uint8_t cache_find (		/* Returns the line holding the sector, or SD_CACHE_SECTORS */
+	DWORD sector
+)
+{
+	uint8_t line;
+
+	for (line = 0; line < SD_CACHE_SECTORS; ++line)
+		if ((CacheLine[line].flags & CACHE_VALID) && (CacheLine[line].sector == sector))
+			break;
+
+	return line;
+}
+
+
+static
+void cache_touch (
+	uint8_t line
+)
+{
+	for (uint8_t i = 0; i < SD_CACHE_SECTORS; ++i)
+		if (CacheLine[i].age != 0xFF)
+			++CacheLine[i].age;
+
+	CacheLine[line].age = 0;		/* Most recently used */
+}
+
+
+static
+DRESULT cache_writeback (
+	uint8_t line
+)
+{
+	if (CacheLine[line].flags & CACHE_DIRTY)
+	{
+		if (mmc_disk_write(0, CacheData[line], CacheLine[line].sector, 1) != RES_OK)
+			return RES_ERROR;
+
+		CacheLine[line].flags &= ~CACHE_DIRTY;
+		++CacheStats.writebacks;
+	}
+	return RES_OK;
+}
+
+
+static
+uint8_t cache_victim (void)		/* Returns an empty line, or SD_CACHE_SECTORS if the LRU line can't be written back */
+{
+	uint8_t line = 0;
+
+	for (uint8_t i = 0; i < SD_CACHE_SECTORS; ++i)
+	{
+		if (!(CacheLine[i].flags & CACHE_VALID))
+			return i;				/* Use an empty line first */
+
+		if (CacheLine[i].age > CacheLine[line].age)
+			line = i;				/* Otherwise the least recently used line */
+	}
+
+	if (cache_writeback(line) != RES_OK)
+		return SD_CACHE_SECTORS;
+
+	CacheLine[line].flags = 0;
+	return line;
+}
+
+
+static
+DRESULT cache_flush (void)		/* Write back dirty lines in sector order, so they stream into the card */
+{
+	uint8_t line;
+
+	do {
+		line = SD_CACHE_SECTORS;
+
+		for (uint8_t i = 0; i < SD_CACHE_SECTORS; ++i)
+			if ((CacheLine[i].flags & CACHE_DIRTY) && ((line == SD_CACHE_SECTORS) || (CacheLine[i].sector < CacheLine[line].sector)))
+				line = i;
+
+		if ((line != SD_CACHE_SECTORS) && (cache_writeback(line) != RES_OK))
+			return RES_ERROR;
+
+	} while (line != SD_CACHE_SECTORS);
+
+	return RES_OK;
+}
+
+
+static
+void cache_invalidate (		/* Forget the sectors, without writing them back */
+	DWORD start,
+	DWORD end
+)
+{
+	for (uint8_t line = 0; line < SD_CACHE_SECTORS; ++line)
+		if ((CacheLine[line].sector >= start) && (CacheLine[line].sector <= end))
+			CacheLine[line].flags = 0;
+}
+
+
+DRESULT disk_read (
+	BYTE drv,			/* Physical drive number (0) */
+	BYTE *buff,			/* Pointer to the data buffer to store read data */
+	DWORD sector,		/* Start sector number (LBA) */
+	UINT count			/* Sector count (1..255) */
+)
+{
+	uint8_t line;
+	DRESULT res;
+
+	if (drv || !count) return RES_PARERR;
+	if (Stat & STA_NOINIT) return RES_NOTRDY;
+
+	if (count == 1)
+	{	/* Single sector read, through the cache */
+
+		if ((line = cache_find(sector)) != SD_CACHE_SECTORS)
+			++CacheStats.hits;
+		else
+		{
+			if ((line = cache_victim()) == SD_CACHE_SECTORS) return RES_ERROR;
+			if ((res = mmc_disk_read(drv, CacheData[line], sector, 1)) != RES_OK) return res;
+
+			CacheLine[line].sector = sector;
+			CacheLine[line].flags = CACHE_VALID;
+			++CacheStats.misses;
+		}
+		cache_touch(line);
+		memcpy(buff, CacheData[line], 512);
+		return RES_OK;
+	}
+
+	/* Multiple sector read, directly from the card. Then overlay any dirty sectors, as they're newer */
+
+	if ((res = mmc_disk_read(drv, buff, sector, count)) != RES_OK) return res;
+
+	for (line = 0; line < SD_CACHE_SECTORS; ++line)
+		if ((CacheLine[line].flags & CACHE_DIRTY) && ((CacheLine[line].sector - sector) < count))
+			memcpy(buff + ((CacheLine[line].sector - sector) << 9), CacheData[line], 512);
+
+	return RES_OK;
+}
+
+
+DRESULT disk_write (
+	BYTE drv,			/* Physical drive number (0) */
+	BYTE const *buff,	/* Pointer to the data to be written */
+	DWORD sector,		/* Start sector number (LBA) */
+	UINT count			/* Sector count (1..255) */
+)
+{
+	uint8_t line;
+	DRESULT res;
+
+	if (drv || !count) return RES_PARERR;
+	if (Stat & STA_NOINIT) return RES_NOTRDY;
+	if (Stat & STA_PROTECT) return RES_WRPRT;
+
+	if (count == 1)
+	{	/* Single sector write, into the cache. Written back later */
+
+		if ((line = cache_find(sector)) != SD_CACHE_SECTORS)
+			++CacheStats.hits;
+		else if ((line = cache_victim()) == SD_CACHE_SECTORS)
+			return RES_ERROR;
+
+		memcpy(CacheData[line], buff, 512);
+		CacheLine[line].sector = sector;
+		CacheLine[line].flags = CACHE_VALID | CACHE_DIRTY;
+		cache_touch(line);
+		return RES_OK;
+	}
+
+	/* Multiple sector write, directly to the card. Then refresh any cached sectors, which are now clean */
+
+	if ((res = mmc_disk_write(drv, buff, sector, count)) != RES_OK) return res;
+
+	for (line = 0; line < SD_CACHE_SECTORS; ++line)
+		if ((CacheLine[line].flags & CACHE_VALID) && ((CacheLine[line].sector - sector) < count))
+		{
+			memcpy(CacheData[line], buff + ((CacheLine[line].sector - sector) << 9), 512);
+			CacheLine[line].flags = CACHE_VALID;
+		}
+
+	return RES_OK;
+}
+
+
+DRESULT disk_ioctl (
+	BYTE drv,		/* Physical drive number (0) */
+	BYTE ctrl,	    /* Control code */
+	void *buff		/* Buffer to send/receive control data */
+)
+{
+	if (drv) return RES_PARERR;
+
+	switch (ctrl)
+	{
+		case CTRL_SYNC :		/* Write back the dirty sectors, before completing the write process */
+			if (cache_flush() != RES_OK) return RES_ERROR;
+			break;
+
+		case CTRL_TRIM :		/* Forget the sectors being erased */
+			cache_invalidate(((DWORD *)buff)[0], ((DWORD *)buff)[1]);
+			break;
+
+		case CTRL_POWER :		/* Write back the dirty sectors and forget them, before power off */
+			if (((BYTE *)buff)[0] == 0)
+			{
+				if (cache_flush() != RES_OK) return RES_ERROR;	/* Keep the card powered and the lines dirty */
+				cache_invalidate(0, 0xFFFFFFFF);
+			}
+			break;
+
+		case CTRL_CACHE_STATS :	/* Get the cache statistics (DCACHE_STATS) */
+			*(DCACHE_STATS *)buff = CacheStats;
+			return RES_OK;
+
+		default :
+			break;
+	}
+
+	return mmc_disk_ioctl(drv, ctrl, buff);
+}
+
+#else
+
+DRESULT disk_read (
+	BYTE drv,			/* Physical drive number (0) */
+	BYTE *buff,			/* Pointer to the data buffer to store read data */
+	DWORD sector,		/* Start sector number (LBA) */
+	UINT count			/* Sector count (1..255) */
+)
+{
+	return mmc_disk_read(drv, buff, sector, count);
+}
+
+DRESULT disk_write (
+	BYTE drv,			/* Physical drive number (0) */
+	BYTE const *buff,	/* Pointer to the data to be written */
+	DWORD sector,		/* Start sector number (LBA) */
+	UINT count			/* Sector count (1..255) */
+)
+{
+	return mmc_disk_write(drv, buff, sector, count);
+}
+
+DRESULT disk_ioctl (
+	BYTE drv,		/* Physical drive number (0) */
+	BYTE ctrl,	    /* Control code */
+	void *buff		/* Buffer to send/receive control data */
+)
+{
+	return mmc_disk_ioctl(drv, ctrl, buff);
+}
+
+#endif
+
 #endif
 
 #endif
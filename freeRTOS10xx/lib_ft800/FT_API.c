@@ -1,5 +1,7 @@
 /* Sample API for the FTDI FT800 EVE */
 
+#include <util/crc16.h>
+
 #include "FT_Platform.h"
 
 /* Global used for HAL management */
@@ -9,6 +11,12 @@ extern FT_GPU_HAL_Context_t * phost;
 /* Index into the Display List Buffer */
 static ft_uint32_t FT_DLBuffer_Index;
 
+/* Count of FT_API_Boot_Config(), as RAM_G and so any retained segment is lost on boot */
+static ft_uint8_t FT_Boot_Count;
+
+/* Offset in RAM_DL of the segment being recorded */
+static ft_uint16_t FT_Segment_Start;
+
 ft_void_t FT_API_Write_CoCmd(ft_const_uint32_t cmd)
 {
 	FT_GPU_HAL_WrCmd32( phost, cmd);
@@ -58,6 +66,52 @@ ft_void_t FT_API_WaitCmdfifo_empty(ft_void_t)
 	FT_GPU_HAL_WaitCmdfifo_empty(phost);
 }
 
+/* API to append a retained display list segment, or to start recording it where its inputs have changed */
+ft_bool_t FT_API_Segment_Begin(FT_API_Segment_t *segment, const ft_void_t *inputs, ft_uint16_t length)
+{
+	ft_uint16_t crc = 0xffff;
+	const ft_uint8_t *input = (const ft_uint8_t *)inputs;
+
+	while (length--)
+		crc = _crc_ccitt_update(crc, *input++);
+
+	if (segment->Size != 0 && segment->Boot == FT_Boot_Count && segment->Inputs == crc)
+	{
+		if (segment->Size > segment->Capacity)
+			return FT_TRUE;		// too large to retain, so it is drawn, and FT_API_Segment_End() doesn't measure it again.
+
+		FT_GPU_CoCmd_Append(phost, segment->Address, segment->Size);
+		return FT_FALSE;
+	}
+
+	segment->Size = 0;
+	segment->Inputs = crc;
+	segment->Boot = FT_Boot_Count;
+
+	/* Wait for the co-processor to write the display list so far, to find where the segment starts */
+	FT_GPU_HAL_WaitCmdfifo_empty(phost);
+	FT_Segment_Start = FT_GPU_HAL_Rd16(phost, REG_CMD_DL);
+
+	return FT_TRUE;
+}
+
+/* API to copy the display list written since FT_API_Segment_Begin() into RAM_G */
+/* Returns FT_FALSE where the segment is empty, or larger than its Capacity, and so is not retained */
+ft_bool_t FT_API_Segment_End(FT_API_Segment_t *segment)
+{
+	if (segment->Size > segment->Capacity)
+		return FT_FALSE;
+
+	FT_GPU_HAL_WaitCmdfifo_empty(phost);
+	segment->Size = FT_GPU_HAL_Rd16(phost, REG_CMD_DL) - FT_Segment_Start;
+
+	if (segment->Size == 0 || segment->Size > segment->Capacity)
+		return FT_FALSE;
+
+	FT_GPU_CoCmd_Memcpy(phost, segment->Address, RAM_DL + FT_Segment_Start, segment->Size);
+	return FT_TRUE;
+}
+
 /* API to give fade out effect by changing the display PWM from 128 till 0 */
 ft_void_t FT_API_fadeout(ft_void_t)
 {
@@ -186,6 +240,9 @@ ft_void_t FT_API_Boot_Config(ft_void_t)  // you must do this first TO OPEN the A
 	FT_GPU_HAL_Open(&host);
 	phost = &host;
 
+	/* RAM_G is lost, so any retained segment has to be recorded again */
+	++FT_Boot_Count;
+
 	/* Access address 0 to wake up the FT800 */
 	FT_GPU_HostCommand(phost, FT_GPU_ACTIVE_M);
 	vTaskDelay( 32 / portTICK_PERIOD_MS ); // assuming waking from POWERDOWN or SLEEP. From STANDBY the delay is unnecessary.
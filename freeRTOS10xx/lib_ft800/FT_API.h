@@ -15,6 +15,17 @@ typedef struct FT_API_Bitmap_header
 	ft_int32_t ArrayOffset;
 }FT_API_Bitmap_header_t;
 
+/* A retained display list segment. Its display list commands are recorded once into RAM_G, and appended */
+/* to later display lists with CMD_APPEND, until its inputs change or the FT800 is booted again. */
+typedef struct FT_API_Segment
+{
+	ft_uint32_t Address;	// in RAM_G, 4 byte aligned, set by the application.
+	ft_uint16_t Capacity;	// bytes reserved at Address, set by the application.
+	ft_uint16_t Size;		// bytes of display list recorded, 0 when not recorded, more than Capacity when too large.
+	ft_uint16_t Inputs;		// CRC of the inputs it was recorded with.
+	ft_uint8_t  Boot;		// FT_API_Boot_Config() count it was recorded with.
+}FT_API_Segment_t;
+
 ft_void_t	FT_API_Boot_Config(ft_void_t);	// you must do this first.
 
 ft_void_t	FT_API_Touch_Config(ft_void_t);	// you must do this before using touch.
@@ -32,6 +43,23 @@ ft_void_t	FT_API_GPU_DLSwap(const ft_uint8_t DL_Swap_Type);
 /* API to wait until the command buffer is empty, following CMD_SWAP */
 ft_void_t	FT_API_WaitCmdfifo_empty(ft_void_t) __attribute__ ((flatten));
 
+/* APIs to retain a display list segment, between CMD_DLSTART and CMD_SWAP.
+ *
+ *	if( FT_API_Segment_Begin(&segment, &inputs, sizeof(inputs)) )
+ *	{
+ *		... write the segment commands ...
+ *		FT_API_Segment_End(&segment);
+ *	}
+ *
+ * FT_API_Segment_Begin() appends the recorded segment and returns FT_FALSE, where it is recorded with the same inputs.
+ * Otherwise it returns FT_TRUE, and the commands written until FT_API_Segment_End() are drawn and recorded.
+ * Only display list state is carried by a segment. Co-processor state (FgColor, BgColor, GradColor, matrix)
+ * set within a segment is not set when it is appended, so commands following it should set their own.
+ * FT_API_Segment_End() returns FT_FALSE where the segment is empty, or larger than its Capacity, and so is not retained.
+ * A segment too large is then drawn every time, without being measured again, until its inputs change. */
+ft_bool_t	FT_API_Segment_Begin(FT_API_Segment_t *segment, const ft_void_t *inputs, ft_uint16_t length);
+ft_bool_t	FT_API_Segment_End(FT_API_Segment_t *segment);
+
 /********** utilities ********************/
 
 ft_void_t	FT_API_fadeout(ft_void_t);
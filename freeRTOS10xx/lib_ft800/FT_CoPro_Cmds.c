@@ -24,14 +24,12 @@ ft_void_t FT_GPU_CoCmd_SendStr_P(FT_GPU_HAL_Context_t *phost, ft_prog_char8_t *s
 
 ft_void_t FT_GPU_CoCmd_StartFunc(FT_GPU_HAL_Context_t *phost, ft_const_uint16_t count)
 {
-  FT_GPU_HAL_CheckCmdBuffer(phost, count);
-  FT_GPU_HAL_StartCmdTransfer(phost, FT_GPU_WRITE );
+  FT_GPU_HAL_StartCmdBuffer(phost, count);
 }
 
 ft_void_t FT_GPU_CoCmd_EndFunc(FT_GPU_HAL_Context_t *phost, ft_const_uint16_t count)
 {
-  FT_GPU_HAL_EndCmdTransfer(phost);
-  FT_GPU_HAL_Updatecmdfifo(phost, count);
+  FT_GPU_HAL_EndCmdBuffer(phost, count);
 }
 
 /************ Co-Processor Command Functions **************/
@@ -158,6 +156,7 @@ ft_void_t FT_GPU_CoCmd_Swap(FT_GPU_HAL_Context_t *phost)
   FT_GPU_CoCmd_StartFunc(phost,FT_CMD_SIZE*1);
   FT_GPU_Copro_SendCmd(phost, CMD_SWAP);
   FT_GPU_CoCmd_EndFunc(phost,(FT_CMD_SIZE*1));
+  FT_GPU_HAL_FlushCmdBuffer(phost); // the end of a frame, so send the staged commands.
 }
 
 ft_void_t FT_GPU_CoCmd_Inflate(FT_GPU_HAL_Context_t *phost, ft_uint32_t ptr)
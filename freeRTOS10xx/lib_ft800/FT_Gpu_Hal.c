@@ -26,9 +26,7 @@ FT_GPU_HAL_Context_t * phost;
 ft_bool_t  FT_GPU_HAL_Open(FT_GPU_HAL_Context_t *host)
 {
 	spiBegin(Gameduino2);					// enable the Gameduino V2 SPI interface
-	spiSetClockDivider(SPI_CLOCK_DIV8);		// SPI at 1/8 SYSCLK speed (3072kHz on Goldilocks, 2000kHz on Uno)
-	spiSetBitOrder(SPI_MSBFIRST);
-	spiSetDataMode(SPI_MODE0);				// Enable SPI function in mode 0, CPOL=0 CPHA=0
+	spiRegisterDevice(Gameduino2, SPI_MODE0, SPI_CLOCK_DIV8, SPI_MSBFIRST);	// mode 0, CPOL=0 CPHA=0, at 1/8 SYSCLK speed (3072kHz on Goldilocks, 2000kHz on Uno)
 
 #if defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__) || defined(__AVR_ATmega644P__) || defined(__AVR_ATmega1284P__) || defined(__AVR_ATmega324PA__) || defined(__AVR_ATmega644PA__)
 	DDRD &= ~_BV(DDD2);                     // Set PD2 (Arduino 2) as an input. Same pin on Goldilocks as in Uno.
@@ -43,15 +41,22 @@ ft_bool_t  FT_GPU_HAL_Open(FT_GPU_HAL_Context_t *host)
     }
 #endif
 
+	if( host->ft_cmd_buffer == NULL )		// not already allocated, if we're opening again.
+	{
+		host->ft_cmd_buffer = (ft_uint8_t *)pvPortMalloc( FT_CMD_BUFFER_SIZE );	// if this fails, commands are written directly.
+	}
+
 	host->status = FT_GPU_HAL_OPENED;
 	host->ft_cmd_fifo_wp = 0;
+	host->ft_cmd_fifo_freespace = 0;	// unknown, until REG_CMD_READ is read.
+	host->ft_cmd_buffer_count = 0;
 
 	return FT_TRUE;
 }
 
 ft_void_t  FT_GPU_HAL_Fast(FT_GPU_HAL_Context_t *host)
 {
-	spiSetClockDivider(SPI_CLOCK_DIV2);		// SPI at 1/2 SYSCLK speed (12.288MHz on GA, 11.059MHz on Goldilocks, 8.000MHz on Uno)
+	spiRegisterDevice(Gameduino2, SPI_MODE0, SPI_CLOCK_DIV2, SPI_MSBFIRST);	// SPI at 1/2 SYSCLK speed (12.288MHz on GA, 11.059MHz on Goldilocks, 8.000MHz on Uno)
 }
 
 ft_void_t  FT_GPU_HAL_Close(FT_GPU_HAL_Context_t *host)
@@ -68,6 +73,12 @@ ft_void_t  FT_GPU_HAL_Close(FT_GPU_HAL_Context_t *host)
     }
 #endif
 
+	if( host->ft_cmd_buffer != NULL )
+	{
+		vPortFree( host->ft_cmd_buffer );
+		host->ft_cmd_buffer = NULL;
+	}
+
 	host->status = FT_GPU_HAL_CLOSED;
 	spiEnd();
 }
@@ -216,7 +227,12 @@ ft_void_t  FT_GPU_HAL_StartCmdTransfer(FT_GPU_HAL_Context_t *host,FT_GPU_TRANSFE
 
 ft_uint32_t  FT_GPU_HAL_TransferCmd(FT_GPU_HAL_Context_t *host, ft_const_uint32_t cmd)
 {
-	return FT_GPU_HAL_Transfer32(phost, cmd);
+	if (host->status == FT_GPU_HAL_BUFFERING){
+		memcpy(&host->ft_cmd_buffer[host->ft_cmd_buffer_count], &cmd, FT_CMD_SIZE);	// LSB first, as is the AVR.
+		host->ft_cmd_buffer_count += FT_CMD_SIZE;
+		return 0;
+	}
+	return FT_GPU_HAL_Transfer32(host, cmd);
 }
 
 ft_void_t  FT_GPU_HAL_EndCmdTransfer(FT_GPU_HAL_Context_t *host)
@@ -224,11 +240,67 @@ ft_void_t  FT_GPU_HAL_EndCmdTransfer(FT_GPU_HAL_Context_t *host)
 	FT_GPU_HAL_EndTransfer(host);
 }
 
+/* Stage a co-processor command of count bytes. Where it doesn't fit in the staging buffer, the buffer is flushed first. */
+/* Where it is larger than the buffer (a long string), the fifo write transaction is started, as before. */
+ft_void_t  FT_GPU_HAL_StartCmdBuffer(FT_GPU_HAL_Context_t *host, ft_const_uint16_t count)
+{
+	ft_uint16_t aligned = (count + 3) & 0xfffc;
+
+	if (host->ft_cmd_buffer != NULL && aligned <= FT_CMD_BUFFER_SIZE){
+		if (aligned > FT_CMD_BUFFER_SIZE - host->ft_cmd_buffer_count)
+			FT_GPU_HAL_FlushCmdBuffer(host);
+
+		host->status = FT_GPU_HAL_BUFFERING;
+	}else{
+		FT_GPU_HAL_FlushCmdBuffer(host);	// keep the commands in order.
+
+		FT_GPU_HAL_CheckCmdBuffer(host, count);
+		FT_GPU_HAL_StartCmdTransfer(host, FT_GPU_WRITE);
+	}
+}
+
+ft_void_t  FT_GPU_HAL_EndCmdBuffer(FT_GPU_HAL_Context_t *host, ft_const_uint16_t count)
+{
+	if (host->status == FT_GPU_HAL_BUFFERING){
+		while (host->ft_cmd_buffer_count & 0x3)		// 4 byte alignment, following a string
+			host->ft_cmd_buffer[host->ft_cmd_buffer_count++] = 0;
+
+		host->status = FT_GPU_HAL_OPENED;
+	}else{
+		FT_GPU_HAL_EndCmdTransfer(host);
+		FT_GPU_HAL_Updatecmdfifo(host, count);
+	}
+}
+
+/* Write all the staged commands to the co-processor fifo, in one transaction, and update REG_CMD_WRITE once. */
+/* The FT800 wraps the write address within RAM_CMD, so the burst can cross the end of the fifo. */
+ft_void_t  FT_GPU_HAL_FlushCmdBuffer(FT_GPU_HAL_Context_t *host)
+{
+	if (host->ft_cmd_buffer_count == 0)
+		return;
+
+	FT_GPU_HAL_CheckCmdBuffer(host, host->ft_cmd_buffer_count);
+
+	FT_GPU_HAL_StartCmdTransfer(host, FT_GPU_WRITE);
+	spiMultiByteTx(host->ft_cmd_buffer, host->ft_cmd_buffer_count);
+	FT_GPU_HAL_EndTransfer(host);
+
+	FT_GPU_HAL_Updatecmdfifo(host, host->ft_cmd_buffer_count);
+
+	host->ft_cmd_buffer_count = 0;
+}
+
 ft_uint8_t FT_GPU_HAL_TransferString(FT_GPU_HAL_Context_t *host, ft_const_char8_t *string)
 {
-    ft_uint16_t length = (ft_uint16_t)strlen((const char *)string);
+    ft_uint16_t length = (ft_uint16_t)strlen((const char *)string) + 1;	// including the null ending flag
 
-    spiMultiByteTx( (ft_uint8_t *)string, length);
+    if (host->status == FT_GPU_HAL_BUFFERING){
+        memcpy(&host->ft_cmd_buffer[host->ft_cmd_buffer_count], string, length);
+        host->ft_cmd_buffer_count += length;
+        return 0;
+    }
+
+    spiMultiByteTx( (ft_uint8_t *)string, length - 1);
 
     //Append one null as ending flag
     return FT_GPU_HAL_Transfer8(host,0);
@@ -236,9 +308,15 @@ ft_uint8_t FT_GPU_HAL_TransferString(FT_GPU_HAL_Context_t *host, ft_const_char8_
 
 ft_uint8_t FT_GPU_HAL_TransferString_P(FT_GPU_HAL_Context_t *host, ft_prog_char8_t *string)
 {
-    ft_uint16_t length = (ft_uint16_t)strlen_P((const char *)string);
+    ft_uint16_t length = (ft_uint16_t)strlen_P((const char *)string) + 1;	// including the null ending flag
 
-    spiMultiByteTx_P( (ft_prog_uint8_t *)string, length);
+    if (host->status == FT_GPU_HAL_BUFFERING){
+        memcpy_P(&host->ft_cmd_buffer[host->ft_cmd_buffer_count], string, length);
+        host->ft_cmd_buffer_count += length;
+        return 0;
+    }
+
+    spiMultiByteTx_P( (ft_prog_uint8_t *)string, length - 1);
 
     //Append one null as ending flag
     return FT_GPU_HAL_Transfer8(host,0);
@@ -276,11 +354,15 @@ ft_void_t FT_GPU_CoreReset(FT_GPU_HAL_Context_t *host)
 
 ft_void_t FT_GPU_HAL_Updatecmdfifo(FT_GPU_HAL_Context_t *host, ft_const_uint16_t count)
 {
+	ft_uint16_t wp = host->ft_cmd_fifo_wp;
+
 	host->ft_cmd_fifo_wp  = (host->ft_cmd_fifo_wp + count) & 0xFFF; // 4095 byte fifo.
 
 	//4 byte alignment
 	host->ft_cmd_fifo_wp = (host->ft_cmd_fifo_wp + 3) & 0xffc;
 	FT_GPU_HAL_Wr16( host,REG_CMD_WRITE,host->ft_cmd_fifo_wp );
+
+	host->ft_cmd_fifo_freespace -= (host->ft_cmd_fifo_wp - wp) & 0xFFF;
 }
 
 ft_uint16_t FT_GPU_Cmdfifo_Freespace(FT_GPU_HAL_Context_t *host)
@@ -289,7 +371,9 @@ ft_uint16_t FT_GPU_Cmdfifo_Freespace(FT_GPU_HAL_Context_t *host)
 
 	fullness = (host->ft_cmd_fifo_wp - FT_GPU_HAL_Rd16(host, REG_CMD_READ)) & 0xFFF; // 4095 byte fifo.;
 
-	return( (FT_CMD_FIFO_SIZE - 4) - fullness);
+	host->ft_cmd_fifo_freespace = (FT_CMD_FIFO_SIZE - 4) - fullness;
+
+	return host->ft_cmd_fifo_freespace;
 }
 
 ft_void_t FT_GPU_HAL_WrCmdBuf(FT_GPU_HAL_Context_t *host, ft_const_uint8_t *buffer, ft_uint16_t count)
@@ -297,10 +381,15 @@ ft_void_t FT_GPU_HAL_WrCmdBuf(FT_GPU_HAL_Context_t *host, ft_const_uint8_t *buff
 	ft_uint16_t length = 0;
 	ft_uint16_t	offset = 0;
 
+	FT_GPU_HAL_FlushCmdBuffer(host); // keep the commands in order.
+
 	do{
 		length = count;
-		if (length > FT_GPU_Cmdfifo_Freespace(host)){
-		    length = FT_GPU_Cmdfifo_Freespace(host);
+		if (length > host->ft_cmd_fifo_freespace){
+		    FT_GPU_Cmdfifo_Freespace(host); // only read REG_CMD_READ when the fifo looks full.
+		}
+		if (length > host->ft_cmd_fifo_freespace){
+		    length = host->ft_cmd_fifo_freespace;
 		}
       	FT_GPU_HAL_CheckCmdBuffer(host, length); // this checks the buffer has enough space
 
@@ -323,10 +412,15 @@ ft_void_t FT_GPU_HAL_WrCmdBuf_P(FT_GPU_HAL_Context_t *host, ft_prog_uint8_t *buf
 	ft_uint16_t length = 0;
 	ft_uint16_t	offset = 0;
 
+	FT_GPU_HAL_FlushCmdBuffer(host); // keep the commands in order.
+
 	do{
 		length = count;
-		if (length > FT_GPU_Cmdfifo_Freespace(host)){
-		    length = FT_GPU_Cmdfifo_Freespace(host);
+		if (length > host->ft_cmd_fifo_freespace){
+		    FT_GPU_Cmdfifo_Freespace(host); // only read REG_CMD_READ when the fifo looks full.
+		}
+		if (length > host->ft_cmd_fifo_freespace){
+		    length = host->ft_cmd_fifo_freespace;
 		}
       	FT_GPU_HAL_CheckCmdBuffer(host, length); // this checks the buffer has enough space
 
@@ -346,40 +440,48 @@ ft_void_t FT_GPU_HAL_WrCmdBuf_P(FT_GPU_HAL_Context_t *host, ft_prog_uint8_t *buf
 
 ft_void_t FT_GPU_HAL_CheckCmdBuffer(FT_GPU_HAL_Context_t *host,ft_const_uint16_t count)
 {
-   ft_uint16_t getfreespace;
-   do{
-        getfreespace = FT_GPU_Cmdfifo_Freespace(host);
-   }while( getfreespace < count );
+   // the co-processor only ever frees space, so poll REG_CMD_READ only when the last free space read is not enough.
+   while( host->ft_cmd_fifo_freespace < count ){
+        FT_GPU_Cmdfifo_Freespace(host);
+   }
 }
 
 ft_void_t FT_GPU_HAL_WaitCmdfifo_empty(FT_GPU_HAL_Context_t *host)
 {
+   FT_GPU_HAL_FlushCmdBuffer(host);
+
    while( FT_GPU_HAL_Rd16(host, REG_CMD_READ) != FT_GPU_HAL_Rd16(host, REG_CMD_WRITE) );
 
    host->ft_cmd_fifo_wp = FT_GPU_HAL_Rd16(host, REG_CMD_WRITE);
+   host->ft_cmd_fifo_freespace = FT_CMD_FIFO_SIZE - 4;
 }
 
 ft_void_t FT_GPU_HAL_WaitLogo_Finish(FT_GPU_HAL_Context_t *host)
 {
     ft_int16_t cmdrdptr,cmdwrptr;
 
+    FT_GPU_HAL_FlushCmdBuffer(host);
+
     do{
 		cmdrdptr = FT_GPU_HAL_Rd16(host,REG_CMD_READ);
 		cmdwrptr = FT_GPU_HAL_Rd16(host,REG_CMD_WRITE);
     }while( (cmdwrptr != cmdrdptr) || (cmdrdptr != 0) );
     host->ft_cmd_fifo_wp = 0;
+    host->ft_cmd_fifo_freespace = FT_CMD_FIFO_SIZE - 4;
 }
 
 ft_void_t FT_GPU_HAL_ResetCmdFifo(FT_GPU_HAL_Context_t *host)
 {
 	host->ft_cmd_fifo_wp = 0;
+	host->ft_cmd_fifo_freespace = 0;
+	host->ft_cmd_buffer_count = 0;
 }
 
 ft_void_t FT_GPU_HAL_WrCmd32(FT_GPU_HAL_Context_t *host, ft_const_uint32_t cmd)
 {
-	FT_GPU_HAL_CheckCmdBuffer(host,sizeof(cmd));
-	FT_GPU_HAL_Wr32(host, RAM_CMD + host->ft_cmd_fifo_wp, cmd);
-	FT_GPU_HAL_Updatecmdfifo(host,sizeof(cmd));
+	FT_GPU_HAL_StartCmdBuffer(host,FT_CMD_SIZE);
+	FT_GPU_HAL_TransferCmd(host, cmd);
+	FT_GPU_HAL_EndCmdBuffer(host,FT_CMD_SIZE);
 }
 
 ft_void_t FT_GPU_HAL_RdMem(FT_GPU_HAL_Context_t *host, ft_uint32_t addr, ft_uint8_t *buffer, ft_const_uint16_t length)
@@ -33,6 +33,7 @@ typedef enum {
 	FT_GPU_HAL_OPENED,
 	FT_GPU_HAL_READING,
 	FT_GPU_HAL_WRITING,
+	FT_GPU_HAL_BUFFERING,
 	FT_GPU_HAL_CLOSED,
 
 	FT_GPU_HAL_STATUS_COUNT,
@@ -59,6 +60,13 @@ typedef enum {
 
 #define FT_GPU_CORE_RESET  (0x68)
 
+/* Co-processor commands are staged in a local buffer, and written to the FT800 fifo in one SPI burst */
+/* with one REG_CMD_WRITE update, when the buffer is full, at CMD_SWAP, or when waiting for the fifo. */
+/* The buffer is allocated from the heap on FT_GPU_HAL_Open(). Without it, commands are written directly. */
+#ifndef FT_CMD_BUFFER_SIZE
+#define FT_CMD_BUFFER_SIZE	(512)	// bytes, a multiple of FT_CMD_SIZE.
+#endif
+
 typedef struct {
 	ft_uint8_t reserved;
 }FT_GPU_App_Context_t;
@@ -77,6 +85,9 @@ typedef struct {
 typedef struct {
 	FT_GPU_HAL_STATUS_E		status;
     ft_uint16_t				ft_cmd_fifo_wp; 	// co-processor fifo write pointer
+    ft_uint16_t				ft_cmd_fifo_freespace;	// co-processor fifo free space, at least. Only refreshed from REG_CMD_READ when too small.
+    ft_uint8_t				*ft_cmd_buffer;		// co-processor command staging buffer, FT_CMD_BUFFER_SIZE bytes
+    ft_uint16_t				ft_cmd_buffer_count;// bytes of commands staged
 	FT_GPU_App_Context_t	app_header;			// prototype for application uses
 	SemaphoreHandle_t		xINT0Semaphore;		// Create a Semaphore binary flag for the interrupt pending, should read the REG_INT_FLAGS to see which one fired.
 }FT_GPU_HAL_Context_t;
@@ -114,6 +125,10 @@ ft_void_t		FT_GPU_HAL_StartCmdTransfer(FT_GPU_HAL_Context_t *host, FT_GPU_TRANSF
 ft_uint32_t		FT_GPU_HAL_TransferCmd(FT_GPU_HAL_Context_t *host, ft_const_uint32_t cmd) __attribute__ ((flatten));
 ft_void_t		FT_GPU_HAL_EndCmdTransfer(FT_GPU_HAL_Context_t *host) __attribute__ ((flatten));
 
+ft_void_t		FT_GPU_HAL_StartCmdBuffer(FT_GPU_HAL_Context_t *host, ft_const_uint16_t count) __attribute__ ((flatten));	// stage a command of count bytes
+ft_void_t		FT_GPU_HAL_EndCmdBuffer(FT_GPU_HAL_Context_t *host, ft_const_uint16_t count) __attribute__ ((flatten));
+ft_void_t		FT_GPU_HAL_FlushCmdBuffer(FT_GPU_HAL_Context_t *host);	// write the staged commands to the co-processor fifo
+
 ft_void_t		FT_GPU_HAL_CheckCmdBuffer(FT_GPU_HAL_Context_t *host,ft_const_uint16_t count)  __attribute__ ((flatten));
 ft_void_t		FT_GPU_HAL_Updatecmdfifo(FT_GPU_HAL_Context_t *host, ft_const_uint16_t count) __attribute__ ((flatten));
 ft_void_t		FT_GPU_HAL_WrCmd32(FT_GPU_HAL_Context_t *host, ft_const_uint32_t cmd) __attribute__ ((flatten));
@@ -12,20 +12,238 @@
 #include "socket.h"
 #include "wizchip_conf.h"
 
-#ifdef __DEF_WIZCHIP_DBG__
 /* Scheduler include files. */
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
 #include "semphr.h"
+#include "event_groups.h"
 
+#ifdef __DEF_WIZCHIP_DBG__
 #include "serial.h"
 #endif
 
 #if   defined(_WIZCHIP_)		// Definition in freeRTOSBoardDefs.h
 
+#ifdef __DEF_WIZCHIP_INT__
+#include <avr/interrupt.h>
+#endif
+
 static uint16_t local_port;
 
+static uint8_t sock_is_sending;						// One bit per socket with a send_async() waiting for SEND_OK.
+
+/* sock_is_sending is shared by the tasks using different sockets, so each change is made in a critical section. */
+#define SOCK_SENDING_SET(s)		do { taskENTER_CRITICAL(); sock_is_sending |= (0x01 << (s)); taskEXIT_CRITICAL(); } while(0)
+#define SOCK_SENDING_CLEAR(s)	do { taskENTER_CRITICAL(); sock_is_sending &= ~(0x01 << (s)); taskEXIT_CRITICAL(); } while(0)
+
+#ifdef __DEF_WIZCHIP_INT__
+static EventGroupHandle_t xSocketEvents[_WIZCHIP_MAX_SOC_NUM_];	// Sn_IR bits delivered by the INTn service task, created on first use.
+static EventGroupHandle_t xSocketActivity;			// One bit per socket with a CON, DISCON, RECV or TIMEOUT delivered.
+static TaskHandle_t xSocketEventTask;				// Task servicing the Wiznet INTn.
+
+#define SOCKET_EVENT_POLL	( 128 / portTICK_PERIOD_MS )	// Recheck the socket state while waiting for a SEND_OK.
+#define SOCKET_EVENT_SERVICE ( 32 / portTICK_PERIOD_MS )	// Service the sockets at least this often, in case an INTn edge is missed.
+#endif
+
+#ifdef __DEF_WIZCHIP_INT__
+/**
+@brief	This returns the event group for the socket, creating it on first use, or NULL if there is no heap for it.
+*/
+static EventGroupHandle_t socket_events(SOCKET s)
+{
+	EventGroupHandle_t xEvents;
+
+	if (xSocketEvents[s] == NULL)
+	{
+		if ( (xEvents = xEventGroupCreate()) == NULL ) return NULL;
+
+		taskENTER_CRITICAL();
+		if (xSocketEvents[s] == NULL)
+		{
+			xSocketEvents[s] = xEvents;
+			xEvents = NULL;
+		}
+		taskEXIT_CRITICAL();
+
+		if (xEvents != NULL)
+			vEventGroupDelete( xEvents );	// another task created it first.
+	}
+	return xSocketEvents[s];
+}
+
+/**
+@brief	This task services the Wiznet INTn, by reading the sockets' Sn_IR once each and delivering them to waiting tasks.
+
+The INTn ISR must not use the SPI bus, as a task may be part way through a transaction,
+so the ISR only wakes this task, which takes the bus like any other.
+*/
+static void vSocketEventTask(void *pvParameters)
+{
+	(void) pvParameters;
+
+	uint8_t sir, ir;
+	SOCKET s;
+	EventGroupHandle_t xEvents;
+
+	for(;;)
+	{
+		/* woken by INTn, or by the timeout so a missed edge (or no INTn jumper) only delays the events. */
+		ulTaskNotifyTake( pdTRUE, SOCKET_EVENT_SERVICE );
+
+		/* process all of the interrupts, until INTn is released. */
+		do
+		{
+			/* the common interrupts (IP conflict, unreachable, PPPoE close) that DHCP enables aren't delivered, only cleared. */
+			if ( (ir = getIR() & 0xF0) )
+				WIZCHIP_write(IR, ir);
+
+			sir = getSIR();
+			for (s = 0; s < _WIZCHIP_MAX_SOC_NUM_; ++s)
+			{
+				if (sir & (0x01 << s))
+				{
+					ir = WIZCHIP_read(Sn_IR(s));
+					WIZCHIP_write(Sn_IR(s), ir);	// interrupt clear
+
+					if ( (xEvents = socket_events(s)) != NULL )
+						xEventGroupSetBits( xEvents, ir & (Sn_IR_SEND_OK | Sn_IR_TIMEOUT | Sn_IR_RECV | Sn_IR_DISCON | Sn_IR_CON) );
+
+					if (ir & (Sn_IR_TIMEOUT | Sn_IR_RECV | Sn_IR_DISCON | Sn_IR_CON))
+						xEventGroupSetBits( xSocketActivity, 0x01 << s );
+				}
+			}
+		} while( sir );
+
+		WIZCHIP_ISR_ENABLE();
+	}
+}
+
+/**
+@brief	Wiznet INTn interrupt routine. Falling edge, so a new edge is seen for each event after INTn is released.
+*/
+ISR(WIZCHIP_INT_vect)
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	WIZCHIP_ISR_DISABLE();	// until the service task has cleared the interrupts.
+
+	vTaskNotifyGiveFromISR( xSocketEventTask, &xHigherPriorityTaskWoken );
+
+	if( xHigherPriorityTaskWoken )
+		taskYIELD();
+}
+#endif
+
+/**
+@brief	This function starts delivering the socket events (Sn_IR) for socket_event_wait().
+		With __DEF_WIZCHIP_INT__ they are delivered by a task woken by INTn, at the priority given.
+		Otherwise the events are polled from Sn_IR by socket_event_wait(), and this does nothing.
+
+@return 1 for success else 0.
+*/
+uint8_t socket_event_init(
+	UBaseType_t uxPriority	/**< priority of the INTn service task, higher than the tasks waiting for events */
+	)
+{
+#ifdef __DEF_WIZCHIP_INT__
+	if (xSocketEventTask != NULL) return 1;
+
+	if ( (xSocketActivity == NULL) && ((xSocketActivity = xEventGroupCreate()) == NULL) )
+		return 0;
+
+	if ( xTaskCreate( vSocketEventTask, (const portCHAR *)"WizINT", 128, NULL, uxPriority, &xSocketEventTask ) != pdPASS )
+		return 0;
+
+	WIZCHIP_INT_SETUP();	// INTn input on D2, falling edge.
+	setSIMR(0xFF);			// interrupts from all sockets.
+	WIZCHIP_ISR_ENABLE();
+#else
+	(void) uxPriority;
+#endif
+	return 1;
+}
+
+
+/**
+@brief	This function waits for any of the socket events (Sn_IR bits) given, and clears those that occurred.
+		With __DEF_WIZCHIP_INT__ the task is blocked until the event, otherwise (or before socket_event_init())
+		Sn_IR is polled each tick.
+
+@return the events that occurred, or 0 if timed out.
+*/
+uint8_t socket_event_wait(
+	SOCKET s,			/**< socket index */
+	uint8_t events,		/**< Sn_IR_CON, Sn_IR_DISCON, Sn_IR_RECV, Sn_IR_TIMEOUT, Sn_IR_SEND_OK */
+	TickType_t timeout	/**< ticks to wait, or portMAX_DELAY */
+	)
+{
+	uint8_t ir;
+	TickType_t xStart;
+
+#ifdef __DEF_WIZCHIP_INT__
+	EventGroupHandle_t xEvents;
+
+	if ( (xSocketEventTask != NULL) && ((xEvents = socket_events(s)) != NULL) )
+		return (uint8_t)xEventGroupWaitBits( xEvents, events, pdTRUE, pdFALSE, timeout ) & events;
+#endif
+
+	xStart = xTaskGetTickCount();
+
+	while ( !(ir = WIZCHIP_read(Sn_IR(s)) & events) )
+	{
+		if ( (timeout != portMAX_DELAY) && ((xTaskGetTickCount() - xStart) >= timeout) )
+			return 0;
+		vTaskDelay( 1 );
+	}
+	WIZCHIP_write(Sn_IR(s), ir);	// clear the events that occurred
+	return ir;
+}
+
+/**
+@brief	This function waits for a connection, disconnection, received data or timeout on any of the sockets given,
+		so a server can sleep until one of its sockets needs attention. With __DEF_WIZCHIP_INT__ the task is blocked
+		until the event, otherwise (or before socket_event_init()) Sn_IR is polled each tick, and CON, DISCON and RECV
+		are cleared for the sockets returned.
+
+@return the sockets with events, one bit per socket, or 0 if timed out.
+*/
+uint8_t socket_event_wait_any(
+	uint8_t sockets,	/**< one bit per socket index */
+	TickType_t timeout	/**< ticks to wait, or portMAX_DELAY */
+	)
+{
+	uint8_t ir, active;
+	SOCKET s;
+	TickType_t xStart;
+
+#ifdef __DEF_WIZCHIP_INT__
+	if (xSocketEventTask != NULL)
+		return (uint8_t)xEventGroupWaitBits( xSocketActivity, sockets, pdTRUE, pdFALSE, timeout ) & sockets;
+#endif
+
+	xStart = xTaskGetTickCount();
+
+	for(;;)
+	{
+		active = 0;
+		for (s = 0; s < _WIZCHIP_MAX_SOC_NUM_; ++s)
+		{
+			if ( (sockets & (0x01 << s)) && (ir = WIZCHIP_read(Sn_IR(s)) & (Sn_IR_TIMEOUT | Sn_IR_RECV | Sn_IR_DISCON | Sn_IR_CON)) )
+			{
+				WIZCHIP_write(Sn_IR(s), ir & (Sn_IR_RECV | Sn_IR_DISCON | Sn_IR_CON));	// TIMEOUT is left for socket_event_wait()
+				active |= (0x01 << s);
+			}
+		}
+		if (active)
+			return active;
+
+		if ( (timeout != portMAX_DELAY) && ((xTaskGetTickCount() - xStart) >= timeout) )
+			return 0;
+		vTaskDelay( 1 );
+	}
+}
+
 /**
 @brief	This Socket function initialise the channel in particular mode, and set the port and wait for W5200/W5100 to complete its state change.
 @return 1 for success else 0.
@@ -50,6 +268,9 @@ uint8_t socket(
 		)
 	{
 		close(s);
+#ifdef __DEF_WIZCHIP_INT__
+		socket_events(s);	// so the service task can deliver this socket's events.
+#endif
 
 		WIZCHIP_write(Sn_MR(s), (protocol | flag) );
 
@@ -130,13 +351,17 @@ void close(SOCKET s)
 	while( WIZCHIP_read(Sn_SR(s)) != SOCK_CLOSED ) ;
 
 	/* clear interrupt */
+	WIZCHIP_write(Sn_IR(s), 0xFF);
+
 	#ifdef __DEF_WIZCHIP_INT__
-      /* all clear */
-	       putISR(s, 0x00);
-	#else
-      /* all clear */
-		WIZCHIP_write(Sn_IR(s), 0xFF);
+	/* all clear */
+	if (xSocketEvents[s] != NULL)
+		xEventGroupClearBits( xSocketEvents[s], 0xFF );
+	if (xSocketActivity != NULL)
+		xEventGroupClearBits( xSocketActivity, 0x01 << s );
 	#endif
+
+	SOCK_SENDING_CLEAR(s);
 }
 
 
@@ -263,6 +488,56 @@ void disconnect(SOCKET s)
 }
 
 
+/**
+@brief	This function sends the data already copied into the Tx buffer, in TCP mode, and waits for it to be sent.
+@return	bytes transmitted length for success else 0 for failure.
+*/
+static uint16_t send_command(
+	SOCKET s				/**< the socket index */
+	)
+{
+	uint16_t ret;
+	uint16_t txrd, txrd_before_send;
+
+	txrd_before_send = WIZCHIP_read(Sn_TX_RD0(s));
+	txrd_before_send = (txrd_before_send << 8) + WIZCHIP_read(Sn_TX_RD1(s));
+
+	WIZCHIP_write(Sn_CR(s), Sn_CR_SEND);
+
+	/* wait to process the command... */
+	while( WIZCHIP_read(Sn_CR(s)) ) ;
+
+#ifdef __DEF_WIZCHIP_INT__
+	while ( !(socket_event_wait(s, Sn_IR_SEND_OK | Sn_IR_TIMEOUT, SOCKET_EVENT_POLL) & Sn_IR_SEND_OK) ) // blocked, not spinning on the SPI bus
+#else
+	while ( (WIZCHIP_read(Sn_IR(s)) & Sn_IR_SEND_OK) != Sn_IR_SEND_OK )
+#endif
+	{
+		if( WIZCHIP_read(Sn_SR(s)) == SOCK_CLOSED )
+		{
+#ifdef __DEF_WIZCHIP_DBG__
+			xSerialPrint_P(PSTR(" SOCK_CLOSED\r\n"));
+#endif
+			close(s);
+			return 0;
+		}
+	}
+#ifndef __DEF_WIZCHIP_INT__
+	WIZCHIP_write(Sn_IR(s), Sn_IR_SEND_OK);
+#endif
+	txrd = WIZCHIP_read(Sn_TX_RD0(s));
+	txrd = (txrd << 8) + WIZCHIP_read(Sn_TX_RD1(s));
+
+	if(txrd > txrd_before_send) {
+		ret = txrd - txrd_before_send;
+	} else {
+		ret = (0xffff - txrd_before_send) + txrd + 1;
+	}
+
+	return ret;
+}
+
+
 /**
 @brief	This function used to send the data in TCP mode
 @return	bytes transmitted length for success else 0 for failure.
@@ -276,7 +551,6 @@ uint16_t send(
 	uint8_t status = 0;
 	uint16_t ret = 0;
 	uint16_t freesize = 0;
-	uint16_t txrd, txrd_before_send;
 #ifdef __DEF_WIZCHIP_DBG__
 	xSerialPrint_P(PSTR(" send()\r\n"));
 #endif
@@ -286,6 +560,12 @@ uint16_t send(
 	else
 		ret = len;
 
+	if (sock_is_sending & (0x01 << s))	// collect the SEND_OK of a previous send_async() first.
+	{
+		socket_event_wait(s, Sn_IR_SEND_OK | Sn_IR_TIMEOUT, portMAX_DELAY);
+		SOCK_SENDING_CLEAR(s);
+	}
+
 	// if free buffer is available, start.
 	do
 	{
@@ -305,44 +585,7 @@ uint16_t send(
 	WIZCHIP_send_data_processing(s, (uint8_t *)buf, ret);
 
 	if(ret != 0)
-	{
-		txrd_before_send = WIZCHIP_read(Sn_TX_RD0(s));
-		txrd_before_send = (txrd_before_send << 8) + WIZCHIP_read(Sn_TX_RD1(s));
-
-		WIZCHIP_write(Sn_CR(s), Sn_CR_SEND);
-
-		/* wait to process the command... */
-		while( WIZCHIP_read(Sn_CR(s)) ) ;
-
-#ifdef __DEF_WIZCHIP_INT__
-		while ( (getISR(s) & Sn_IR_SEND_OK) != Sn_IR_SEND_OK )
-#else
-		while ( (WIZCHIP_read(Sn_IR(s)) & Sn_IR_SEND_OK) != Sn_IR_SEND_OK )
-#endif
-        {
-			if( WIZCHIP_read(Sn_SR(s)) == SOCK_CLOSED )
-			{
-#ifdef __DEF_WIZCHIP_DBG__
-				xSerialPrint_P(PSTR(" SOCK_CLOSED\r\n"));
-#endif
-				close(s);
-				return 0;
-			}
-		}
-#ifdef __DEF_WIZCHIP_INT__
-  		putISR(s, getISR(s) & (~Sn_IR_SEND_OK));
-#else
-		WIZCHIP_write(Sn_IR(s), Sn_IR_SEND_OK);
-#endif
-		txrd = WIZCHIP_read(Sn_TX_RD0(s));
-		txrd = (txrd << 8) + WIZCHIP_read(Sn_TX_RD1(s));
-
-		if(txrd > txrd_before_send) {
-			ret = txrd - txrd_before_send;
-		} else {
-			ret = (0xffff - txrd_before_send) + txrd + 1;
-		}
-	}
+		ret = send_command(s);
 
 	return ret;
 }
@@ -380,6 +623,237 @@ uint16_t recv(
 }
 
 
+/**
+@brief	This function is used to send the data in TCP mode, without waiting for it to be sent.
+		The data is copied to the W5x00 and the SEND command issued. The SEND_OK is collected
+		by the next send_async() on the socket, which will not wait if the previous send is
+		still in progress, or if there is not enough free buffer for all of the data.
+
+@return	bytes queued for transmission, or 0 if busy or failed.
+*/
+uint16_t send_async(
+	SOCKET s, 				/**< the socket index */
+	const uint8_t * buf, 	/**< a pointer to data */
+	uint16_t len			/**< the data size to be send */
+	)
+{
+	uint8_t status;
+	uint8_t events;
+
+	status = WIZCHIP_read(Sn_SR(s));
+	if ((status != SOCK_ESTABLISHED) && (status != SOCK_CLOSE_WAIT))
+		return 0;
+
+	if (sock_is_sending & (0x01 << s))
+	{
+		events = socket_event_wait(s, Sn_IR_SEND_OK | Sn_IR_TIMEOUT, 0);	// collect the previous send, without waiting.
+
+		if (events & Sn_IR_TIMEOUT)
+		{
+			close(s);
+			return 0;
+		}
+		if (!(events & Sn_IR_SEND_OK))
+			return 0;	// previous send still busy.
+
+		SOCK_SENDING_CLEAR(s);
+	}
+
+	if (len > WIZCHIP_getTxMAX(s))
+		len = WIZCHIP_getTxMAX(s); // check size not to exceed MAX size.
+
+	if (getSn_TX_FSR(s) < len)
+		return 0;	// not enough free buffer now, try again later.
+
+	// copy data
+	WIZCHIP_send_data_processing(s, (uint8_t *)buf, len);
+
+	WIZCHIP_write(Sn_CR(s), Sn_CR_SEND);
+
+	/* wait to process the command... */
+	while( WIZCHIP_read(Sn_CR(s)) ) ;
+
+	SOCK_SENDING_SET(s);
+
+	return len;
+}
+
+
+/**
+@brief	This function is used to receive the data in TCP mode, blocking the task until data arrives.
+
+@return	received data size, up to len, or 0 if timed out or the connection is closed.
+*/
+uint16_t recv_wait(
+	SOCKET s, 			/**< socket index */
+	uint8_t * buf, 		/**< a pointer to copy the data to be received */
+	uint16_t len,		/**< the maximum data size to be read */
+	TickType_t timeout	/**< ticks to wait for data, or portMAX_DELAY */
+	)
+{
+	uint16_t size;
+	uint8_t status;
+
+	while ( (size = getSn_RX_RSR(s)) == 0 )
+	{
+		status = WIZCHIP_read(Sn_SR(s));
+		if (status != SOCK_ESTABLISHED)
+			return 0;	// no more data is coming.
+
+		if ( !(socket_event_wait(s, Sn_IR_RECV | Sn_IR_DISCON | Sn_IR_TIMEOUT, timeout) & Sn_IR_RECV) )
+			return 0;
+	}
+
+	if (size > len) size = len;
+
+	return recv(s, buf, size);
+}
+
+
+#if FF_USE_FORWARD
+static SOCKET sendfile_sock;		// Socket streamed to by sendfile_stream(), as f_forward() passes no context.
+static uint16_t sendfile_space;		// Bytes that may still be copied into the Tx buffer before the next SEND.
+
+/**
+@brief	This is the f_forward() streaming function for sendfile().
+@return	for a sense call (n == 0) 1 if ready, otherwise the bytes taken.
+*/
+static UINT sendfile_stream(
+	const BYTE * data,	/**< data in the FatFs sector window */
+	UINT n				/**< bytes to take, no more than sendfile_space */
+	)
+{
+	if (n == 0) return (sendfile_space != 0);
+
+	WIZCHIP_send_data_processing(sendfile_sock, (uint8_t *)data, n);	// straight from the sector window to the Tx buffer.
+	sendfile_space -= n;
+
+	return n;
+}
+
+/**
+@brief	This function sends part of a file in TCP mode, without a staging buffer.
+		The data is moved from the FatFs sector window directly into the Tx buffer,
+		as much as the Tx buffer has free before each SEND. Not reentrant.
+
+@return	bytes of the file sent, which is less than len on error or closed connection.
+*/
+uint32_t sendfile(
+	SOCKET s, 		/**< the socket index */
+	FIL * fp, 		/**< the open file, read from its current position */
+	uint32_t len	/**< the bytes to be sent */
+	)
+{
+	uint32_t sent = 0;
+	uint16_t freesize;
+	uint8_t status;
+	UINT forwarded;
+	FRESULT res;
+
+	if (sock_is_sending & (0x01 << s))	// collect the SEND_OK of a previous send_async() first.
+	{
+		socket_event_wait(s, Sn_IR_SEND_OK | Sn_IR_TIMEOUT, portMAX_DELAY);
+		SOCK_SENDING_CLEAR(s);
+	}
+
+	sendfile_sock = s;
+
+	while (sent < len)
+	{
+		status = WIZCHIP_read(Sn_SR(s));
+		if ((status != SOCK_ESTABLISHED) && (status != SOCK_CLOSE_WAIT))
+			break;
+
+		if ((freesize = getSn_TX_FSR(s)) == 0)
+		{
+			vTaskDelay( 1 );	// sleep while the peer acknowledges some data, as no Sn_IR event marks it.
+			continue;
+		}
+
+		if (freesize > len - sent) freesize = (uint16_t)(len - sent);
+
+		sendfile_space = freesize;
+		res = f_forward(fp, sendfile_stream, freesize, &forwarded);
+
+		if (forwarded)
+			if (send_command(s) == 0)
+				break;
+
+		sent += forwarded;
+
+		if (res != FR_OK || forwarded == 0)
+			break;	// file error, or reached end of file.
+	}
+
+	return sent;
+}
+#endif
+
+
+#if !FF_FS_READONLY
+/**
+@brief	This function receives data in TCP mode into a file, at its current position.
+		Each run of received data is moved through a small buffer to f_write(), and
+		the RECV command is issued once per run, rather than once per buffer.
+
+@return	bytes written to the file, which is less than len on timeout, error or closed connection.
+*/
+uint32_t recvfile(
+	SOCKET s, 			/**< the socket index */
+	FIL * fp, 			/**< the file open for writing */
+	uint32_t len,		/**< the bytes to be received */
+	TickType_t timeout	/**< ticks to wait for each run of data, or portMAX_DELAY */
+	)
+{
+	uint8_t chunk[RECVFILE_CHUNK_SIZE];
+	uint32_t received = 0;
+	uint16_t size, done, n;
+	UINT written = 0;
+	FRESULT res = FR_OK;
+
+	while (received < len && res == FR_OK)
+	{
+		if ((size = getSn_RX_RSR(s)) == 0)
+		{
+			if (WIZCHIP_read(Sn_SR(s)) != SOCK_ESTABLISHED)
+				break;	// no more data is coming.
+
+			if ( !(socket_event_wait(s, Sn_IR_RECV | Sn_IR_DISCON | Sn_IR_TIMEOUT, timeout) & Sn_IR_RECV) )
+				break;
+
+			continue;
+		}
+
+		if (size > len - received) size = (uint16_t)(len - received);
+
+		for (done = 0; done < size; done += written)
+		{
+			n = size - done;
+			if (n > RECVFILE_CHUNK_SIZE) n = RECVFILE_CHUNK_SIZE;
+
+			WIZCHIP_recv_data_processing(s, chunk, n);
+
+			if ((res = f_write(fp, chunk, n, &written)) != FR_OK || written != n)
+			{
+				done += written;
+				res = FR_DENIED;	// disk full, or error.
+				break;
+			}
+		}
+
+		WIZCHIP_write(Sn_CR(s), Sn_CR_RECV);
+
+		/* wait to process the command... */
+		while( WIZCHIP_read(Sn_CR(s)) ) ;
+
+		received += done;
+	}
+
+	return received;
+}
+#endif
+
+
 /**
 @brief	This function is an application I/F function which is used to send the data for other than TCP mode.
 		Unlike TCP transmission, The peer's destination address and the port is needed.
@@ -440,37 +914,33 @@ uint16_t sendto(
 		while( WIZCHIP_read(Sn_CR(s)) ) ;
 
 #ifdef __DEF_WIZCHIP_INT__
-   	while ( (getISR(s) & Sn_IR_SEND_OK) != Sn_IR_SEND_OK )
+		if ( !(socket_event_wait(s, Sn_IR_SEND_OK | Sn_IR_TIMEOUT, portMAX_DELAY) & Sn_IR_SEND_OK) ) // one of these always follows a SEND
+		{
+#ifdef __DEF_WIZCHIP_DBG__
+			xSerialPrint_P(PSTR(" ...sendto() fail.\r\n"));
+#endif
+			return 0;
+		}
 #else
 	   while ( (WIZCHIP_read(Sn_IR(s)) & Sn_IR_SEND_OK) != Sn_IR_SEND_OK )
-#endif
 		{
-#ifdef __DEF_WIZCHIP_INT__
-      	if (getISR(s) & Sn_IR_TIMEOUT)
-#else
 	      if (WIZCHIP_read(Sn_IR(s)) & Sn_IR_TIMEOUT)
-#endif
 			{
 
 #ifdef __DEF_WIZCHIP_DBG__
 				xSerialPrint_P(PSTR(" ...sendto() fail.\r\n"));
 #endif
 			/* clear interrupt */
-#ifdef __DEF_WIZCHIP_INT__
-         	putISR(s, getISR(s) & ~(Sn_IR_SEND_OK | Sn_IR_TIMEOUT));  /* clear SEND_OK & TIMEOUT */
-#else
          	WIZCHIP_write(Sn_IR(s), (Sn_IR_SEND_OK | Sn_IR_TIMEOUT)); /* clear SEND_OK & TIMEOUT */
-#endif
 			return 0;
 			}
 	   }
+#endif
 #if   (_WIZCHIP_ <= 5200)
 	   clearSUBR();	   // clear the subnet mask again and keep it because of the ARP errata
 #endif
 
-#ifdef __DEF_WIZCHIP_INT__
-     	putISR(s, getISR(s) & (~Sn_IR_SEND_OK));
-#else
+#ifndef __DEF_WIZCHIP_INT__
 	   WIZCHIP_write(Sn_IR(s), Sn_IR_SEND_OK);
 #endif
 
@@ -655,16 +1125,17 @@ uint16_t macraw_send(
 		while( WIZCHIP_read(Sn_CR(MACRAW_SOCKET)) ) ;
 
 #ifdef __DEF_WIZCHIP_INT__
-		while ( (getISR(MACRAW_SOCKET) & Sn_IR_SEND_OK) != Sn_IR_SEND_OK )
+		if ( !(socket_event_wait(MACRAW_SOCKET, Sn_IR_SEND_OK | Sn_IR_TIMEOUT, portMAX_DELAY) & Sn_IR_SEND_OK) )
+		{
+#ifdef __DEF_WIZCHIP_DBG__
+			xSerialPrint_P(PSTR(" ...macraw_send fail.\r\n"));
+#endif
+			return 0;
+		}
 #else
    		while ( (WIZCHIP_read(Sn_IR(MACRAW_SOCKET)) & Sn_IR_SEND_OK) != Sn_IR_SEND_OK )
-#endif
 		{
-#ifdef __DEF_WIZCHIP_INT__
-      	if (getISR(MACRAW_SOCKET) & Sn_IR_TIMEOUT)
-#else
 	      if (WIZCHIP_read(Sn_IR(MACRAW_SOCKET)) & Sn_IR_TIMEOUT)
-#endif
 			{
 #ifdef __DEF_WIZCHIP_DBG__
 				xSerialPrint_P(PSTR(" ...macraw_send fail.\r\n"));
@@ -672,9 +1143,6 @@ uint16_t macraw_send(
 			   return 0;
 			}
 		}
-#ifdef __DEF_WIZCHIP_INT__
-		putISR(s, getISR(MACRAW_SOCKET) & (~Sn_IR_SEND_OK));
-#else
 		WIZCHIP_write(Sn_IR(MACRAW_SOCKET), Sn_IR_SEND_OK);
 #endif
    }
@@ -66,7 +66,6 @@
    #include "md5.h"
 #endif
 
-static uint8_t 	I_STATUS[_WIZCHIP_MAX_SOC_NUM_];
 static uint16_t SMASK[_WIZCHIP_MAX_SOC_NUM_]; /**< Variable for Tx buffer MASK in each channel */
 static uint16_t RMASK[_WIZCHIP_MAX_SOC_NUM_]; /**< Variable for Rx buffer MASK in each channel */
 static uint16_t SSIZE[_WIZCHIP_MAX_SOC_NUM_]; /**< Max Tx buffer size by each channel */
@@ -77,14 +76,6 @@ static uint16_t RBUFBASEADDRESS[_WIZCHIP_MAX_SOC_NUM_]; /**< Rx buffer base addr
 // the ARP errata fix, only relevant to W5100
 static un_l2cval SUBN_VAR; // off-chip subnet mask address - solve Errata 2 & 3 v1.6 - March 2012
 
-uint8_t WIZCHIP_getISR(uint8_t s)
-{
-	return I_STATUS[s];
-}
-void WIZCHIP_putISR(uint8_t s, uint8_t val)
-{
-   I_STATUS[s] = val;
-}
 uint16_t WIZCHIP_getRxMAX(uint8_t s)
 {
    return RSIZE[s];
@@ -121,9 +112,6 @@ uint8_t WIZCHIP_write(uint16_t addr, uint8_t data)
 
 	spiSelect(Wiznet);    						// CS=0, get semaphore, SPI start
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
-
 	// Make sure you manually pull slave select low to indicate start of transfer.
 	// That is NOT done by this function..., because...
 	// Some devices need to have their SS held low across multiple transfer calls.
@@ -177,9 +165,6 @@ uint8_t WIZCHIP_read(uint16_t addr)
 
 	spiSelect(Wiznet);    						// CS=0, get semaphore, SPI start
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
-
 	// Make sure you manually pull slave select low to indicate start of transfer.
 	// That is NOT done by this function..., because...
 	// Some devices need to have their SS held low across multiple transfer calls.
@@ -225,242 +210,143 @@ uint8_t WIZCHIP_read(uint16_t addr)
 
 
 /**
-@brief	This function writes into W5100 memory (Buffer)
+@brief	These functions move a run of bytes to or from W5100 memory, with the SPI bus already selected.
+
+The W5100 has no burst mode, so every byte is a separate 4 byte frame (op code, address, data)
+ended by raising SS. The next byte is prepared while each byte is shifted out, and interrupts are
+left enabled, as the Wiznet semaphore is already held and no interrupt routine uses the SPI bus.
 */
-uint16_t WIZCHIP_write_buf(uint16_t addr, uint8_t *buf, uint16_t len)
+static void WIZCHIP_write_frames(uint16_t addr, const uint8_t *buf, uint16_t len)
 {
 	uint8_t TxByte;
-	uint16_t i;
-
-    if(len == 0)
-    {
-      return 0;
-    }
-
-	WIZCHIP_ISR_DISABLE();
-
-	// Make sure you manually pull slave select low to indicate start of transfer.
-	// That is NOT done by this function..., because...
-	// Some devices need to have their SS held low across multiple transfer calls.
-	// Using spiSelect (SS_pin);
-	// But, this one needs the SS pin toggled to finish a transmission.
-	// So call the fast macro to make it snappy. No need to release semaphore.
 
-	spiSelect(Wiznet);    						// SS=0, SPI start, get semaphore
-
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
-
-	// If the SPI module has not been enabled yet, then return with nothing.
-	if ( !(SPCR & _BV(SPE)) ) return 0;
-
-	// The SPI module is enabled, but it is in slave mode, so we can not
-	// transmit the byte.  This can happen if SSbar is an input and it went low.
-	// We will try to recover by setting the MSTR bit.
-	// Check this once only at the start. Assume that things don't change.
-	if ( !(SPCR & _BV(MSTR)) ) SPCR |= _BV(MSTR);
-	if ( !(SPCR & _BV(MSTR)) ) return 0;
-
-#ifdef __DEF_WIZCHIP_DBG__
-	xSerialPrintf_P(PSTR("WIZCHIP_write_buf: tx_ptr: %.4x "), addr);
-#endif
-
-	for( i=0; i<len; ++i)
+	while (len--)
 	{
-
-		portENTER_CRITICAL();
-
-		SPI_PORT &= ~SPI_BIT_SS_WIZNET;	// SS=0, SPI start
+		SPI_PORT &= ~SPI_BIT_SS_WIZNET;	// SS=0, frame start
 
 		SPDR = 0xF0; // Begin transmission with Write Op Code
-		TxByte = (((addr+i) & 0xFF00) >> 8); // pre-load the upper address to be transmitted
+		TxByte = (uint8_t)(addr >> 8); // pre-load the upper address to be transmitted
 		while ( !(SPSR & _BV(SPIF)) );
 
 		SPDR = TxByte; // Continue transmission
-		TxByte = ((addr+i) & 0x00FF); // pre-load the lower address to be transmitted
+		TxByte = (uint8_t)addr; // pre-load the lower address to be transmitted
 		while ( !(SPSR & _BV(SPIF)) );
 
 		SPDR = TxByte; // Continue transmission
-		TxByte = buf[i]; // pre-load the byte to be transmitted
+		TxByte = *buf++; // pre-load the byte to be transmitted
 		while ( !(SPSR & _BV(SPIF)) );
 
 		SPDR = TxByte; // Continue transmission
+		++addr;
 		while ( !(SPSR & _BV(SPIF)) );
 
-		SPI_PORT |= SPI_BIT_SS_WIZNET;	// SS=1, SPI stop, but keep semaphore
-
-		portEXIT_CRITICAL();
+		SPI_PORT |= SPI_BIT_SS_WIZNET;	// SS=1, frame end, but keep semaphore
 	}
-
-	if ( !(SPCR & _BV(MSTR)) ) return 0; 	// The SPI module is enabled, but it is in slave mode.
-
-	spiDeselect(Wiznet);	// SS=1, SPI end
-
-	WIZCHIP_ISR_ENABLE();
-
-#ifdef __DEF_WIZCHIP_DBG__
-	xSerialPrintf_P(PSTR(" %.4x tx_len: %.4x\r\n"), addr+i, len);
-#endif
-
-	return len;
 }
 
-
-/**
-@brief	This function reads from W5100 memory (Buffer)
-*/
-uint16_t WIZCHIP_read_buf(uint16_t addr, uint8_t *buf, uint16_t len)
+static void WIZCHIP_read_frames(uint16_t addr, uint8_t *buf, uint16_t len)
 {
 	uint8_t RxByte;
-	uint16_t i;
-
-	WIZCHIP_ISR_DISABLE();
-
-	// Make sure you manually pull slave select low to indicate start of transfer.
-	// That is NOT done by this function..., because...
-	// Some devices need to have their SS held low across multiple transfer calls.
-	// Using spiSelect (SS_pin);
-	// But, this one needs the SS pin toggled to finish a transmission.
-	// So call the fast macro to make it snappy. No need to release semaphore.
-
-	spiSelect(Wiznet);    						// SS=0, SPI start
-
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
-
-	// If the SPI module has not been enabled yet, then return with nothing.
-	if ( !(SPCR & _BV(SPE)) ) return 0;
-
-	// The SPI module is enabled, but it is in slave mode, so we can not
-	// transmit the byte.  This can happen if SSbar is an input and it went low.
-	// We will try to recover by setting the MSTR bit.
-	// Check this once only at the start. Assume that things don't change.
-	if ( !(SPCR & _BV(MSTR)) ) SPCR |= _BV(MSTR);
-	if ( !(SPCR & _BV(MSTR)) ) return 0;
-
-#ifdef __DEF_WIZCHIP_DBG__
-	xSerialPrintf_P(PSTR("WIZCHIP_read_buf: rx_ptr: %.4x "), addr);
-#endif
 
-	for ( i=0; i<len; ++i)
-    {
-
-		portENTER_CRITICAL();
-
-		SPI_PORT &= ~SPI_BIT_SS_WIZNET;	// SS=0, SPI start
+	while (len--)
+	{
+		SPI_PORT &= ~SPI_BIT_SS_WIZNET;	// SS=0, frame start
 
 		SPDR = 0x0F; // Begin transmission with Read Op Code
-		RxByte = (((addr+i) & 0xFF00) >> 8); // pre-load the upper address to be transmitted
+		RxByte = (uint8_t)(addr >> 8); // pre-load the upper address to be transmitted
 		while ( !(SPSR & _BV(SPIF)) );
 
 		SPDR = RxByte; // Continue transmission
-		RxByte = ((addr+i) & 0x00FF); // pre-load the lower address to be transmitted
+		RxByte = (uint8_t)addr; // pre-load the lower address to be transmitted
 		while ( !(SPSR & _BV(SPIF)) );
 
 		SPDR = RxByte; // Continue transmission
-		RxByte = 0xFF; // pre-load a dummy byte to be transmitted
+		++addr;
 		while ( !(SPSR & _BV(SPIF)) );
 
-		SPDR = RxByte; // Continue transmission
+		SPDR = 0xFF; // Continue transmission with a dummy byte
 		while ( !(SPSR & _BV(SPIF)) );
 
-		buf[i] = SPDR; // copy received byte
+		*buf++ = SPDR; // copy received byte
+
+		SPI_PORT |= SPI_BIT_SS_WIZNET;	// SS=1, frame end, but keep semaphore
+	}
+}
+
+
+/**
+@brief	This function selects the W5100 for a buffer transfer.
+@return 1 if the SPI bus is ready, else 0 and the bus is released.
+*/
+static uint8_t WIZCHIP_select_buf(void)
+{
+	WIZCHIP_ISR_DISABLE();
+
+	spiSelect(Wiznet);    						// SS=0, SPI start, get semaphore
 
-		SPI_PORT |= SPI_BIT_SS_WIZNET;	// SS=1, SPI stop, but keep semaphore
+	// If the SPI module has not been enabled yet, then return with nothing.
+	// The SPI module may be enabled, but it is in slave mode, so we can not
+	// transmit the byte.  This can happen if SSbar is an input and it went low.
+	// We will try to recover by setting the MSTR bit.
+	// Check this once only at the start. Assume that things don't change.
+	if ( (SPCR & _BV(SPE)) && !(SPCR & _BV(MSTR)) ) SPCR |= _BV(MSTR);
 
-		portEXIT_CRITICAL();
+	if ( (SPCR & (_BV(SPE) | _BV(MSTR))) != (_BV(SPE) | _BV(MSTR)) )
+	{
+		spiDeselect(Wiznet);
+		WIZCHIP_ISR_ENABLE();
+		return 0;
 	}
 
-	if ( !(SPCR & _BV(MSTR)) ) return 0; 	// The SPI module is enabled, but it is in slave mode.
+	return 1;
+}
 
-	spiDeselect(Wiznet);	// SS=1, SPI end
+static void WIZCHIP_deselect_buf(void)
+{
+	spiDeselect(Wiznet);	// SS=1, SPI end, give semaphore
 
 	WIZCHIP_ISR_ENABLE();
+}
+
+
+/**
+@brief	This function writes into W5100 memory (Buffer)
+*/
+uint16_t WIZCHIP_write_buf(uint16_t addr, uint8_t *buf, uint16_t len)
+{
+	if( len == 0 || !WIZCHIP_select_buf() ) return 0;
 
 #ifdef __DEF_WIZCHIP_DBG__
-	xSerialPrintf_P(PSTR(" %.4x rx_len: %.4x\r\n"), addr+i, len);
+	xSerialPrintf_P(PSTR("WIZCHIP_write_buf: tx_ptr: %.4x tx_len: %.4x\r\n"), addr, len);
 #endif
 
+	WIZCHIP_write_frames(addr, buf, len);
+
+	WIZCHIP_deselect_buf();
+
 	return len;
 }
 
 
 /**
-@brief	Socket interrupt routine
+@brief	This function reads from W5100 memory (Buffer)
 */
-#if defined(__AVR_ATmega640__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega1281__) || defined(__AVR_ATmega2560__) || defined(__AVR_ATmega2561__)
-ISR(INT4_vect)
-#elif defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__) || defined(__AVR_ATmega1284P__)
-ISR(INT0_vect)
-#endif
+uint16_t WIZCHIP_read_buf(uint16_t addr, uint8_t *buf, uint16_t len)
 {
-#ifdef __DEF_WIZCHIP_INT__
-	uint8_t int_val;
+	if( len == 0 || !WIZCHIP_select_buf() ) return 0;
 
-	WIZCHIP_ISR_DISABLE();
-	int_val = WIZCHIP_read(IR);
-
-	/* process all of interrupt */
-   do {
-   /*---*/
-
-   	if (int_val & IR_CONFLICT)
-   	{
-   		xSerialPrintf_P(PSTR("IP conflict : %.2x\r\n"), int_val);
-   	}
-   	if (int_val & IR_UNREACH)
-   	{
-   		xSerialPrintf_P(PSTR("INT Port Unreachable : %.2x\r\n"), int_val);
-   		xSerialPrintf_P(PSTR("UIPR0 : %d.%d.%d.%d\r\n"), WIZCHIP_read(UIPR0), WIZCHIP_read(UIPR0+1), WIZCHIP_read(UIPR0+2), WIZCHIP_read(UIPR0+3));
-   		xSerialPrintf_P(PSTR("UPORT0 : %.2x %.2x\r\n"), WIZCHIP_read(UPORT0), WIZCHIP_read(UPORT0+1));
-   	}
-
-   	/* interrupt clear */
-   	WIZCHIP_write(IR, 0xf0);
-      /*---*/
-
-   	if (int_val & IR_SOCK(0))
-   	{
-   	/* save interrupt value*/
-   		I_STATUS[0] |= WIZCHIP_read(Sn_IR(0)); // can be come to over two times.
-   		WIZCHIP_write(Sn_IR(0), I_STATUS[0]);
-      /*---*/
-   	}
-   	if (int_val & IR_SOCK(1))
-   	{
-   	/* save interrupt value*/
-   		I_STATUS[1] |= WIZCHIP_read(Sn_IR(1));
-   		WIZCHIP_write(Sn_IR(1), I_STATUS[1]);
-      /*---*/
-   	}
-   	if (int_val & IR_SOCK(2))
-   	{
-   	/* save interrupt value*/
-   		I_STATUS[2] |= WIZCHIP_read(Sn_IR(2));
-   		WIZCHIP_write(Sn_IR(2), I_STATUS[2]);
-      /*---*/
-   	}
-   	if (int_val & IR_SOCK(3))
-   	{
-   	/* save interrupt value*/
-   		I_STATUS[3] |= WIZCHIP_read(Sn_IR(3));
-   		WIZCHIP_write(Sn_IR(3), I_STATUS[3]);
-      /*---*/
-   	}
-
-   	/* re-read interrupt value*/
-   	int_val = WIZCHIP_read(IR);
-
-	/* if exist, continue to process */
-   } while (int_val != 0x00);
-   /*---*/
+#ifdef __DEF_WIZCHIP_DBG__
+	xSerialPrintf_P(PSTR("WIZCHIP_read_buf: rx_ptr: %.4x rx_len: %.4x\r\n"), addr, len);
+#endif
 
-	WIZCHIP_ISR_ENABLE();
+	WIZCHIP_read_frames(addr, buf, len);
 
-#endif
+	WIZCHIP_deselect_buf();
 
+	return len;
 }
 
+
 /**
  * @brief	This function is for resetting of the W5100. Initialises the W5100 to work in SPI mode
  */
@@ -471,8 +357,7 @@ void WIZCHIP_init(void)
 
 	spiBegin(Wiznet);							// enable the EtherMega W5100
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
+	spiRegisterDevice(Wiznet, SPI_MODE0, _WIZCHIP_SPI_DIVIDER, SPI_MSBFIRST);	// mode 0, CPOL=0 CPHA=0, at maximum speed, applied by spiSelect()
 
 	WIZCHIP_write(MR, MR_RST); // reset the W5100 chip.
 
@@ -738,6 +623,26 @@ void setIMR(uint8_t mask)
 }
 
 
+/**
+@brief	This function enables the socket interrupts. ('1' : interrupt enable for that socket)
+
+The W5100 socket interrupts are the lower four bits of IMR. The upper bits are left unchanged.
+*/
+void setSIMR(uint8_t mask)
+{
+	WIZCHIP_write(IMR, (WIZCHIP_read(IMR) & 0xF0) | (mask & 0x0F));
+}
+
+
+/**
+@brief	This function gets the sockets with an interrupt pending, one bit per socket.
+*/
+uint8_t getSIR( void )
+{
+	return WIZCHIP_read(IR) & 0x0F;
+}
+
+
 
 
 /**
@@ -952,19 +857,23 @@ void WIZCHIP_write_data(SOCKET s, volatile uint8_t * src, volatile uint8_t * dst
 	dst_mask = (uint16_t)dst & WIZCHIP_getTxMASK(s);
 	dst_ptr = (uint8_t *)(WIZCHIP_getTxBASE(s) + dst_mask);
 
+	if( len == 0 || !WIZCHIP_select_buf() ) return;
+
 	if (dst_mask + len > WIZCHIP_getTxMAX(s))
-	{
+	{	// both parts of a wrapped ring buffer transfer are done in the one selection of the bus.
 		size = WIZCHIP_getTxMAX(s) - dst_mask;
-		WIZCHIP_write_buf((uint16_t)dst_ptr, (uint8_t *)src, size);
+		WIZCHIP_write_frames((uint16_t)dst_ptr, (const uint8_t *)src, size);
 		src += size;
 		size = len - size;
 		dst_ptr = (uint8_t *)(WIZCHIP_getTxBASE(s));
-		WIZCHIP_write_buf((uint16_t)dst_ptr, (uint8_t *)src, size);
+		WIZCHIP_write_frames((uint16_t)dst_ptr, (const uint8_t *)src, size);
 	}
 	else
 	{
-		WIZCHIP_write_buf((uint16_t)dst_ptr, (uint8_t *)src, len);
+		WIZCHIP_write_frames((uint16_t)dst_ptr, (const uint8_t *)src, len);
 	}
+
+	WIZCHIP_deselect_buf();
 }
 
 
@@ -984,19 +893,23 @@ void WIZCHIP_read_data(SOCKET s, volatile uint8_t * src, volatile uint8_t * dst,
 	src_mask = (uint16_t)src & WIZCHIP_getRxMASK(s);
 	src_ptr = (uint8_t *)(WIZCHIP_getRxBASE(s) + src_mask);
 
+	if( len == 0 || !WIZCHIP_select_buf() ) return;
+
 	if( (src_mask + len) > WIZCHIP_getRxMAX(s) )
-	{
+	{	// both parts of a wrapped ring buffer transfer are done in the one selection of the bus.
 		size = WIZCHIP_getRxMAX(s) - src_mask;
-		WIZCHIP_read_buf((uint16_t)src_ptr, (uint8_t *)dst, size);
+		WIZCHIP_read_frames((uint16_t)src_ptr, (uint8_t *)dst, size);
 		dst += size;
 		size = len - size;
 		src_ptr = (uint8_t *)(WIZCHIP_getRxBASE(s));
-		WIZCHIP_read_buf((uint16_t)src_ptr, (uint8_t *)dst, size);
+		WIZCHIP_read_frames((uint16_t)src_ptr, (uint8_t *)dst, size);
 	}
 	else
 	{
-		WIZCHIP_read_buf((uint16_t)src_ptr, (uint8_t *)dst, len);
+		WIZCHIP_read_frames((uint16_t)src_ptr, (uint8_t *)dst, len);
 	}
+
+	WIZCHIP_deselect_buf();
 }
 
 #endif // #if   (_WIZCHIP_ == 5100)		// Definition in freeRTOSBoardDefs.h
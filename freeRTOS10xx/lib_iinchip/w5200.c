@@ -36,7 +36,6 @@
    #include "md5.h"
 #endif
 
-static uint8_t 	I_STATUS[_WIZCHIP_MAX_SOC_NUM_];
 static uint16_t SMASK[_WIZCHIP_MAX_SOC_NUM_]; /**< Variable for Tx buffer MASK in each channel */
 static uint16_t RMASK[_WIZCHIP_MAX_SOC_NUM_]; /**< Variable for Rx buffer MASK in each channel */
 static uint16_t SSIZE[_WIZCHIP_MAX_SOC_NUM_]; /**< Max Tx buffer size by each channel */
@@ -49,14 +48,6 @@ static un_l2cval SUBN_VAR; // off-chip subnet mask address - solve Errata 2 & 3
 
 uint16_t pre_sent_ptr, sent_ptr;
 
-uint8_t WIZCHIP_getISR(uint8_t s)
-{
-	return I_STATUS[s];
-}
-void WIZCHIP_putISR(uint8_t s, uint8_t val)
-{
-   I_STATUS[s] = val;
-}
 uint16_t WIZCHIP_getRxMAX(uint8_t s)
 {
    return RSIZE[s];
@@ -95,9 +86,6 @@ uint8_t WIZCHIP_write(uint16_t addr, uint8_t data)
 
 	spiSelect(Wiznet);							// CS=0, get semaphore, SPI start
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
-
 	// Make sure you manually pull slave select low to indicate start of transfer.
 	// That is NOT done by this function..., because...
 	// Some devices need to have their SS held low across multiple transfer calls.
@@ -155,9 +143,6 @@ uint8_t WIZCHIP_read(uint16_t addr)
 
 	spiSelect(Wiznet);							// CS=0, get semaphore, SPI start
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
-
 	// Make sure you manually pull slave select low to indicate start of transfer.
 	// That is NOT done by this function..., because...
 	// Some devices need to have their SS held low across multiple transfer calls.
@@ -218,9 +203,6 @@ uint16_t WIZCHIP_write_buf(uint16_t addr, uint8_t * buf, uint16_t len)
 
 	spiSelect(Wiznet);							// CS=0, get semaphore, SPI start
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
-
 	// Make sure you manually pull slave select low to indicate start of transfer.
 	// That is NOT done by this function..., because...
 	// Some devices need to have their SS held low across multiple transfer calls.
@@ -283,9 +265,6 @@ uint16_t WIZCHIP_read_buf(uint16_t addr, uint8_t * buf, uint16_t len)
 
 	spiSelect(Wiznet);							// CS=0, get semaphore, SPI start
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
-
 	// Make sure you manually pull slave select low to indicate start of transfer.
 	// That is NOT done by this function..., because...
 	// Some devices need to have their SS held low across multiple transfer calls.
@@ -353,8 +332,7 @@ void WIZCHIP_init(void)
 
 	spiBegin(Wiznet);		// enable the EtherMega W5200
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
+	spiRegisterDevice(Wiznet, SPI_MODE0, _WIZCHIP_SPI_DIVIDER, SPI_MSBFIRST);	// mode 0, CPOL=0 CPHA=0, at maximum speed, applied by spiSelect()
 
 	WIZCHIP_write(MR, MR_RST); // reset the W5200 chip.
 
@@ -640,6 +618,26 @@ void setIMR(uint8_t mask)
 }
 
 
+/**
+@brief	This function enables the socket interrupts. ('1' : interrupt enable for that socket)
+
+On the W5200 the socket interrupt mask is at 0x0036, here named IMR2.
+*/
+void setSIMR(uint8_t mask)
+{
+	WIZCHIP_write(IMR2, mask);
+}
+
+
+/**
+@brief	This function gets the sockets with an interrupt pending, one bit per socket.
+*/
+uint8_t getSIR( void )
+{
+	return WIZCHIP_read(IR2);
+}
+
+
 /**
  * @ingroup Common_register_access_function
  * @brief Get @ref PHYCFGR register
@@ -35,18 +35,9 @@
    #include "md5.h"
 #endif
 
-static uint8_t  I_STATUS[_WIZCHIP_MAX_SOC_NUM_];
 static uint16_t SSIZE   [_WIZCHIP_MAX_SOC_NUM_]; /**< Max Tx buffer size by each channel */
 static uint16_t RSIZE   [_WIZCHIP_MAX_SOC_NUM_]; /**< Max Rx buffer size by each channel */
 
-uint8_t WIZCHIP_getISR(uint8_t s)
-{
-	return I_STATUS[s];
-}
-void WIZCHIP_putISR(uint8_t s, uint8_t val)
-{
-   I_STATUS[s] = val;
-}
 uint16_t WIZCHIP_getRxMAX(uint8_t s)
 {
    return RSIZE[s];
@@ -68,9 +59,6 @@ void WIZCHIP_write( uint32_t addrbsb,  uint8_t data)
 
 	spiSelect(Wiznet);							// CS=0, get semaphore, SPI start
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
-
 	// If the SPI module has not been enabled yet, then return with nothing.
 	if ( !(SPCR & _BV(SPE)) ) return;
 
@@ -116,9 +104,6 @@ uint8_t WIZCHIP_read(uint32_t addrbsb)
 
 	spiSelect(Wiznet);							// CS=0, get semaphore, SPI start
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
-
 	// If the SPI module has not been enabled yet, then return with nothing.
 	if ( !(SPCR & _BV(SPE)) ) return 0;
 
@@ -169,9 +154,6 @@ uint16_t WIZCHIP_write_buf(uint32_t addrbsb, uint8_t * buf, uint16_t len)
 
 	spiSelect(Wiznet);							// CS=0, get semaphore, SPI start
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
-
 	// If the SPI module has not been enabled yet, then return with nothing.
 	if ( !(SPCR & _BV(SPE)) ) return 0;
 
@@ -224,9 +206,6 @@ uint16_t WIZCHIP_read_buf(uint32_t addrbsb, uint8_t* buf, uint16_t len)
 
 	spiSelect(Wiznet);							// CS=0, get semaphore, SPI start
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
-
 	// If the SPI module has not been enabled yet, then return with nothing.
 	if ( !(SPCR & _BV(SPE)) ) return 0;
 
@@ -285,8 +264,7 @@ void WIZCHIP_init(void)
 
 	spiBegin(Wiznet);		// enable the EtherMega W5500
 
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
+	spiRegisterDevice(Wiznet, SPI_MODE0, _WIZCHIP_SPI_DIVIDER, SPI_MSBFIRST);	// mode 0, CPOL=0 CPHA=0, at maximum speed, applied by spiSelect()
 
 	WIZCHIP_sw_reset(); // software reset the W5500 chip, and preserve only the MAC address.
 
@@ -536,6 +514,22 @@ void clearIR(uint8_t mask)
 	WIZCHIP_write(IR, ~mask | getIR() ); // must be set to 0x10.
 }
 
+/**
+@brief  This function enables the socket interrupts. ('1' : interrupt enable for that socket)
+*/
+void setSIMR(uint8_t mask)
+{
+	WIZCHIP_write(SIMR, mask);
+}
+
+/**
+@brief  This function gets the sockets with an interrupt pending, one bit per socket.
+*/
+uint8_t getSIR( void )
+{
+	return WIZCHIP_read(SIR);
+}
+
 /**
 @brief  This sets the maximum segment size of TCP in Active Mode), while in Passive Mode this is set by peer
 */
@@ -94,8 +94,6 @@ void 	  wizchip_cris_exit(void)
 void 	wizchip_cs_select(void)
 {
 	WIZCHIP_ISR_DISABLE();
-	spiSetDataMode(SPI_MODE0);					// Enable SPI function in mode 0, CPOL=0 CPHA=0
-	spiSetClockDivider(_WIZCHIP_SPI_DIVIDER);	// SPI at maximum speed
 	spiSelect(Wiznet);
 }
 /**
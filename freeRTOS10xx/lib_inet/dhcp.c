@@ -806,7 +806,7 @@ uint8_t getIP_DHCPS()
 			return 0;
 		}
 		check_DHCP_state(DHCPC_SOCK);
-		vTaskDelay(  128 / portTICK_PERIOD_MS  );
+		socket_event_wait(DHCPC_SOCK, Sn_IR_RECV, 128 / portTICK_PERIOD_MS);	// until the server replies, or the DHCP timers are due.
 	}
 	return 1;
 }
@@ -25,6 +25,13 @@ uint8_t *pHTTPResponse;		// < Pointer to HTTP response buffer
 
 static SOCKET HTTPD_SOCK;			// < Socket for the HTTP daemon.
 
+static SOCKET HTTPD_SOCKS[HTTP_MAX_SOCKETS];		// < Sockets listening for the HTTP server.
+static TickType_t HTTPD_LAST_REQUEST[HTTP_MAX_SOCKETS];	// < Tick of the last request on each persistent connection.
+static uint8_t HTTPD_CONNECTING[HTTP_MAX_SOCKETS];		// < Set while listening, so the idle timer starts when the peer connects.
+static uint8_t HTTPD_SOCK_COUNT;					// < Number of sockets in use by the HTTP server.
+
+static uint8_t init_HTTP_buffers(void);
+
 /**
  * @brief		Initialise the socket & buffer for HTTP server
  */
@@ -48,6 +55,27 @@ uint8_t init_HTTP(SOCKET s)
 		xSerialPrintf_P(PSTR("HTTPD socket: %d, initialise success..!\r\n"),s);
 #endif
 
+	if(!init_HTTP_buffers())
+		return 0;
+
+	HTTPD_SOCK = s;
+
+	return 1;
+}
+
+
+
+SOCKET get_HTTP_socket(void)				// Get the socket assigned for HTTPD
+{
+	return HTTPD_SOCK;
+}
+
+
+/**
+ * @brief		Allocate the request & response buffers, shared by all HTTP sockets
+ */
+static uint8_t init_HTTP_buffers(void)
+{
 	if(pHTTPRequest == NULL) // if there is no buffer allocated (pointer is NULL), then allocate request buffer for all HTTP functions.
 	{
 		if( !(pHTTPRequest = (HTTP_REQUEST *) pvPortMalloc( sizeof(HTTP_REQUEST) )))
@@ -67,6 +95,7 @@ uint8_t init_HTTP(SOCKET s)
 		{
 			xSerialPrint_P(PSTR("HTTP Response Buffer: malloc fail..!\r\n"));
 			vPortFree(pHTTPRequest);
+			pHTTPRequest = NULL;
 			return 0;
 		}
 #ifdef HTTP_DEBUG
@@ -75,16 +104,148 @@ uint8_t init_HTTP(SOCKET s)
 #endif
 	}
 
-	HTTPD_SOCK = s;
-
 	return 1;
 }
 
 
+/**
+ * @brief		Initialise up to count sockets listening for the HTTP server
+ * @return		The number of sockets initialised
+ *
+ * The W5x00 accepts one connection per listening socket, so each socket opened on
+ * the HTTP port allows another client to be connected concurrently.
+ */
+uint8_t init_HTTP_server(uint8_t count)
+{
+	SOCKET s = 0;
 
-SOCKET get_HTTP_socket(void)				// Get the socket assigned for HTTPD
+	if(!init_HTTP_buffers())
+		return 0;
+
+	if(count > HTTP_MAX_SOCKETS) count = HTTP_MAX_SOCKETS;
+
+	for (HTTPD_SOCK_COUNT = 0; HTTPD_SOCK_COUNT < count; ++HTTPD_SOCK_COUNT, ++s)
+	{
+		s = getSocket(SOCK_CLOSED, s);	// find the next free socket,
+		if(s == _WIZCHIP_MAX_SOC_NUM_)	// If there is no free socket?
+			break;
+
+		if(!socket(s, Sn_MR_TCP, IP_PORT_HTTP, 0x00)) // initialise the socket for HTTP service
+		{
+			xSerialPrintf_P(PSTR("HTTPD socket: %d, initialise fail..!\r\n"),s);
+			break;
+		}
+#ifdef HTTP_DEBUG
+		else
+			xSerialPrintf_P(PSTR("HTTPD socket: %d, initialise success..!\r\n"),s);
+#endif
+
+		HTTPD_SOCKS[HTTPD_SOCK_COUNT] = s;
+	}
+
+	if(HTTPD_SOCK_COUNT) HTTPD_SOCK = HTTPD_SOCKS[0];
+
+	return HTTPD_SOCK_COUNT;
+}
+
+
+/**
+ * @brief		Service each HTTP server socket once
+ * @return		The number of sockets that were busy, so the caller need only wait when none were
+ *
+ * A connection is kept open after its request is processed if the peer asked for that, and
+ * is closed by us if no further request arrives within HTTP_KEEPALIVE_TIMEOUT. It is closed
+ * at once if the whole response didn't go out, as the peer would wait for the rest of it.
+ * Requests are processed by the process_HTTP() function provided by the application.
+ */
+uint8_t serve_HTTP(void)
 {
-	return HTTPD_SOCK;
+	SOCKET s;
+	uint16_t len;
+	uint8_t i, keep_alive, busy = 0;
+
+	for (i = 0; i < HTTPD_SOCK_COUNT; ++i)
+	{
+		s = HTTPD_SOCKS[i];
+
+		switch(getSn_SR(s))
+		{
+		case SOCK_ESTABLISHED:
+			if (HTTPD_CONNECTING[i])
+			{
+				HTTPD_LAST_REQUEST[i] = xTaskGetTickCount();	// start the idle timer on the first poll after the peer connects,
+				HTTPD_CONNECTING[i] = 0;						// however long the socket was listening before that.
+			}
+
+			if ((len = getSn_RX_RSR(s)) > 0)
+			{
+				if (len > MAX_URI_SIZE) len = MAX_URI_SIZE;
+				len = recv(s, (uint8_t*)pHTTPRequest, len);
+				*(((uint8_t*)pHTTPRequest)+len) = 0;
+
+#ifdef HTTP_DEBUG
+				xSerialPrintf_P(PSTR("HTTP_REQUEST %d : Length %u from %s(%u)\r\n"), s, len, inet_ntoa(GetDestAddr(s)), GetDestPort(s));
+#endif
+				keep_alive = get_HTTP_keep_alive((uint8_t*)pHTTPRequest);	// check before the request is parsed in place
+
+				if (!process_HTTP(s, (uint8_t*)pHTTPRequest, len))	// request is processed
+					keep_alive = 0;									// but the response fell short of its Content-Length
+
+				if (keep_alive)
+					HTTPD_LAST_REQUEST[i] = xTaskGetTickCount();
+				else
+					disconnect(s);
+
+				++busy;
+			}
+			else if( (xTaskGetTickCount() - HTTPD_LAST_REQUEST[i]) > (HTTP_KEEPALIVE_TIMEOUT / portTICK_PERIOD_MS) )
+			{
+				disconnect(s);	// idle persistent connection, or a peer that connected and sent nothing.
+			}
+			break;
+
+		case SOCK_CLOSE_WAIT:
+			disconnect(s);	// if a peer requests to close the current connection
+			break;
+
+		case SOCK_INIT:
+			listen(s);		// wait for a peer to establish a new connection
+			HTTPD_CONNECTING[i] = 1;
+			break;
+
+		case SOCK_LISTEN:
+			HTTPD_CONNECTING[i] = 1;
+			break;
+
+		case SOCK_CLOSED:
+			if( !socket(s, Sn_MR_TCP, IP_PORT_HTTP, 0x00) )    // reinitialise the socket
+				xSerialPrintf_P(PSTR("HTTPD socket: %d, initialise fail..!\r\n"),s);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	return busy;
+}
+
+
+/**
+ * @brief		Wait for a connection, request or disconnection on any HTTP server socket
+ * @return		The HTTP server sockets with events, one bit per socket, or 0 if timed out
+ *
+ * Used between calls to serve_HTTP() when no socket was busy. The timeout still has to be short
+ * enough for serve_HTTP() to close idle connections, and to reopen closed sockets, in good time.
+ */
+uint8_t wait_HTTP(TickType_t timeout)
+{
+	uint8_t i, sockets = 0;
+
+	for (i = 0; i < HTTPD_SOCK_COUNT; ++i)
+		sockets |= (0x01 << HTTPD_SOCKS[i]);
+
+	return socket_event_wait_any(sockets, timeout);
 }
 
 
@@ -301,6 +462,22 @@ uint8_t* get_HTTP_param_value(
 }
 
 
+/**
+ @brief	check whether the peer wants the connection kept open after this request
+ @return 1 for HTTP/1.1 unless "Connection: close" is requested, otherwise 0
+
+ HTTP/1.0 clients are always closed, as they would need a "Connection: keep-alive" response header.
+ */
+uint8_t get_HTTP_keep_alive(
+	uint8_t * buf	/**< unparsed request from the peer */
+	)
+{
+	if (!strstr_P((const char *)buf, PSTR("HTTP/1.1"))) return 0;
+	if (strcasestr_P((const char *)buf, PSTR("Connection: close"))) return 0;
+	return 1;
+}
+
+
 uint8_t* get_HTTP_URI_name(uint8_t* uri)
 {
 	uint8_t tempURI[MAX_URI_SIZE];
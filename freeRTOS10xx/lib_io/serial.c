@@ -153,6 +153,148 @@ xComPortHandle xSerial3Port;
 
 /*-----------------------------------------------------------------*/
 
+/* Release the serial work buffer, once the UDRE ISR has transmitted it. */
+static void prvSerialWorkBufferRelease( void * pvContext )
+{
+	((xComPortHandlePtr)pvContext)->serialWorkBufferInUse = VACANT;
+}
+
+/* Called within the critical section that found the lent block, or the work buffer, taken.
+ * Register the calling task to be woken when the block is released, and return how long to sleep.
+ * Only one task can be woken directly, so any other task sleeps one tick before it checks again. */
+static TickType_t prvSerialTxWaitTicks( const xComPortHandlePtr pxPort )
+{
+	TaskHandle_t xCurrentTask = xTaskGetCurrentTaskHandle();
+
+	if( (pxPort->xTxWaitingTask == NULL) || (pxPort->xTxWaitingTask == xCurrentTask) )
+	{
+		pxPort->xTxWaitingTask = xCurrentTask;
+		return portMAX_DELAY;
+	}
+	return 1;
+}
+
+/* Wake the task waiting for the lent block, or the work buffer, once it is released from task context. */
+static void prvSerialTxWake( const xComPortHandlePtr pxPort )
+{
+	TaskHandle_t xWaitingTask;
+
+	portENTER_CRITICAL();
+	{
+		xWaitingTask = pxPort->xTxWaitingTask;
+		pxPort->xTxWaitingTask = NULL;
+	}
+	portEXIT_CRITICAL();
+
+	if( xWaitingTask != NULL )
+		xTaskNotifyGive( xWaitingTask );
+}
+
+/* Claim the serial work buffer for vsnprintf, sleeping until the UDRE ISR has transmitted it, if it is in use. */
+static void prvSerialWorkBufferClaim( const xComPortHandlePtr pxPort )
+{
+	TickType_t xTicks;
+
+	for(;;)
+	{
+		portENTER_CRITICAL();
+		{
+			if( pxPort->serialWorkBufferInUse == VACANT )
+			{
+				pxPort->serialWorkBufferInUse = ENGAGED;
+				xTicks = 0;
+			}
+			else
+				xTicks = prvSerialTxWaitTicks( pxPort );
+		}
+		portEXIT_CRITICAL();
+
+		if( xTicks == 0 )
+			return;
+
+		ulTaskNotifyTake( pdTRUE, xTicks );
+	}
+}
+
+/* Drop any borrowed block not yet transmitted, and return it to its owner. */
+static void prvSerialTxBlockCancel( const xComPortHandlePtr pxPort )
+{
+	void (*vComplete)(void * pvContext) = NULL;
+
+	portENTER_CRITICAL();
+	{
+		if( pxPort->xTxBlock.data != NULL )
+			vComplete = pxPort->xTxBlock.complete;
+		pxPort->xTxBlock.data = NULL;
+		pxPort->xTxBlock.length = 0;
+	}
+	portEXIT_CRITICAL();
+
+	if( vComplete != NULL )
+		vComplete( pxPort->xTxBlock.context );
+
+	prvSerialTxWake( pxPort );
+}
+
+/* Get the next character to transmit for the UDRE ISR, either from the Tx ring buffer,
+ * or from a borrowed block, once the ring buffer has sent everything put before the block. */
+static inline uint8_t prvSerialTxNext( const xComPortHandlePtr pxPort, uint8_t * pcChar ) __attribute__ ((hot, always_inline));
+static inline uint8_t prvSerialTxNext( const xComPortHandlePtr pxPort, uint8_t * pcChar )
+{
+	xSerialTxBlock * pxBlock = &(pxPort->xTxBlock);
+
+	if( (pxBlock->data != NULL) && (pxPort->xCharsForTx.out == pxBlock->mark) )
+	{
+		*pcChar = *pxBlock->data++;
+
+		if( --pxBlock->length == 0 )
+		{
+			pxBlock->data = NULL;
+			if( pxBlock->complete != NULL )
+				pxBlock->complete( pxBlock->context );
+
+			if( pxPort->xTxWaitingTask != NULL )
+			{
+				BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+				vTaskNotifyGiveFromISR( pxPort->xTxWaitingTask, &xHigherPriorityTaskWoken );
+				pxPort->xTxWaitingTask = NULL;	// only one task is woken for each block.
+
+				if( xHigherPriorityTaskWoken )
+					taskYIELD();
+			}
+		}
+		return pdTRUE;
+	}
+
+	if( ringBufferSPSC_IsEmpty( &(pxPort->xCharsForTx) ) )
+		return pdFALSE;
+
+	*pcChar = ringBufferSPSC_Pop( &(pxPort->xCharsForTx) );
+	return pdTRUE;
+}
+
+/* Notify a task waiting in xSerialReadUntil(), once the Rx ISR has put enough characters, or the delimiter, on the ring buffer. */
+static inline void prvSerialRxNotify( const xComPortHandlePtr pxPort, const uint8_t cChar ) __attribute__ ((hot, always_inline));
+static inline void prvSerialRxNotify( const xComPortHandlePtr pxPort, const uint8_t cChar )
+{
+	BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+	if( pxPort->xRxWaitingTask != NULL )
+	{
+		if( ((int16_t)cChar == pxPort->rxWakeDelimiter) || (ringBufferSPSC_GetCount( &(pxPort->xRxedChars) ) >= pxPort->rxWakeCount) )
+		{
+			vTaskNotifyGiveFromISR( pxPort->xRxWaitingTask, &xHigherPriorityTaskWoken );
+			pxPort->xRxWaitingTask = NULL;	// only one notification for each wait.
+
+			if( xHigherPriorityTaskWoken )
+				taskYIELD();
+		}
+	}
+}
+
+/*-----------------------------------------------------------------*/
+
 // xSerialPrintf_P(PSTR("\r\nMessage %u %u %u"), var1, var2, var2);
 
 void xSerialPrintf( const char * format, ...)
@@ -161,13 +303,10 @@ void xSerialPrintf( const char * format, ...)
 
 	va_start(arg, format);
 
-	while(xSerialPort.serialWorkBufferInUse == ENGAGED ) taskYIELD();
-	xSerialPort.serialWorkBufferInUse = ENGAGED;
+	prvSerialWorkBufferClaim( &xSerialPort );
 
 	vsnprintf((char *)(xSerialPort.serialWorkBuffer), xSerialPort.serialWorkBufferSize, (const char *)format, arg);
-	xSerialPrint((uint8_t *)(xSerialPort.serialWorkBuffer));
-
-	xSerialPort.serialWorkBufferInUse = VACANT;
+	xSerialWrite( &xSerialPort, xSerialPort.serialWorkBuffer, strlen((char *)(xSerialPort.serialWorkBuffer)), prvSerialWorkBufferRelease, &xSerialPort ); // released by the ISR.
 
 	va_end(arg);
 }
@@ -178,26 +317,17 @@ void xSerialPrintf_P(PGM_P format, ...)
 
 	va_start(arg, format);
 
-	while(xSerialPort.serialWorkBufferInUse == ENGAGED ) taskYIELD();
-	xSerialPort.serialWorkBufferInUse = ENGAGED;
+	prvSerialWorkBufferClaim( &xSerialPort );
 
 	vsnprintf_P((char *)(xSerialPort.serialWorkBuffer), xSerialPort.serialWorkBufferSize, format, arg);
-	xSerialPrint((uint8_t *)(xSerialPort.serialWorkBuffer));
-
-	xSerialPort.serialWorkBufferInUse = VACANT;
+	xSerialWrite( &xSerialPort, xSerialPort.serialWorkBuffer, strlen((char *)(xSerialPort.serialWorkBuffer)), prvSerialWorkBufferRelease, &xSerialPort ); // released by the ISR.
 
 	va_end(arg);
 }
 
 void xSerialPrint( const uint8_t * str)
 {
-	int16_t i = 0;
-	size_t stringlength;
-
-	stringlength = strlen((char *)str);
-
-	while(i < stringlength)
-		xSerialPutChar( &xSerialPort, str[i++] );
+	xSerialPutBlock( &xSerialPort, str, strlen((char *)str) );
 }
 
 void xSerialPrint_P(PGM_P str)
@@ -218,13 +348,10 @@ void xSerialxPrintf( const xComPortHandlePtr pxPort, const char * format, ...)
 
 	va_start(arg, format);
 
-	while(pxPort->serialWorkBufferInUse == ENGAGED ) taskYIELD();
-	pxPort->serialWorkBufferInUse = ENGAGED;
+	prvSerialWorkBufferClaim( pxPort );
 
 	vsnprintf((char *)(pxPort->serialWorkBuffer), pxPort->serialWorkBufferSize, (const char *)format, arg);
-	xSerialxPrint(pxPort, (uint8_t *)(pxPort->serialWorkBuffer));
-
-	pxPort->serialWorkBufferInUse = VACANT;
+	xSerialWrite( pxPort, pxPort->serialWorkBuffer, strlen((char *)(pxPort->serialWorkBuffer)), prvSerialWorkBufferRelease, pxPort ); // released by the ISR.
 
 	va_end(arg);
 }
@@ -235,26 +362,17 @@ void xSerialxPrintf_P( const xComPortHandlePtr pxPort, PGM_P format, ...)
 
 	va_start(arg, format);
 
-	while(pxPort->serialWorkBufferInUse == ENGAGED ) taskYIELD();
-	pxPort->serialWorkBufferInUse = ENGAGED;
+	prvSerialWorkBufferClaim( pxPort );
 
 	vsnprintf_P((char *)(pxPort->serialWorkBuffer), pxPort->serialWorkBufferSize, format, arg);
-	xSerialxPrint(pxPort, (uint8_t *)(pxPort->serialWorkBuffer));
-
-	pxPort->serialWorkBufferInUse = VACANT;
+	xSerialWrite( pxPort, pxPort->serialWorkBuffer, strlen((char *)(pxPort->serialWorkBuffer)), prvSerialWorkBufferRelease, pxPort ); // released by the ISR.
 
 	va_end(arg);
 }
 
 void xSerialxPrint( const xComPortHandlePtr pxPort, const uint8_t * str)
 {
-	int16_t i = 0;
-	size_t stringlength;
-
-	stringlength = strlen((char *)str);
-
-	while(i < stringlength)
-		xSerialPutChar( pxPort, str[i++]);
+	xSerialPutBlock( pxPort, str, strlen((char *)str) );
 }
 
 void xSerialxPrint_P( const xComPortHandlePtr pxPort, PGM_P str)
@@ -311,7 +429,7 @@ void xSerialRxFlush( const xComPortHandlePtr pxPort )
 		break;
 	}
 
-	ringBuffer_Flush( (ringBuffer_t*) &(pxPort->xRxedChars) );	// flush received characters
+	ringBufferSPSC_Flush( &(pxPort->xRxedChars) );	// flush received characters
 }
 /*-----------------------------------------------------------*/
 
@@ -351,48 +469,116 @@ void xSerialTxFlush( const xComPortHandlePtr pxPort )
 		break;
 	}
 
-	ringBuffer_Flush( (ringBuffer_t*) &(pxPort->xCharsForTx) ); // flush not yet transmitted characters.
+	ringBufferSPSC_Flush( &(pxPort->xCharsForTx) ); // flush not yet transmitted characters.
+	prvSerialTxBlockCancel( pxPort );				// and any borrowed block.
 }
 
 uint16_t xSerialAvailableChar( const xComPortHandlePtr pxPort )
 {
 	/* Are characters available in the serial port buffer.*/
 
-	return ringBuffer_GetCount( (ringBuffer_t*) &(pxPort->xRxedChars) );
+	return ringBufferSPSC_GetCount( &(pxPort->xRxedChars) );
 }
 
 UBaseType_t xSerialGetChar( const xComPortHandlePtr pxPort, UBaseType_t *pcRxedChar )
 {
 	/* Get the next character from the ring buffer.  Return false if no characters are available */
 
-	if( ringBuffer_IsEmpty( (ringBuffer_t*) &(pxPort->xRxedChars) ) )
+	if( ringBufferSPSC_IsEmpty( &(pxPort->xRxedChars) ) )
 	{
 		return pdFALSE;
 	}
 	else
 	{
-		* pcRxedChar = ringBuffer_Pop( (ringBuffer_t*) &(pxPort->xRxedChars) );
+		* pcRxedChar = ringBufferSPSC_Pop( &(pxPort->xRxedChars) );
 		return pdTRUE;
 	}
 }
 
-UBaseType_t xSerialPutChar( const xComPortHandlePtr pxPort, const UBaseType_t cOutChar )
+uint16_t xSerialGetBlock( const xComPortHandlePtr pxPort, uint8_t * pxBuffer, const uint16_t uxLength )
 {
-	/* Return false if there remains no room on the Tx ring buffer */
+	/* Get as many characters as are available, up to uxLength, from the ring buffer. */
 
-	if( ! ringBuffer_IsFull( (ringBuffer_t*) &(pxPort->xCharsForTx) ) )
-		ringBuffer_Poke( (ringBuffer_t*) &(pxPort->xCharsForTx), cOutChar ); // poke in a fast byte
-	else
+	return ringBufferSPSC_PopN( &(pxPort->xRxedChars), pxBuffer, uxLength );
+}
+
+uint16_t xSerialReadUntil( const xComPortHandlePtr pxPort, uint8_t * pxBuffer, const uint16_t uxMaximum, const int16_t xDelimiter, const TickType_t xIdleTimeout )
+{
+	/* Read characters until uxMaximum are read, the delimiter is read, or the line goes idle.
+	 * Between reads, sleep until the Rx ISR notifies that the wanted characters have arrived. */
+
+	uint16_t uxRead = 0;
+	uint16_t uxSpan;
+	uint8_t * pxSpan;
+	uint8_t * pxFound;
+
+	for(;;)
 	{
-		 // go slower, per character rate for 38400 is 28ms
-		_delay_ms(32); // delay for about one character
+		/* Take whatever has already arrived, up to and including any delimiter. */
+		while( (uxRead < uxMaximum) && (uxSpan = ringBufferSPSC_GetLinearSpan( &(pxPort->xRxedChars), &pxSpan )) )
+		{
+			if( uxSpan > uxMaximum - uxRead )
+				uxSpan = uxMaximum - uxRead;
 
-		if( ! ringBuffer_IsFull( (ringBuffer_t*) &(pxPort->xCharsForTx) ) )
-			ringBuffer_Poke( (ringBuffer_t*) &(pxPort->xCharsForTx), cOutChar ); // poke in a byte slowly
-		else
-			return pdFAIL; // if the Tx ring buffer remains full
+			pxFound = NULL;
+			if( xDelimiter >= 0 && (pxFound = (uint8_t *)memchr( pxSpan, xDelimiter, uxSpan )) )
+				uxSpan = (uint16_t)(pxFound - pxSpan) + 1;
+
+			memcpy( pxBuffer + uxRead, pxSpan, uxSpan );
+			ringBufferSPSC_Discard( &(pxPort->xRxedChars), uxSpan );
+			uxRead += uxSpan;
+
+			if( pxFound != NULL )
+				return uxRead;
+		}
+
+		if( uxRead >= uxMaximum )
+			return uxRead;
+
+		/* Sleep until more arrive. If nothing arrived in the meantime, then the line is idle. */
+		if( xSerialWaitChar( pxPort, uxMaximum - uxRead, xDelimiter, xIdleTimeout ) == 0 )
+			return uxRead;
+	}
+}
+
+uint16_t xSerialWaitChar( const xComPortHandlePtr pxPort, const uint16_t uxCount, const int16_t xDelimiter, const TickType_t xTimeout )
+{
+	/* Sleep until the Rx ISR notifies that uxCount characters, or the delimiter, have arrived,
+	 * or until the timeout. Nothing is taken from the ring buffer. */
+
+	uint32_t ulNotified;
+
+	/* Register to be woken by the Rx ISR. Characters may have arrived before registration,
+	 * so if there are any, return to take them rather than sleeping. */
+	portENTER_CRITICAL();
+	{
+		pxPort->rxWakeCount = uxCount;
+		pxPort->rxWakeDelimiter = xDelimiter;
+		pxPort->xRxWaitingTask = xTaskGetCurrentTaskHandle();
+	}
+	portEXIT_CRITICAL();
+
+	if( ringBufferSPSC_IsEmpty( &(pxPort->xRxedChars) ) )
+		ulNotified = ulTaskNotifyTake( pdTRUE, xTimeout );
+	else
+		ulNotified = 1;
+
+	portENTER_CRITICAL();
+	{
+		if( pxPort->xRxWaitingTask == NULL )	// the ISR notified after the wait finished,
+			ulNotified = 1;						// so consume the notification below.
+		pxPort->xRxWaitingTask = NULL;
 	}
+	portEXIT_CRITICAL();
+
+	if( ulNotified != 0 )
+		ulTaskNotifyTake( pdTRUE, 0 );	// clear any notification still pending.
 
+	return ringBufferSPSC_GetCount( &(pxPort->xRxedChars) );
+}
+
+static void prvSerialTxInterruptOn( const xComPortHandlePtr pxPort )
+{
 	switch (pxPort->usart)
 	{
 	case USART0:
@@ -424,9 +610,103 @@ UBaseType_t xSerialPutChar( const xComPortHandlePtr pxPort, const UBaseType_t cO
 	default:
 		break;
 	}
+}
+
+UBaseType_t xSerialPutChar( const xComPortHandlePtr pxPort, const UBaseType_t cOutChar )
+{
+	/* Return false if there remains no room on the Tx ring buffer */
+
+	if( ! ringBufferSPSC_IsFull( &(pxPort->xCharsForTx) ) )
+		ringBufferSPSC_Poke( &(pxPort->xCharsForTx), cOutChar ); // poke in a fast byte
+	else
+	{
+		 // go slower, per character rate for 38400 is 28ms
+		_delay_ms(32); // delay for about one character
+
+		if( ! ringBufferSPSC_IsFull( &(pxPort->xCharsForTx) ) )
+			ringBufferSPSC_Poke( &(pxPort->xCharsForTx), cOutChar ); // poke in a byte slowly
+		else
+			return pdFAIL; // if the Tx ring buffer remains full
+	}
+
+	prvSerialTxInterruptOn( pxPort );
 
 	return pdPASS;
 }
+
+uint16_t xSerialPutBlock( const xComPortHandlePtr pxPort, const uint8_t * pxBuffer, const uint16_t uxLength )
+{
+	/* Copy as much of the block as will fit onto the Tx ring buffer, and return the number of characters taken.
+	 * Where the ring buffer fills, wait for about one character and try again, just like xSerialPutChar(). */
+
+	uint16_t uxWritten;
+	uint16_t uxPoked;
+
+	uxWritten = ringBufferSPSC_PokeN( &(pxPort->xCharsForTx), pxBuffer, uxLength ); // poke in a fast block
+
+	while( uxWritten < uxLength )
+	{
+		prvSerialTxInterruptOn( pxPort );
+
+		 // go slower, per character rate for 38400 is 28ms
+		_delay_ms(32); // delay for about one character
+
+		uxPoked = ringBufferSPSC_PokeN( &(pxPort->xCharsForTx), pxBuffer + uxWritten, uxLength - uxWritten ); // poke in the rest slowly
+		if( uxPoked == 0 )
+			break; // if the Tx ring buffer remains full
+
+		uxWritten += uxPoked;
+	}
+
+	if( uxWritten )
+		prvSerialTxInterruptOn( pxPort );
+
+	return uxWritten;
+}
+
+void xSerialWrite( const xComPortHandlePtr pxPort, const uint8_t * pxBuffer, const uint16_t uxLength, void (*vComplete)(void * pvContext), void * pvContext )
+{
+	/* Lend the block to the UDRE ISR, which transmits it in place once the Tx ring buffer
+	 * has sent the characters put before it. Only one block may be lent to each port at once. */
+
+	TickType_t xTicks;
+
+	if( uxLength == 0 )
+	{
+		if( vComplete != NULL )
+			vComplete( pvContext );
+		prvSerialTxWake( pxPort );
+		return;
+	}
+
+	/* Check for, and claim, the lent block together, so two tasks can't both lend one.
+	 * If a block is already lent, sleep until the UDRE ISR has sent it. */
+	for(;;)
+	{
+		portENTER_CRITICAL();
+		{
+			if( pxPort->xTxBlock.data == NULL )
+			{
+				pxPort->xTxBlock.length = uxLength;
+				pxPort->xTxBlock.mark = pxPort->xCharsForTx.in;
+				pxPort->xTxBlock.complete = vComplete;
+				pxPort->xTxBlock.context = pvContext;
+				pxPort->xTxBlock.data = pxBuffer;
+				xTicks = 0;
+			}
+			else
+				xTicks = prvSerialTxWaitTicks( pxPort );
+		}
+		portEXIT_CRITICAL();
+
+		if( xTicks == 0 )
+			break;
+
+		ulTaskNotifyTake( pdTRUE, xTicks );
+	}
+
+	prvSerialTxInterruptOn( pxPort );
+}
 /*-----------------------------------------------------------*/
 
 xComPortHandle xSerialPortInitMinimal( eCOMPort ePort, uint32_t ulWantedBaud, uint16_t uxTxQueueLength, uint16_t uxRxQueueLength )
@@ -437,16 +717,21 @@ xComPortHandle xSerialPortInitMinimal( eCOMPort ePort, uint32_t ulWantedBaud, ui
 
 	/* Create the ring-buffers used by the serial communications task. */
 	if( (dataPtr = (uint8_t *)pvPortMalloc( sizeof(uint8_t) * uxRxQueueLength )))
-		ringBuffer_InitBuffer( (ringBuffer_t*) &(newComPort.xRxedChars), dataPtr, uxRxQueueLength);
+		ringBufferSPSC_InitBuffer( &(newComPort.xRxedChars), dataPtr, uxRxQueueLength);
 
 	if( (dataPtr = (uint8_t *)pvPortMalloc( sizeof(uint8_t) * uxTxQueueLength )))
-		ringBuffer_InitBuffer( (ringBuffer_t*) &(newComPort.xCharsForTx), dataPtr, uxTxQueueLength);
+		ringBufferSPSC_InitBuffer( &(newComPort.xCharsForTx), dataPtr, uxTxQueueLength);
 
 	// create a working buffer for vsnprintf on the heap (so we can use extended RAM, if available).
 	// create the structures on the heap (so they can be moved later).
 	if( !(newComPort.serialWorkBuffer = (uint8_t *)pvPortMalloc( sizeof(uint8_t) * uxTxQueueLength )))
 		newComPort.serialWorkBuffer = NULL;
 
+	newComPort.xTxBlock.data = NULL; // no borrowed block to transmit.
+	newComPort.xTxBlock.length = 0;
+	newComPort.xTxWaitingTask = NULL; // no task waiting to transmit.
+	newComPort.xRxWaitingTask = NULL; // no task waiting to receive.
+
 	newComPort.usart = ePort; // containing eCOMPort
 	newComPort.serialWorkBufferSize = uxTxQueueLength; // size of the working buffer for vsnprintf
 	newComPort.serialWorkBufferInUse = VACANT;  // clear the occupation flag.
@@ -639,12 +924,11 @@ void xSerialPortReInit( const xComPortHandlePtr oldComPortPtr )
 	}
 
 	/* Flush both the ring-buffers used by the serial communications task. */
-	if( &oldComPortPtr->xCharsForTx )
-		ringBuffer_Flush( (ringBuffer_t*) &(oldComPortPtr->xCharsForTx) );	// flush not yet transmitted characters.
-	if( &oldComPortPtr->xRxedChars )
-		ringBuffer_Flush( (ringBuffer_t*) &(oldComPortPtr->xRxedChars) );	// flush received characters
+	ringBufferSPSC_Flush( &(oldComPortPtr->xCharsForTx) );	// flush not yet transmitted characters.
+	ringBufferSPSC_Flush( &(oldComPortPtr->xRxedChars) );	// flush received characters
 
 	oldComPortPtr->serialWorkBufferInUse = VACANT; 							// clear the occupation flag.
+	prvSerialTxBlockCancel( oldComPortPtr );									// drop any borrowed block, and wake any waiting task.
 
 	switch (oldComPortPtr->usart)
 	{
@@ -1184,6 +1468,8 @@ ISR( USART0_RX_vect )
 
 #endif
 {
+	traceISR_ENTER( TRACE_ISR_USART0_RX );
+
 	/* Get status and data from buffer */
 
 	/* If error bit set (Frame Error, Data Over Run, Parity), flush and return nothing */
@@ -1197,9 +1483,13 @@ ISR( USART0_RX_vect )
 		/* If no error, get the character and post it on the buffer of Rxed characters.*/
 		register uint8_t cChar = UDR0;
 
-		if( ! ringBuffer_IsFull( (ringBuffer_t*) &(xSerialPort.xRxedChars) ) )
-			ringBuffer_Poke( (ringBuffer_t*) &(xSerialPort.xRxedChars), cChar);
+		if( ! ringBufferSPSC_IsFull( &(xSerialPort.xRxedChars) ) )
+			ringBufferSPSC_Poke( &(xSerialPort.xRxedChars), cChar);
+
+		prvSerialRxNotify( &xSerialPort, cChar );
 	}
+
+	traceISR_EXIT( TRACE_ISR_USART0_RX );
 }
 /*-----------------------------------------------------------*/
 
@@ -1213,14 +1503,16 @@ ISR( USART0_UDRE_vect )
 
 #endif
 {
-	if( ringBuffer_IsEmpty( (ringBuffer_t*) &(xSerialPort.xCharsForTx) ) )
+	uint8_t cChar;
+
+	if( prvSerialTxNext( &xSerialPort, &cChar ) )
 	{
-		// Queue empty, nothing to send.
-		vInterrupt0_Off();
+		UDR0 = cChar;
 	}
 	else
 	{
-		UDR0 = ringBuffer_Pop( (ringBuffer_t*) &(xSerialPort.xCharsForTx) );
+		// Queue empty, nothing to send.
+		vInterrupt0_Off();
 	}
 }
 /*-----------------------------------------------------------*/
@@ -1230,6 +1522,8 @@ ISR( USART0_UDRE_vect )
 ISR( USART1_RX_vect ) __attribute__ ((hot, flatten));
 ISR( USART1_RX_vect )
 {
+	traceISR_ENTER( TRACE_ISR_USART1_RX );
+
 	/* Get status and data from buffer */
 
 	/* If error bit set (Frame Error, Data Over Run, Parity), flush and return nothing */
@@ -1243,23 +1537,29 @@ ISR( USART1_RX_vect )
 		/* If no error, get the character and post it on the buffer of Rxed characters.*/
 		register uint8_t cChar = UDR1;
 
-		if( ! ringBuffer_IsFull( (ringBuffer_t*) &(xSerial1Port.xRxedChars) ) )
-			ringBuffer_Poke( (ringBuffer_t*) &(xSerial1Port.xRxedChars), cChar);
+		if( ! ringBufferSPSC_IsFull( &(xSerial1Port.xRxedChars) ) )
+			ringBufferSPSC_Poke( &(xSerial1Port.xRxedChars), cChar);
+
+		prvSerialRxNotify( &xSerial1Port, cChar );
 	}
+
+	traceISR_EXIT( TRACE_ISR_USART1_RX );
 }
 /*-----------------------------------------------------------*/
 
 ISR( USART1_UDRE_vect ) __attribute__ ((hot, flatten));
 ISR( USART1_UDRE_vect )
 {
-	if( ringBuffer_IsEmpty( (ringBuffer_t*) &(xSerial1Port.xCharsForTx) ) )
+	uint8_t cChar;
+
+	if( prvSerialTxNext( &xSerial1Port, &cChar ) )
 	{
-		// Queue empty, nothing to send.
-		vInterrupt1_Off();
+		UDR1 = cChar;
 	}
 	else
 	{
-		UDR1 = ringBuffer_Pop( (ringBuffer_t*) &(xSerial1Port.xCharsForTx) );
+		// Queue empty, nothing to send.
+		vInterrupt1_Off();
 	}
 }
 /*-----------------------------------------------------------*/
@@ -1272,6 +1572,8 @@ ISR( USART1_UDRE_vect )
 ISR( USART2_RX_vect ) __attribute__ ((hot, flatten));
 ISR( USART2_RX_vect )
 {
+	traceISR_ENTER( TRACE_ISR_USART2_RX );
+
 	/* Get status and data from buffer */
 
 	/* If error bit set (Frame Error, Data Over Run, Parity), flush and return nothing */
@@ -1285,23 +1587,29 @@ ISR( USART2_RX_vect )
 		/* If no error, get the character and post it on the buffer of Rxed characters.*/
 		register uint8_t cChar = UDR2;
 
-		if( ! ringBuffer_IsFull( (ringBuffer_t*) &(xSerial2Port.xRxedChars) ) )
-			ringBuffer_Poke( (ringBuffer_t*) &(xSerial2Port.xRxedChars), cChar);
+		if( ! ringBufferSPSC_IsFull( &(xSerial2Port.xRxedChars) ) )
+			ringBufferSPSC_Poke( &(xSerial2Port.xRxedChars), cChar);
+
+		prvSerialRxNotify( &xSerial2Port, cChar );
 	}
+
+	traceISR_EXIT( TRACE_ISR_USART2_RX );
 }
 /*-----------------------------------------------------------*/
 
 ISR( USART2_UDRE_vect ) __attribute__ ((hot, flatten));
 ISR( USART2_UDRE_vect )
 {
-	if( ringBuffer_IsEmpty( (ringBuffer_t*) &(xSerial2Port.xCharsForTx) ) )
+	uint8_t cChar;
+
+	if( prvSerialTxNext( &xSerial2Port, &cChar ) )
 	{
-		// Queue empty, nothing to send.
-		vInterrupt2_Off();
+		UDR2 = cChar;
 	}
 	else
 	{
-		UDR2 = ringBuffer_Pop( (ringBuffer_t*) &(xSerial2Port.xCharsForTx) );
+		// Queue empty, nothing to send.
+		vInterrupt2_Off();
 	}
 }
 /*-----------------------------------------------------------*/
@@ -1309,6 +1617,8 @@ ISR( USART2_UDRE_vect )
 ISR( USART3_RX_vect ) __attribute__ ((hot, flatten));
 ISR( USART3_RX_vect )
 {
+	traceISR_ENTER( TRACE_ISR_USART3_RX );
+
 	/* Get status and data from buffer */
 
 	/* If error bit set (Frame Error, Data Over Run, Parity), flush and return nothing */
@@ -1322,23 +1632,29 @@ ISR( USART3_RX_vect )
 		/* If no error, get the character and post it on the buffer of Rxed characters.*/
 		register uint8_t cChar = UDR3;
 
-		if( ! ringBuffer_IsFull( (ringBuffer_t*) &(xSerial3Port.xRxedChars) ) )
-			ringBuffer_Poke( (ringBuffer_t*) &(xSerial3Port.xRxedChars), cChar);
+		if( ! ringBufferSPSC_IsFull( &(xSerial3Port.xRxedChars) ) )
+			ringBufferSPSC_Poke( &(xSerial3Port.xRxedChars), cChar);
+
+		prvSerialRxNotify( &xSerial3Port, cChar );
 	}
+
+	traceISR_EXIT( TRACE_ISR_USART3_RX );
 }
 /*-----------------------------------------------------------*/
 
 ISR( USART3_UDRE_vect ) __attribute__ ((hot, flatten));
 ISR( USART3_UDRE_vect )
 {
-	if( ringBuffer_IsEmpty( (ringBuffer_t*) &(xSerial3Port.xCharsForTx) ) )
+	uint8_t cChar;
+
+	if( prvSerialTxNext( &xSerial3Port, &cChar ) )
 	{
-		// Queue empty, nothing to send.
-		vInterrupt3_Off();
+		UDR3 = cChar;
 	}
 	else
 	{
-		UDR3 = ringBuffer_Pop( (ringBuffer_t*) &(xSerial3Port.xCharsForTx) );
+		// Queue empty, nothing to send.
+		vInterrupt3_Off();
 	}
 }
 /*-----------------------------------------------------------*/
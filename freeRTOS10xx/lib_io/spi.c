@@ -10,11 +10,15 @@
 
 // AVR include files.
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 
 #include "FreeRTOS.h"
+#include "task.h"
 #include "semphr.h"
 
+#include <string.h>
+
 #include "spi.h"
 
 #if (_WIZCHIP_ == 5500)
@@ -28,6 +32,15 @@
 /* Declare a binary Semaphore flag for the SPI Bus. To ensure only single access to SPI Bus. */
 SemaphoreHandle_t xSPISemaphore = NULL; // removed STATIC to allow other processes to use same semaphore.
 
+/* The device registry, and the device whose settings are currently loaded in the SPI control registers. */
+static spiDevice_t spiDevices[ Default + 1 ];
+static uint8_t spiConfiguredDevice = 0xFF;						// none, settings must be applied on next select.
+
+/* The interrupt driven transaction engine state. Only one transaction is active, as it holds xSPISemaphore. */
+static spiTransaction_t * volatile spiActiveTransaction = NULL;	// transaction being advanced by the SPI STC ISR.
+static uint16_t spiActiveIndex;									// next byte of the active transaction.
+static TaskHandle_t spiWaitingTask = NULL;						// task to notify, once the chain is complete.
+
 /*******************************************************/
 
 void spiBegin(SPI_SLAVE_SELECT SS_pin)
@@ -129,12 +142,16 @@ void spiEnd(void)
 
 void spiSetClockDivider(SPI_CLOCK_DIV_t rate)
 {
+	spiConfiguredDevice = 0xFF;		// bus has been set up by hand, so reapply registered settings on next select.
+
 	SPCR = (SPCR & ~SPI_CLOCK_MASK) | ((uint8_t)rate & SPI_CLOCK_MASK);
 	SPSR = (SPSR & ~SPI_2XCLOCK_MASK) | (((uint8_t)rate >> 2) & SPI_2XCLOCK_MASK);
 }
 
 void spiSetBitOrder(uint8_t bitOrder)
 {
+	spiConfiguredDevice = 0xFF;
+
 	if(bitOrder == SPI_LSBFIRST) {
 		SPCR |= _BV(DORD);
 	} else {
@@ -144,10 +161,43 @@ void spiSetBitOrder(uint8_t bitOrder)
 
 void spiSetDataMode(SPI_MODE_t mode)
 {
+	spiConfiguredDevice = 0xFF;
+
 	SPCR = (SPCR & ~SPI_MODE_MASK) | (uint8_t) mode;
 }
 
 
+void spiRegisterDevice(SPI_SLAVE_SELECT SS_pin, SPI_MODE_t mode, SPI_CLOCK_DIV_t rate, uint8_t bitOrder)
+{
+	if( SS_pin > Default ) SS_pin = Default;
+
+	spiDevices[SS_pin].mode = mode;
+	spiDevices[SS_pin].rate = rate;
+	spiDevices[SS_pin].bitOrder = bitOrder;
+	spiDevices[SS_pin].registered = 1;
+
+	if( spiConfiguredDevice == SS_pin )
+		spiConfiguredDevice = 0xFF;	// settings changed, so reapply them on next select.
+}
+
+const spiDevice_t * spiGetDevice(SPI_SLAVE_SELECT SS_pin)
+{
+	if( SS_pin > Default ) SS_pin = Default;
+
+	return &spiDevices[SS_pin];
+}
+
+void spiResetDeviceStats(SPI_SLAVE_SELECT SS_pin)
+{
+	if( SS_pin > Default ) SS_pin = Default;
+
+	portENTER_CRITICAL();
+	spiDevices[SS_pin].selects = 0;
+	spiDevices[SS_pin].waitTicks = 0;
+	spiDevices[SS_pin].maxWaitTicks = 0;
+	portEXIT_CRITICAL();
+}
+
 void spiAttachInterrupt(void)
 {
 	SPCR |= _BV(SPIE);
@@ -164,9 +214,32 @@ void spiDetachInterrupt(void)
 
 uint8_t spiSelect(SPI_SLAVE_SELECT SS_pin)	/* 1:Successful, 0:Timeout */
 {
+	TickType_t xWaitTicks;
+	spiDevice_t * device;
+
+	xWaitTicks = xTaskGetTickCount();
 
 	if( (xSemaphoreTake( xSPISemaphore, (SPI_TIMEOUT / portTICK_PERIOD_MS )) == pdTRUE ) )
 	{
+		xWaitTicks = xTaskGetTickCount() - xWaitTicks;
+
+		device = &spiDevices[ (SS_pin > Default) ? Default : SS_pin ];
+
+		// Holding the bus, so the statistics can be updated without a critical section.
+		++device->selects;
+		device->waitTicks += xWaitTicks;
+		if( xWaitTicks > device->maxWaitTicks )
+			device->maxWaitTicks = (uint16_t)xWaitTicks;
+
+		// Apply the registered settings, only if another device (or spiSet*) has changed the bus.
+		if( device->registered && (spiConfiguredDevice != (uint8_t)SS_pin) )
+		{
+			SPCR = (SPCR & ~(SPI_MODE_MASK | SPI_CLOCK_MASK | _BV(DORD))) | (uint8_t)device->mode
+					| ((uint8_t)device->rate & SPI_CLOCK_MASK) | ((device->bitOrder == SPI_LSBFIRST) ? _BV(DORD) : 0);
+			SPSR = (SPSR & ~SPI_2XCLOCK_MASK) | (((uint8_t)device->rate >> 2) & SPI_2XCLOCK_MASK);
+
+			spiConfiguredDevice = (uint8_t)SS_pin;
+		}
 
 		switch( SS_pin )
 		{
@@ -464,3 +537,129 @@ uint8_t spiMultiByteTransfer(uint8_t *data, const uint16_t length)
 	// That is NOT done by this function.
 	// Using spiDeselect (SS_pin);
 }
+
+
+/*-----------------------------------------------------------------------*/
+/* Interrupt driven SPI transaction engine                               */
+/*-----------------------------------------------------------------------*/
+
+static uint8_t spiRateIsPolled(SPI_CLOCK_DIV_t rate)
+{
+	// A byte at these rates takes 64 cycles or less, which is about the cost of taking the STC interrupt.
+	return ( rate == SPI_CLOCK_DIV2 || rate == SPI_CLOCK_DIV4 || rate == SPI_CLOCK_DIV8 );
+}
+
+uint8_t spiTransact(spiTransaction_t * transaction)	/* 1:Successful, 0:Timeout */
+{
+	spiTransaction_t * segment;
+	uint8_t result = 1;
+
+	// Skip any empty transactions at the start of the chain.
+	for( segment = transaction; segment != NULL && segment->length == 0; segment = segment->next );
+
+	if( !spiSelect( transaction->ss ) ) return 0;
+
+	spiSetDataMode( transaction->mode );
+	spiSetClockDivider( transaction->rate );
+
+	if( segment == NULL )
+	{
+		// nothing to transfer.
+	}
+	else if( spiRateIsPolled( transaction->rate ) )
+	{
+		for( ; segment != NULL && result; segment = segment->next )
+		{
+			if( segment->length == 0 )
+				continue;
+
+			if( segment->rxData == NULL )
+			{
+				if( segment->txData == NULL )
+				{
+					uint16_t index;
+					for( index = 0; index < segment->length; ++index )
+						spiTransfer(0xFF);
+				}
+				else
+					result = spiMultiByteTx( segment->txData, segment->length );
+			}
+			else if( segment->txData == NULL )
+				result = spiMultiByteRx( segment->rxData, segment->length );
+			else
+			{
+				if( segment->rxData != segment->txData )
+					memcpy( segment->rxData, segment->txData, segment->length );
+				result = spiMultiByteTransfer( segment->rxData, segment->length );
+			}
+		}
+	}
+	else
+	{
+		register uint8_t tmp __attribute__ ((unused));
+
+		ulTaskNotifyTake( pdTRUE, 0 );					// clear any stale notification.
+
+		spiWaitingTask = xTaskGetCurrentTaskHandle();
+		spiActiveIndex = 0;
+		spiActiveTransaction = segment;
+
+		tmp = SPSR;										// clear any SPIF left by a polled transfer,
+		tmp = SPDR;										// so it isn't taken for the first byte.
+
+		SPDR = (segment->txData != NULL) ? segment->txData[0] : 0xFF; // Begin transmission, the ISR does the rest.
+		SPCR |= _BV(SPIE);
+
+		if( ulTaskNotifyTake( pdTRUE, (SPI_TIMEOUT / portTICK_PERIOD_MS) ) == 0 )
+		{
+			portENTER_CRITICAL();
+			SPCR &= ~_BV(SPIE);							// the device has left master mode, or similar.
+			spiActiveTransaction = NULL;
+			portEXIT_CRITICAL();
+			result = 0;
+		}
+	}
+
+	spiDeselect( transaction->ss );
+	return result;
+}
+
+ISR(SPI_STC_vect) __attribute__ ((hot, flatten));
+ISR(SPI_STC_vect)
+{
+	spiTransaction_t * segment = spiActiveTransaction;
+	uint8_t RxByte = SPDR;
+
+	if( segment == NULL )
+	{
+		SPCR &= ~_BV(SPIE);		// spurious, or the transaction timed out.
+		return;
+	}
+
+	if( segment->rxData != NULL )
+		segment->rxData[ spiActiveIndex ] = RxByte;
+
+	if( ++spiActiveIndex >= segment->length )
+	{
+		spiActiveIndex = 0;
+		do {
+			segment = segment->next;
+		} while( segment != NULL && segment->length == 0 );
+
+		spiActiveTransaction = segment;
+
+		if( segment == NULL )
+		{
+			BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+			SPCR &= ~_BV(SPIE);
+			vTaskNotifyGiveFromISR( spiWaitingTask, &xHigherPriorityTaskWoken );
+
+			if( xHigherPriorityTaskWoken )
+				taskYIELD();
+			return;
+		}
+	}
+
+	SPDR = (segment->txData != NULL) ? segment->txData[ spiActiveIndex ] : 0xFF; // Continue transmission
+}
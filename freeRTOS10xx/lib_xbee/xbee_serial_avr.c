@@ -94,7 +94,6 @@ const char *xbee_ser_portname( xbee_serial_t *serial)
 int xbee_ser_write( xbee_serial_t *serial, const void FAR *buffer, int length)
 {
 	int16_t written;
-	UBaseType_t *buff = (UBaseType_t *)buffer;
 
 	XBEE_SER_CHECK( serial );
 
@@ -103,11 +102,10 @@ int xbee_ser_write( xbee_serial_t *serial, const void FAR *buffer, int length)
 		return -EINVAL;
 	}
 
-	for( written = 0; written < length; ++written )
-	{
-		if( !(xSerialPutChar( serial, buff[written] )))	// if there's an error
-				return -EIO;							// return an error
-	}
+	written = (int16_t)xSerialPutBlock( serial, (const uint8_t *)buffer, (uint16_t)length );
+
+	if( written < length )								// if there's an error
+		return -EIO;									// return an error
 
 	return written;										// otherwise return bytes written.
 }
@@ -117,7 +115,6 @@ int xbee_ser_write( xbee_serial_t *serial, const void FAR *buffer, int length)
 int xbee_ser_read( xbee_serial_t *serial, void FAR *buffer, int bufsize)
 {
 	int16_t read;
-	UBaseType_t *buff = (UBaseType_t *)buffer;
 
 	XBEE_SER_CHECK( serial );
 
@@ -126,11 +123,10 @@ int xbee_ser_read( xbee_serial_t *serial, void FAR *buffer, int bufsize)
 		return -EINVAL;
 	}
 
-	for( read = 0; read < bufsize; ++read )
-	{
-		if( !(xSerialGetChar( serial, &buff[read] )))	// if there's an error, because we have no bytes
-				return -EIO;							// return an error
-	}
+	read = (int16_t)xSerialGetBlock( serial, (uint8_t *)buffer, (uint16_t)bufsize );
+
+	if( read < bufsize )								// if there's an error, because we have no bytes
+		return -EIO;									// return an error
 
 	return read;										// otherwise return bytes read.
 }
@@ -174,7 +170,7 @@ int xbee_ser_tx_free( xbee_serial_t *serial)
 {
 	XBEE_SER_CHECK( serial);
 
-	return (int)(serial->xCharsForTx.size - serial->xCharsForTx.count );
+	return (int)ringBufferSPSC_GetFreeCount( &(serial->xCharsForTx) );
 }
 
 /*** BeginHeader xbee_ser_tx_used */
@@ -183,7 +179,7 @@ int xbee_ser_tx_used( xbee_serial_t *serial)
 {
 	XBEE_SER_CHECK( serial );
 
-	return (int)( serial->xCharsForTx.count );
+	return (int)ringBufferSPSC_GetCount( &(serial->xCharsForTx) );
 }
 
 /*** BeginHeader xbee_ser_tx_flush */
@@ -202,7 +198,7 @@ int xbee_ser_rx_free( xbee_serial_t *serial)
 {
 	XBEE_SER_CHECK( serial );
 
-	return (int)(serial->xRxedChars.size - serial->xRxedChars.count );
+	return (int)ringBufferSPSC_GetFreeCount( &(serial->xRxedChars) );
 }
 
 /*** BeginHeader xbee_ser_rx_used */
@@ -214,7 +210,7 @@ int xbee_ser_rx_used( xbee_serial_t *serial)
 // return bytes used in rx buffer -- will this be difficult on some platforms
 // (like PC) where we can't peek at the stream?  It may be necessary to create
 // a small buffer for the program to buffer up to 512 bytes from COM port.
-	return (int)( serial->xRxedChars.count );
+	return (int)ringBufferSPSC_GetCount( &(serial->xRxedChars) );
 }
 
 /*** BeginHeader xbee_ser_rx_flush */
@@ -109,6 +109,71 @@
 
 #endif
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+    #if !defined( portUSE_TIMER2 )
+        #error "Tickless idle needs portUSE_TIMER2, as only the 32,768Hz Timer2 keeps counting in power save sleep."
+    #endif
+
+    #ifndef configTICKLESS_SLEEP_MODE
+        #define configTICKLESS_SLEEP_MODE           SLEEP_MODE_PWR_SAVE
+    #endif
+
+    /* The compare match can be at most 255 counts (ticks) ahead of the counter. */
+    #define portMAX_SUPPRESSED_TICKS                ( (TickType_t) 255 )
+#endif
+
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+/* Hardware constants for the run time stats timer, a free running 16 bit timer
+ * counting CPU clocks divided by 8, extended to 32 bits by its overflow interrupt. */
+    #if defined( portUSE_TIMER1_STATS )
+        #define portSTATS_ISR                       TIMER1_OVF_vect
+        #define portSTATS_PRESCALE_8                ( (uint8_t) _BV(CS11) )
+        #define portSTATS_OVERFLOW_INTERRUPT_ENABLE ( (uint8_t) _BV(TOIE1) )
+        #define portSTATS_OVERFLOW_FLAG             ( (uint8_t) _BV(TOV1) )
+        #define portSTATS_TCNT                      TCNT1
+        #define portSTATS_TCCRa                     TCCR1A
+        #define portSTATS_TCCRb                     TCCR1B
+        #define portSTATS_TIMSK                     TIMSK1
+        #define portSTATS_TIFR                      TIFR1
+
+    #elif defined( portUSE_TIMER3_STATS )
+        #define portSTATS_ISR                       TIMER3_OVF_vect
+        #define portSTATS_PRESCALE_8                ( (uint8_t) _BV(CS31) )
+        #define portSTATS_OVERFLOW_INTERRUPT_ENABLE ( (uint8_t) _BV(TOIE3) )
+        #define portSTATS_OVERFLOW_FLAG             ( (uint8_t) _BV(TOV3) )
+        #define portSTATS_TCNT                      TCNT3
+        #define portSTATS_TCCRa                     TCCR3A
+        #define portSTATS_TCCRb                     TCCR3B
+        #define portSTATS_TIMSK                     TIMSK3
+        #define portSTATS_TIFR                      TIFR3
+
+    #elif defined( portUSE_TIMER4_STATS )
+        #define portSTATS_ISR                       TIMER4_OVF_vect
+        #define portSTATS_PRESCALE_8                ( (uint8_t) _BV(CS41) )
+        #define portSTATS_OVERFLOW_INTERRUPT_ENABLE ( (uint8_t) _BV(TOIE4) )
+        #define portSTATS_OVERFLOW_FLAG             ( (uint8_t) _BV(TOV4) )
+        #define portSTATS_TCNT                      TCNT4
+        #define portSTATS_TCCRa                     TCCR4A
+        #define portSTATS_TCCRb                     TCCR4B
+        #define portSTATS_TIMSK                     TIMSK4
+        #define portSTATS_TIFR                      TIFR4
+
+    #elif defined( portUSE_TIMER5_STATS )
+        #define portSTATS_ISR                       TIMER5_OVF_vect
+        #define portSTATS_PRESCALE_8                ( (uint8_t) _BV(CS51) )
+        #define portSTATS_OVERFLOW_INTERRUPT_ENABLE ( (uint8_t) _BV(TOIE5) )
+        #define portSTATS_OVERFLOW_FLAG             ( (uint8_t) _BV(TOV5) )
+        #define portSTATS_TCNT                      TCNT5
+        #define portSTATS_TCCRa                     TCCR5A
+        #define portSTATS_TCCRb                     TCCR5B
+        #define portSTATS_TIMSK                     TIMSK5
+        #define portSTATS_TIFR                      TIFR5
+
+    #else
+        #error "Run time stats need a 16 bit timer. Define portUSE_TIMERn_STATS in FreeRTOSBoardDefs.h."
+    #endif
+#endif
+
 
 /*-----------------------------------------------------------*/
 
@@ -138,6 +203,24 @@ static void prvSetupRTCInterrupt( void );
 
 #endif
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+/* Timer2 compare match for the next tick. Timer2 runs free, one count per tick,
+ * and the compare match is moved on by one each tick, or further while tickless. */
+static uint8_t ucNextCompareMatch;
+
+/*
+ * Advance the system_tick() count by ticks that were suppressed.
+ */
+static void prvStepSystemTick( TickType_t xTicks );
+
+#endif
+
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+/* High 16 bits of the run time counter, incremented by the stats timer overflow. */
+static volatile uint16_t usRunTimeCounterHigh;
+
+#endif
+
 /*-----------------------------------------------------------*/
 
 /*
@@ -597,6 +680,8 @@ void vPortYieldFromTick( void )
 
     sleep_reset();        //     reset the sleep_mode() faster than sleep_disable();
 
+    traceISR_ENTER( TRACE_ISR_TICK );
+
 #if defined(DEBUG_PING)
     // start mark - check for start of interrupt - for debugging only
     PORTD |=  _BV(PORTD7);                // Ping IO line.
@@ -610,12 +695,18 @@ void vPortYieldFromTick( void )
     }
 #endif
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+    portOCRL = ++ucNextCompareMatch;    // next tick, one count on. The count has a whole tick to take the update.
+#endif
+
     if( xTaskIncrementTick() != pdFALSE )
     {
         vTaskSwitchContext();
 
     }
 
+    traceISR_EXIT( TRACE_ISR_TICK );
+
 #if defined(DEBUG_PING)
     // end mark - check for end of interrupt - for debugging only
     PORTD &= ~_BV(PORTD7);
@@ -724,6 +815,12 @@ static void prvSetupTimerInterrupt( void )
 {
     uint16_t usCompareMatch;
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+    /* Timer2 clock divisors, indexed by the clock select bits CS22:CS20. */
+    static const uint16_t usPrescale[] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+    uint8_t ucClockSelect;
+#endif
+
     /* Using 8bit Timer2 to generate the tick.  A 32.768 KHz crystal
      * must be attached to the appropriate pins.  We then adjust the number
      * to a power of two so we can get EXACT seconds for the Real Time clock.
@@ -760,6 +857,22 @@ static void prvSetupTimerInterrupt( void )
     /* initialise first second of ticks */
     ticksRemainingInSec = portTickRateHz;
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+    /* Prescale so one count is one tick. This needs a tick rate of 1024 Hz or less. */
+    for (ucClockSelect = 7; usPrescale[ucClockSelect] > usCompareMatch; --ucClockSelect);
+    configASSERT( usPrescale[ucClockSelect] == usCompareMatch );
+
+    ucNextCompareMatch = 1;
+
+    portTIMSK &= ~( _BV(OCIE2B)|_BV(OCIE2A)|_BV(TOIE2) );   // disable all Timer2 interrupts
+    portTIFR |=  _BV(OCF2B)|_BV(OCF2A)|_BV(TOV2);           // clear all pending interrupts
+    ASSR = _BV(AS2);                                        // set Timer/Counter2 to be asynchronous from the CPU clock
+                                                            // with a second external clock (32,768kHz) driving it.
+    portTCNT  = 0x00;                                       // zero out the counter
+    portTCCRa = 0x00;                                       // Normal mode, counter runs free
+    portTCCRb = ucClockSelect;                              // divide timer clock to count ticks
+    portOCRL  = ucNextCompareMatch;                         // set the first tick
+#else
     /* Adjust for correct value. */
     usCompareMatch -= ( uint16_t ) 1;
 
@@ -771,6 +884,7 @@ static void prvSetupTimerInterrupt( void )
     portTCCRa = _BV(WGM21);                                 // mode CTC (clear on counter match)
     portTCCRb = _BV(CS20);                                  // divide timer clock by 1 (No prescaling)
     portOCRL  = usCompareMatch;                             // set the counter
+#endif
 
     while( ASSR & (_BV(TCN2UB)|_BV(OCR2AUB)|_BV(TCR2AUB))); // Wait until Timer2 update complete
 
@@ -781,6 +895,120 @@ static void prvSetupTimerInterrupt( void )
 #endif
 
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+/*
+ * Stop the tick for the expected idle time, by moving the Timer2 compare match
+ * that many ticks on, and sleep. Timer2 counts on from the last tick throughout,
+ * so the tick count and the system_tick() RTC keep crystal accuracy.
+ * Called by the idle task with the scheduler suspended.
+ */
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+    TickType_t xModifiableIdleTime, xCompleteTicks;
+    uint8_t ucLastCompareMatch, ucSleepCompareMatch;
+
+    if( xExpectedIdleTime > portMAX_SUPPRESSED_TICKS )
+    {
+        xExpectedIdleTime = portMAX_SUPPRESSED_TICKS;
+    }
+
+    portDISABLE_INTERRUPTS();
+
+    /* Don't sleep if a tick is already due, or if an interrupt has readied a task. */
+    if( ( portTIFR & _BV(OCF2A) ) || ( eTaskConfirmSleepModeStatus() == eAbortSleep ) )
+    {
+        portENABLE_INTERRUPTS();
+        return;
+    }
+
+    /* The counter is still at the last tick. */
+    ucLastCompareMatch = ucNextCompareMatch - 1;
+    ucSleepCompareMatch = ucLastCompareMatch + (uint8_t) xExpectedIdleTime;
+
+    while( ASSR & _BV(OCR2AUB) );                           // Wait until any Timer2 update complete
+    portOCRL = ucSleepCompareMatch;
+    while( ASSR & _BV(OCR2AUB) );                           // Wait until Timer2 update complete, also needed before re-entering power save
+
+    if( portTIFR & _BV(OCF2A) )
+    {
+        /* The tick fell due before the compare match was moved. Put it back, and take the tick. */
+        portOCRL = ucNextCompareMatch;
+        while( ASSR & _BV(OCR2AUB) );
+        portENABLE_INTERRUPTS();
+        return;
+    }
+
+    ucNextCompareMatch = ucSleepCompareMatch;
+
+    xModifiableIdleTime = xExpectedIdleTime;
+    configPRE_SLEEP_PROCESSING( xModifiableIdleTime );
+
+    if( xModifiableIdleTime > 0 )
+    {
+        set_sleep_mode( configTICKLESS_SLEEP_MODE );
+        sleep_enable();
+        portENABLE_INTERRUPTS();
+        sleep_cpu();                                        // the instruction following sei is always executed, so no wake up is missed.
+        sleep_disable();
+        portDISABLE_INTERRUPTS();
+    }
+
+    configPOST_SLEEP_PROCESSING( xExpectedIdleTime );
+
+    if( ( ucNextCompareMatch != ucSleepCompareMatch ) || ( portTIFR & _BV(OCF2A) ) )
+    {
+        /* The compare match was reached, and the tick interrupt has counted, or will count, the last tick. */
+        xCompleteTicks = xExpectedIdleTime - 1;
+    }
+    else
+    {
+        /* Woken early by another interrupt. Count the whole ticks that have passed, and bring the
+         * compare match back to the next tick, which the tick interrupt will count.
+         * Write TCCR2A and wait first, so TCNT2 reads correctly after waking.
+         */
+        portTCCRa = 0x00;
+        while( ASSR & _BV(TCR2AUB) );
+
+        do
+        {
+            xCompleteTicks = (uint8_t) ( portTCNT - ucLastCompareMatch );
+            if( xCompleteTicks >= xExpectedIdleTime )
+            {
+                xCompleteTicks = xExpectedIdleTime - 1;     // the compare match was reached just now.
+            }
+            ucNextCompareMatch = ucLastCompareMatch + (uint8_t) xCompleteTicks + 1;
+
+            portOCRL = ucNextCompareMatch;
+            while( ASSR & _BV(OCR2AUB) );
+
+            /* Go round again if the counter reached the new compare match before it was written. */
+        } while( !( portTIFR & _BV(OCF2A) ) && ( (uint8_t) ( portTCNT - ucLastCompareMatch ) > (uint8_t) xCompleteTicks ) );
+    }
+
+    if( xCompleteTicks > 0 )
+    {
+        vTaskStepTick( xCompleteTicks );
+        prvStepSystemTick( xCompleteTicks );
+    }
+
+    portENABLE_INTERRUPTS();
+}
+/*-----------------------------------------------------------*/
+
+static void prvStepSystemTick( TickType_t xTicks )
+{
+    while( xTicks >= ticksRemainingInSec )
+    {
+        xTicks -= ticksRemainingInSec;
+        system_tick();
+        ticksRemainingInSec = portTickRateHz;
+    }
+
+    ticksRemainingInSec -= xTicks;
+}
+#endif
+
+
 #if defined(portUSE_TIMER2_RTC) && !defined(portUSE_TIMER2)
 /*
  * Setup Crystal-controlled timer2 compare match A to generate a tick interrupt.
@@ -815,6 +1043,62 @@ static void prvSetupRTCInterrupt( void )
 
 #endif
 
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+/*
+ * Setup the stats timer to run free at the CPU clock divided by 8, overflowing every 65536 counts.
+ * That is 0.5us per count, and about 35 minutes before the 32 bit counter wraps, at 16MHz.
+ */
+void vPortConfigureTimerForRunTimeStats( void )
+{
+    portSTATS_TIMSK &= ~portSTATS_OVERFLOW_INTERRUPT_ENABLE;    // disable the overflow interrupt while we set up
+    portSTATS_TCCRa = 0x00;                                     // Normal mode
+    portSTATS_TCCRb = 0x00;                                     // stop the timer
+    portSTATS_TCNT = 0x0000;
+    usRunTimeCounterHigh = 0;
+    portSTATS_TIFR = portSTATS_OVERFLOW_FLAG;                   // clear a pending overflow, by writing a one
+
+    portSTATS_TCCRb = portSTATS_PRESCALE_8;
+
+    /* Enable the interrupt - this is okay as interrupts are currently globally disabled. */
+    portSTATS_TIMSK |= portSTATS_OVERFLOW_INTERRUPT_ENABLE;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Read the 32 bit run time counter, from any context.
+ * Where the counter has overflowed but the overflow interrupt is yet to run (because interrupts are
+ * disabled, or we are in another ISR), the high word is one behind. The overflow flag is then set,
+ * and the low word has just wrapped, so count the pending overflow here.
+ */
+uint32_t ulPortGetRunTimeCounterValue( void )
+{
+    uint8_t ucSREG;
+    uint16_t usLow;
+    uint16_t usHigh;
+
+    ucSREG = SREG;
+    portDISABLE_INTERRUPTS();
+
+    usLow = portSTATS_TCNT;
+    usHigh = usRunTimeCounterHigh;
+
+    if( (portSTATS_TIFR & portSTATS_OVERFLOW_FLAG) && (usLow < 0x8000) )
+        ++usHigh;
+
+    SREG = ucSREG;
+
+    return ( (uint32_t)usHigh << 16 ) | usLow;
+}
+/*-----------------------------------------------------------*/
+
+    ISR(portSTATS_ISR) __attribute__ ((hot, flatten));
+    ISR(portSTATS_ISR)
+    {
+        ++usRunTimeCounterHigh;
+    }
+
+#endif
+
 
 /*-----------------------------------------------------------*/
 
@@ -854,8 +1138,13 @@ static void prvSetupRTCInterrupt( void )
             system_tick();
             ticksRemainingInSec = portTickRateHz;
         }
+#endif
+        traceISR_ENTER( TRACE_ISR_TICK );
+#if ( configUSE_TICKLESS_IDLE == 1 )
+        portOCRL = ++ucNextCompareMatch;
 #endif
         xTaskIncrementTick();
+        traceISR_EXIT( TRACE_ISR_TICK );
     }
 
 #endif // configUSE_PREEMPTION
@@ -0,0 +1,172 @@
+/*
+ * Host test and benchmark for lib_util/crc.c.
+ *
+ * crc7(), crc8() and crc16() are checked against bit serial references over random buffers of every
+ * length up to two sectors, and crc8_update() and crc16_update() are checked to give the same result
+ * when a sector arrives in random chunks, as it does when the CRC is taken while bytes arrive over SPI.
+ * The bit serial crc8 is the one the library used before the table, so it is the reference for the
+ * 1-Wire results too. Then each variant is timed over 512 byte sectors.
+ */
+
+#include <assert.h>
+
+#include "lib_util.h"
+
+#define TEST_SECTOR			512
+#define TEST_SECTORS		20000
+
+static uint8_t ucData[ 2 * TEST_SECTOR ];
+
+/* The crc8 as it was, bit serial, 8 iterations a byte. */
+static uint8_t prvCrc8BitSerial( const uint8_t * data, uint16_t number_of_bytes_in_data )
+{
+	uint8_t crc = 0x00, bit_counter, b, feedback_bit;
+
+	for( uint16_t loop_count = 0; loop_count != number_of_bytes_in_data; loop_count++ )
+	{
+		b = data[ loop_count ];
+
+		bit_counter = 8;
+		do {
+			feedback_bit = ( crc ^ b ) & 0x01;
+			if( feedback_bit == 0x01 )
+				crc = crc ^ 0x18;
+			crc = ( crc >> 1 ) & 0x7F;
+			if( feedback_bit == 0x01 )
+				crc = crc | 0x80;
+			b = b >> 1;
+		} while( --bit_counter > 0 );
+	}
+	return crc;
+}
+
+static uint8_t prvCrc7BitSerial( const uint8_t * pucData, uint16_t uxLength )
+{
+	uint8_t ucCrc = 0, b;
+
+	while( uxLength-- )
+	{
+		uint8_t ucByte = *pucData++;
+		for( b = 0; b < 8; ++b, ucByte <<= 1 )
+		{
+			ucCrc <<= 1;
+			if( ( ucByte ^ ucCrc ) & 0x80 )
+				ucCrc ^= 0x09;
+		}
+	}
+	return ucCrc & 0x7F;
+}
+
+static uint16_t prvCrc16BitSerial( const uint8_t * pucData, uint16_t uxLength, uint16_t uxCrc )
+{
+	uint8_t b;
+
+	while( uxLength-- )
+	{
+		uxCrc ^= (uint16_t)*pucData++ << 8;
+		for( b = 0; b < 8; ++b )
+			uxCrc = ( uxCrc & 0x8000 ) ? ( uxCrc << 1 ) ^ 0x1021 : uxCrc << 1;
+	}
+	return uxCrc;
+}
+
+static uint32_t ulSeed = 1;
+
+static uint16_t prvRandom( void )
+{
+	ulSeed = ulSeed * 1103515245UL + 12345UL;
+	return (uint16_t)( ulSeed >> 16 );
+}
+
+static void prvTestResults( void )
+{
+	uint16_t uxLength, i;
+
+	for( i = 0; i < sizeof( ucData ); ++i )
+		ucData[ i ] = (uint8_t)prvRandom();
+
+	/* The known check values, for "123456789". */
+	assert( crc16( (const uint8_t *)"123456789", 9, CRC16XMODEM_INIT ) == 0x31C3 );
+	assert( crc16( (const uint8_t *)"123456789", 9, CRC16CCITT_INIT ) == 0x29B1 );
+	assert( crc8( (const uint8_t *)"123456789", 9 ) == 0xA1 );
+
+	/* A CMD0 frame has the CRC7 0x4A, so it is sent as 0x95. */
+	assert( crc7( (const uint8_t *)"\x40\x00\x00\x00\x00", 5 ) == 0x4A );
+
+	for( uxLength = 0; uxLength <= sizeof( ucData ); ++uxLength )
+	{
+		assert( crc7( ucData, uxLength ) == prvCrc7BitSerial( ucData, uxLength ) );
+		assert( crc8( ucData, uxLength ) == prvCrc8BitSerial( ucData, uxLength ) );
+		assert( crc16( ucData, uxLength, CRC16XMODEM_INIT ) == prvCrc16BitSerial( ucData, uxLength, CRC16XMODEM_INIT ) );
+		assert( crc16( ucData, uxLength, CRC16CCITT_INIT ) == prvCrc16BitSerial( ucData, uxLength, CRC16CCITT_INIT ) );
+	}
+}
+
+/* A sector in random chunks, including empty ones, gives the same CRC as the whole sector. */
+static void prvTestStreaming( void )
+{
+	uint16_t uxDone, uxChunk, uxCrc16;
+	uint8_t ucCrc8;
+	unsigned uxRound;
+
+	for( uxRound = 0; uxRound < 1000; ++uxRound )
+	{
+		uxCrc16 = CRC16XMODEM_INIT;
+		ucCrc8 = 0x00;
+
+		for( uxDone = 0; uxDone < TEST_SECTOR; uxDone += uxChunk )
+		{
+			uxChunk = prvRandom() % 70;
+			if( uxChunk > TEST_SECTOR - uxDone )
+				uxChunk = TEST_SECTOR - uxDone;
+
+			uxCrc16 = crc16_update( uxCrc16, ucData + uxRound % TEST_SECTOR + uxDone, uxChunk );
+			ucCrc8 = crc8_update( ucCrc8, ucData + uxRound % TEST_SECTOR + uxDone, uxChunk );
+		}
+
+		assert( uxCrc16 == crc16( ucData + uxRound % TEST_SECTOR, TEST_SECTOR, CRC16XMODEM_INIT ) );
+		assert( ucCrc8 == crc8( ucData + uxRound % TEST_SECTOR, TEST_SECTOR ) );
+	}
+}
+
+static volatile uint16_t uxSink;
+
+#define TEST_TIME( name, expression )														\
+	do {																					\
+		uint64_t ullStart = host_nanoseconds();												\
+		unsigned n;																			\
+		for( n = 0; n < TEST_SECTORS; ++n )													\
+			uxSink += ( expression );														\
+		printf( "  %-28s %7.0f ns/sector %8.1f MB/s\n", name,								\
+				(double)( host_nanoseconds() - ullStart ) / TEST_SECTORS,					\
+				(double)TEST_SECTORS * TEST_SECTOR * 1000.0 / (double)( host_nanoseconds() - ullStart ) );	\
+	} while( 0 )
+
+static void prvBenchmark( void )
+{
+	const uint8_t * pucSector = ucData + 1;		// not aligned, as a FatFs window needn't be.
+
+	printf( "CRCs over %u byte sectors, %u sectors each, on the host\n", TEST_SECTOR, TEST_SECTORS );
+
+	TEST_TIME( "crc7 table", crc7( pucSector, TEST_SECTOR ) );
+	TEST_TIME( "crc7 bit serial", prvCrc7BitSerial( pucSector, TEST_SECTOR ) );
+	TEST_TIME( "crc8 table", crc8( pucSector, TEST_SECTOR ) );
+	TEST_TIME( "crc8 bit serial (before)", prvCrc8BitSerial( pucSector, TEST_SECTOR ) );
+	TEST_TIME( "crc16 table", crc16( pucSector, TEST_SECTOR, CRC16XMODEM_INIT ) );
+	TEST_TIME( "crc16_update, 64 byte chunks", ( {
+			uint16_t uxCrc = CRC16XMODEM_INIT, c;
+			for( c = 0; c < TEST_SECTOR; c += 64 )
+				uxCrc = crc16_update( uxCrc, pucSector + c, 64 );
+			uxCrc; } ) );
+	TEST_TIME( "crc16 bit serial", prvCrc16BitSerial( pucSector, TEST_SECTOR, CRC16XMODEM_INIT ) );
+}
+
+int main( void )
+{
+	prvTestResults();
+	prvTestStreaming();
+	prvBenchmark();
+
+	printf( "PASS\n" );
+	return 0;
+}
@@ -0,0 +1,732 @@
+/*
+ * Host test and benchmark for the FT800 co-processor command staging in lib_ft800/FT_Gpu_Hal.c.
+ *
+ * A model FT800 sits on the simulated SPI bus, with RAM_G, RAM_DL, the registers and the 4kB RAM_CMD fifo,
+ * and decodes the 3 byte address of each transaction (and the dummy byte of a read) byte by byte. Writes
+ * within RAM_CMD wrap at its end, as on the FT800. Its co-processor reads the fifo when REG_CMD_WRITE is
+ * written and when REG_CMD_READ is polled, all at once or only a few bytes each time, as a busy one would.
+ * It carries out CMD_DLSTART, CMD_SWAP, CMD_APPEND and CMD_MEMCPY, and writes every other command, as sent,
+ * to the display list at REG_CMD_DL, which is enough to compare what a frame drew. A write into the fifo
+ * where the co-processor has not yet read is an overrun.
+ *
+ * The GA Synth FT_GUI() frame, and one with a string longer than the staging buffer, are built with the
+ * staging buffer, and with the commands written directly, as when the buffer can't be allocated. The
+ * co-processor must read the same commands, and swap the same display lists, every time.
+ *
+ * The frame is built again with its labels and keyboard retained as segments, as GA Synth does, which must
+ * swap the same display lists. Each segment is recorded into RAM_G on the first frame, and appended after,
+ * and the keyboard is recorded again when the key changes. A segment larger than its capacity is refused by
+ * FT_API_Segment_End(), and is then drawn every frame without waiting on the co-processor to measure it.
+ *
+ * Then the SPI transactions, bytes, REG_CMD_READ polls and REG_CMD_WRITE updates of a frame are counted,
+ * and its time on the Uno estimated in AVR clock cycles, as in w5100_test.c.
+ */
+
+#include <assert.h>
+
+#include <avr/io.h>
+
+#include "FT_Platform.h"
+
+#define TEST_CPU_HZ				16000000ULL
+#define TEST_SELECT_CYCLES		120				// AVR cycles for spiSelect() and spiDeselect(), with the semaphore free.
+#define TEST_TRANSFER_CYCLES	40				// AVR cycles to call spiTransfer() for one byte, from the figures in spi.h.
+
+#define TEST_FRAMES				10
+#define TEST_SLOW				64				// bytes the busy co-processor reads each time.
+#define TEST_STREAM				0x10000			// bytes of commands kept, to compare.
+#define TEST_SWAPS				16
+
+#define TEST_RAM_SIZE			( RAM_CMD + FT_CMD_FIFO_SIZE )
+#define TEST_DL_SIZE			0x2000
+
+#define TEST_LABELS				( RAM_G + 0x3E000 )	// where GA Synth keeps its segments.
+#define TEST_KEYBOARD			( RAM_G + 0x3F000 )
+#define TEST_SEGMENT_SIZE		0x1000
+
+typedef struct
+{
+	uint8_t memory[ TEST_RAM_SIZE ];
+	uint8_t header[ 3 ];
+	uint8_t position;			// of the next byte in the transaction.
+	uint8_t reading;
+	uint8_t updated;			// REG_CMD_WRITE was written in this transaction.
+	uint32_t address;
+
+	uint16_t uxRead;			// the co-processor's place in the fifo.
+	uint16_t uxLimit;			// bytes read each time, or 0 for all of them.
+	uint8_t command[ FT_CMD_FIFO_SIZE ];
+	uint16_t uxCommand;			// bytes of the command being read.
+
+	uint8_t stream[ TEST_STREAM ];
+	unsigned long ulStream;		// bytes of the commands read.
+	uint32_t ulSwaps[ TEST_SWAPS ];
+	unsigned uxSwaps;			// display lists swapped, with a hash of each.
+
+	unsigned long transactions;
+	unsigned long bytes;
+	unsigned long transfers;	// bytes sent one at a time, with spiTransfer().
+	unsigned long polls;		// reads of REG_CMD_READ.
+	unsigned long updates;		// writes of REG_CMD_WRITE.
+	unsigned long appends;		// CMD_APPEND read.
+	unsigned long copies;		// CMD_MEMCPY read.
+	unsigned long overruns;
+	unsigned long errors;		// bytes with the wrong devices selected, and commands the model doesn't know.
+} xFT800;
+
+static xFT800 xChip;
+
+static const uint8_t ucDivider[ 8 ] = { 4, 16, 64, 128, 2, 8, 32, 64 };
+
+static uint64_t ullCycles;		// AVR clock cycles, since the start.
+
+/* The bus selections the library makes, each a transaction, and the bytes it sends one at a time. */
+uint8_t __real_spiSelect( SPI_SLAVE_SELECT SS_pin );
+uint8_t __wrap_spiSelect( SPI_SLAVE_SELECT SS_pin )
+{
+	++xChip.transactions;
+	xChip.position = 0;
+	xChip.updated = 0;
+	ullCycles += TEST_SELECT_CYCLES;
+	return __real_spiSelect( SS_pin );
+}
+
+static void prvCoprocessor( void );
+
+void __real_spiDeselect( SPI_SLAVE_SELECT SS_pin );
+void __wrap_spiDeselect( SPI_SLAVE_SELECT SS_pin )
+{
+	__real_spiDeselect( SS_pin );
+	if( xChip.updated )
+	{
+		++xChip.updates;
+		prvCoprocessor();
+	}
+}
+
+uint8_t __real_spiTransfer( uint8_t data );
+uint8_t __wrap_spiTransfer( uint8_t data )
+{
+	++xChip.transfers;
+	ullCycles += TEST_TRANSFER_CYCLES;
+	return __real_spiTransfer( data );
+}
+
+static uint16_t prvRead16( uint32_t ulAddress )
+{
+	return xChip.memory[ ulAddress ] | (uint16_t)xChip.memory[ ulAddress + 1 ] << 8;
+}
+
+static void prvWrite16( uint32_t ulAddress, uint16_t uxValue )
+{
+	xChip.memory[ ulAddress ] = (uint8_t)uxValue;
+	xChip.memory[ ulAddress + 1 ] = uxValue >> 8;
+}
+
+static uint32_t prvWord( const uint8_t * pucBytes )
+{
+	return pucBytes[ 0 ] | (uint32_t)pucBytes[ 1 ] << 8 | (uint32_t)pucBytes[ 2 ] << 16 | (uint32_t)pucBytes[ 3 ] << 24;
+}
+
+/* The length of the command read so far, or 0 while that isn't known yet. A string is padded to 4 bytes. */
+static uint16_t prvCommandLength( uint16_t * puxString )
+{
+	uint16_t uxFixed, i;
+
+	*puxString = 0;
+	if( xChip.uxCommand < FT_CMD_SIZE )
+		return 0;
+
+	switch( prvWord( xChip.command ) )
+	{
+	case CMD_DLSTART:
+	case CMD_SWAP:		return 4;
+	case CMD_FGCOLOR:
+	case CMD_BGCOLOR:
+	case CMD_GRADCOLOR:	return 8;
+	case CMD_APPEND:	return 12;
+	case CMD_MEMCPY:
+	case CMD_DIAL:		return 16;
+	case CMD_TEXT:		uxFixed = 12; break;
+	case CMD_TOGGLE:
+	case CMD_BUTTON:
+	case CMD_KEYS:		uxFixed = 16; break;
+	default:
+		if( ( prvWord( xChip.command ) >> 24 ) == 0xFF )
+			++xChip.errors;		// a co-processor command the model doesn't know.
+		return 4;				// a display list command.
+	}
+
+	for( i = uxFixed; i < xChip.uxCommand; ++i )
+		if( xChip.command[ i ] == 0 )
+		{
+			*puxString = i + 1;
+			return ( i + 1 + 3 ) & ~3;
+		}
+	return 0;
+}
+
+/* A hash of the display list, to compare the frames. */
+static uint32_t prvHash( const uint8_t * pucBytes, uint16_t uxLength )
+{
+	uint32_t ulHash = 2166136261UL;
+
+	while( uxLength-- )
+		ulHash = ( ulHash ^ *pucBytes++ ) * 16777619UL;
+	return ulHash;
+}
+
+static void prvExecute( uint16_t uxLength, uint16_t uxString )
+{
+	uint16_t uxDisplay = prvRead16( REG_CMD_DL );
+	uint32_t ulFrom, ulTo, ulCount;
+
+	if( uxString != 0 )
+		memset( xChip.command + uxString, 0, uxLength - uxString );	// padding the library doesn't write, when direct.
+
+	assert( xChip.ulStream + uxLength <= TEST_STREAM );
+	memcpy( xChip.stream + xChip.ulStream, xChip.command, uxLength );
+	xChip.ulStream += uxLength;
+
+	switch( prvWord( xChip.command ) )
+	{
+	case CMD_DLSTART:
+		uxDisplay = 0;
+		break;
+
+	case CMD_SWAP:
+		assert( xChip.uxSwaps < TEST_SWAPS );
+		xChip.ulSwaps[ xChip.uxSwaps++ ] = prvHash( xChip.memory + RAM_DL, uxDisplay );
+		break;
+
+	case CMD_APPEND:
+		++xChip.appends;
+		ulFrom = prvWord( xChip.command + 4 );
+		ulCount = prvWord( xChip.command + 8 );
+		if( ulFrom + ulCount > RAM_DL || uxDisplay + ulCount > TEST_DL_SIZE )
+			++xChip.errors;
+		else
+		{
+			memcpy( xChip.memory + RAM_DL + uxDisplay, xChip.memory + ulFrom, ulCount );
+			uxDisplay += ulCount;
+		}
+		break;
+
+	case CMD_MEMCPY:
+		++xChip.copies;
+		ulTo = prvWord( xChip.command + 4 );
+		ulFrom = prvWord( xChip.command + 8 );
+		ulCount = prvWord( xChip.command + 12 );
+		if( ulTo + ulCount > TEST_RAM_SIZE || ulFrom + ulCount > TEST_RAM_SIZE )
+			++xChip.errors;
+		else
+			memmove( xChip.memory + ulTo, xChip.memory + ulFrom, ulCount );
+		break;
+
+	default:
+		if( uxDisplay + uxLength > TEST_DL_SIZE )
+			++xChip.errors;
+		else
+		{
+			memcpy( xChip.memory + RAM_DL + uxDisplay, xChip.command, uxLength );
+			uxDisplay += uxLength;
+		}
+		break;
+	}
+
+	prvWrite16( REG_CMD_DL, uxDisplay );
+}
+
+/* Read the fifo up to REG_CMD_WRITE, or up to the limit, a command at a time. */
+static void prvCoprocessor( void )
+{
+	uint16_t uxWrite = prvRead16( REG_CMD_WRITE ) & ( FT_CMD_FIFO_SIZE - 1 ), uxLength, uxString, n = 0;
+
+	while( xChip.uxRead != uxWrite && ( xChip.uxLimit == 0 || n < xChip.uxLimit ) )
+	{
+		xChip.command[ xChip.uxCommand++ ] = xChip.memory[ RAM_CMD + xChip.uxRead ];
+		xChip.uxRead = ( xChip.uxRead + 1 ) & ( FT_CMD_FIFO_SIZE - 1 );
+		++n;
+
+		uxLength = prvCommandLength( &uxString );
+		if( uxLength != 0 && xChip.uxCommand == uxLength )
+		{
+			prvExecute( uxLength, uxString );
+			xChip.uxCommand = 0;
+		}
+		assert( xChip.uxCommand < FT_CMD_FIFO_SIZE );
+	}
+
+	prvWrite16( REG_CMD_READ, xChip.uxRead );
+}
+
+static uint8_t prvDevice( uint8_t ucSent )
+{
+	uint16_t uxWrite;
+	uint8_t ucReply = 0x00;
+
+	++xChip.bytes;
+	ullCycles += 8 * ucDivider[ ( SPCR & SPI_CLOCK_MASK ) | ( ( SPSR & SPI_2XCLOCK_MASK ) << 2 ) ];
+
+	if( ( PORTB & SPI_BIT_SS_G2 ) || !( PORTD & SPI_BIT_SS_SD ) || !( PORTB & SPI_BIT_SS_WIZNET ) )
+	{
+		++xChip.errors;		// the FT800 is not selected, or is not the only device selected.
+		return 0xFF;
+	}
+
+	if( xChip.position < 3 )
+	{
+		xChip.header[ xChip.position++ ] = ucSent;
+		if( xChip.position == 3 )
+		{
+			xChip.address = (uint32_t)( xChip.header[ 0 ] & 0x3F ) << 16 | (uint32_t)xChip.header[ 1 ] << 8 | xChip.header[ 2 ];
+			xChip.reading = !( xChip.header[ 0 ] & 0x80 );
+			if( xChip.reading && xChip.address == REG_CMD_READ )
+			{
+				++xChip.polls;
+				prvCoprocessor();
+			}
+		}
+		return 0x00;
+	}
+
+	if( xChip.reading && xChip.position == 3 )
+	{
+		++xChip.position;	// the dummy byte.
+		return 0x00;
+	}
+
+	if( xChip.address >= TEST_RAM_SIZE )
+		++xChip.errors;
+	else if( xChip.reading )
+		ucReply = xChip.memory[ xChip.address ];
+	else
+	{
+		if( xChip.address >= RAM_CMD )
+		{
+			uxWrite = prvRead16( REG_CMD_WRITE );
+			if( ( ( xChip.address - RAM_CMD - xChip.uxRead ) & ( FT_CMD_FIFO_SIZE - 1 ) ) < ( ( uxWrite - xChip.uxRead ) & ( FT_CMD_FIFO_SIZE - 1 ) ) )
+				++xChip.overruns;	// over commands the co-processor hasn't read.
+		}
+		else if( xChip.address == REG_CMD_WRITE || xChip.address == REG_CMD_WRITE + 1 )
+			xChip.updated = 1;
+		xChip.memory[ xChip.address ] = ucSent;
+	}
+
+	if( xChip.address >= RAM_CMD )
+		xChip.address = RAM_CMD + ( ( xChip.address + 1 - RAM_CMD ) & ( FT_CMD_FIFO_SIZE - 1 ) );
+	else
+		++xChip.address;
+
+	return ucReply;
+}
+
+/* The touch tags, and the part of synth_t that FT_GUI() draws, from GA_Synth/GASynth.h. */
+#define KBD_TOGGLE		0x01
+#define SETTINGS		0x02
+#define VCO1_TOGGLE		0x12
+#define VCO1_WAVE		0x13
+#define VCO2_TOGGLE		0x22
+#define VCO2_WAVE		0x23
+#define LFO_TOGGLE		0x32
+#define LFO_WAVE 		0x33
+#define VCO1_PITCH		0x81
+#define VCO2_PITCH		0x82
+#define LFO_PITCH		0x83
+#define MIXER_VCO1		0x91
+#define MIXER_VCO2		0x92
+#define MIXER_LFO		0x93
+#define MIXER_XMOD		0x94
+#define VCF_CUTOFF		0xa1
+#define VCF_PEAK		0xa2
+#define DELAY_TIME		0xb1
+#define DELAY_FEEDBACK	0xb2
+#define MASTER			0xf1
+
+typedef struct {
+	uint16_t pitch;
+	uint16_t volume;
+	uint16_t wave;
+	uint16_t toggle;
+} vco_t;
+
+static struct {
+	uint8_t note;
+	uint8_t settings_loaded;
+	uint16_t kbd_toggle;
+	vco_t vco1;
+	vco_t vco2;
+	vco_t lfo;
+	uint16_t xmod;
+	uint16_t vcf_cutoff;
+	uint16_t vcf_peak;
+	uint16_t delay_time;
+	uint16_t delay_feedback;
+	uint16_t master;
+} synth;
+
+/* The segments the frame retains, or NULL to draw it all every time, and the results of FT_API_Segment_End(). */
+static FT_API_Segment_t * pxLabels, * pxKeyboard;
+static unsigned long ulRetained, ulRefused;
+
+static void prvSegmentEnd( FT_API_Segment_t * pxSegment )
+{
+	if( FT_API_Segment_End( pxSegment ) )
+		++ulRetained;
+	else
+		++ulRefused;
+}
+
+/* The GA Synth FT_GUI() frame, from GA_Synth/main.c. */
+static void prvFrame( void )
+{
+	FT_GPU_CoCmd_Dlstart(phost);
+	FT_API_Write_CoCmd(CLEAR_COLOR_RGB(0,0,0));
+	FT_API_Write_CoCmd(CLEAR(1,1,1));
+
+	FT_API_Write_CoCmd(SAVE_CONTEXT());
+
+	if( pxLabels == NULL || FT_API_Segment_Begin(pxLabels, NULL, 0) )
+	{
+		FT_API_Write_CoCmd(COLOR_RGB(255,255,255));
+		FT_GPU_CoCmd_Text_P(phost,   4,  8, 27, OPT_CENTERY, PSTR("VCO 1"));
+		FT_GPU_CoCmd_Text_P(phost,   4,100, 27, OPT_CENTERY, PSTR("VCO 2"));
+		FT_GPU_CoCmd_Text_P(phost,   4,194, 27, OPT_CENTERY, PSTR("LFO"));
+		FT_GPU_CoCmd_Text_P(phost, 103, 18, 26, OPT_CENTER, PSTR("OCTAVE"));
+		FT_GPU_CoCmd_Text_P(phost, 103,111, 26, OPT_CENTER, PSTR("PITCH"));
+		FT_GPU_CoCmd_Text_P(phost, 103,204, 26, OPT_CENTER, PSTR("PITCH"));
+
+		FT_GPU_CoCmd_Text_P(phost, 203,  8, 27, OPT_CENTER, PSTR("MIXER"));
+		FT_GPU_CoCmd_Text_P(phost, 170, 25, 26, OPT_CENTER, PSTR("VCO 1"));
+		FT_GPU_CoCmd_Text_P(phost, 235, 25, 26, OPT_CENTER, PSTR("VCO 2"));
+		FT_GPU_CoCmd_Text_P(phost, 170, 95, 26, OPT_CENTER, PSTR("LFO"));
+		FT_GPU_CoCmd_Text_P(phost, 235, 95, 26, OPT_CENTER, PSTR("X MOD"));
+
+		FT_GPU_CoCmd_Text_P(phost, 300,  8, 27, OPT_CENTER, PSTR("VCF"));
+		FT_GPU_CoCmd_Text_P(phost, 300, 25, 26, OPT_CENTER, PSTR("CUTOFF"));
+		FT_GPU_CoCmd_Text_P(phost, 300, 95, 26, OPT_CENTER, PSTR("PEAK"));
+
+		FT_GPU_CoCmd_Text_P(phost, 365,  8, 27, OPT_CENTER, PSTR("DELAY"));
+		FT_GPU_CoCmd_Text_P(phost, 365, 25, 26, OPT_CENTER, PSTR("TIME"));
+		FT_GPU_CoCmd_Text_P(phost, 365, 95, 26, OPT_CENTER, PSTR("FEEDBACK"));
+
+		FT_GPU_CoCmd_Text_P(phost, 440,  8, 27, OPT_CENTER, PSTR("MASTER"));
+
+		if( pxLabels != NULL )
+			prvSegmentEnd(pxLabels);
+	}
+
+	FT_API_Write_CoCmd(TAG_MASK(FT_TRUE));
+
+	FT_API_Write_CoCmd(COLOR_RGB(255,255,255));
+	FT_GPU_CoCmd_FgColor(phost, 0xff0000);
+	FT_GPU_CoCmd_BgColor(phost, 0x1a1a1a);
+
+	FT_API_Write_CoCmd(TAG(VCO1_TOGGLE));
+	FT_GPU_CoCmd_Toggle_P(phost, 13,26,46,18, OPT_3D, synth.vco1.toggle, PSTR("OFF" "\xFF" "VCO 1"));
+
+	FT_GPU_CoCmd_FgColor(phost, 0x0000ff);
+
+	FT_API_Write_CoCmd(TAG(VCO2_TOGGLE));
+	FT_GPU_CoCmd_Toggle_P(phost, 13,119,46,18, OPT_3D, synth.vco2.toggle, PSTR("OFF" "\xFF" "VCO 2"));
+
+	FT_GPU_CoCmd_FgColor(phost, 0x00ff00);
+
+	FT_API_Write_CoCmd(TAG(LFO_TOGGLE));
+	FT_GPU_CoCmd_Toggle_P(phost, 13,212,46,18, OPT_3D, synth.lfo.toggle, PSTR( "OFF" "\xFF" "LFO"));
+
+	FT_GPU_CoCmd_FgColor(phost, 0xfffae0);
+
+	FT_API_Write_CoCmd(TAG(VCO1_WAVE));
+	FT_GPU_CoCmd_Toggle_P(phost, 13,56,46,18, OPT_3D, synth.vco1.wave, PSTR("SQR" "\xFF" "SIN"));
+
+	FT_API_Write_CoCmd(TAG(VCO2_WAVE));
+	FT_GPU_CoCmd_Toggle_P(phost, 13,150,46,18, OPT_3D, synth.vco2.wave, PSTR("TRI" "\xFF" "SAW"));
+
+	FT_API_Write_CoCmd(TAG(LFO_WAVE));
+	FT_GPU_CoCmd_Toggle_P(phost, 13,242,46,18, OPT_3D, synth.lfo.wave, PSTR("SIN" "\xFF" "TRI"));
+
+	FT_API_Write_CoCmd(TAG(KBD_TOGGLE));
+	FT_GPU_CoCmd_Toggle_P(phost, 405,130,60,26, OPT_3D, synth.kbd_toggle, PSTR("CONCRT" "\xFF" "VERDI"));
+
+	FT_GPU_CoCmd_FgColor(phost, 0x1a1a1a);
+
+	FT_API_Write_CoCmd(COLOR_RGB(255,0,0));
+	FT_API_Write_CoCmd(TAG(VCO1_PITCH));
+	FT_GPU_CoCmd_Dial(phost, 103,50,22, OPT_3D, synth.vco1.pitch);
+
+	FT_API_Write_CoCmd(COLOR_RGB(0,0,255));
+	FT_API_Write_CoCmd(TAG(VCO2_PITCH));
+	FT_GPU_CoCmd_Dial(phost, 103,145,22, OPT_3D, synth.vco2.pitch);
+
+	FT_API_Write_CoCmd(COLOR_RGB(0,255,0));
+	FT_API_Write_CoCmd(TAG(LFO_PITCH));
+	FT_GPU_CoCmd_Dial(phost, 103,235,22, OPT_3D, synth.lfo.pitch);
+
+	FT_API_Write_CoCmd(COLOR_RGB(255,0,0));
+	FT_API_Write_CoCmd(TAG(MIXER_VCO1));
+	FT_GPU_CoCmd_Dial(phost, 170,55,20, OPT_3D, synth.vco1.volume);
+
+	FT_API_Write_CoCmd(COLOR_RGB(0,0,255));
+	FT_API_Write_CoCmd(TAG(MIXER_VCO2));
+	FT_GPU_CoCmd_Dial(phost, 235,55,20, OPT_3D, synth.vco2.volume);
+
+	FT_API_Write_CoCmd(COLOR_RGB(0,255,0));
+	FT_API_Write_CoCmd(TAG(MIXER_LFO));
+	FT_GPU_CoCmd_Dial(phost, 170,125,20, OPT_3D, synth.lfo.volume);
+
+	FT_API_Write_CoCmd(COLOR_RGB(255,0,255));
+	FT_API_Write_CoCmd(TAG(MIXER_XMOD));
+	FT_GPU_CoCmd_Dial(phost, 235,125,20, OPT_3D, synth.xmod);
+
+	FT_API_Write_CoCmd(COLOR_RGB(255,250,224));
+	FT_GPU_CoCmd_FgColor(phost, 0x1a1a1a);
+
+	FT_API_Write_CoCmd(TAG(VCF_CUTOFF));
+	FT_GPU_CoCmd_Dial(phost, 300,55,20, OPT_3D, synth.vcf_cutoff);
+
+	FT_API_Write_CoCmd(TAG(VCF_PEAK));
+	FT_GPU_CoCmd_Dial(phost, 300,125,20, OPT_3D, synth.vcf_peak);
+
+	FT_API_Write_CoCmd(TAG(DELAY_TIME));
+	FT_GPU_CoCmd_Dial(phost, 365,55,20, OPT_3D, synth.delay_time);
+
+	FT_API_Write_CoCmd(TAG(DELAY_FEEDBACK));
+	FT_GPU_CoCmd_Dial(phost, 365,125,20, OPT_3D, synth.delay_feedback);
+
+	FT_API_Write_CoCmd(TAG(MASTER));
+	FT_GPU_CoCmd_Dial(phost, 440,55,26, OPT_3D, synth.master);
+
+	if( pxKeyboard == NULL || FT_API_Segment_Begin(pxKeyboard, &synth.note, sizeof(synth.note)) )
+	{
+		FT_API_Write_CoCmd(COLOR_RGB(0xff,0xfa,0xe0));
+		FT_GPU_CoCmd_FgColor(phost, 0xfffae0);
+		FT_GPU_CoCmd_GradColor(phost, 0x1a1a1a);
+
+		FT_GPU_CoCmd_Keys_P(phost, 137,160,340,110, 27, synth.note | OPT_3D, PSTR("CDEFGAB"));
+
+		FT_API_Write_CoCmd(COLOR_RGB(0x1f,0x1f,0x1f));
+		FT_GPU_CoCmd_FgColor(phost, 0x1a1a1a);
+		FT_GPU_CoCmd_GradColor(phost, 0xffffff);
+
+		FT_GPU_CoCmd_Keys_P(phost, 169,160,30,45, 27, synth.note | OPT_3D, PSTR("c"));
+		FT_GPU_CoCmd_Keys_P(phost, 219,160,30,45, 27, synth.note | OPT_3D, PSTR("d"));
+		FT_GPU_CoCmd_Keys_P(phost, 316,160,30,45, 27, synth.note | OPT_3D, PSTR("f"));
+		FT_GPU_CoCmd_Keys_P(phost, 365,160,30,45, 27, synth.note | OPT_3D, PSTR("g"));
+		FT_GPU_CoCmd_Keys_P(phost, 414,160,30,45, 27, synth.note | OPT_3D, PSTR("a"));
+
+		if( pxKeyboard != NULL )
+			prvSegmentEnd(pxKeyboard);
+	}
+
+	FT_API_Write_CoCmd(COLOR_RGB(0x1a,0x1a,0x1a));
+	FT_GPU_CoCmd_FgColor(phost, 0x1a1a1a);
+	FT_GPU_CoCmd_GradColor(phost, 0xffffff);
+
+	FT_API_Write_CoCmd(TAG(SETTINGS));
+	if (synth.settings_loaded)
+		FT_GPU_CoCmd_Button_P(phost, 415,95, 50,20, 26, OPT_3D, PSTR("STO"));
+	else
+		FT_GPU_CoCmd_Button_P(phost, 415,95, 50,20, 26, OPT_3D, PSTR("RCL"));
+
+	FT_API_Write_CoCmd(RESTORE_CONTEXT());
+
+	FT_API_Write_CoCmd(DISPLAY());
+	FT_GPU_CoCmd_Swap(phost);
+
+	FT_GPU_HAL_WaitCmdfifo_empty(phost);
+}
+
+/* Strings longer than the staging buffer are written directly, between staged commands, and more than the fifo holds. */
+static void prvLongFrame( void )
+{
+	char cText[ FT_CMD_BUFFER_SIZE + 100 ];
+	unsigned i, j;
+
+	for( i = 0; i < sizeof( cText ) - 1; ++i )
+		cText[ i ] = 'A' + i % 26;
+	cText[ sizeof( cText ) - 1 ] = '\0';
+
+	FT_GPU_CoCmd_Dlstart(phost);
+	FT_API_Write_CoCmd(CLEAR(1,1,1));
+	for( i = 0; i < 6; ++i )
+	{
+		FT_GPU_CoCmd_Text(phost, 0, 20 * i, 26, 0, cText + i);		// padded differently each time.
+		for( j = 0; j < 100; ++j )
+			FT_API_Write_CoCmd(COLOR_RGB(i,j,0));
+	}
+	FT_API_Write_CoCmd(DISPLAY());
+	FT_GPU_CoCmd_Swap(phost);
+
+	FT_GPU_HAL_WaitCmdfifo_empty(phost);
+}
+
+typedef struct
+{
+	unsigned long transactions, bytes, transfers, polls, updates, appends, copies;
+	uint64_t ullCycles;
+} xFrameCounts;
+
+static xFrameCounts xFrames[ TEST_FRAMES ];
+
+static void prvCount( xFrameCounts * pxCounts )
+{
+	pxCounts->transactions = xChip.transactions - pxCounts->transactions;
+	pxCounts->bytes = xChip.bytes - pxCounts->bytes;
+	pxCounts->transfers = xChip.transfers - pxCounts->transfers;
+	pxCounts->polls = xChip.polls - pxCounts->polls;
+	pxCounts->updates = xChip.updates - pxCounts->updates;
+	pxCounts->appends = xChip.appends - pxCounts->appends;
+	pxCounts->copies = xChip.copies - pxCounts->copies;
+	pxCounts->ullCycles = ullCycles - pxCounts->ullCycles;
+}
+
+/* A fresh FT800, and the library opened on it, with or without the staging buffer. */
+static void prvOpen( int xStaged, uint16_t uxLimit )
+{
+	memset( &xChip, 0, sizeof( xChip ) );
+	xChip.uxLimit = uxLimit;
+
+	phost = &host;
+	FT_GPU_HAL_Open( phost );
+	FT_GPU_HAL_Fast( phost );
+	if( !xStaged )
+	{
+		vPortFree( host.ft_cmd_buffer );	// as if the allocation had failed.
+		host.ft_cmd_buffer = NULL;
+	}
+}
+
+/* Not FT_GPU_HAL_Close(), as spiEnd() would leave the bus semaphore deleted for the next run. */
+static void prvClose( void )
+{
+	assert( xChip.overruns == 0 && xChip.errors == 0 && xChip.uxCommand == 0 );
+}
+
+/* The frames, each drawing changed dials, and every few frames a different key, with the counts of each in xFrames.
+ * With a labels capacity, the labels and keyboard are retained as segments. */
+static void prvRun( int xStaged, uint16_t uxLimit, uint16_t uxLabels )
+{
+	static FT_API_Segment_t xLabels, xKeyboard;
+	unsigned f;
+
+	prvOpen( xStaged, uxLimit );
+
+	xLabels = (FT_API_Segment_t){ TEST_LABELS, uxLabels };
+	xKeyboard = (FT_API_Segment_t){ TEST_KEYBOARD, TEST_SEGMENT_SIZE };
+	pxLabels = uxLabels != 0 ? &xLabels : NULL;
+	pxKeyboard = uxLabels != 0 ? &xKeyboard : NULL;
+	ulRetained = ulRefused = 0;
+
+	for( f = 0; f < TEST_FRAMES; ++f )
+	{
+		synth.vco1.pitch = f * 1000;
+		synth.note = 'C' + f / 5;
+
+		memset( &xFrames[ f ], 0, sizeof( xFrames[ f ] ) );
+		prvCount( &xFrames[ f ] );
+		prvFrame();
+		prvCount( &xFrames[ f ] );
+	}
+
+	pxLabels = pxKeyboard = NULL;
+	prvLongFrame();
+	prvClose();
+}
+
+/* Retained segments must swap the same display lists as the frames drawn in full. */
+static void prvTestSegments( const uint32_t * pulSwaps )
+{
+	uint8_t ucEmpty[ 64 ] = { 0 };
+	unsigned f, i;
+
+	for( i = 0; i < 4; ++i )
+	{
+		prvRun( i & 1, i < 2 ? 0 : TEST_SLOW, TEST_SEGMENT_SIZE );
+		assert( memcmp( xChip.ulSwaps, pulSwaps, TEST_SWAPS * sizeof( uint32_t ) ) == 0 );
+		assert( ulRetained == 3 && ulRefused == 0 );
+
+		for( f = 0; f < TEST_FRAMES; ++f )
+			if( f == 0 )
+				assert( xFrames[ f ].copies == 2 && xFrames[ f ].appends == 0 );
+			else if( f == 5 )
+				assert( xFrames[ f ].copies == 1 && xFrames[ f ].appends == 1 );	// a different key.
+			else
+				assert( xFrames[ f ].copies == 0 && xFrames[ f ].appends == 2 );
+	}
+
+	/* The labels are too large for a smaller capacity, so they are refused, and then drawn every frame without
+	 * waiting on the co-processor to measure them again. The keyboard is still retained. */
+	prvRun( 1, 0, 64 );
+	assert( memcmp( xChip.ulSwaps, pulSwaps, TEST_SWAPS * sizeof( uint32_t ) ) == 0 );
+	assert( ulRetained == 2 && ulRefused == TEST_FRAMES );
+	assert( memcmp( xChip.memory + TEST_LABELS, ucEmpty, sizeof( ucEmpty ) ) == 0 );
+
+	for( f = 0; f < TEST_FRAMES; ++f )
+		if( f == 0 || f == 5 )
+			assert( xFrames[ f ].copies == 1 && xFrames[ f ].appends == 0 );
+		else
+			assert( xFrames[ f ].copies == 0 && xFrames[ f ].appends == 1 && xFrames[ f ].polls == 1 );
+}
+
+/* The co-processor must read the same commands, and swap the same display lists, in every case. */
+static void prvTestStreams( void )
+{
+	static uint8_t ucStream[ TEST_STREAM ];
+	static const uint16_t uxLimits[] = { 0, TEST_SLOW, 4 };
+	uint32_t ulSwaps[ TEST_SWAPS ];
+	unsigned long ulStream;
+	unsigned i;
+
+	prvRun( 1, 0, 0 );
+	assert( xChip.uxSwaps == TEST_FRAMES + 1 );
+	ulStream = xChip.ulStream;
+	memcpy( ucStream, xChip.stream, ulStream );
+	memcpy( ulSwaps, xChip.ulSwaps, sizeof( ulSwaps ) );
+
+	for( i = 0; i < 2 * sizeof( uxLimits ) / sizeof( uxLimits[ 0 ] ); ++i )
+	{
+		prvRun( i & 1, uxLimits[ i / 2 ], 0 );
+		assert( xChip.ulStream == ulStream && memcmp( xChip.stream, ucStream, ulStream ) == 0 );
+		assert( xChip.uxSwaps == TEST_FRAMES + 1 && memcmp( xChip.ulSwaps, ulSwaps, sizeof( ulSwaps ) ) == 0 );
+	}
+
+	memcpy( ulSwaps, xChip.ulSwaps, sizeof( ulSwaps ) );
+	prvTestSegments( ulSwaps );
+}
+
+static void prvReport( const char * pcName, const xFrameCounts * pxFrame )
+{
+	printf( "  %-32s %4lu transactions %5lu bytes (%4lu one at a time) %3lu polls %3lu updates, %6.0f us on the Uno\n",
+			pcName, pxFrame->transactions, pxFrame->bytes, pxFrame->transfers, pxFrame->polls, pxFrame->updates,
+			(double)pxFrame->ullCycles * 1000000.0 / TEST_CPU_HZ );
+}
+
+static void prvBenchmark( void )
+{
+	printf( "GA Synth FT_GUI() frame, SPI at clock / %u, with the co-processor reading at once\n",
+			ucDivider[ SPI_CLOCK_DIV2 ] );
+
+	prvRun( 0, 0, 0 );
+	prvReport( "commands written directly", &xFrames[ TEST_FRAMES - 1 ] );
+	prvRun( 1, 0, 0 );
+	prvReport( "staging buffer", &xFrames[ TEST_FRAMES - 1 ] );
+	prvRun( 1, 0, TEST_SEGMENT_SIZE );
+	prvReport( "segments recorded", &xFrames[ 0 ] );
+	prvReport( "keyboard recorded again", &xFrames[ 5 ] );
+	prvReport( "segments appended", &xFrames[ TEST_FRAMES - 1 ] );
+}
+
+int main( void )
+{
+	host_spi_device = prvDevice;
+
+	spiBegin( SDCard );
+	spiBegin( Wiznet );
+
+	prvTestStreams();
+	prvBenchmark();
+
+	printf( "PASS\n" );
+	return 0;
+}
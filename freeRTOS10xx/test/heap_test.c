@@ -0,0 +1,405 @@
+/*
+ * Host test and benchmark for MemMang/heap_6.c, replaying allocation traces against it and against heap_4.c.
+ *
+ * Both heaps are built here from the same sources as for the AVR, with heap_4.c's functions renamed so the
+ * two can be linked together (see the Makefile). The host pointers are wider, so the block headers are, but
+ * the lists are walked and merged just as on the AVR.
+ *
+ * Each trace is a sequence of allocations and frees, generated once from a fixed seed and replayed on each
+ * heap, so both see exactly the same requests. They model the kernel objects and buffers of the apps here:
+ *   tasks       long lived tasks and queues, then a task and its queue created and deleted over and over.
+ *   small       event groups, semaphores, timers and list items, 8 to 64 bytes, with random lifetimes.
+ *   network     HTTP request, file and response buffers for up to four connections, and small objects.
+ *   fill        random sizes up to 2kB, allocated until the heap is full, then a random half freed, so
+ *               the heap is fragmented and some requests fail.
+ *
+ * Every block is filled when allocated and checked when freed, so an overlap is caught, and everything is
+ * freed at the end of each replay, which must return the heap to its starting free size. Each replay is run
+ * several times, and the time of each operation is the least seen, to take out the host's own noise, less
+ * the time to read the clock. The host is far faster than the AVR, so the times are only to compare the two
+ * heaps with; the worst case matters more than the mean, as heap_6 should not walk a long list.
+ */
+
+#include <assert.h>
+
+#define TEST_LIVE			512				// the most blocks live at once, in any trace.
+#define TEST_OPS			40000			// the most operations in a trace.
+#define TEST_REPEATS		5
+
+typedef struct
+{
+	uint16_t id;			// the block, 0 to TEST_LIVE - 1.
+	uint16_t size;			// the size to allocate, or 0 to free the block.
+} xOp;
+
+typedef struct
+{
+	const char * name;
+	void * ( * malloc )( size_t xWantedSize );
+	void ( * free )( void * pv );
+	size_t ( * freeSize )( void );
+} xHeap;
+
+void * pvHeap4Malloc( size_t xWantedSize );
+void vHeap4Free( void * pv );
+size_t xHeap4GetFreeHeapSize( void );
+
+static const xHeap xHeaps[] =
+{
+	{ "heap_4", pvHeap4Malloc, vHeap4Free, xHeap4GetFreeHeapSize },
+	{ "heap_6", pvPortMalloc, vPortFree, xPortGetFreeHeapSize },
+};
+
+#define TEST_HEAPS	( sizeof( xHeaps ) / sizeof( xHeaps[ 0 ] ) )
+
+static xOp xTrace[ TEST_OPS ];
+static unsigned uxTraceLength;
+static uint8_t ucLive[ TEST_LIVE ];			// while the trace is generated, which blocks are live.
+static uint64_t ullBest[ TEST_OPS ];		// the least time seen for each operation.
+
+static uint64_t ullClock;					// the time host_nanoseconds() itself takes, taken off each operation.
+
+static uint32_t ulSeed;
+
+static uint16_t prvRandom( void )
+{
+	ulSeed = ulSeed * 1103515245UL + 12345UL;
+	return (uint16_t)( ulSeed >> 16 );
+}
+
+static void prvStart( uint32_t ulTraceSeed )
+{
+	ulSeed = ulTraceSeed;
+	uxTraceLength = 0;
+	memset( ucLive, 0, sizeof( ucLive ) );
+}
+
+static void prvAlloc( uint16_t uxId, uint16_t uxSize )
+{
+	assert( uxTraceLength < TEST_OPS && uxId < TEST_LIVE && !ucLive[ uxId ] && uxSize != 0 );
+	xTrace[ uxTraceLength ].id = uxId;
+	xTrace[ uxTraceLength++ ].size = uxSize;
+	ucLive[ uxId ] = 1;
+}
+
+static void prvFree( uint16_t uxId )
+{
+	assert( uxTraceLength < TEST_OPS && ucLive[ uxId ] );
+	xTrace[ uxTraceLength ].id = uxId;
+	xTrace[ uxTraceLength++ ].size = 0;
+	ucLive[ uxId ] = 0;
+}
+
+/* A live block chosen at random from the ids from uxFirst to uxLast, or -1 if there is none. */
+static int prvRandomLive( uint16_t uxFirst, uint16_t uxLast, int xLive )
+{
+	uint16_t uxCount = uxLast - uxFirst + 1, uxStart = uxFirst + prvRandom() % uxCount, i;
+
+	for( i = 0; i < uxCount; ++i )
+	{
+		uint16_t uxId = uxFirst + ( uxStart - uxFirst + i ) % uxCount;
+		if( ucLive[ uxId ] == xLive )
+			return uxId;
+	}
+	return -1;
+}
+
+/* The TCB is 40 bytes on the AVR, and a queue 38 bytes plus its storage. */
+static void prvTraceTasks( void )
+{
+	uint16_t uxId = 0, uxRound;
+	static const uint16_t uxStacks[] = { 256, 256, 2048, 1768, 512, 128 };
+
+	prvStart( 1 );
+
+	for( uxId = 0; uxId < 6; ++uxId )
+	{
+		prvAlloc( 2 * uxId, 40 );						// TCB
+		prvAlloc( 2 * uxId + 1, uxStacks[ uxId ] );		// stack
+	}
+	for( uxId = 12; uxId < 24; ++uxId )
+		prvAlloc( uxId, 38 + ( prvRandom() % 4 ) * 16 );	// queues and semaphores
+
+	for( uxRound = 0; uxRound < 3000; ++uxRound )
+	{
+		prvAlloc( 30, 40 );
+		prvAlloc( 31, 192 );
+		prvAlloc( 32, 38 + 8 * ( prvRandom() % 8 ) );
+		if( uxRound % 7 == 0 )
+		{
+			int xId = prvRandomLive( 40, 60, 0 );		// and now and then a longer lived object.
+			if( xId >= 0 )
+				prvAlloc( xId, 16 + prvRandom() % 48 );
+			if( ( xId = prvRandomLive( 40, 60, 1 ) ) >= 0 && prvRandom() % 2 )
+				prvFree( xId );
+		}
+		prvFree( 32 );
+		prvFree( 31 );
+		prvFree( 30 );
+	}
+}
+
+static void prvTraceSmall( void )
+{
+	unsigned uxOp;
+	int xId;
+
+	prvStart( 2 );
+
+	for( uxOp = 0; uxOp < 30000; ++uxOp )
+	{
+		if( prvRandom() % 100 < 55 && ( xId = prvRandomLive( 0, 299, 0 ) ) >= 0 )
+			prvAlloc( xId, 8 + prvRandom() % 57 );
+		else if( ( xId = prvRandomLive( 0, 299, 1 ) ) >= 0 )
+			prvFree( xId );
+	}
+}
+
+static void prvTraceNetwork( void )
+{
+	unsigned uxOp;
+	int xId;
+
+	prvStart( 3 );
+
+	for( uxOp = 0; uxOp < 8000; ++uxOp )
+	{
+		uint16_t uxConnection = prvRandom() % 4, uxBase = 3 * uxConnection;
+
+		if( !ucLive[ uxBase ] )
+		{	// a connection opens, with its request buffer, an open file, and a response buffer.
+			prvAlloc( uxBase, 1025 );
+			prvAlloc( uxBase + 1, 560 );
+			prvAlloc( uxBase + 2, 128 + prvRandom() % 384 );
+		}
+		else if( prvRandom() % 3 == 0 )
+		{
+			prvFree( uxBase + 2 );
+			prvFree( uxBase );
+			prvFree( uxBase + 1 );
+		}
+
+		if( prvRandom() % 2 && ( xId = prvRandomLive( 20, 80, 0 ) ) >= 0 )
+			prvAlloc( xId, 8 + prvRandom() % 120 );
+		else if( ( xId = prvRandomLive( 20, 80, 1 ) ) >= 0 )
+			prvFree( xId );
+	}
+}
+
+/* Sizes from 16 bytes to 2kB, more of them small, as many as the heap holds, then a random half are freed. */
+static void prvTraceFill( void )
+{
+	uint16_t uxRound, uxSize;
+	size_t xUsed = 0;
+	static uint16_t uxSizes[ TEST_LIVE ];
+	int xId;
+
+	prvStart( 4 );
+
+	for( uxRound = 0; uxRound < 60; ++uxRound )
+	{
+		while( ( xId = prvRandomLive( 0, TEST_LIVE - 1, 0 ) ) >= 0 && xUsed < configTOTAL_HEAP_SIZE + configTOTAL_HEAP_SIZE / 8 )
+		{
+			uxSize = 16 << ( prvRandom() % 8 );
+			uxSize += prvRandom() % uxSize;
+			prvAlloc( xId, uxSize );
+			uxSizes[ xId ] = uxSize;
+			xUsed += uxSize;
+		}
+		for( xId = 0; xId < TEST_LIVE; ++xId )
+			if( ucLive[ xId ] && prvRandom() % 2 )
+			{
+				prvFree( xId );
+				xUsed -= uxSizes[ xId ];
+			}
+	}
+}
+
+static void prvFreeAll( void )
+{
+	uint16_t uxId;
+
+	for( uxId = 0; uxId < TEST_LIVE; ++uxId )
+		if( ucLive[ uxId ] )
+			prvFree( uxId );
+}
+
+/* Replay the trace on a heap. Blocks that could not be allocated are left out of the frees that follow. */
+static void prvReplay( const xHeap * pxHeap, int xFirst, unsigned long * pulFailed, size_t * pxLeastFree )
+{
+	static uint8_t * pucBlock[ TEST_LIVE ];
+	static uint16_t uxSize[ TEST_LIVE ];
+	size_t xStartFree = pxHeap->freeSize(), xFree;
+	unsigned uxOp;
+	uint64_t ullStart, ullTime;
+	uint16_t uxId, i;
+
+	*pulFailed = 0;
+	*pxLeastFree = xStartFree;
+
+	for( uxOp = 0; uxOp < uxTraceLength; ++uxOp )
+	{
+		uxId = xTrace[ uxOp ].id;
+
+		if( xTrace[ uxOp ].size )
+		{
+			ullStart = host_nanoseconds();
+			pucBlock[ uxId ] = pxHeap->malloc( xTrace[ uxOp ].size );
+			ullTime = host_nanoseconds() - ullStart;
+
+			if( pucBlock[ uxId ] == NULL )
+				++*pulFailed;
+			else
+			{
+				assert( ( (uintptr_t)pucBlock[ uxId ] & portBYTE_ALIGNMENT_MASK ) == 0 );
+				uxSize[ uxId ] = xTrace[ uxOp ].size;
+				memset( pucBlock[ uxId ], (uint8_t)( uxId ^ 0x5A ), uxSize[ uxId ] );
+			}
+		}
+		else
+		{
+			if( pucBlock[ uxId ] != NULL )
+				for( i = 0; i < uxSize[ uxId ]; ++i )
+					assert( pucBlock[ uxId ][ i ] == (uint8_t)( uxId ^ 0x5A ) );	// no other block overlapped it.
+
+			ullStart = host_nanoseconds();
+			pxHeap->free( pucBlock[ uxId ] );		// freeing NULL is allowed.
+			ullTime = host_nanoseconds() - ullStart;
+			pucBlock[ uxId ] = NULL;
+		}
+
+		ullTime = ullTime > ullClock ? ullTime - ullClock : 0;
+		if( xFirst || ullTime < ullBest[ uxOp ] )
+			ullBest[ uxOp ] = ullTime;
+
+		if( ( xFree = pxHeap->freeSize() ) < *pxLeastFree )
+			*pxLeastFree = xFree;
+	}
+
+	assert( pxHeap->freeSize() == xStartFree );		// everything freed, and merged back.
+}
+
+static void prvRun( const char * pcName, void ( * vGenerate )( void ) )
+{
+	unsigned long ulFailed;
+	size_t xLeastFree, xStartFree;
+	uint64_t ullTotal, ullWorst;
+	unsigned uxOp, uxHeap, uxRepeat, uxAllocs = 0;
+	HeapStats_t xStats;
+
+	vGenerate();
+	prvFreeAll();
+
+	for( uxOp = 0; uxOp < uxTraceLength; ++uxOp )
+		uxAllocs += xTrace[ uxOp ].size != 0;
+
+	printf( "  %-8s %5u allocations, %5u frees\n", pcName, uxAllocs, uxTraceLength - uxAllocs );
+
+	for( uxHeap = 0; uxHeap < TEST_HEAPS; ++uxHeap )
+	{
+		xStartFree = xHeaps[ uxHeap ].freeSize();
+
+		for( uxRepeat = 0; uxRepeat < TEST_REPEATS; ++uxRepeat )
+			prvReplay( &xHeaps[ uxHeap ], uxRepeat == 0, &ulFailed, &xLeastFree );
+
+		for( uxOp = 0, ullTotal = 0, ullWorst = 0; uxOp < uxTraceLength; ++uxOp )
+		{
+			ullTotal += ullBest[ uxOp ];
+			if( ullBest[ uxOp ] > ullWorst )
+				ullWorst = ullBest[ uxOp ];
+		}
+
+		printf( "    %-6s %6.1f ns/op, worst %6llu ns, %5lu failed, at most %5.1f%% of the heap in use\n",
+				xHeaps[ uxHeap ].name, (double)ullTotal / uxTraceLength, (unsigned long long)ullWorst, ulFailed,
+				100.0 * (double)( xStartFree - xLeastFree ) / (double)xStartFree );
+	}
+
+	vPortGetHeapStats( &xStats );
+	assert( xStats.xNumberOfFreeBlocks == 1 && xStats.xSizeOfLargestFreeBlockInBytes == xPortGetLargestFreeBlockSize() );	// all merged,
+	assert( xStats.xSizeOfLargestFreeBlockInBytes < xStats.xAvailableHeapSpaceInBytes );	// less its header.
+}
+
+/* heap_6 fragmentation, part way through the fill trace, from vPortGetHeapStats(). */
+static void prvTestStats( void )
+{
+	static uint8_t * pucBlock[ TEST_LIVE ];
+	HeapStats_t xStats;
+	size_t xStartFree = xPortGetFreeHeapSize();
+	unsigned uxOp, uxEnd = uxTraceLength / 2;
+	uint16_t uxId;
+
+	prvTraceFill();
+
+	for( uxOp = 0; uxOp < uxEnd; ++uxOp )
+	{
+		uxId = xTrace[ uxOp ].id;
+		if( xTrace[ uxOp ].size )
+			pucBlock[ uxId ] = pvPortMalloc( xTrace[ uxOp ].size );
+		else
+		{
+			vPortFree( pucBlock[ uxId ] );
+			pucBlock[ uxId ] = NULL;
+		}
+	}
+
+	vPortGetHeapStats( &xStats );
+	assert( xStats.xAvailableHeapSpaceInBytes == xPortGetFreeHeapSize() );
+	assert( xStats.xSizeOfLargestFreeBlockInBytes == xPortGetLargestFreeBlockSize() );	// both less the header.
+	assert( xStats.xSizeOfSmallestFreeBlockInBytes <= xStats.xSizeOfLargestFreeBlockInBytes );
+	assert( xStats.xMinimumEverFreeBytesRemaining == xPortGetMinimumEverFreeHeapSize() );
+
+	printf( "  heap_6 half way through fill: %u free blocks, %u bytes free, largest %u, %.1f%% fragmented\n",
+			(unsigned)xStats.xNumberOfFreeBlocks, (unsigned)xStats.xAvailableHeapSpaceInBytes, (unsigned)xStats.xSizeOfLargestFreeBlockInBytes,
+			100.0 - 100.0 * (double)xStats.xSizeOfLargestFreeBlockInBytes / (double)xStats.xAvailableHeapSpaceInBytes );
+
+	for( uxId = 0; uxId < TEST_LIVE; ++uxId )
+		vPortFree( pucBlock[ uxId ] );
+
+	assert( xPortGetFreeHeapSize() == xStartFree );
+}
+
+/* Requests that cannot succeed fail cleanly, and all the largest free block is there to be had. */
+static void prvTestLimits( void )
+{
+	size_t xLargest;
+	void * pv;
+
+	assert( pvPortMalloc( 0 ) == NULL );			// this sets the heap up, too.
+	assert( pvPortMalloc( (size_t)-1 ) == NULL );
+	assert( pvPortMalloc( configTOTAL_HEAP_SIZE ) == NULL );
+
+	xLargest = xPortGetLargestFreeBlockSize();		// less its header, which the free size includes.
+	assert( xLargest != 0 && xLargest < xPortGetFreeHeapSize() );
+	assert( ( pv = pvPortMalloc( xLargest ) ) != NULL && xPortGetFreeHeapSize() == 0 );
+	assert( pvPortMalloc( 1 ) == NULL && xPortGetLargestFreeBlockSize() == 0 );
+	vPortFree( pv );
+	assert( xPortGetLargestFreeBlockSize() == xLargest );
+}
+
+int main( void )
+{
+	uint64_t ullStart;
+	unsigned n;
+
+	for( n = 0, ullClock = ~0ULL; n < 10000; ++n )
+	{
+		ullStart = host_nanoseconds();
+		if( host_nanoseconds() - ullStart < ullClock )
+			ullClock = host_nanoseconds() - ullStart;
+	}
+
+	prvTestLimits();
+	assert( pvHeap4Malloc( 0 ) == NULL );			// heap_4 is set up on its first call, too.
+
+	printf( "Allocation traces replayed on a %u byte heap, the least of %u replays for each operation\n",
+			(unsigned)configTOTAL_HEAP_SIZE, TEST_REPEATS );
+	prvRun( "tasks", prvTraceTasks );
+	prvRun( "small", prvTraceSmall );
+	prvRun( "network", prvTraceNetwork );
+	prvRun( "fill", prvTraceFill );
+
+	prvTestStats();
+
+	printf( "PASS\n" );
+	return 0;
+}
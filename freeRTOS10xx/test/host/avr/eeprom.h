@@ -0,0 +1,8 @@
+/*
+ * Host stand in for avr-libc <avr/eeprom.h>. FT_Platform.h includes it, but nothing under test uses the EEPROM.
+ */
+
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+#endif /* HOST_AVR_EEPROM_H */
@@ -0,0 +1,14 @@
+/*
+ * Host stand in for avr-libc <avr/interrupt.h>. An ISR is an ordinary function, for a test to call
+ * with the critical section held, as the hardware would call it with interrupts disabled.
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#define ISR( vector, ... )	void vector( void )
+
+#define sei()
+#define cli()
+
+#endif /* HOST_AVR_INTERRUPT_H */
@@ -0,0 +1,87 @@
+/*
+ * Host stand in for avr-libc <avr/io.h>. The USART0 and SPI registers, and the ports, of the ATmega328P,
+ * as plain variables defined in host.c, so a test can play the part of the hardware. UDR0 is wider than
+ * the real register, so a test can load it with a value no byte can take, and see whether an ISR wrote to it.
+ *
+ * SPDR and SPSR are reached through functions, so that the simulated SPI peripheral in host.c sees each
+ * access. A byte written to SPDR is shifted out, and the reply shifted in, at the next access to either.
+ */
+
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+#ifndef _BV
+#define _BV( bit )	( 1 << ( bit ) )
+#endif
+
+extern volatile uint8_t UCSR0A, UCSR0B, UCSR0C;
+extern volatile uint16_t UBRR0, UDR0;
+extern volatile uint8_t DDRB, DDRD, DDRE;
+extern volatile uint8_t PORTB, PORTD, PORTE;
+extern volatile uint8_t SPCR;
+
+volatile uint16_t * host_spi_data( void );
+volatile uint8_t * host_spi_status( void );
+#define SPDR	( *host_spi_data() )
+#define SPSR	( *host_spi_status() )
+
+/* UCSR0A */
+#define RXC0	7
+#define TXC0	6
+#define UDRE0	5
+#define FE0		4
+#define DOR0	3
+#define UPE0	2
+#define U2X0	1
+#define MPCM0	0
+
+/* UCSR0B */
+#define RXCIE0	7
+#define TXCIE0	6
+#define UDRIE0	5
+#define RXEN0	4
+#define TXEN0	3
+#define UCSZ02	2
+#define RXB80	1
+#define TXB80	0
+
+/* UCSR0C */
+#define UMSEL01	7
+#define UMSEL00	6
+#define UPM01	5
+#define UPM00	4
+#define USBS0	3
+#define UCSZ01	2
+#define UCSZ00	1
+#define UCPOL0	0
+
+/* SPCR */
+#define SPIE	7
+#define SPE		6
+#define DORD	5
+#define MSTR	4
+#define CPOL	3
+#define CPHA	2
+#define SPR1	1
+#define SPR0	0
+
+/* SPSR */
+#define SPIF	7
+#define WCOL	6
+#define SPI2X	0
+
+#define PB0		0
+#define PB1		1
+#define PB2		2
+#define PB3		3
+#define PB4		4
+#define PB5		5
+#define PD4		4
+#define PD7		7
+#define DDD7	7
+#define PORTD7	7
+#define PE2		2
+
+#endif /* HOST_AVR_IO_H */
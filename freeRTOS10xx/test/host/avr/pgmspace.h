@@ -0,0 +1,22 @@
+/*
+ * Host stand in for avr-libc <avr/pgmspace.h>. There is only one address space.
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P				const char *
+#define PSTR( s )			( s )
+#define pgm_read_byte( p )	( *(const uint8_t *)( p ) )
+#define pgm_read_word( p )	( *(const uint16_t *)( p ) )
+
+#define strlen_P			strlen
+#define strcmp_P			strcmp
+#define memcpy_P			memcpy
+#define vsnprintf_P			vsnprintf
+
+#endif /* HOST_AVR_PGMSPACE_H */
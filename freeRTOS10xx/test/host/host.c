@@ -0,0 +1,293 @@
+/*
+ * Host shim for building freeRTOS10xx library code natively. See host.h.
+ */
+
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+#include "host.h"
+
+#include <avr/io.h>
+
+volatile uint8_t UCSR0A, UCSR0B, UCSR0C;
+volatile uint16_t UBRR0, UDR0;
+volatile uint8_t DDRB, DDRD, DDRE;
+volatile uint8_t PORTB, PORTD, PORTE;
+volatile uint8_t SPCR;
+
+unsigned host_assert_count = 0;
+int host_assert_abort = 1;
+
+void host_assert_failed( const char * file, int line, const char * expr )
+{
+	++host_assert_count;
+	if( host_assert_abort )
+	{
+		fprintf( stderr, "%s:%d: configASSERT( %s ) failed\n", file, line, expr );
+		abort();
+	}
+}
+
+static pthread_mutex_t xCritical;
+static pthread_once_t xCriticalOnce = PTHREAD_ONCE_INIT;
+
+static void prvCriticalInit( void )
+{
+	pthread_mutexattr_t xAttr;
+
+	pthread_mutexattr_init( &xAttr );
+	pthread_mutexattr_settype( &xAttr, PTHREAD_MUTEX_RECURSIVE );
+	pthread_mutex_init( &xCritical, &xAttr );
+}
+
+void host_critical_enter( void )
+{
+	pthread_once( &xCriticalOnce, prvCriticalInit );
+	pthread_mutex_lock( &xCritical );
+}
+
+void host_critical_exit( void )
+{
+	pthread_mutex_unlock( &xCritical );
+}
+
+uint64_t host_nanoseconds( void )
+{
+	struct timespec xNow;
+
+	clock_gettime( CLOCK_MONOTONIC, &xNow );
+	return (uint64_t)xNow.tv_sec * 1000000000ULL + xNow.tv_nsec;
+}
+
+/* A task, for each host thread, with its notification count. */
+typedef struct
+{
+	pthread_mutex_t xMutex;
+	pthread_cond_t xCond;
+	uint32_t ulNotifications;
+} xHostTask;
+
+static __thread xHostTask * pxCurrentTask;
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void )
+{
+	if( pxCurrentTask == NULL )
+	{
+		pxCurrentTask = calloc( 1, sizeof( xHostTask ) );	// never freed, as a notification may arrive late.
+		pthread_mutex_init( &pxCurrentTask->xMutex, NULL );
+		pthread_cond_init( &pxCurrentTask->xCond, NULL );
+	}
+	return pxCurrentTask;
+}
+
+TickType_t xTaskGetTickCount( void )
+{
+	return (TickType_t)( host_nanoseconds() * configTICK_RATE_HZ / 1000000000ULL );
+}
+
+void vTaskDelay( const TickType_t xTicksToDelay )
+{
+	struct timespec xDelay;
+	uint64_t ullNanoseconds = (uint64_t)xTicksToDelay * 1000000000ULL / configTICK_RATE_HZ;
+
+	if( xTicksToDelay == 0 )
+	{
+		sched_yield();		// as the kernel does, rather than sleeping for the timer slack.
+		return;
+	}
+
+	xDelay.tv_sec = ullNanoseconds / 1000000000ULL;
+	xDelay.tv_nsec = ullNanoseconds % 1000000000ULL;
+	while( nanosleep( &xDelay, &xDelay ) == -1 && errno == EINTR )
+		;
+}
+
+uint32_t ulTaskNotifyTake( BaseType_t xClearCountOnExit, TickType_t xTicksToWait )
+{
+	xHostTask * pxTask = xTaskGetCurrentTaskHandle();
+	struct timespec xUntil;
+	uint64_t ullUntil;
+	uint32_t ulCount;
+
+	clock_gettime( CLOCK_REALTIME, &xUntil );
+	ullUntil = (uint64_t)xUntil.tv_sec * 1000000000ULL + xUntil.tv_nsec + (uint64_t)xTicksToWait * 1000000000ULL / configTICK_RATE_HZ;
+	xUntil.tv_sec = ullUntil / 1000000000ULL;
+	xUntil.tv_nsec = ullUntil % 1000000000ULL;
+
+	pthread_mutex_lock( &pxTask->xMutex );
+	while( pxTask->ulNotifications == 0 && xTicksToWait != 0 )
+	{
+		if( xTicksToWait == portMAX_DELAY )
+			pthread_cond_wait( &pxTask->xCond, &pxTask->xMutex );
+		else if( pthread_cond_timedwait( &pxTask->xCond, &pxTask->xMutex, &xUntil ) == ETIMEDOUT )
+			break;
+	}
+	ulCount = pxTask->ulNotifications;
+	if( ulCount != 0 )
+		pxTask->ulNotifications = xClearCountOnExit ? 0 : ulCount - 1;
+	pthread_mutex_unlock( &pxTask->xMutex );
+
+	return ulCount;
+}
+
+BaseType_t xTaskNotifyGive( TaskHandle_t xTaskToNotify )
+{
+	xHostTask * pxTask = xTaskToNotify;
+
+	pthread_mutex_lock( &pxTask->xMutex );
+	++pxTask->ulNotifications;
+	pthread_cond_signal( &pxTask->xCond );
+	pthread_mutex_unlock( &pxTask->xMutex );
+
+	return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR( TaskHandle_t xTaskToNotify, BaseType_t * pxHigherPriorityTaskWoken )
+{
+	xTaskNotifyGive( xTaskToNotify );
+	if( pxHigherPriorityTaskWoken != NULL )
+		*pxHigherPriorityTaskWoken = pdFALSE;	// the host threads have no priorities.
+}
+
+/* The SPI peripheral. SPDR holds 0x100 plus the last byte received, until a byte is written to it.
+ * That byte is then transferred at the next access to SPDR or SPSR, which sets SPIF. As on the AVR,
+ * SPIF is cleared by the access to SPDR that follows. */
+static volatile uint16_t uxSpiData = 0x1FF;
+static volatile uint8_t ucSpiStatus;
+
+uint8_t ( * host_spi_device )( uint8_t ucSent );
+
+static void prvSpiShift( void )
+{
+	uint8_t ucSent;
+
+	if( uxSpiData < 0x100 )
+	{
+		ucSent = (uint8_t)uxSpiData;
+		uxSpiData = 0x1FF;	// so the device model may look at the registers.
+		uxSpiData = 0x100 | ( host_spi_device != NULL ? host_spi_device( ucSent ) : 0xFF );
+		ucSpiStatus |= _BV(SPIF);
+	}
+}
+
+volatile uint16_t * host_spi_data( void )
+{
+	prvSpiShift();
+	ucSpiStatus &= ~_BV(SPIF);
+	return &uxSpiData;
+}
+
+volatile uint8_t * host_spi_status( void )
+{
+	prvSpiShift();
+	return &ucSpiStatus;
+}
+
+/* The SPI STC interrupt. Once a test attaches the ISR, a thread plays the interrupt controller. While SPIE
+ * is set, each byte written to SPDR is transferred, and the ISR called with the critical section held, as
+ * the hardware calls it with interrupts disabled. */
+static void ( * volatile pvSpiInterrupt )( void );
+
+static void * prvSpiInterruptThread( void * pvParameters )
+{
+	( void ) pvParameters;
+
+	for( ;; )
+	{
+		if( SPCR & _BV(SPIE) )
+		{
+			host_critical_enter();
+			if( ( SPCR & _BV(SPIE) ) && ( SPSR & _BV(SPIF) ) )
+				pvSpiInterrupt();
+			host_critical_exit();
+		}
+		else
+			sched_yield();
+	}
+	return NULL;
+}
+
+void host_spi_attach_interrupt( void ( * pvInterrupt )( void ) )
+{
+	pthread_t xThread;
+
+	if( pvSpiInterrupt == NULL )
+	{
+		pvSpiInterrupt = pvInterrupt;
+		pthread_create( &xThread, NULL, prvSpiInterruptThread, NULL );
+		pthread_detach( xThread );
+	}
+	else
+		pvSpiInterrupt = pvInterrupt;
+}
+
+/* A counting semaphore, with a maximum count of one. */
+typedef struct
+{
+	pthread_mutex_t xMutex;
+	pthread_cond_t xCond;
+	unsigned uxCount;
+} xHostSemaphore;
+
+SemaphoreHandle_t xSemaphoreCreateMutex( void )
+{
+	xHostSemaphore * pxSemaphore = calloc( 1, sizeof( xHostSemaphore ) );
+
+	pthread_mutex_init( &pxSemaphore->xMutex, NULL );
+	pthread_cond_init( &pxSemaphore->xCond, NULL );
+	pxSemaphore->uxCount = 1;	// a mutex is created available.
+	return pxSemaphore;
+}
+
+BaseType_t xSemaphoreTake( SemaphoreHandle_t xSemaphore, TickType_t xTicksToWait )
+{
+	xHostSemaphore * pxSemaphore = xSemaphore;
+	struct timespec xUntil;
+	uint64_t ullUntil;
+	BaseType_t xTaken = pdFALSE;
+
+	clock_gettime( CLOCK_REALTIME, &xUntil );
+	ullUntil = (uint64_t)xUntil.tv_sec * 1000000000ULL + xUntil.tv_nsec + (uint64_t)xTicksToWait * 1000000000ULL / configTICK_RATE_HZ;
+	xUntil.tv_sec = ullUntil / 1000000000ULL;
+	xUntil.tv_nsec = ullUntil % 1000000000ULL;
+
+	pthread_mutex_lock( &pxSemaphore->xMutex );
+	while( pxSemaphore->uxCount == 0 && xTicksToWait != 0 )
+	{
+		if( xTicksToWait == portMAX_DELAY )
+			pthread_cond_wait( &pxSemaphore->xCond, &pxSemaphore->xMutex );
+		else if( pthread_cond_timedwait( &pxSemaphore->xCond, &pxSemaphore->xMutex, &xUntil ) == ETIMEDOUT )
+			break;
+	}
+	if( pxSemaphore->uxCount != 0 )
+	{
+		--pxSemaphore->uxCount;
+		xTaken = pdTRUE;
+	}
+	pthread_mutex_unlock( &pxSemaphore->xMutex );
+
+	return xTaken;
+}
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t xSemaphore )
+{
+	xHostSemaphore * pxSemaphore = xSemaphore;
+	BaseType_t xGiven = pdFALSE;
+
+	pthread_mutex_lock( &pxSemaphore->xMutex );
+	if( pxSemaphore->uxCount == 0 )
+	{
+		pxSemaphore->uxCount = 1;
+		xGiven = pdTRUE;
+		pthread_cond_signal( &pxSemaphore->xCond );
+	}
+	pthread_mutex_unlock( &pxSemaphore->xMutex );
+
+	return xGiven;
+}
+
+void vQueueDelete( QueueHandle_t xQueue )
+{
+	free( xQueue );
+}
@@ -0,0 +1,167 @@
+/*
+ * Host shim for building freeRTOS10xx library code natively, for the tests and benchmarks in this directory.
+ *
+ * It is force included ahead of every source (-include host/host.h), and stands in for the kernel by
+ * defining the include guards of FreeRTOS.h, task.h and the rest, so the real AVR headers are skipped.
+ * Only what the library code under test needs is provided. Critical sections are one recursive mutex,
+ * so code under test can be driven from several host threads at once, and each thread is a task.
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+
+#define INC_FREERTOS_H
+#define INC_TASK_H
+#define QUEUE_H
+#define SEMAPHORE_H
+#define EVENT_GROUPS_H
+#define PORTABLE_H
+#define FREERTOS_CONFIG_H
+#define freeRTOSBoardDefs_h
+
+typedef int8_t		BaseType_t;
+typedef uint8_t		UBaseType_t;
+typedef uint16_t	TickType_t;
+typedef void *		TaskHandle_t;
+typedef void *		QueueHandle_t;
+typedef void *		SemaphoreHandle_t;
+
+#define pdFALSE			( ( BaseType_t ) 0 )
+#define pdTRUE			( ( BaseType_t ) 1 )
+#define pdPASS			( pdTRUE )
+#define pdFAIL			( pdFALSE )
+#define portMAX_DELAY	( TickType_t ) 0xffff
+
+#define configTICK_RATE_HZ	( ( TickType_t ) 128 )
+#define configCPU_CLOCK_HZ	( ( uint32_t ) 16000000 )
+#define portTICK_PERIOD_MS	( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+
+#define portCHAR	char
+#ifdef HOST_HEAP
+#define portBYTE_ALIGNMENT	8		// the heap blocks hold host pointers.
+#else
+#define portBYTE_ALIGNMENT	1
+#endif
+#define portBYTE_ALIGNMENT_MASK	( portBYTE_ALIGNMENT - 1 )
+#define portPOINTER_SIZE_TYPE	uint16_t
+
+/* A failed configASSERT() is counted, and aborts unless a test has asked to count them instead. */
+extern unsigned host_assert_count;
+extern int host_assert_abort;
+void host_assert_failed( const char * file, int line, const char * expr );
+#define configASSERT( x )	do { if( !( x ) ) host_assert_failed( __FILE__, __LINE__, #x ); } while( 0 )
+
+void host_critical_enter( void );
+void host_critical_exit( void );
+#define portENTER_CRITICAL()	host_critical_enter()
+#define portEXIT_CRITICAL()		host_critical_exit()
+#define portDISABLE_INTERRUPTS()	host_critical_enter()
+#define portENABLE_INTERRUPTS()		host_critical_exit()
+#define taskENTER_CRITICAL()	host_critical_enter()
+#define taskEXIT_CRITICAL()		host_critical_exit()
+
+#define taskYIELD()			sched_yield()
+#define vTaskSuspendAll()	host_critical_enter()
+#define xTaskResumeAll()	( host_critical_exit(), pdFALSE )
+
+/* The kernel heap is the host malloc, unless the test builds one of the MemMang heaps (-DHOST_HEAP).
+ * Then HeapStats_t is as in portable.h, which is not included. */
+#ifndef HOST_HEAP
+#define pvPortMalloc( x )	malloc( x )
+#define vPortFree( x )		free( x )
+#else
+#define configSUPPORT_DYNAMIC_ALLOCATION	1
+
+typedef struct xHeapStats
+{
+	size_t xAvailableHeapSpaceInBytes;
+	size_t xSizeOfLargestFreeBlockInBytes;
+	size_t xSizeOfSmallestFreeBlockInBytes;
+	size_t xNumberOfFreeBlocks;
+	size_t xMinimumEverFreeBytesRemaining;
+	size_t xNumberOfSuccessfulAllocations;
+	size_t xNumberOfSuccessfulFrees;
+} HeapStats_t;
+
+void * pvPortMalloc( size_t xWantedSize );
+void vPortFree( void * pv );
+size_t xPortGetFreeHeapSize( void );
+size_t xPortGetMinimumEverFreeHeapSize( void );
+size_t xPortGetLargestFreeBlockSize( void );
+void vPortGetHeapStats( HeapStats_t * pxHeapStats );
+void vPortInitialiseBlocks( void );
+#endif
+
+#define mtCOVERAGE_TEST_MARKER()
+#define traceMALLOC( pvAddress, uiSize )
+#define traceFREE( pvAddress, uiSize )
+#define traceISR_ENTER( ucIsrId )
+#define traceISR_EXIT( ucIsrId )
+
+/* Each host thread is a task, and has a notification count for the direct to task notifications.
+ * A tick is 1 / configTICK_RATE_HZ of real time. */
+TaskHandle_t xTaskGetCurrentTaskHandle( void );
+TickType_t xTaskGetTickCount( void );
+void vTaskDelay( const TickType_t xTicksToDelay );
+uint32_t ulTaskNotifyTake( BaseType_t xClearCountOnExit, TickType_t xTicksToWait );
+BaseType_t xTaskNotifyGive( TaskHandle_t xTaskToNotify );
+void vTaskNotifyGiveFromISR( TaskHandle_t xTaskToNotify, BaseType_t * pxHigherPriorityTaskWoken );
+
+/* The trace recorder is built with -DHOST_TRACE. The test plays the kernel, and the run time stats timer,
+ * and so provides these. */
+#ifdef HOST_TRACE
+#define configGENERATE_RUN_TIME_STATS	1
+#define configUSE_TRACE_FACILITY		1
+#define configUSE_TRACE_RECORDER		1
+#define configMAX_TASK_NAME_LEN			( 8 )
+
+typedef struct xTASK_STATUS
+{
+	TaskHandle_t xHandle;
+	const char * pcTaskName;
+	UBaseType_t xTaskNumber;
+} TaskStatus_t;
+
+UBaseType_t uxTaskGetNumberOfTasks( void );
+UBaseType_t uxTaskGetSystemState( TaskStatus_t * const pxTaskStatusArray, const UBaseType_t uxArraySize, uint32_t * const pulTotalRunTime );
+uint32_t ulPortGetRunTimeCounterValue( void );
+#endif
+
+/* Counting semaphores, also standing in for the mutexes, without priority inheritance. */
+SemaphoreHandle_t xSemaphoreCreateMutex( void );
+BaseType_t xSemaphoreTake( SemaphoreHandle_t xSemaphore, TickType_t xTicksToWait );
+BaseType_t xSemaphoreGive( SemaphoreHandle_t xSemaphore );
+void vQueueDelete( QueueHandle_t xQueue );
+
+/* The SPI pins of the Arduino Uno, from FreeRTOSBoardDefs.h. */
+#define SPI_PORT			PORTB
+#define SPI_PORT_DIR		DDRB
+#define SPI_BIT_SCK			_BV(PB5)
+#define SPI_BIT_MISO		_BV(PB4)
+#define SPI_BIT_MOSI		_BV(PB3)
+#define SPI_BIT_SS			_BV(PB2)
+#define SPI_BIT_SS_WIZNET	_BV(PB2)
+#define SPI_PORT_SS_G2		PORTB
+#define SPI_PORT_DIR_SS_G2	DDRB
+#define SPI_BIT_SS_G2		_BV(PB0)
+#define SPI_PORT_SS_SD		PORTD
+#define SPI_PORT_DIR_SS_SD	DDRD
+#define SPI_BIT_SS_SD		_BV(PD4)
+
+/* The simulated SPI peripheral calls the test's device model with each byte sent, for the byte to reply. */
+extern uint8_t ( * host_spi_device )( uint8_t ucSent );
+
+/* From then on, the simulated SPI peripheral calls the ISR given for each byte transferred while SPIE is set. */
+void host_spi_attach_interrupt( void ( * pvInterrupt )( void ) );
+
+/* Monotonic time, for the benchmarks. */
+uint64_t host_nanoseconds( void );
+
+#endif /* HOST_H */
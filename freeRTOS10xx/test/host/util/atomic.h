@@ -0,0 +1,18 @@
+/*
+ * Host stand in for avr-libc <util/atomic.h>. On the AVR an ATOMIC_BLOCK holds off interrupts, and so is also
+ * a compiler memory barrier. On the host an aligned 16 bit load or store is already atomic, so only the
+ * barrier is kept.
+ */
+
+#ifndef HOST_UTIL_ATOMIC_H
+#define HOST_UTIL_ATOMIC_H
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+
+#define ATOMIC_BLOCK( type ) \
+	for( int __atomic_todo = ( __atomic_signal_fence( __ATOMIC_SEQ_CST ), 1 ); \
+		 __atomic_todo; \
+		 __atomic_todo = ( __atomic_signal_fence( __ATOMIC_SEQ_CST ), 0 ) )
+
+#endif /* HOST_UTIL_ATOMIC_H */
@@ -0,0 +1,19 @@
+/*
+ * Host stand in for avr-libc <util/crc16.h>. The library code mostly uses lib_util/crc.c instead.
+ */
+
+#ifndef HOST_UTIL_CRC16_H
+#define HOST_UTIL_CRC16_H
+
+#include <stdint.h>
+
+/* The C equivalent given in the avr-libc documentation. */
+static inline uint16_t _crc_ccitt_update( uint16_t crc, uint8_t data )
+{
+	data ^= crc & 0xff;
+	data ^= data << 4;
+
+	return ( ( (uint16_t)data << 8 ) | ( crc >> 8 ) ) ^ (uint8_t)( data >> 4 ) ^ ( (uint16_t)data << 3 );
+}
+
+#endif /* HOST_UTIL_CRC16_H */
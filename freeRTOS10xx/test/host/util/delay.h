@@ -0,0 +1,23 @@
+/*
+ * Host stand in for avr-libc <util/delay.h>. The AVR delays are busy loops, and so are these,
+ * so the time spent in them still counts as CPU time taken from the other tasks.
+ */
+
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+
+#include <stdint.h>
+
+uint64_t host_nanoseconds( void );
+
+static inline void _delay_us( double us )
+{
+	uint64_t ullEnd = host_nanoseconds() + (uint64_t)( us * 1000.0 );
+
+	while( host_nanoseconds() < ullEnd )
+		;
+}
+
+#define _delay_ms( ms )		_delay_us( ( ms ) * 1000.0 )
+
+#endif /* HOST_UTIL_DELAY_H */
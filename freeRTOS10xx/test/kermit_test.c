@@ -0,0 +1,327 @@
+/*
+ * Host test for the true sliding windows (F_TSW) in KermitServer/kermit.c.
+ *
+ * Two Kermit instances, a sender and a receiver, are joined by a packet loopback in each direction, as
+ * kermitTask.c drives one over the serial port: a packet is read into a slot from getrslot() and handed to
+ * kermit(), and a timeout is a call with an empty slot. The loopback can lose one chosen packet, and when
+ * neither direction has anything in flight the sender times out first, then the receiver.
+ *
+ * A file of random bytes goes across with nothing lost, which gives the packets the other runs are compared
+ * with. Then one packet is lost in each run:
+ *
+ *   a data packet, so the ones behind it are ACKd and stashed, and only the lost one is NAKd and sent again;
+ *   the ACK of a data packet, so the sender times out with its window full and resends only that packet;
+ *   the last data packet, so the EOF waits until the window has drained.
+ *
+ * In every run the file must arrive whole, and the EOF must not be sent while a data packet is not ACKd.
+ */
+
+#include <assert.h>
+
+#include "cdefs.h"
+#include "platform.h"
+#include "kermit.h"
+
+#define TEST_FILE_SIZE		16000		// more than 64 data packets, so the sequence numbers wrap.
+#define TEST_QUEUE			64			// packets in flight in each direction.
+#define TEST_TURNS			20000
+
+enum { LINK_TO_RECEIVER, LINK_TO_SENDER, LINKS };
+
+typedef struct
+{
+	UCHAR ucPacket[ TEST_QUEUE ][ P_SLOTLEN ];
+	int xLength[ TEST_QUEUE ];
+	unsigned uxHead, uxTail;
+
+	unsigned uxSent[ 128 ][ 64 ];		// packets handed to txd(), by type and sequence number.
+	char cLoseType;						// the packet to lose, its type, sequence number,
+	short xLoseSeq;
+	unsigned uxLoseCount;				// and which one of those it is, from 1.
+} xLink_t;
+
+static xLink_t xLink[ LINKS ];
+
+static struct k_data xSender, xReceiver;
+static struct k_response xSenderResponse, xReceiverResponse;
+
+static UCHAR ucSenderIn[ IBUFLEN + 8 ], ucReceiverOut[ OBUFLEN + 8 ];
+static UCHAR ucSenderSlots[ 2 ][ P_WSLOTS * P_SLOTLEN ], ucReceiverSlots[ 2 ][ P_WSLOTS * P_SLOTLEN ];
+
+static UCHAR ucFile[ TEST_FILE_SIZE ];
+static int xFileRead;
+static UCHAR ucReceived[ 2 * TEST_FILE_SIZE ];
+static int xReceived;
+
+static uint8_t ucUnacked[ 64 ];			// data packets the sender has sent, but has not had ACKd.
+static short xFirstData, xLastData;		// sequence numbers of the first and the last data packet sent.
+static unsigned uxEarlyEof;
+static unsigned uxTimeouts;
+
+/* The comms and file functions kermitTask.c gets from avrio.c. */
+
+static int prvTransmit( struct k_data * k, UCHAR * p, int n )
+{
+	xLink_t * pxLink = &xLink[ k == &xSender ? LINK_TO_RECEIVER : LINK_TO_SENDER ];
+	char cType = p[ 3 ];
+	short xSeq = xunchar( p[ 2 ] );
+	unsigned uxSeq;
+
+	assert( p[ 0 ] == SOH && n <= P_SLOTLEN );
+
+	if( k == &xSender && cType == 'D' )
+	{
+		if( xFirstData < 0 )
+			xFirstData = xSeq;
+		xLastData = xSeq;
+		ucUnacked[ xSeq ] = 1;
+	}
+	if( k == &xSender && cType == 'Z' )
+		for( uxSeq = 0; uxSeq < 64; ++uxSeq )
+			uxEarlyEof += ucUnacked[ uxSeq ];
+
+	if( ++pxLink->uxSent[ (uint8_t)cType & 127 ][ xSeq ] == pxLink->uxLoseCount &&
+		cType == pxLink->cLoseType && xSeq == pxLink->xLoseSeq )
+		return X_OK;
+
+	assert( pxLink->uxTail - pxLink->uxHead < TEST_QUEUE );
+	memcpy( pxLink->ucPacket[ pxLink->uxTail % TEST_QUEUE ], p, n );
+	pxLink->xLength[ pxLink->uxTail % TEST_QUEUE ] = n;
+	pxLink->uxTail++;
+	return X_OK;
+}
+
+static int prvOpen( struct k_data * k, UCHAR * s, int mode )
+{
+	( void ) s;
+
+	if( mode == 1 )
+	{
+		xFileRead = 0;
+		k->s_first = 1;
+		k->zinptr = k->zinbuf;
+		k->zincnt = 0;
+	}
+	else
+		xReceived = 0;
+	return X_OK;
+}
+
+static int prvInfo( struct k_data * k, UCHAR * filename, UCHAR * buf, int buflen, short * type, short mode )
+{
+	( void ) k; ( void ) filename; ( void ) buflen; ( void ) type; ( void ) mode;
+
+	buf[ 0 ] = '\0';
+	return TEST_FILE_SIZE;
+}
+
+static int prvRead( struct k_data * k )
+{
+	int n = TEST_FILE_SIZE - xFileRead;
+
+	if( n > k->zinlen )
+		n = k->zinlen;
+	if( n <= 0 )
+		return -1;
+	memcpy( k->zinbuf, ucFile + xFileRead, n );
+	xFileRead += n;
+	k->zincnt = n - 1;
+	k->zinptr = k->zinbuf + 1;
+	return k->zinbuf[ 0 ];
+}
+
+static int prvWrite( struct k_data * k, UCHAR * s, int n )
+{
+	( void ) k;
+
+	assert( xReceived + n <= (int)sizeof( ucReceived ) );
+	memcpy( ucReceived + xReceived, s, n );
+	xReceived += n;
+	return X_OK;
+}
+
+static int prvClose( struct k_data * k, UCHAR c, int mode )
+{
+	( void ) k; ( void ) c; ( void ) mode;
+
+	return X_OK;
+}
+
+static void prvSetup( struct k_data * k, UCHAR pucSlots[ 2 ][ P_WSLOTS * P_SLOTLEN ] )
+{
+	memset( k, 0, sizeof( *k ) );
+	k->remote = 1;
+	k->binary = 1;
+	k->zinbuf = ucSenderIn;
+	k->zinlen = IBUFLEN;
+	k->obuf = ucReceiverOut;
+	k->obuflen = OBUFLEN;
+	k->ipktbuf = pucSlots[ 0 ];
+	k->opktwin = pucSlots[ 1 ];
+	k->txd = prvTransmit;
+	k->openf = prvOpen;
+	k->finfo = prvInfo;
+	k->readf = prvRead;
+	k->writef = prvWrite;
+	k->closef = prvClose;
+}
+
+/* Hand the next packet on a link to Kermit, as readpkt() would, without the SOH and the EOM. */
+static int prvDeliver( struct k_data * k, struct k_response * r, xLink_t * pxLink )
+{
+	UCHAR * pucSlot, * p;
+	short xSlot;
+	int n, len;
+
+	pucSlot = getrslot( k, &xSlot );
+	assert( pucSlot );
+
+	p = pxLink->ucPacket[ pxLink->uxHead % TEST_QUEUE ];
+	n = pxLink->xLength[ pxLink->uxHead % TEST_QUEUE ];
+	pxLink->uxHead++;
+
+	for( len = 0; len + 1 < n && p[ len + 1 ] != CR; ++len )
+		pucSlot[ len ] = p[ len + 1 ];
+
+	if( k == &xSender && p[ 3 ] == 'Y' )
+		ucUnacked[ xunchar( p[ 2 ] ) ] = 0;
+
+	return kermit( K_RUN, k, xSlot, len, "", r );
+}
+
+static int prvTimeout( struct k_data * k, struct k_response * r )
+{
+	short xSlot;
+
+	getrslot( k, &xSlot );
+	freerslot( k, xSlot );
+	uxTimeouts++;
+	return kermit( K_RUN, k, xSlot, 0, "", r );
+}
+
+/* Send the file, losing the given packet, and check that it arrives whole, with no EOF sent early. */
+static void prvTransfer( int xLoseLink, char cLoseType, short xLoseSeq, unsigned uxLoseCount )
+{
+	static UCHAR * pucFiles[] = { (UCHAR *)"TEST.BIN", (UCHAR *)0 };
+	int xSent, xGot, xTurns;
+
+	memset( xLink, 0, sizeof( xLink ) );
+	memset( ucUnacked, 0, sizeof( ucUnacked ) );
+	uxEarlyEof = uxTimeouts = 0;
+	xFirstData = xLastData = -1;
+	if( xLoseLink >= 0 )
+	{
+		xLink[ xLoseLink ].cLoseType = cLoseType;
+		xLink[ xLoseLink ].xLoseSeq = xLoseSeq;
+		xLink[ xLoseLink ].uxLoseCount = uxLoseCount;
+	}
+
+	prvSetup( &xSender, ucSenderSlots );
+	prvSetup( &xReceiver, ucReceiverSlots );
+	xSender.filelist = pucFiles;
+
+	assert( kermit( K_INIT, &xSender, 0, 0, "", &xSenderResponse ) == X_OK );
+	assert( kermit( K_INIT, &xReceiver, 0, 0, "", &xReceiverResponse ) == X_OK );
+	xSent = kermit( K_SEND, &xSender, 0, 0, "", &xSenderResponse );
+	xGot = X_OK;
+
+	for( xTurns = 0; ( xSent != X_DONE || xGot != X_DONE ) && xTurns < TEST_TURNS; ++xTurns )
+	{
+		int xMoved = 0;
+
+		if( xGot != X_DONE && xLink[ LINK_TO_RECEIVER ].uxHead != xLink[ LINK_TO_RECEIVER ].uxTail )
+		{
+			xGot = prvDeliver( &xReceiver, &xReceiverResponse, &xLink[ LINK_TO_RECEIVER ] );
+			xMoved = 1;
+		}
+		if( xSent != X_DONE && xLink[ LINK_TO_SENDER ].uxHead != xLink[ LINK_TO_SENDER ].uxTail )
+		{
+			xSent = prvDeliver( &xSender, &xSenderResponse, &xLink[ LINK_TO_SENDER ] );
+			xMoved = 1;
+		}
+		if( !xMoved )
+		{
+			if( xSent != X_DONE )
+				xSent = prvTimeout( &xSender, &xSenderResponse );
+			else
+				xGot = prvTimeout( &xReceiver, &xReceiverResponse );
+		}
+		assert( xSent != X_ERROR && xGot != X_ERROR );
+	}
+
+	assert( xSent == X_DONE && xGot == X_DONE );
+	assert( xReceived == TEST_FILE_SIZE && memcmp( ucReceived, ucFile, TEST_FILE_SIZE ) == 0 );
+	assert( uxEarlyEof == 0 );
+	for( xTurns = 0, xSent = 0; xTurns < 64; ++xTurns )
+		xSent += xLink[ LINK_TO_RECEIVER ].uxSent[ 'Z' ][ xTurns ];
+	assert( xSent == 1 );
+}
+
+/* Data packets the sender sent, by sequence number, and the total. */
+static unsigned prvDataSent( unsigned uxData[ 64 ] )
+{
+	unsigned uxSeq, uxTotal = 0;
+
+	for( uxSeq = 0; uxSeq < 64; ++uxSeq )
+		uxTotal += uxData[ uxSeq ] = xLink[ LINK_TO_RECEIVER ].uxSent[ 'D' ][ uxSeq ];
+	return uxTotal;
+}
+
+static unsigned prvNaks( void )
+{
+	unsigned uxSeq, uxTotal = 0;
+
+	for( uxSeq = 0; uxSeq < 64; ++uxSeq )
+		uxTotal += xLink[ LINK_TO_SENDER ].uxSent[ 'N' ][ uxSeq ];
+	return uxTotal;
+}
+
+/* Only the one data packet was sent again, once. */
+static void prvCheckResent( const unsigned uxClean[ 64 ], short xSeq )
+{
+	unsigned uxData[ 64 ], uxSeq;
+
+	prvDataSent( uxData );
+	for( uxSeq = 0; uxSeq < 64; ++uxSeq )
+		assert( uxData[ uxSeq ] == uxClean[ uxSeq ] + ( uxSeq == (unsigned)xSeq ) );
+}
+
+int main( void )
+{
+	unsigned uxClean[ 64 ], uxData, uxSeq;
+	short xFirst, xLast;
+
+	for( uxSeq = 0; uxSeq < TEST_FILE_SIZE; ++uxSeq )
+		ucFile[ uxSeq ] = (UCHAR)rand();
+
+	prvTransfer( -1, 0, 0, 0 );
+	uxData = prvDataSent( uxClean );
+	assert( uxData > 64 && prvNaks() == 0 && uxTimeouts == 0 );
+	xFirst = xFirstData;
+	xLast = xLastData;
+	assert( xLast == ( ( xFirst + uxData - 1 ) & 63 ) );
+	printf( "%u data packets in a window of %d, with nothing lost\n", uxData, xSender.wslots );
+	assert( xSender.wslots == P_WSLOTS && xReceiver.wslots == P_WSLOTS && P_WSLOTS > 2 );
+
+	/* The second data packet is lost. The ones behind it are kept, and only it is NAKd and sent again. */
+	prvTransfer( LINK_TO_RECEIVER, 'D', ( xFirst + 1 ) & 63, 1 );
+	prvCheckResent( uxClean, ( xFirst + 1 ) & 63 );
+	assert( xLink[ LINK_TO_SENDER ].uxSent[ 'N' ][ ( xFirst + 1 ) & 63 ] > 0 );
+	assert( prvNaks() == xLink[ LINK_TO_SENDER ].uxSent[ 'N' ][ ( xFirst + 1 ) & 63 ] && uxTimeouts == 0 );
+	printf( "  data packet %d lost: stashed the rest of the window, %u NAK, no timeouts\n", ( xFirst + 1 ) & 63, prvNaks() );
+
+	/* The ACK of the third is lost. The sender fills its window, times out, and sends only that one again. */
+	prvTransfer( LINK_TO_SENDER, 'Y', ( xFirst + 2 ) & 63, 1 );
+	prvCheckResent( uxClean, ( xFirst + 2 ) & 63 );
+	assert( prvNaks() == 0 && uxTimeouts == 1 );
+	printf( "  ACK %d lost: resent one data packet after %u timeout\n", ( xFirst + 2 ) & 63, uxTimeouts );
+
+	/* The last data packet is lost. The EOF waits until it has been sent again and ACKd. */
+	prvTransfer( LINK_TO_RECEIVER, 'D', xLast, uxClean[ xLast ] );
+	prvCheckResent( uxClean, xLast );
+	assert( uxTimeouts == 1 );
+	printf( "  last data packet %d lost: EOF sent after the window drained, %u timeout\n", xLast, uxTimeouts );
+
+	printf( "PASS\n" );
+	return 0;
+}
@@ -0,0 +1,226 @@
+/*
+ * Host test and benchmark for the Life generation step in ConwayLifePeggy/life.h.
+ *
+ * next_row() is checked for every one of the 512 neighbourhoods of a cell, at every column, so the wrap
+ * at both edges is covered. Then next_generation() is checked against the scalar step peggy2.c used before,
+ * get_neighbours() on each cell of a second array, on random arrays with garbage above the 25 cells of each
+ * row, as fill_random_data() leaves. The changed and live cell counts must match get_difference() and
+ * get_total(). A glider must cross the torus and come back to where it started, and a blinker must blink.
+ *
+ * Then both steps are timed, with the counts, on the host.
+ */
+
+#include <assert.h>
+
+#include "life.h"
+
+#define TEST_ARRAYS			20000
+#define TEST_GENERATIONS	20000
+
+static uint32_t ulSeed = 1;
+
+static uint16_t prvRandom( void )
+{
+	ulSeed = ulSeed * 1103515245UL + 12345UL;
+	return (uint16_t)( ulSeed >> 16 );
+}
+
+static uint32_t prvRandomRow( void )
+{
+	return (uint32_t)prvRandom() << 16 | prvRandom();
+}
+
+/* The step as it was in peggy2.c, a cell at a time, into a second array. */
+static uint8_t get_cell( uint32_t from[], int8_t x, int8_t y )
+{
+	if( x < 0 ) x = 24;
+	if( x > 24 ) x = 0;
+	if( y < 0 ) y = 24;
+	if( y > 24 ) y = 0;
+	return ( ( from[ x ] & ( (uint32_t)1 << y ) ) > 0 );
+}
+
+static uint8_t get_neighbours( uint32_t from[], int8_t x, int8_t y )
+{
+	return get_cell( from, x - 1, y - 1 ) + get_cell( from, x - 1, y ) + get_cell( from, x - 1, y + 1 )
+		 + get_cell( from, x, y - 1 ) + get_cell( from, x, y + 1 )
+		 + get_cell( from, x + 1, y - 1 ) + get_cell( from, x + 1, y ) + get_cell( from, x + 1, y + 1 );
+}
+
+/* This counted in a uint8_t, which wrapped when more than 255 cells changed, as they do in a random array. */
+static uint16_t get_difference( uint32_t a[], uint32_t b[] )
+{
+	uint16_t diff = 0;
+
+	for( uint8_t x = 0; x < CELLS_X; x++ )
+		for( uint8_t y = 0; y < CELLS_Y; y++ )
+			if( get_cell( a, x, y ) != get_cell( b, x, y ) )
+				diff++;
+	return diff;
+}
+
+static uint16_t get_total( uint32_t from[] )
+{
+	uint16_t total = 0;
+
+	for( uint8_t x = 0; x < CELLS_X; x++ )
+		for( uint8_t y = 0; y < CELLS_Y; y++ )
+			if( get_cell( from, x, y ) )
+				total++;
+	return total;
+}
+
+/* The old main loop step: current = old, each cell from old's neighbours, then the counts, then old = current. */
+static uint16_t prvScalarGeneration( uint32_t old_generation[], uint16_t * total )
+{
+	uint32_t current_generation[ CELLS_X ];
+	uint16_t changes;
+	uint8_t temp;
+
+	memcpy( current_generation, old_generation, sizeof( current_generation ) );
+
+	for( uint8_t x = 0; x < CELLS_X; x++ )
+		for( uint8_t y = 0; y < CELLS_Y; y++ )
+		{
+			temp = get_neighbours( old_generation, x, y );
+			if( temp < 2 || temp > 3 )
+				current_generation[ x ] &= ~( (uint32_t)1 << y );
+			if( temp == 3 )
+				current_generation[ x ] |= (uint32_t)1 << y;
+		}
+
+	changes = get_difference( current_generation, old_generation );
+	*total = get_total( current_generation );
+	memcpy( old_generation, current_generation, sizeof( current_generation ) );
+	return changes;
+}
+
+/* Every neighbourhood, centred on every column, with garbage above the row. */
+static void prvTestRow( void )
+{
+	uint32_t ulRows[ 3 ], ulNext;
+	unsigned uxPattern, uxAlive, uxNeighbours;
+	int y, r, c;
+
+	for( y = 0; y < CELLS_Y; ++y )
+		for( uxPattern = 0; uxPattern < 512; ++uxPattern )
+		{
+			uxAlive = ( uxPattern >> 4 ) & 1;
+			uxNeighbours = __builtin_popcount( uxPattern ) - uxAlive;
+
+			for( r = 0; r < 3; ++r )
+			{
+				ulRows[ r ] = prvRandomRow() & ~CELLS_MASK;
+				for( c = 0; c < 3; ++c )
+					if( uxPattern & ( 1 << ( 3 * r + c ) ) )
+						ulRows[ r ] |= (uint32_t)1 << ( ( y + c - 1 + CELLS_Y ) % CELLS_Y );
+			}
+
+			ulNext = next_row( ulRows[ 0 ] & CELLS_MASK, ulRows[ 1 ] & CELLS_MASK, ulRows[ 2 ] & CELLS_MASK );
+			assert( !( ulNext & ~CELLS_MASK ) );
+			assert( !!( ulNext & ( (uint32_t)1 << y ) ) == ( uxNeighbours == 3 || ( uxNeighbours == 2 && uxAlive ) ) );
+		}
+}
+
+static void prvTestGenerations( void )
+{
+	uint32_t ulCells[ CELLS_X ], ulScalar[ CELLS_X ];
+	uint16_t uxChanges, uxTotal, uxScalarTotal;
+	unsigned uxArray, x, g;
+
+	for( uxArray = 0; uxArray < TEST_ARRAYS; ++uxArray )
+	{
+		for( x = 0; x < CELLS_X; ++x )
+		{
+			ulScalar[ x ] = ulCells[ x ] = prvRandomRow() & ( uxArray % 2 ? 0xFFFFFFFFUL : prvRandomRow() );
+			if( uxArray % 3 == 0 )
+				ulCells[ x ] |= ~CELLS_MASK;	// the scalar step never looks above the row.
+		}
+
+		for( g = 0; g < 4; ++g )	// a few steps on, where random arrays thin out.
+		{
+			uxChanges = next_generation( ulCells, &uxTotal );
+			assert( uxChanges == prvScalarGeneration( ulScalar, &uxScalarTotal ) && uxTotal == uxScalarTotal );
+			for( x = 0; x < CELLS_X; ++x )
+				assert( ulCells[ x ] == ( ulScalar[ x ] & CELLS_MASK ) );
+		}
+	}
+}
+
+static void prvTestPatterns( void )
+{
+	uint32_t ulCells[ CELLS_X ] = { 0 }, ulStart[ CELLS_X ];
+	uint16_t uxChanges, uxTotal;
+	unsigned g;
+
+	/* A glider moves one cell diagonally every four generations, so it is back after 4 * 25. */
+	ulCells[ 23 ] = 0x2;
+	ulCells[ 24 ] = 0x4;
+	ulCells[ 0 ] = 0x7;		// across the wrap, top to bottom.
+	memcpy( ulStart, ulCells, sizeof( ulStart ) );
+
+	for( g = 0; g < 4 * CELLS_X; ++g )
+	{
+		uxChanges = next_generation( ulCells, &uxTotal );
+		assert( uxTotal == 5 && uxChanges != 0 );
+		assert( ( g + 1 ) % ( 4 * CELLS_X ) == 0 || memcmp( ulCells, ulStart, sizeof( ulStart ) ) != 0 );
+	}
+	assert( memcmp( ulCells, ulStart, sizeof( ulStart ) ) == 0 );
+
+	/* A blinker across the side to side wrap. */
+	memset( ulCells, 0, sizeof( ulCells ) );
+	ulCells[ 12 ] = 0x1000003;
+	memcpy( ulStart, ulCells, sizeof( ulStart ) );
+
+	uxChanges = next_generation( ulCells, &uxTotal );
+	assert( uxChanges == 4 && uxTotal == 3 && ulCells[ 11 ] == 1 && ulCells[ 12 ] == 1 && ulCells[ 13 ] == 1 );
+	uxChanges = next_generation( ulCells, &uxTotal );
+	assert( uxChanges == 4 && uxTotal == 3 && memcmp( ulCells, ulStart, sizeof( ulStart ) ) == 0 );
+}
+
+static void prvBenchmark( void )
+{
+	static uint32_t ulCells[ CELLS_X ], ulScalar[ CELLS_X ];
+	volatile uint16_t uxSink;
+	uint16_t uxTotal;
+	uint64_t ullStart, ullScalar, ullRows;
+	unsigned x, g;
+
+	for( x = 0; x < CELLS_X; ++x )
+		ulScalar[ x ] = ulCells[ x ] = prvRandomRow() & CELLS_MASK;
+
+	ullStart = host_nanoseconds();
+	for( g = 0; g < TEST_GENERATIONS; ++g )
+	{
+		uxSink = prvScalarGeneration( ulScalar, &uxTotal );
+		if( uxTotal < 6 )
+			ulScalar[ 7 ] = ulScalar[ 8 ] = ulScalar[ 9 ] = prvRandomRow();	// keep it alive, as main() does.
+	}
+	ullScalar = host_nanoseconds() - ullStart;
+
+	ullStart = host_nanoseconds();
+	for( g = 0; g < TEST_GENERATIONS; ++g )
+	{
+		uxSink = next_generation( ulCells, &uxTotal );
+		if( uxTotal < 6 )
+			ulCells[ 7 ] = ulCells[ 8 ] = ulCells[ 9 ] = prvRandomRow();
+	}
+	ullRows = host_nanoseconds() - ullStart;
+	( void ) uxSink;
+
+	printf( "Life generations of the 25x25 array, with the changed and live counts, %u each on the host\n", TEST_GENERATIONS );
+	printf( "  %-36s %8.0f ns/generation\n", "get_neighbours() per cell (before)", (double)ullScalar / TEST_GENERATIONS );
+	printf( "  %-36s %8.0f ns/generation, %.0fx faster\n", "next_generation() a row at a time", (double)ullRows / TEST_GENERATIONS,
+			(double)ullScalar / (double)ullRows );
+}
+
+int main( void )
+{
+	prvTestRow();
+	prvTestGenerations();
+	prvTestPatterns();
+	prvBenchmark();
+
+	printf( "PASS\n" );
+	return 0;
+}
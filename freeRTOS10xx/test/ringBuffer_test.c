@@ -0,0 +1,260 @@
+/*
+ * Host test and benchmark for the SPSC ring buffer in include/ringBuffer.h.
+ *
+ * A producer thread and a consumer thread move a numbered byte stream through one ring, using every
+ * combination of the single byte, bulk (PokeN / PopN) and in place (GetLinearSpan / Discard) calls,
+ * with chunk sizes that straddle the wrap. The consumer checks every byte arrives once, in order.
+ * Then the same stream is timed through the SPSC ring, and through the locking ringBuffer_t that the
+ * serial driver used before, with its critical section standing in for the AVR interrupt disable.
+ */
+
+#include <pthread.h>
+#include <assert.h>
+
+#include "ringBuffer.h"
+
+#define TEST_RING_SIZE		256
+#define TEST_STREAM_BYTES	( 16UL * 1024 * 1024 )
+
+enum { MODE_BYTE, MODE_BULK, MODE_SPAN, MODES };
+
+static const char * const pcModeName[ MODES ] = { "byte", "bulk", "span" };
+
+static ringBufferSPSC_t xRing;
+static uint8_t ucRingStorage[ TEST_RING_SIZE ];
+
+static ringBuffer_t xLockedRing;
+static uint8_t ucLockedStorage[ TEST_RING_SIZE ];
+
+static int xProducerMode;
+static int xConsumerMode;
+static unsigned long ulErrors;
+
+/* Chunk sizes from a little linear congruential generator, so the runs are repeatable. */
+static uint16_t prvChunk( uint32_t * pulSeed )
+{
+	*pulSeed = *pulSeed * 1103515245UL + 12345UL;
+	return (uint16_t)( ( *pulSeed >> 16 ) % ( TEST_RING_SIZE + 37 ) ) + 1;
+}
+
+static void * prvProducer( void * pvParameters )
+{
+	uint8_t ucChunk[ TEST_RING_SIZE + 64 ];
+	uint32_t ulSeed = 1;
+	unsigned long ulSent = 0;
+	uint16_t uxLength, uxDone, i;
+
+	( void ) pvParameters;
+
+	while( ulSent < TEST_STREAM_BYTES )
+	{
+		if( xProducerMode == MODE_BYTE )
+		{
+			while( ringBufferSPSC_IsFull( &xRing ) )
+				sched_yield();
+			ringBufferSPSC_Poke( &xRing, (uint8_t)( ulSent % 251 ) );
+			++ulSent;
+			continue;
+		}
+
+		uxLength = prvChunk( &ulSeed );
+		if( uxLength > TEST_STREAM_BYTES - ulSent )
+			uxLength = TEST_STREAM_BYTES - ulSent;
+		for( i = 0; i < uxLength; ++i )
+			ucChunk[ i ] = (uint8_t)( ( ulSent + i ) % 251 );
+
+		for( uxDone = 0; uxDone < uxLength; )
+		{
+			uint16_t uxPut = ringBufferSPSC_PokeN( &xRing, ucChunk + uxDone, uxLength - uxDone );
+			if( uxPut == 0 )
+				sched_yield();
+			uxDone += uxPut;
+		}
+		ulSent += uxLength;
+	}
+	return NULL;
+}
+
+static void * prvConsumer( void * pvParameters )
+{
+	uint8_t ucChunk[ TEST_RING_SIZE + 64 ];
+	uint32_t ulSeed = 7;
+	unsigned long ulReceived = 0;
+	uint16_t uxLength, i;
+	uint8_t * pucSpan;
+
+	( void ) pvParameters;
+
+	while( ulReceived < TEST_STREAM_BYTES )
+	{
+		switch( xConsumerMode )
+		{
+		case MODE_BYTE:
+			if( ringBufferSPSC_IsEmpty( &xRing ) )
+			{
+				sched_yield();
+				continue;
+			}
+			if( ringBufferSPSC_Pop( &xRing ) != (uint8_t)( ulReceived % 251 ) )
+				++ulErrors;
+			++ulReceived;
+			break;
+
+		case MODE_BULK:
+			uxLength = ringBufferSPSC_PopN( &xRing, ucChunk, prvChunk( &ulSeed ) );
+			if( uxLength == 0 )
+				sched_yield();
+			for( i = 0; i < uxLength; ++i, ++ulReceived )
+				if( ucChunk[ i ] != (uint8_t)( ulReceived % 251 ) )
+					++ulErrors;
+			break;
+
+		case MODE_SPAN:
+			uxLength = ringBufferSPSC_GetLinearSpan( &xRing, &pucSpan );
+			if( uxLength == 0 )
+				sched_yield();
+			for( i = 0; i < uxLength; ++i, ++ulReceived )
+				if( pucSpan[ i ] != (uint8_t)( ulReceived % 251 ) )
+					++ulErrors;
+			ringBufferSPSC_Discard( &xRing, uxLength );
+			break;
+		}
+	}
+	return NULL;
+}
+
+static double prvRun( int xProducer, int xConsumer )
+{
+	pthread_t xProducerThread, xConsumerThread;
+	uint64_t ullStart;
+
+	ringBufferSPSC_InitBuffer( &xRing, ucRingStorage, sizeof( ucRingStorage ) );
+	xProducerMode = xProducer;
+	xConsumerMode = xConsumer;
+
+	ullStart = host_nanoseconds();
+	pthread_create( &xConsumerThread, NULL, prvConsumer, NULL );
+	pthread_create( &xProducerThread, NULL, prvProducer, NULL );
+	pthread_join( xProducerThread, NULL );
+	pthread_join( xConsumerThread, NULL );
+
+	assert( ringBufferSPSC_IsEmpty( &xRing ) );
+	return (double)TEST_STREAM_BYTES * 1000.0 / (double)( host_nanoseconds() - ullStart );
+}
+
+static void * prvLockedProducer( void * pvParameters )
+{
+	unsigned long ulSent;
+
+	( void ) pvParameters;
+
+	for( ulSent = 0; ulSent < TEST_STREAM_BYTES; ++ulSent )
+	{
+		while( ringBuffer_IsFull( &xLockedRing ) )
+			sched_yield();
+		ringBuffer_Poke( &xLockedRing, (uint8_t)( ulSent % 251 ) );
+	}
+	return NULL;
+}
+
+static void * prvLockedConsumer( void * pvParameters )
+{
+	unsigned long ulReceived;
+
+	( void ) pvParameters;
+
+	for( ulReceived = 0; ulReceived < TEST_STREAM_BYTES; ++ulReceived )
+	{
+		while( ringBuffer_IsEmpty( &xLockedRing ) )
+			sched_yield();
+		if( ringBuffer_Pop( &xLockedRing ) != (uint8_t)( ulReceived % 251 ) )
+			++ulErrors;
+	}
+	return NULL;
+}
+
+static double prvRunLocked( void )
+{
+	pthread_t xProducerThread, xConsumerThread;
+	uint64_t ullStart;
+
+	ringBuffer_InitBuffer( &xLockedRing, ucLockedStorage, sizeof( ucLockedStorage ) );
+
+	ullStart = host_nanoseconds();
+	pthread_create( &xConsumerThread, NULL, prvLockedConsumer, NULL );
+	pthread_create( &xProducerThread, NULL, prvLockedProducer, NULL );
+	pthread_join( xProducerThread, NULL );
+	pthread_join( xConsumerThread, NULL );
+
+	return (double)TEST_STREAM_BYTES * 1000.0 / (double)( host_nanoseconds() - ullStart );
+}
+
+static void prvTestInit( void )
+{
+	ringBufferSPSC_t xOdd;
+
+	/* A size that isn't a power of two is caught, and only the power of two below it is used. */
+	host_assert_abort = 0;
+	ringBufferSPSC_InitBuffer( &xOdd, ucRingStorage, 200 );
+	host_assert_abort = 1;
+
+	assert( host_assert_count == 1 );
+	assert( xOdd.size == 128 && xOdd.mask == 127 );
+	assert( ringBufferSPSC_GetFreeCount( &xOdd ) == 128 );
+
+	host_assert_count = 0;
+	ringBufferSPSC_InitBuffer( &xOdd, ucRingStorage, 256 );
+	assert( host_assert_count == 0 && xOdd.size == 256 );
+}
+
+static void prvTestWrap( void )
+{
+	uint8_t ucIn[ 300 ], ucOut[ 300 ];
+	uint8_t * pucSpan;
+	uint16_t i, uxStart;
+
+	for( i = 0; i < sizeof( ucIn ); ++i )
+		ucIn[ i ] = (uint8_t)i;
+
+	/* Free running indices wrap at 16 bits, as well as at the storage array. */
+	for( uxStart = 0; uxStart < 2; ++uxStart )
+	{
+		ringBufferSPSC_InitBuffer( &xRing, ucRingStorage, sizeof( ucRingStorage ) );
+		xRing.in = xRing.out = uxStart ? 0xFFF0 : 200;
+
+		assert( ringBufferSPSC_PokeN( &xRing, ucIn, sizeof( ucIn ) ) == TEST_RING_SIZE );	// clipped to the space.
+		assert( ringBufferSPSC_IsFull( &xRing ) );
+		assert( ringBufferSPSC_PokeN( &xRing, ucIn, 1 ) == 0 );
+
+		assert( ringBufferSPSC_GetLinearSpan( &xRing, &pucSpan ) == ( uxStart ? 16 : 56 ) );	// up to the end of the array.
+		assert( pucSpan[ 0 ] == 0 );
+
+		assert( ringBufferSPSC_PopN( &xRing, ucOut, sizeof( ucOut ) ) == TEST_RING_SIZE );
+		assert( memcmp( ucIn, ucOut, TEST_RING_SIZE ) == 0 );
+		assert( ringBufferSPSC_IsEmpty( &xRing ) );
+		assert( ringBufferSPSC_PopN( &xRing, ucOut, 1 ) == 0 );
+	}
+}
+
+int main( void )
+{
+	int xProducer, xConsumer;
+
+	prvTestInit();
+	prvTestWrap();
+
+	printf( "SPSC ring, %u bytes, %lu byte stream between two threads\n", TEST_RING_SIZE, TEST_STREAM_BYTES );
+	for( xProducer = MODE_BYTE; xProducer <= MODE_BULK; ++xProducer )
+		for( xConsumer = MODE_BYTE; xConsumer < MODES; ++xConsumer )
+			printf( "  producer %-4s consumer %-4s %8.1f MB/s\n", pcModeName[ xProducer ], pcModeName[ xConsumer ], prvRun( xProducer, xConsumer ) );
+
+	printf( "Locking ring, producer byte consumer byte %8.1f MB/s\n", prvRunLocked() );
+
+	if( ulErrors )
+	{
+		printf( "FAIL: %lu bytes out of order\n", ulErrors );
+		return 1;
+	}
+	printf( "PASS\n" );
+	return 0;
+}
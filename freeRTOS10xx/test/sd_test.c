@@ -0,0 +1,474 @@
+/*
+ * Host test and benchmark for the SD card write path in lib_fatf/diskio.c, built as for the ATmega328P.
+ *
+ * A model SDHC card sits on the simulated SPI bus, and answers the SPI mode protocol byte by byte: command
+ * frames with their CRC7 checked, R1 / R3 / R7 responses, data tokens with their CRC16 checked, the data
+ * response token, and busy (0x00) while it programs a block. Time is kept in AVR clock cycles, counted as
+ * the SPI bus clocks each byte takes at the loaded divider, plus the cycles the table driven crc16() takes
+ * on the AVR for each byte. The card is busy programming for a fixed time after each block, longer for
+ * a single block write (CMD24) than for a block within a pre-erased stream (ACMD23 and CMD25).
+ *
+ * Writes of one sector per call, as a data logger makes them, are timed going to sequential sectors, so
+ * they are streamed into one open CMD25, and to scattered sectors, so each is a separate CMD24 with its
+ * CRC16 prepared before the block is sent, as every single sector write was before. Multiple sector
+ * calls are timed too. The CRC16 cycles spent while the card was still busy with the previous block are
+ * the ones hidden by preparing the next CRC16 during the card programming time.
+ *
+ * Every sector written is checked on the card, and read back through disk_read().
+ */
+
+#include <assert.h>
+
+#include <avr/io.h>
+
+#include "spi.h"
+#include "diskio.h"
+#include "lib_util.h"
+
+#define TEST_CPU_HZ				16000000ULL
+#define TEST_CRC16_CYCLES		20				// AVR cycles per byte for the crc16() table lookup.
+
+#define SD_SECTORS				4096
+#define SD_STREAM_BUSY_US		250				// programming a block, within a pre-erased CMD25 stream.
+#define SD_SINGLE_BUSY_US		1000			// programming a block, for a CMD24 single block write.
+#define SD_STOP_BUSY_US			500				// closing a CMD25 stream, after the STOP_TRAN token.
+#define SD_READ_ACCESS_BYTES	16				// 0xFF bytes before each read data token.
+
+#define TEST_RUN_SECTORS		1024
+
+#define US_TO_CYCLES( us )		( (uint64_t)( us ) * TEST_CPU_HZ / 1000000ULL )
+
+enum { WRITE_NONE, WRITE_SINGLE, WRITE_MULTIPLE };
+
+typedef struct
+{
+	uint8_t frame[ 6 ];			// the command frame, as it arrives.
+	uint8_t frameLength;
+
+	uint8_t out[ 600 ];			// the bytes queued for MISO.
+	uint16_t outHead;
+	uint16_t outTail;
+
+	uint8_t idle;				// in the idle state, until ACMD41 completes initialisation.
+	uint8_t appCmd;				// CMD55 seen, so the next command is an ACMD.
+	uint8_t crcOn;				// CMD59 set CRC checking on.
+	uint8_t initTries;
+
+	uint8_t writeMode;			// WRITE_NONE, or the block write command in progress.
+	uint8_t receiving;			// receiving a data block, after its token.
+	uint16_t received;
+	uint8_t block[ 514 ];		// the data block, and its CRC16.
+	uint32_t sector;			// the next sector to write, or to read for CMD18.
+	uint8_t reading;			// CMD18 READ_MULTIPLE is sending blocks.
+
+	uint64_t busyUntil;			// the cycle the card stops programming.
+
+	unsigned long commands;
+	unsigned long singleWrites;
+	unsigned long streams;
+	unsigned long blocks;
+	unsigned long errors;		// bad CRCs, and anything the card would not expect.
+} xSdCard;
+
+static xSdCard xCard;
+static uint8_t ucCard[ SD_SECTORS ][ 512 ];
+static uint8_t ucExpect[ SD_SECTORS ][ 512 ];
+
+static const uint8_t ucDivider[ 8 ] = { 4, 16, 64, 128, 2, 8, 32, 64 };
+
+static uint64_t ullCycles;			// AVR clock cycles, since the start.
+static uint64_t ullCrcCycles;		// of them, spent in crc16().
+static uint64_t ullCrcHidden;		// of them, spent while the card was busy programming.
+
+/* Reference CRCs, bit by bit, for the card to check against. */
+static uint8_t prvCrc7( const uint8_t * pucData, uint16_t uxLength )
+{
+	uint8_t ucCrc = 0, b;
+
+	while( uxLength-- )
+	{
+		uint8_t ucByte = *pucData++;
+		for( b = 0; b < 8; ++b, ucByte <<= 1 )
+		{
+			ucCrc <<= 1;
+			if( ( ucByte ^ ucCrc ) & 0x80 )
+				ucCrc ^= 0x09;
+		}
+	}
+	return ucCrc & 0x7F;
+}
+
+static uint16_t prvCrc16( const uint8_t * pucData, uint16_t uxLength )
+{
+	uint16_t uxCrc = 0;
+	uint8_t b;
+
+	while( uxLength-- )
+	{
+		uxCrc ^= (uint16_t)*pucData++ << 8;
+		for( b = 0; b < 8; ++b )
+			uxCrc = ( uxCrc & 0x8000 ) ? ( uxCrc << 1 ) ^ 0x1021 : uxCrc << 1;
+	}
+	return uxCrc;
+}
+
+/* crc16() as the driver calls it, costed in AVR cycles. */
+uint16_t __real_crc16( const uint8_t * data, uint16_t number_of_bytes_in_data, uint16_t init );
+
+uint16_t __wrap_crc16( const uint8_t * data, uint16_t number_of_bytes_in_data, uint16_t init )
+{
+	uint64_t ullCost = (uint64_t)TEST_CRC16_CYCLES * number_of_bytes_in_data;
+
+	if( xCard.busyUntil > ullCycles )
+		ullCrcHidden += ( xCard.busyUntil - ullCycles < ullCost ) ? xCard.busyUntil - ullCycles : ullCost;
+	ullCrcCycles += ullCost;
+	ullCycles += ullCost;
+
+	return __real_crc16( data, number_of_bytes_in_data, init );
+}
+
+static void prvQueue( uint8_t ucByte )
+{
+	if( xCard.outTail < sizeof( xCard.out ) )
+		xCard.out[ xCard.outTail++ ] = ucByte;
+	else
+		++xCard.errors;
+}
+
+static void prvQueueBlock( uint32_t ulSector )
+{
+	uint16_t uxCrc, i;
+
+	if( ulSector >= SD_SECTORS )
+	{
+		prvQueue( 0x08 );		// out of range error token.
+		return;
+	}
+
+	for( i = 0; i < SD_READ_ACCESS_BYTES; ++i )
+		prvQueue( 0xFF );
+	prvQueue( 0xFE );
+	for( i = 0; i < 512; ++i )
+		prvQueue( ucCard[ ulSector ][ i ] );
+	uxCrc = prvCrc16( ucCard[ ulSector ], 512 );
+	prvQueue( (uint8_t)( uxCrc >> 8 ) );
+	prvQueue( (uint8_t)uxCrc );
+}
+
+/* The next byte on MISO: queued responses, then read data, then busy or idle. */
+static uint8_t prvOut( void )
+{
+	if( xCard.outHead == xCard.outTail && xCard.reading )
+	{
+		xCard.outHead = xCard.outTail = 0;
+		prvQueueBlock( xCard.sector++ );
+	}
+
+	if( xCard.outHead < xCard.outTail )
+	{
+		uint8_t ucByte = xCard.out[ xCard.outHead++ ];
+		if( xCard.outHead == xCard.outTail )
+			xCard.outHead = xCard.outTail = 0;
+		return ucByte;
+	}
+
+	return ullCycles < xCard.busyUntil ? 0x00 : 0xFF;
+}
+
+static void prvCommand( void )
+{
+	uint8_t ucCmd = xCard.frame[ 0 ] & 0x3F;
+	uint32_t ulArg = (uint32_t)xCard.frame[ 1 ] << 24 | (uint32_t)xCard.frame[ 2 ] << 16 | (uint32_t)xCard.frame[ 3 ] << 8 | xCard.frame[ 4 ];
+	uint8_t ucAppCmd = xCard.appCmd;
+
+	++xCard.commands;
+	xCard.appCmd = 0;
+	xCard.outHead = xCard.outTail = 0;
+	prvQueue( 0xFF );		// one byte, before the response.
+
+	if( ( xCard.crcOn || ucCmd == 0 || ucCmd == 8 ) && xCard.frame[ 5 ] != ( ( prvCrc7( xCard.frame, 5 ) << 1 ) | 0x01 ) )
+	{
+		++xCard.errors;
+		prvQueue( 0x08 | xCard.idle );
+		return;
+	}
+
+	if( ullCycles < xCard.busyUntil && ucCmd != 0 )
+		++xCard.errors;		// the driver must wait for the card to be ready.
+
+	if( xCard.writeMode == WRITE_MULTIPLE && ucCmd != 12 )
+		++xCard.errors;		// only the STOP_TRAN token, or CMD12, should end the stream.
+
+	if( ucAppCmd && ucCmd == 41 )
+	{
+		if( ++xCard.initTries >= 2 )
+			xCard.idle = 0;
+		prvQueue( xCard.idle );
+		return;
+	}
+
+	if( ucAppCmd && ucCmd == 23 )
+	{
+		prvQueue( 0x00 );	// the pre-erase count is only a hint, and the model doesn't need it.
+		return;
+	}
+
+	switch( ucCmd )
+	{
+	case 0:
+		memset( &xCard, 0, offsetof( xSdCard, commands ) );
+		xCard.idle = 1;
+		prvQueue( 0xFF );
+		prvQueue( 0x01 );
+		break;
+
+	case 55:
+		xCard.appCmd = 1;
+		prvQueue( xCard.idle );
+		break;
+
+	case 59:
+		xCard.crcOn = ulArg & 0x01;
+		prvQueue( xCard.idle );
+		break;
+
+	case 8:
+		prvQueue( xCard.idle );
+		prvQueue( 0x00 );
+		prvQueue( 0x00 );
+		prvQueue( 0x01 );
+		prvQueue( (uint8_t)ulArg );
+		break;
+
+	case 58:
+		prvQueue( xCard.idle );
+		prvQueue( 0xC0 );	// powered up, and CCS set for SDHC block addressing.
+		prvQueue( 0xFF );
+		prvQueue( 0x80 );
+		prvQueue( 0x00 );
+		break;
+
+	case 16:
+		prvQueue( ulArg == 512 ? 0x00 : 0x40 );
+		break;
+
+	case 17:
+		prvQueue( 0x00 );
+		prvQueueBlock( ulArg );
+		break;
+
+	case 18:
+		prvQueue( 0x00 );
+		xCard.reading = 1;
+		xCard.sector = ulArg;
+		break;
+
+	case 12:
+		xCard.reading = 0;
+		xCard.writeMode = WRITE_NONE;
+		prvQueue( 0x00 );
+		xCard.busyUntil = ullCycles + US_TO_CYCLES( 10 );
+		break;
+
+	case 24:
+		prvQueue( 0x00 );
+		xCard.writeMode = WRITE_SINGLE;
+		xCard.sector = ulArg;
+		++xCard.singleWrites;
+		break;
+
+	case 25:
+		prvQueue( 0x00 );
+		xCard.writeMode = WRITE_MULTIPLE;
+		xCard.sector = ulArg;
+		++xCard.streams;
+		break;
+
+	default:
+		prvQueue( 0x04 | xCard.idle );	// illegal command.
+		break;
+	}
+}
+
+static void prvBlockReceived( void )
+{
+	xCard.receiving = 0;
+
+	if( ( xCard.crcOn && prvCrc16( xCard.block, 512 ) != ( (uint16_t)xCard.block[ 512 ] << 8 | xCard.block[ 513 ] ) )
+	 || xCard.sector >= SD_SECTORS )
+	{
+		++xCard.errors;
+		prvQueue( 0xEB );	// data rejected, CRC error.
+		xCard.writeMode = WRITE_NONE;
+		return;
+	}
+
+	memcpy( ucCard[ xCard.sector++ ], xCard.block, 512 );
+	++xCard.blocks;
+	prvQueue( 0xE5 );		// data accepted.
+
+	if( xCard.writeMode == WRITE_SINGLE )
+	{
+		xCard.writeMode = WRITE_NONE;
+		xCard.busyUntil = ullCycles + US_TO_CYCLES( SD_SINGLE_BUSY_US );
+	}
+	else
+		xCard.busyUntil = ullCycles + US_TO_CYCLES( SD_STREAM_BUSY_US );
+}
+
+static uint8_t prvCard( uint8_t ucSent )
+{
+	ullCycles += 8 * ucDivider[ ( SPCR & SPI_CLOCK_MASK ) | ( ( SPSR & SPI_2XCLOCK_MASK ) << 2 ) ];
+
+	if( PORTD & SPI_BIT_SS_SD )
+		return 0xFF;		// not selected, so the card ignores the clocks.
+
+	if( xCard.receiving )
+	{
+		xCard.block[ xCard.received++ ] = ucSent;
+		if( xCard.received == sizeof( xCard.block ) )
+			prvBlockReceived();
+		return 0xFF;
+	}
+
+	if( xCard.frameLength )
+	{
+		xCard.frame[ xCard.frameLength++ ] = ucSent;
+		if( xCard.frameLength == sizeof( xCard.frame ) )
+		{
+			xCard.frameLength = 0;
+			prvCommand();
+		}
+		return prvOut();
+	}
+
+	if( ( ucSent & 0xC0 ) == 0x40 )
+	{
+		xCard.frame[ 0 ] = ucSent;
+		xCard.frameLength = 1;
+		return prvOut();
+	}
+
+	if( ucSent != 0xFF )
+	{
+		if( ullCycles < xCard.busyUntil )
+			++xCard.errors;		// a token sent while the card is busy.
+
+		if( ( xCard.writeMode == WRITE_SINGLE && ucSent == 0xFE ) || ( xCard.writeMode == WRITE_MULTIPLE && ucSent == 0xFC ) )
+		{
+			xCard.receiving = 1;
+			xCard.received = 0;
+			return 0xFF;
+		}
+		if( xCard.writeMode == WRITE_MULTIPLE && ucSent == 0xFD )
+		{
+			xCard.writeMode = WRITE_NONE;
+			prvQueue( 0xFF );
+			xCard.busyUntil = ullCycles + US_TO_CYCLES( SD_STOP_BUSY_US );
+			return 0xFF;
+		}
+		++xCard.errors;
+	}
+
+	return prvOut();
+}
+
+static void prvFill( uint8_t * pucBlock, uint32_t ulSector, unsigned uxRun )
+{
+	uint16_t i;
+
+	for( i = 0; i < 512; ++i )
+		pucBlock[ i ] = (uint8_t)( ulSector * 31 + i * 7 + uxRun * 101 + ( i >> 8 ) );
+}
+
+/* Write TEST_RUN_SECTORS, uxCount sectors per call, sequentially or scattered over the card. */
+static void prvRun( const char * pcName, unsigned uxRun, uint8_t uxCount, int xScattered )
+{
+	static uint8_t ucBuffer[ 255 * 512 ];
+	unsigned long ulSingle = xCard.singleWrites, ulStreams = xCard.streams, ulCommands = xCard.commands;
+	uint64_t ullStart, ullCrc = ullCrcCycles, ullHidden = ullCrcHidden;
+	uint32_t ulSector, ulBase = uxRun * 512;
+	unsigned uxCall, i;
+	double dSeconds;
+
+	ullStart = ullCycles;
+
+	for( uxCall = 0; uxCall < TEST_RUN_SECTORS / uxCount; ++uxCall )
+	{
+		ulSector = xScattered ? ( ulBase + uxCall * 977UL * uxCount ) % ( SD_SECTORS - uxCount ) : ( ulBase + uxCall * uxCount ) % SD_SECTORS;
+
+		for( i = 0; i < uxCount; ++i )
+		{
+			prvFill( ucBuffer + i * 512, ulSector + i, uxRun );
+			memcpy( ucExpect[ ulSector + i ], ucBuffer + i * 512, 512 );
+		}
+		if( disk_write( 0, ucBuffer, ulSector, uxCount ) != RES_OK )
+			++xCard.errors;
+	}
+	if( disk_ioctl( 0, CTRL_SYNC, NULL ) != RES_OK )
+		++xCard.errors;
+
+	dSeconds = (double)( ullCycles - ullStart ) / TEST_CPU_HZ;
+	printf( "  %-30s %6.1f KB/s %6.0f us/sector  CMD24 %4lu  CMD25 %4lu  %5.2f commands/sector  crc16 %4.1f%% of the time, %5.1f%% hidden\n",
+			pcName, TEST_RUN_SECTORS * 0.5 / dSeconds, dSeconds * 1e6 / TEST_RUN_SECTORS,
+			xCard.singleWrites - ulSingle, xCard.streams - ulStreams,
+			(double)( xCard.commands - ulCommands ) / TEST_RUN_SECTORS,
+			100.0 * (double)( ullCrcCycles - ullCrc ) / (double)( ullCycles - ullStart ),
+			ullCrcCycles == ullCrc ? 0.0 : 100.0 * (double)( ullCrcHidden - ullHidden ) / (double)( ullCrcCycles - ullCrc ) );
+}
+
+/* Everything written is on the card, and reads back the same, through multiple and single block reads. */
+static void prvVerify( void )
+{
+	static uint8_t ucBuffer[ 8 * 512 ];
+	uint32_t ulSector;
+
+	assert( memcmp( ucCard, ucExpect, sizeof( ucCard ) ) == 0 );
+
+	for( ulSector = 0; ulSector < SD_SECTORS; ulSector += 8 )
+	{
+		assert( disk_read( 0, ucBuffer, ulSector, 8 ) == RES_OK );
+		assert( memcmp( ucBuffer, ucExpect[ ulSector ], sizeof( ucBuffer ) ) == 0 );
+	}
+	for( ulSector = 3; ulSector < SD_SECTORS; ulSector += 509 )
+	{
+		assert( disk_read( 0, ucBuffer, ulSector, 1 ) == RES_OK );
+		assert( memcmp( ucBuffer, ucExpect[ ulSector ], 512 ) == 0 );
+	}
+
+	/* A write after the reads continues correctly, and the reads closed any open stream. */
+	prvFill( ucBuffer, 100, 99 );
+	memcpy( ucExpect[ 100 ], ucBuffer, 512 );
+	assert( disk_write( 0, ucBuffer, 100, 1 ) == RES_OK );
+	assert( disk_read( 0, ucBuffer + 512, 100, 1 ) == RES_OK );
+	assert( memcmp( ucBuffer + 512, ucExpect[ 100 ], 512 ) == 0 );
+}
+
+int main( void )
+{
+	uint8_t ucType;
+
+	host_spi_device = prvCard;
+
+	assert( disk_initialize( 0 ) == 0 );
+	assert( disk_ioctl( 0, MMC_GET_TYPE, &ucType ) == RES_OK && ucType == ( CT_SD2 | CT_BLOCK ) );
+	assert( xCard.crcOn == SD_DATA_CRC && !xCard.idle );
+
+	printf( "SD card model at SPI_CLOCK_DIV%u, %llu MHz, %u us to program a block in a stream, %u us for CMD24, %u sectors each run\n",
+			ucDivider[ SD_SPI_DIVIDER ], TEST_CPU_HZ / 1000000, SD_STREAM_BUSY_US, SD_SINGLE_BUSY_US, TEST_RUN_SECTORS );
+
+	prvRun( "sequential, 1 sector a call", 0, 1, 0 );
+	prvRun( "scattered, 1 sector a call", 1, 1, 1 );
+	prvRun( "sequential, 8 sectors a call", 2, 8, 0 );
+	prvRun( "scattered, 8 sectors a call", 3, 8, 1 );
+
+	prvVerify();
+
+	if( xCard.errors )
+	{
+		printf( "FAIL: %lu blocks, tokens or commands the card rejected\n", xCard.errors );
+		return 1;
+	}
+	printf( "PASS\n" );
+	return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * Host test and benchmark for the transmit side of lib_io/serial.c, built as for the ATmega328P.
+ *
+ * A thread plays the USART0 hardware at 115200 baud 8N2, calling the UDRE ISR once per character time
+ * while UDRIE0 is set, with the critical section held as the AVR would have interrupts disabled.
+ * Two tasks print through xSerialPrintf(), and a third lends its own blocks with xSerialWrite(), as the
+ * trace stream task does, so the work buffer and the lent block are both contended.
+ *
+ * The same load runs through the previous claim, which tested the flags and then yielded until they
+ * cleared, and through the current one, which claims in one critical section and sleeps until the ISR
+ * releases the block. Every line must arrive whole and in order. The line rate is the same for both, so
+ * the difference is the CPU time the waiting tasks take, which on the AVR is taken from the idle task.
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <time.h>
+#include <assert.h>
+
+#include <avr/io.h>
+
+#include "serial.h"
+
+extern void USART_UDRE_vect( void );
+
+#define TEST_BAUD			115200UL
+#define TEST_CHAR_NS		( 11UL * 1000000000UL / TEST_BAUD )	// start bit, 8 data bits, 2 stop bits.
+#define TEST_WRITERS		3
+#define TEST_LINES			60
+#define TEST_LINE_LENGTH	50
+
+enum { CLAIM_YIELD, CLAIM_SLEEP, CLAIMS };
+
+static const char * const pcClaimName[ CLAIMS ] = { "test and yield (before)", "claim and sleep (after)" };
+
+static int xClaim;
+static volatile int xUartRunning;
+
+static uint8_t ucWire[ TEST_WRITERS * TEST_LINES * TEST_LINE_LENGTH + 256 ];
+static volatile size_t uxWireLength;
+
+/* The USART0 transmitter. Each character time, if the UDRE interrupt is enabled, run the ISR. */
+static void * prvUart( void * pvParameters )
+{
+	struct timespec xNext;
+	uint64_t ullNext;
+
+	( void ) pvParameters;
+
+	clock_gettime( CLOCK_MONOTONIC, &xNext );
+	ullNext = (uint64_t)xNext.tv_sec * 1000000000ULL + xNext.tv_nsec;
+
+	while( xUartRunning )
+	{
+		ullNext += TEST_CHAR_NS;
+		xNext.tv_sec = ullNext / 1000000000ULL;
+		xNext.tv_nsec = ullNext % 1000000000ULL;
+		clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &xNext, NULL );
+
+		portENTER_CRITICAL();
+		if( UCSR0B & _BV(UDRIE0) )
+		{
+			UDR0 = 0x100;
+			USART_UDRE_vect();
+			if( UDR0 < 0x100 && uxWireLength < sizeof( ucWire ) )
+				ucWire[ uxWireLength++ ] = (uint8_t)UDR0;
+		}
+		portEXIT_CRITICAL();
+	}
+	return NULL;
+}
+
+/* The claim as it was: test the flag, yield until it is clear, then set it, with no critical section between. */
+static void prvYieldWorkBufferRelease( void * pvContext )
+{
+	((xComPortHandlePtr)pvContext)->serialWorkBufferInUse = VACANT;
+}
+
+static void prvYieldWrite( const xComPortHandlePtr pxPort, const uint8_t * pxBuffer, const uint16_t uxLength, void (*vComplete)(void * pvContext), void * pvContext )
+{
+	while( pxPort->xTxBlock.data != NULL ) taskYIELD();
+
+	portENTER_CRITICAL();
+	{
+		pxPort->xTxBlock.length = uxLength;
+		pxPort->xTxBlock.mark = pxPort->xCharsForTx.in;
+		pxPort->xTxBlock.complete = vComplete;
+		pxPort->xTxBlock.context = pvContext;
+		pxPort->xTxBlock.data = pxBuffer;
+	}
+	portEXIT_CRITICAL();
+
+	UCSR0B |= _BV(UDRIE0);
+}
+
+static void prvYieldPrintf( const char * format, ... )
+{
+	va_list arg;
+
+	va_start( arg, format );
+
+	while( xSerialPort.serialWorkBufferInUse == ENGAGED ) taskYIELD();
+	xSerialPort.serialWorkBufferInUse = ENGAGED;
+
+	vsnprintf( (char *)( xSerialPort.serialWorkBuffer ), xSerialPort.serialWorkBufferSize, format, arg );
+	prvYieldWrite( &xSerialPort, xSerialPort.serialWorkBuffer, strlen( (char *)( xSerialPort.serialWorkBuffer ) ), prvYieldWorkBufferRelease, &xSerialPort );
+
+	va_end( arg );
+}
+
+/* Each line is the writer letter, the line number, and filler, to a fixed length. */
+static void prvFormatLine( char * pcLine, int xWriter, unsigned uxLine )
+{
+	int i;
+
+	sprintf( pcLine, "%c%05u:", 'A' + xWriter, uxLine );
+	for( i = strlen( pcLine ); i < TEST_LINE_LENGTH - 2; ++i )
+		pcLine[ i ] = 'a' + ( i + uxLine ) % 26;
+	pcLine[ i++ ] = '\r';
+	pcLine[ i++ ] = '\n';
+	pcLine[ i ] = '\0';
+}
+
+static void prvWriteComplete( void * pvContext )
+{
+	vTaskNotifyGiveFromISR( (TaskHandle_t)pvContext, NULL );
+}
+
+static uint64_t ullWriterCpu[ TEST_WRITERS ];
+
+static void * prvWriter( void * pvParameters )
+{
+	int xWriter = (int)(intptr_t)pvParameters;
+	char cLine[ TEST_LINE_LENGTH + 1 ];
+	char cFiller[ TEST_LINE_LENGTH + 1 ];
+	struct timespec xCpu;
+	unsigned uxLine;
+
+	for( uxLine = 0; uxLine < TEST_LINES; ++uxLine )
+	{
+		prvFormatLine( cLine, xWriter, uxLine );
+
+		if( xWriter == TEST_WRITERS - 1 )
+		{
+			/* Lend the line itself, and wait for it to be sent before changing it, as the trace stream task does. */
+			if( xClaim == CLAIM_YIELD )
+				prvYieldWrite( &xSerialPort, (uint8_t *)cLine, TEST_LINE_LENGTH, prvWriteComplete, xTaskGetCurrentTaskHandle() );
+			else
+				xSerialWrite( &xSerialPort, (uint8_t *)cLine, TEST_LINE_LENGTH, prvWriteComplete, xTaskGetCurrentTaskHandle() );
+			ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+		}
+		else
+		{
+			strcpy( cFiller, cLine + 7 );
+			if( xClaim == CLAIM_YIELD )
+				prvYieldPrintf( "%c%05u:%s", 'A' + xWriter, uxLine, cFiller );
+			else
+				xSerialPrintf( "%c%05u:%s", 'A' + xWriter, uxLine, cFiller );
+		}
+	}
+
+	clock_gettime( CLOCK_THREAD_CPUTIME_ID, &xCpu );
+	ullWriterCpu[ xWriter ] = (uint64_t)xCpu.tv_sec * 1000000000ULL + xCpu.tv_nsec;
+	return NULL;
+}
+
+/* Every line must arrive whole, and each writer's lines in order. Return the number that don't. */
+static unsigned prvCheckWire( void )
+{
+	char cLine[ TEST_LINE_LENGTH + 1 ];
+	unsigned uxNext[ TEST_WRITERS ] = { 0 };
+	unsigned uxGood = 0;
+	size_t uxAt;
+	int xWriter;
+
+	for( uxAt = 0; uxAt + TEST_LINE_LENGTH <= uxWireLength; uxAt += TEST_LINE_LENGTH )
+	{
+		xWriter = ucWire[ uxAt ] - 'A';
+		if( xWriter < 0 || xWriter >= TEST_WRITERS )
+			continue;
+
+		prvFormatLine( cLine, xWriter, uxNext[ xWriter ] );
+		if( memcmp( cLine, ucWire + uxAt, TEST_LINE_LENGTH ) == 0 )
+		{
+			++uxNext[ xWriter ];
+			++uxGood;
+		}
+	}
+
+	return TEST_WRITERS * TEST_LINES - uxGood;
+}
+
+static unsigned prvRun( int xClaimUsed )
+{
+	pthread_t xUartThread, xWriterThread[ TEST_WRITERS ];
+	uint64_t ullStart, ullWall, ullCpu = 0;
+	unsigned uxBad;
+	int i;
+
+	xClaim = xClaimUsed;
+	uxWireLength = 0;
+	xSerialTxFlush( &xSerialPort );
+
+	xUartRunning = 1;
+	pthread_create( &xUartThread, NULL, prvUart, NULL );
+
+	ullStart = host_nanoseconds();
+	for( i = 0; i < TEST_WRITERS; ++i )
+		pthread_create( &xWriterThread[ i ], NULL, prvWriter, (void *)(intptr_t)i );
+	for( i = 0; i < TEST_WRITERS; ++i )
+		pthread_join( xWriterThread[ i ], NULL );
+
+	while( uxWireLength < sizeof( ucWire ) - 256 && ( xSerialPort.xTxBlock.data != NULL || ( UCSR0B & _BV(UDRIE0) ) ) )
+		sched_yield();
+	ullWall = host_nanoseconds() - ullStart;
+
+	xUartRunning = 0;
+	pthread_join( xUartThread, NULL );
+
+	for( i = 0; i < TEST_WRITERS; ++i )
+		ullCpu += ullWriterCpu[ i ];
+
+	uxBad = prvCheckWire();
+	printf( "  %-24s %7.0f bytes/s  tasks %6.1f%% of the CPU, idle %5.1f%%, %u lines bad\n",
+			pcClaimName[ xClaimUsed ],
+			(double)uxWireLength * 1e9 / (double)ullWall,
+			100.0 * (double)ullCpu / (double)ullWall,
+			ullCpu >= ullWall ? 0.0 : 100.0 - 100.0 * (double)ullCpu / (double)ullWall,
+			uxBad );
+
+	return uxBad;
+}
+
+int main( void )
+{
+	unsigned uxBad;
+
+	xSerialPort = xSerialPortInitMinimal( USART0, TEST_BAUD, 256, 16 );
+	assert( xSerialPort.serialWorkBuffer != NULL );
+
+	printf( "Serial Tx at %lu baud, %u tasks each sending %u lines of %u bytes\n", TEST_BAUD, TEST_WRITERS, TEST_LINES, TEST_LINE_LENGTH );
+	prvRun( CLAIM_YIELD );
+	uxBad = prvRun( CLAIM_SLEEP );
+
+	assert( xSerialPort.xTxWaitingTask == NULL );
+
+	if( uxBad )
+	{
+		printf( "FAIL: %u lines lost or out of order\n", uxBad );
+		return 1;
+	}
+	printf( "PASS\n" );
+	return 0;
+}
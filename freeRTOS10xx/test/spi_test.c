@@ -0,0 +1,392 @@
+/*
+ * Host test for lib_io/spi.c, against the simulated SPI peripheral in host/host.c.
+ *
+ * Three devices, the Wiznet, the SD card and the Gameduino2, each hang off their own slave select line,
+ * and are registered with different data modes, clock dividers and bit orders. Every byte on the bus is
+ * checked to have exactly one device selected, with that device's registered settings loaded, and each
+ * device replies with a byte that depends on its position and on the byte sent before it, so the pipelined
+ * spiMultiByte functions can be checked for getting every reply into the right place.
+ *
+ * A chain of transactions through spiTransact() is checked the same way, byte for byte, at a clock divider
+ * the SPI STC interrupt advances the bytes at, and at one that is polled, and must give the same stream.
+ *
+ * Then one task for each device contends for the bus, the SD card through the interrupt driven transactions,
+ * and the test checks each task is served, and counts the bus clocks each device used, as a measure of the
+ * share of the bus each task gets.
+ */
+
+#include <pthread.h>
+#include <assert.h>
+
+#include <avr/io.h>
+
+#include "spi.h"
+
+#define TEST_DEVICES		3
+#define TEST_ROUNDS			400
+#define TEST_BLOCK			512
+
+typedef struct
+{
+	SPI_SLAVE_SELECT ss;
+	const char * name;
+	SPI_MODE_t mode;
+	SPI_CLOCK_DIV_t rate;
+	uint8_t bitOrder;
+	uint8_t key;				// mixed into every reply, so each device replies differently.
+	uint8_t transact;			// the contention task uses spiTransact(), rather than selecting the device.
+
+	uint8_t previous;			// the last byte the device received.
+	uint16_t position;			// the byte count since the device was reset.
+	unsigned long bytes;		// bytes transferred.
+	unsigned long long clocks;	// bus clocks used, at the clock divider loaded.
+	uint8_t sent[ TEST_BLOCK ];	// the first bytes received, since the device was reset.
+} xTestDevice;
+
+static xTestDevice xDevice[ TEST_DEVICES ] =
+{
+	{ Wiznet,		"Wiznet",		SPI_MODE0, SPI_CLOCK_DIV2, SPI_MSBFIRST, 0x5A },
+	{ SDCard,		"SDCard",		SPI_MODE0, SPI_CLOCK_DIV32, SPI_MSBFIRST, 0xC3, 1 },
+	{ Gameduino2,	"Gameduino2",	SPI_MODE3, SPI_CLOCK_DIV8, SPI_LSBFIRST, 0x96 },
+};
+
+static const uint8_t ucDivider[ 8 ] = { 4, 16, 64, 128, 2, 8, 32, 64 };
+
+static unsigned long ulErrors;
+static volatile unsigned long ulInterrupts;		// bytes advanced by the SPI STC ISR.
+
+void SPI_STC_vect( void );
+
+static void prvInterrupt( void )
+{
+	++ulInterrupts;
+	SPI_STC_vect();
+}
+
+/* Which device is selected. Wiznet uses the default SS line on the Uno. */
+static int prvSelected( void )
+{
+	int xSelected = -1, xCount = 0;
+
+	if( !( PORTB & SPI_BIT_SS_WIZNET ) ) { xSelected = 0; ++xCount; }
+	if( !( PORTD & SPI_BIT_SS_SD ) )     { xSelected = 1; ++xCount; }
+	if( !( PORTB & SPI_BIT_SS_G2 ) )     { xSelected = 2; ++xCount; }
+
+	return xCount == 1 ? xSelected : -1;
+}
+
+static uint8_t prvReply( const xTestDevice * pxDevice, uint16_t uxPosition, uint8_t ucPrevious )
+{
+	return (uint8_t)( pxDevice->key ^ ( uxPosition * 7 ) ^ ucPrevious );
+}
+
+static uint8_t prvDevice( uint8_t ucSent )
+{
+	xTestDevice * pxDevice;
+	uint8_t ucReply;
+	int xSelected = prvSelected();
+
+	if( xSelected < 0 )
+	{
+		++ulErrors;		// no device, or more than one, selected.
+		return 0xFF;
+	}
+	pxDevice = &xDevice[ xSelected ];
+
+	if( ( SPCR & SPI_MODE_MASK ) != pxDevice->mode
+	 || ( ( SPCR & SPI_CLOCK_MASK ) | ( ( SPSR & SPI_2XCLOCK_MASK ) << 2 ) ) != pxDevice->rate
+	 || !( SPCR & _BV(DORD) ) != ( pxDevice->bitOrder == SPI_MSBFIRST ) )
+		++ulErrors;		// the bus is not set up for this device.
+
+	ucReply = prvReply( pxDevice, pxDevice->position, pxDevice->previous );
+	if( pxDevice->position < TEST_BLOCK )
+		pxDevice->sent[ pxDevice->position ] = ucSent;
+	++pxDevice->position;
+	pxDevice->previous = ucSent;
+
+	++pxDevice->bytes;
+	pxDevice->clocks += 8 * ucDivider[ ( SPCR & SPI_CLOCK_MASK ) | ( ( SPSR & SPI_2XCLOCK_MASK ) << 2 ) ];
+
+	return ucReply;
+}
+
+static void prvReset( xTestDevice * pxDevice )
+{
+	pxDevice->previous = 0;
+	pxDevice->position = 0;
+}
+
+/* The pipelined functions, on each device in turn, so the settings change between them. */
+static void prvTestTransfers( void )
+{
+	uint8_t ucBlock[ TEST_BLOCK ], ucData[ TEST_BLOCK ];
+	uint8_t ucPrevious;
+	uint16_t i;
+	int d;
+
+	for( i = 0; i < TEST_BLOCK; ++i )
+		ucBlock[ i ] = (uint8_t)( i * 13 + 1 );
+
+	for( d = 0; d < TEST_DEVICES; ++d )
+	{
+		xTestDevice * pxDevice = &xDevice[ d ];
+
+		/* Tx: the device gets the whole block. */
+		assert( spiSelect( pxDevice->ss ) );
+		prvReset( pxDevice );
+		assert( spiMultiByteTx( ucBlock, TEST_BLOCK ) );
+		spiDeselect( pxDevice->ss );
+		assert( pxDevice->position == TEST_BLOCK && memcmp( pxDevice->sent, ucBlock, TEST_BLOCK ) == 0 );
+
+		assert( spiSelect( pxDevice->ss ) );
+		prvReset( pxDevice );
+		assert( spiMultiByteTx_P( ucBlock, TEST_BLOCK ) );
+		spiDeselect( pxDevice->ss );
+		assert( pxDevice->position == TEST_BLOCK && memcmp( pxDevice->sent, ucBlock, TEST_BLOCK ) == 0 );
+
+		/* Rx: 0xFF is sent for every byte, and every reply is stored in place. */
+		assert( spiSelect( pxDevice->ss ) );
+		prvReset( pxDevice );
+		assert( spiMultiByteRx( ucData, TEST_BLOCK ) );
+		spiDeselect( pxDevice->ss );
+		assert( pxDevice->position == TEST_BLOCK );
+		for( i = 0; i < TEST_BLOCK; ++i )
+			assert( pxDevice->sent[ i ] == 0xFF && ucData[ i ] == prvReply( pxDevice, i, i ? 0xFF : 0 ) );
+
+		/* Transfer: the block is sent, and replaced in place by the replies. */
+		memcpy( ucData, ucBlock, TEST_BLOCK );
+		assert( spiSelect( pxDevice->ss ) );
+		prvReset( pxDevice );
+		assert( spiMultiByteTransfer( ucData, TEST_BLOCK ) );
+		spiDeselect( pxDevice->ss );
+		assert( memcmp( pxDevice->sent, ucBlock, TEST_BLOCK ) == 0 );
+		for( i = 0, ucPrevious = 0; i < TEST_BLOCK; ucPrevious = ucBlock[ i++ ] )
+			assert( ucData[ i ] == prvReply( pxDevice, i, ucPrevious ) );
+
+		/* And single bytes. */
+		assert( spiSelect( pxDevice->ss ) );
+		prvReset( pxDevice );
+		assert( spiTransfer( 0x42 ) == prvReply( pxDevice, 0, 0 ) );
+		assert( spiTransfer( 0x24 ) == prvReply( pxDevice, 1, 0x42 ) );
+		spiDeselect( pxDevice->ss );
+	}
+
+	/* Changing the bus by hand is undone by the next select. */
+	assert( spiSelect( Gameduino2 ) );
+	spiSetClockDivider( SPI_CLOCK_DIV128 );
+	spiSetDataMode( SPI_MODE1 );
+	spiDeselect( Gameduino2 );
+	assert( spiSelect( Gameduino2 ) );
+	spiTransfer( 0 );
+	spiDeselect( Gameduino2 );
+
+	assert( ulErrors == 0 );
+}
+
+/* A chain with a header, an empty transaction, a block received, clocks only, a block transferred in place
+ * and one transferred into another buffer. The stream the device saw, and the replies stored, are checked. */
+static void prvTestChain( xTestDevice * pxDevice, SPI_CLOCK_DIV_t rate, uint8_t ucStream[ TEST_BLOCK ] )
+{
+	static const uint8_t ucHeader[ 6 ] = { 0x51, 0x00, 0x00, 0x02, 0x00, 0xFF };
+	uint8_t ucBlock[ TEST_BLOCK ], ucRx[ 256 ], ucInPlace[ 100 ], ucTx[ 128 ], ucTxRx[ 128 ];
+	spiTransaction_t xChain[ 6 ] =
+	{
+		{ pxDevice->ss, pxDevice->mode, rate, ucHeader, NULL, sizeof( ucHeader ), &xChain[ 1 ] },
+		{ pxDevice->ss, pxDevice->mode, rate, ucHeader, ucRx, 0, &xChain[ 2 ] },
+		{ pxDevice->ss, pxDevice->mode, rate, NULL, ucRx, sizeof( ucRx ), &xChain[ 3 ] },
+		{ pxDevice->ss, pxDevice->mode, rate, NULL, NULL, 10, &xChain[ 4 ] },
+		{ pxDevice->ss, pxDevice->mode, rate, ucInPlace, ucInPlace, sizeof( ucInPlace ), &xChain[ 5 ] },
+		{ pxDevice->ss, pxDevice->mode, rate, ucTx, ucTxRx, sizeof( ucTx ), NULL },
+	};
+	uint8_t * pucReply[ 6 ] = { NULL, NULL, ucRx, NULL, ucInPlace, ucTxRx };
+	uint16_t i, uxPosition = 0, uxLength = 0;
+	int t;
+
+	for( i = 0; i < sizeof( ucInPlace ); ++i )
+		ucInPlace[ i ] = (uint8_t)( i * 3 + 5 );
+	for( i = 0; i < sizeof( ucTx ); ++i )
+		ucTx[ i ] = (uint8_t)( i * 11 + 7 );
+
+	/* The stream the device should see. */
+	for( t = 0; t < 6; ++t )
+		for( i = 0; i < xChain[ t ].length; ++i )
+			ucBlock[ uxLength++ ] = xChain[ t ].txData ? xChain[ t ].txData[ i ] : 0xFF;
+
+	pxDevice->rate = rate;
+	spiRegisterDevice( pxDevice->ss, pxDevice->mode, rate, pxDevice->bitOrder );
+
+	assert( spiSelect( pxDevice->ss ) );	// reset the device model while holding the bus.
+	prvReset( pxDevice );
+	spiDeselect( pxDevice->ss );
+
+	assert( spiTransact( &xChain[ 0 ] ) );
+	assert( pxDevice->position == uxLength && memcmp( pxDevice->sent, ucBlock, uxLength ) == 0 );
+
+	for( t = 0; t < 6; ++t )
+	{
+		for( i = 0; i < xChain[ t ].length; ++i, ++uxPosition )
+			if( pucReply[ t ] != NULL )
+				assert( pucReply[ t ][ i ] == prvReply( pxDevice, uxPosition, uxPosition ? ucBlock[ uxPosition - 1 ] : 0 ) );
+	}
+
+	memcpy( ucStream, ucBlock, uxLength );
+}
+
+static void prvTestTransactions( void )
+{
+	xTestDevice * pxDevice = &xDevice[ 1 ];
+	SPI_CLOCK_DIV_t xRegistered = pxDevice->rate;
+	uint8_t ucPolled[ TEST_BLOCK ], ucInterrupt[ TEST_BLOCK ];
+	spiTransaction_t xEmpty = { pxDevice->ss, pxDevice->mode, SPI_CLOCK_DIV64, NULL, NULL, 0, NULL };
+	unsigned long ulBefore;
+
+	ulBefore = ulInterrupts;
+	prvTestChain( pxDevice, SPI_CLOCK_DIV4, ucPolled );
+	assert( ulInterrupts == ulBefore );		// polled at this rate.
+
+	prvTestChain( pxDevice, SPI_CLOCK_DIV64, ucInterrupt );
+	assert( ulInterrupts - ulBefore == 6 + 256 + 10 + 100 + 128 );		// one for each byte.
+	assert( memcmp( ucPolled, ucInterrupt, 6 + 256 + 10 + 100 + 128 ) == 0 );
+	assert( !( SPCR & _BV(SPIE) ) );
+
+	/* Nothing to transfer still selects the device, and leaves the interrupt off. */
+	ulBefore = ulInterrupts;
+	assert( spiTransact( &xEmpty ) && ulInterrupts == ulBefore && !( SPCR & _BV(SPIE) ) );
+
+	/* The bus is left for a polled user, on another device. */
+	assert( spiSelect( Wiznet ) );
+	prvReset( &xDevice[ 0 ] );
+	assert( spiTransfer( 0x42 ) == prvReply( &xDevice[ 0 ], 0, 0 ) );
+	spiDeselect( Wiznet );
+
+	pxDevice->rate = xRegistered;
+	spiRegisterDevice( pxDevice->ss, pxDevice->mode, xRegistered, pxDevice->bitOrder );
+
+	assert( ulErrors == 0 );
+}
+
+static void * prvTask( void * pvParameters )
+{
+	xTestDevice * pxDevice = pvParameters;
+	uint8_t ucBlock[ TEST_BLOCK ], ucReply[ 16 ];
+	static const uint8_t ucCommand = 0x0F;
+	spiTransaction_t xChain[ 3 ] =
+	{
+		{ pxDevice->ss, pxDevice->mode, pxDevice->rate, &ucCommand, NULL, 1, &xChain[ 1 ] },
+		{ pxDevice->ss, pxDevice->mode, pxDevice->rate, ucBlock, NULL, TEST_BLOCK, &xChain[ 2 ] },
+		{ pxDevice->ss, pxDevice->mode, pxDevice->rate, NULL, ucReply, sizeof( ucReply ), NULL },
+	};
+	unsigned uxRound;
+
+	memset( ucBlock, (int)pxDevice->key, sizeof( ucBlock ) );
+
+	for( uxRound = 0; uxRound < TEST_ROUNDS; ++uxRound )
+	{
+		if( pxDevice->transact )
+		{
+			if( !spiTransact( &xChain[ 0 ] ) )	// the device model isn't reset, as the bus is only held inside.
+				++ulErrors;
+			sched_yield();
+			continue;
+		}
+
+		if( !spiSelect( pxDevice->ss ) )
+		{
+			++ulErrors;
+			continue;
+		}
+		prvReset( pxDevice );
+		spiTransfer( 0x0F );
+		spiMultiByteTx( ucBlock, TEST_BLOCK );
+		spiMultiByteRx( ucReply, sizeof( ucReply ) );
+		spiDeselect( pxDevice->ss );
+
+		sched_yield();
+	}
+	return NULL;
+}
+
+static void prvTestContention( void )
+{
+	pthread_t xThread[ TEST_DEVICES ];
+	unsigned long long ullClocks = 0;
+	uint64_t ullStart, ullElapsed;
+	unsigned long ulBefore = ulInterrupts;
+	int d;
+
+	for( d = 0; d < TEST_DEVICES; ++d )
+	{
+		spiResetDeviceStats( xDevice[ d ].ss );
+		xDevice[ d ].bytes = 0;
+		xDevice[ d ].clocks = 0;
+	}
+
+	ullStart = host_nanoseconds();
+	for( d = 0; d < TEST_DEVICES; ++d )
+		pthread_create( &xThread[ d ], NULL, prvTask, &xDevice[ d ] );
+	for( d = 0; d < TEST_DEVICES; ++d )
+		pthread_join( xThread[ d ], NULL );
+	ullElapsed = host_nanoseconds() - ullStart;
+	ulBefore = ulInterrupts - ulBefore;
+
+	for( d = 0; d < TEST_DEVICES; ++d )
+		ullClocks += xDevice[ d ].clocks;
+
+	printf( "%d tasks, each selecting its device %d times for %d bytes, %.1f MB/s through the driver on the host\n",
+			TEST_DEVICES, TEST_ROUNDS, TEST_BLOCK + 17, (double)TEST_DEVICES * TEST_ROUNDS * ( TEST_BLOCK + 17 ) * 1000.0 / (double)ullElapsed );
+
+	for( d = 0; d < TEST_DEVICES; ++d )
+	{
+		const spiDevice_t * pxStats = spiGetDevice( xDevice[ d ].ss );
+
+		printf( "  %-10s SPI_CLOCK_DIV%-3u %4u selects %7lu bytes %5.1f%% of the bus clocks, waited %lu ticks, at most %u\n",
+				xDevice[ d ].name, ucDivider[ xDevice[ d ].rate ], pxStats->selects, xDevice[ d ].bytes,
+				100.0 * (double)xDevice[ d ].clocks / (double)ullClocks, (unsigned long)pxStats->waitTicks, pxStats->maxWaitTicks );
+
+		if( pxStats->selects != TEST_ROUNDS || xDevice[ d ].bytes != TEST_ROUNDS * ( TEST_BLOCK + 17UL ) )
+			++ulErrors;
+	}
+
+	printf( "  %lu bytes advanced by the SPI STC interrupt, while their task slept\n", ulBefore );
+
+	if( ulBefore != TEST_ROUNDS * ( TEST_BLOCK + 17UL ) )
+		++ulErrors;		// all of the SD card's, and none of the polled devices'.
+}
+
+static uint8_t prvReplyNone( uint8_t ucSent )
+{
+	( void ) ucSent;
+	++ulErrors;
+	return 0xFF;
+}
+
+int main( void )
+{
+	int d;
+
+	host_spi_device = prvReplyNone;
+
+	for( d = 0; d < TEST_DEVICES; ++d )
+		spiBegin( xDevice[ d ].ss );
+
+	assert( prvSelected() < 0 && ( SPCR & _BV(MSTR) ) && ( SPCR & _BV(SPE) ) );
+	assert( ulErrors == 0 );
+
+	host_spi_device = prvDevice;
+	host_spi_attach_interrupt( prvInterrupt );
+
+	for( d = 0; d < TEST_DEVICES; ++d )
+		spiRegisterDevice( xDevice[ d ].ss, xDevice[ d ].mode, xDevice[ d ].rate, xDevice[ d ].bitOrder );
+
+	prvTestTransfers();
+	prvTestTransactions();
+	prvTestContention();
+
+	if( ulErrors )
+	{
+		printf( "FAIL: %lu bytes with the wrong device, or the wrong settings\n", ulErrors );
+		return 1;
+	}
+	printf( "PASS\n" );
+	return 0;
+}
@@ -0,0 +1,337 @@
+/*
+ * Host decoder for the trace stream from freeRTOS10xx/trace.c. The format is in include/trace.h.
+ *
+ *   trace_decode [file]      decode a captured stream, or stdin, eg. trace_decode < /dev/ttyUSB1
+ *
+ * It reports the CPU load of each task, with the interrupt time taken out of the task that was interrupted,
+ * the context switch rate, and for each interrupt its rate and a histogram of its service times, from entry
+ * to exit. The stream does not see the interrupt request, so the latency from the request to the entry is not
+ * there. The service time is the latency each interrupt adds, as it holds off the tasks and, on the AVR, the
+ * other interrupts.
+ *
+ * A stream can be joined at any point. Only a record that begins with TRACE_SYNC and has a known event, and
+ * is followed by another such record, is taken as the first. Where a record then does not begin with
+ * TRACE_SYNC, the bytes are skipped until the stream is joined again. Until a TRACE_EVENT_TIMEBASE record
+ * arrives, the run time counter is taken to count configCPU_CLOCK_HZ / 8 per second, as the AVR port does.
+ *
+ * Built with -DTRACE_DECODE_LIBRARY it has no main(), so trace_test.c can include it.
+ */
+
+#include "trace.h"
+
+#define TRACE_DECODE_BINS		16		// service time bins, < 1us, then 1us to 2us, 2us to 4us, and so on.
+
+typedef struct
+{
+	char name[ 4 * 16 + 1 ];			// four characters from each TRACE_EVENT_TASK_NAME record.
+	uint64_t run;						// counts, with interrupts taken out.
+	unsigned long switchedIn;
+} xTraceTask;
+
+typedef struct
+{
+	uint64_t total, max;				// service time counts, entry to exit.
+	uint64_t entered;
+	unsigned long count;
+	unsigned long bins[ TRACE_DECODE_BINS ];
+	uint8_t active;
+} xTraceIsr;
+
+typedef struct
+{
+	uint8_t record[ 2 * TRACE_RECORD_SIZE ];
+	unsigned length;					// bytes held in record[].
+	int synced;
+
+	uint32_t hz;
+	int timed;							// a time stamp has been seen.
+	uint32_t last;						// the last time stamp, as sent.
+	uint64_t start, now, since;			// times from the first time stamp, extended past the 32 bit wrap.
+
+	int current;						// the task running, or -1 if not known.
+	int previous;						// the task last switched in.
+	unsigned depth;						// interrupts active.
+	uint64_t interrupts;				// counts in interrupts.
+	uint64_t other;						// counts not in a known task nor an interrupt, ie. switching.
+	unsigned long switches;				// switches to a task other than the one before.
+
+	unsigned long records;				// all records decoded.
+	unsigned long events;				// task switch and interrupt records decoded.
+	unsigned long lost;					// records lost by the recorder, from TRACE_EVENT_OVERFLOW.
+	unsigned long skipped;				// bytes skipped to join the stream.
+	unsigned long resyncs;				// times the stream was joined again.
+
+	xTraceTask task[ 256 ];
+	xTraceIsr isr[ 256 ];
+} xTraceDecoder;
+
+static void vTraceDecodeInit( xTraceDecoder * d )
+{
+	memset( d, 0, sizeof( *d ) );
+	d->hz = configCPU_CLOCK_HZ / 8;
+	d->current = -1;
+	d->previous = -1;
+}
+
+static int prvTraceValid( const uint8_t * pucRecord )
+{
+	return pucRecord[ 0 ] == TRACE_SYNC
+		&& ( ( pucRecord[ 1 ] >= TRACE_EVENT_TASK_SWITCHED_IN && pucRecord[ 1 ] <= TRACE_EVENT_TIMEBASE )
+		  || ( pucRecord[ 1 ] & 0xF0 ) == TRACE_EVENT_TASK_NAME );
+}
+
+/* Time from the last time stamp to now goes to the interrupts, the task running, or neither. */
+static void prvTraceAccount( xTraceDecoder * d )
+{
+	uint64_t ullElapsed = d->now - d->since;
+
+	if( d->depth )
+		d->interrupts += ullElapsed;
+	else if( d->current >= 0 )
+		d->task[ d->current ].run += ullElapsed;
+	else
+		d->other += ullElapsed;
+
+	d->since = d->now;
+}
+
+static void prvTraceIsrExit( xTraceDecoder * d, xTraceIsr * pxIsr )
+{
+	uint64_t ullTime = d->now - pxIsr->entered;
+	uint64_t ullMicroseconds = ullTime * 1000000ULL / d->hz;
+	unsigned uxBin = 0;
+
+	while( ullMicroseconds && uxBin < TRACE_DECODE_BINS - 1 )
+	{
+		ullMicroseconds >>= 1;
+		++uxBin;
+	}
+
+	++pxIsr->bins[ uxBin ];
+	++pxIsr->count;
+	pxIsr->total += ullTime;
+	if( ullTime > pxIsr->max )
+		pxIsr->max = ullTime;
+
+	pxIsr->active = 0;
+	--d->depth;
+}
+
+static void prvTraceRecord( xTraceDecoder * d, const uint8_t * pucRecord )
+{
+	uint8_t ucEvent = pucRecord[ 1 ], ucId = pucRecord[ 2 ];
+	uint32_t ulValue = pucRecord[ 3 ] | (uint32_t)pucRecord[ 4 ] << 8 | (uint32_t)pucRecord[ 5 ] << 16 | (uint32_t)pucRecord[ 6 ] << 24;
+	unsigned i;
+
+	++d->records;
+
+	if( ( ucEvent & 0xF0 ) == TRACE_EVENT_TASK_NAME )
+	{
+		memcpy( &d->task[ ucId ].name[ ( ucEvent & 0x0F ) * 4 ], &ulValue, 4 );
+		return;
+	}
+	if( ucEvent == TRACE_EVENT_TIMEBASE )
+	{
+		d->hz = ulValue;
+		return;
+	}
+
+	/* Everything else is time stamped. */
+	if( !d->timed )
+	{
+		d->timed = 1;
+		d->start = d->now = d->since = ulValue;
+	}
+	else
+		d->now += (uint32_t)( ulValue - d->last );
+	d->last = ulValue;
+
+	prvTraceAccount( d );
+
+	switch( ucEvent )
+	{
+	case TRACE_EVENT_TASK_SWITCHED_OUT:
+		++d->events;
+		if( d->current == ucId )
+			d->current = -1;
+		break;
+
+	case TRACE_EVENT_TASK_SWITCHED_IN:
+		++d->events;
+		if( d->previous != ucId )
+			++d->switches;
+		++d->task[ ucId ].switchedIn;
+		d->current = d->previous = ucId;
+		break;
+
+	case TRACE_EVENT_ISR_ENTER:
+		++d->events;
+		if( !d->isr[ ucId ].active )
+		{
+			d->isr[ ucId ].active = 1;
+			d->isr[ ucId ].entered = d->now;
+			++d->depth;
+		}
+		break;
+
+	case TRACE_EVENT_ISR_EXIT:
+		++d->events;
+		if( d->isr[ ucId ].active )
+			prvTraceIsrExit( d, &d->isr[ ucId ] );
+		break;
+
+	case TRACE_EVENT_OVERFLOW:
+		/* The lost records may have been any, so which task runs is not known until the next switch in,
+		 * and the interrupts are taken to have ended here, without counting their service times. */
+		d->lost += ucId;
+		d->current = -1;
+		for( i = 0; i < 256; ++i )
+			d->isr[ i ].active = 0;
+		d->depth = 0;
+		break;
+	}
+}
+
+/* Drop the first byte held, and any that follow it up to the next TRACE_SYNC. */
+static void prvTraceSkip( xTraceDecoder * d )
+{
+	unsigned uxSkip = 1;
+
+	while( uxSkip < d->length && d->record[ uxSkip ] != TRACE_SYNC )
+		++uxSkip;
+
+	memmove( d->record, d->record + uxSkip, d->length - uxSkip );
+	d->length -= uxSkip;
+	d->skipped += uxSkip;
+}
+
+static void vTraceDecode( xTraceDecoder * d, const uint8_t * pucData, size_t uxLength )
+{
+	while( uxLength-- )
+	{
+		d->record[ d->length++ ] = *pucData++;
+
+		if( d->synced )
+		{
+			if( d->length < TRACE_RECORD_SIZE )
+				continue;
+
+			if( prvTraceValid( d->record ) )
+			{
+				prvTraceRecord( d, d->record );
+				d->length = 0;
+				continue;
+			}
+
+			d->synced = 0;
+			++d->resyncs;
+		}
+
+		/* Not joined. Hold bytes from a TRACE_SYNC, until two whole records are there to check. */
+		for( ;; )
+		{
+			if( d->length && ( d->record[ 0 ] != TRACE_SYNC || ( d->length >= TRACE_RECORD_SIZE && !prvTraceValid( d->record ) ) ) )
+				prvTraceSkip( d );
+			else if( d->length == 2 * TRACE_RECORD_SIZE && !prvTraceValid( d->record + TRACE_RECORD_SIZE ) )
+				prvTraceSkip( d );
+			else
+				break;
+		}
+
+		if( d->length == 2 * TRACE_RECORD_SIZE )
+		{
+			prvTraceRecord( d, d->record );
+			prvTraceRecord( d, d->record + TRACE_RECORD_SIZE );
+			d->length = 0;
+			d->synced = 1;
+		}
+	}
+}
+
+static const char * prvTraceIsrName( uint8_t ucId )
+{
+	static char cName[ 12 ];
+
+	switch( ucId )
+	{
+	case TRACE_ISR_TICK:		return "tick";
+	case TRACE_ISR_USART0_RX:	return "USART0 Rx";
+	case TRACE_ISR_USART1_RX:	return "USART1 Rx";
+	case TRACE_ISR_USART2_RX:	return "USART2 Rx";
+	case TRACE_ISR_USART3_RX:	return "USART3 Rx";
+	}
+	snprintf( cName, sizeof( cName ), "user %u", ucId - TRACE_ISR_USER );
+	return cName;
+}
+
+static void vTraceDecodeReport( const xTraceDecoder * d, FILE * pxFile )
+{
+	double dSpan = d->timed ? (double)( d->now - d->start ) : 0.0;
+	double dSeconds = dSpan / d->hz;
+	unsigned i, b, uxLast;
+
+	fprintf( pxFile, "%.3f s traced at %lu Hz, %lu records, %lu lost, %lu bytes skipped, joined %lu times\n",
+			dSeconds, (unsigned long)d->hz, d->records, d->lost, d->skipped, d->resyncs + ( d->records != 0 ) );
+	if( dSpan == 0.0 )
+		return;
+
+	fprintf( pxFile, "  task                    CPU  switched in\n" );
+	for( i = 0; i < 256; ++i )
+		if( d->task[ i ].run || d->task[ i ].switchedIn )
+			fprintf( pxFile, "  %3u %-16s %6.2f%% %10lu\n", i, d->task[ i ].name[ 0 ] ? d->task[ i ].name : "?",
+					100.0 * (double)d->task[ i ].run / dSpan, d->task[ i ].switchedIn );
+	fprintf( pxFile, "      %-16s %6.2f%%\n", "interrupts", 100.0 * (double)d->interrupts / dSpan );
+	fprintf( pxFile, "      %-16s %6.2f%%\n", "switching", 100.0 * (double)d->other / dSpan );
+	fprintf( pxFile, "  %.1f context switches a second\n", (double)d->switches / dSeconds );
+
+	fprintf( pxFile, "  interrupt      count   per second   mean us    max us   service times, us: count\n" );
+	for( i = 0; i < 256; ++i )
+	{
+		const xTraceIsr * pxIsr = &d->isr[ i ];
+
+		if( !pxIsr->count )
+			continue;
+
+		fprintf( pxFile, "  %-10s %9lu %12.1f %9.1f %9.1f  ", prvTraceIsrName( i ), pxIsr->count, (double)pxIsr->count / dSeconds,
+				1e6 * (double)pxIsr->total / pxIsr->count / d->hz, 1e6 * (double)pxIsr->max / d->hz );
+
+		for( uxLast = TRACE_DECODE_BINS - 1; !pxIsr->bins[ uxLast ]; --uxLast )
+			;
+		for( b = 0; b <= uxLast; ++b )
+		{
+			if( b == 0 )
+				fprintf( pxFile, " <1: %lu", pxIsr->bins[ b ] );
+			else if( b == TRACE_DECODE_BINS - 1 )
+				fprintf( pxFile, " %u+: %lu", 1U << ( b - 1 ), pxIsr->bins[ b ] );
+			else
+				fprintf( pxFile, " %u-%u: %lu", 1U << ( b - 1 ), 1U << b, pxIsr->bins[ b ] );
+		}
+		fprintf( pxFile, "\n" );
+	}
+}
+
+#ifndef TRACE_DECODE_LIBRARY
+
+int main( int argc, char ** argv )
+{
+	static xTraceDecoder xDecoder;
+	uint8_t ucBuffer[ 4096 ];
+	size_t uxRead;
+	FILE * pxFile = stdin;
+
+	if( argc > 2 || ( argc == 2 && ( pxFile = fopen( argv[ 1 ], "rb" ) ) == NULL ) )
+	{
+		fprintf( stderr, "usage: %s [file]\n", argv[ 0 ] );
+		return 1;
+	}
+
+	vTraceDecodeInit( &xDecoder );
+
+	while( ( uxRead = fread( ucBuffer, 1, sizeof( ucBuffer ), pxFile ) ) != 0 )
+		vTraceDecode( &xDecoder, ucBuffer, uxRead );
+
+	vTraceDecodeReport( &xDecoder, stdout );
+	return 0;
+}
+
+#endif
@@ -0,0 +1,317 @@
+/*
+ * Host test for the trace recorder in freeRTOS10xx/trace.c, and the host decoder in trace_decode.c.
+ *
+ * The test plays the kernel and the run time counter. It scripts a schedule of four tasks on a simulated
+ * 2MHz counter that wraps part way through: tick interrupts, some of which switch tasks, serial Rx interrupts,
+ * and tasks that yield. The records go through vTraceRecord(), and vTraceStreamTask() runs in its own thread,
+ * sending them to a stand in for xSerialWrite() that feeds the decoder. As the schedule is scripted, the run
+ * time of each task, the interrupt time, the switches and the service time histograms are known exactly, and
+ * the decoder must find the same.
+ *
+ * The captured stream is then decoded again joined part way into a record, in random chunks, and with a
+ * record broken, and finally the recorder is overrun, and every record must be either decoded or counted lost.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include "serial.h"
+
+#define TRACE_DECODE_LIBRARY
+#include "trace_decode.c"
+
+#define TEST_TASKS			4
+#define TEST_HZ				( configCPU_CLOCK_HZ / 8 )
+#define TEST_TICK			( TEST_HZ / configTICK_RATE_HZ )
+#define TEST_SECONDS		3
+#define TEST_DRAIN			48				// records put before waiting for the stream to catch up.
+#define TEST_OVERRUN		150
+
+static const char * const pcTaskName[ TEST_TASKS + 1 ] = { NULL, "IDLE", "Tmr Svc", "httpd", "Trace" };
+
+static volatile uint32_t ulClock = 0xFFFFFFFFUL - TEST_HZ;		// wraps after a second.
+
+static uint8_t ucCapture[ 256 * 1024 ];
+static size_t uxCaptured;
+static xTraceDecoder xLive;
+static unsigned long ulPut;
+
+/* What the decoder should find. */
+static uint64_t ullRun[ TEST_TASKS + 1 ], ullInterrupts, ullOther;
+static unsigned long ulSwitches, ulSwitchedIn[ TEST_TASKS + 1 ], ulIsrCount[ 2 ], ulIsrBins[ 2 ][ TRACE_DECODE_BINS ];
+static uint64_t ullIsrMax[ 2 ];
+
+static uint32_t ulSeed = 1;
+
+static uint16_t prvRandom( void )
+{
+	ulSeed = ulSeed * 1103515245UL + 12345UL;
+	return (uint16_t)( ulSeed >> 16 );
+}
+
+/* The kernel and the run time counter, for trace.c. */
+uint32_t ulPortGetRunTimeCounterValue( void )
+{
+	return ulClock;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks( void )
+{
+	return TEST_TASKS;
+}
+
+UBaseType_t uxTaskGetSystemState( TaskStatus_t * const pxTaskStatusArray, const UBaseType_t uxArraySize, uint32_t * const pulTotalRunTime )
+{
+	UBaseType_t i;
+
+	( void ) pulTotalRunTime;
+
+	for( i = 0; i < uxArraySize && i < TEST_TASKS; ++i )
+	{
+		pxTaskStatusArray[ i ].xHandle = NULL;
+		pxTaskStatusArray[ i ].pcTaskName = pcTaskName[ i + 1 ];
+		pxTaskStatusArray[ i ].xTaskNumber = i + 1;
+	}
+	return i;
+}
+
+/* The serial port. The span is sent at once, and decoded as it arrives. */
+void xSerialWrite( const xComPortHandlePtr pxPort, const uint8_t * pxBuffer, const uint16_t uxLength, void (*vComplete)(void * pvContext), void * pvContext )
+{
+	( void ) pxPort;
+
+	host_critical_enter();
+	assert( uxCaptured + uxLength <= sizeof( ucCapture ) );
+	memcpy( ucCapture + uxCaptured, pxBuffer, uxLength );
+	uxCaptured += uxLength;
+	vTraceDecode( &xLive, pxBuffer, uxLength );
+	host_critical_exit();
+
+	vComplete( pvContext );
+}
+
+static void * prvStream( void * pvParameters )
+{
+	vTraceStreamTask( pvParameters );
+	return NULL;
+}
+
+static unsigned long prvDecoded( void )
+{
+	unsigned long ulDecoded;
+
+	host_critical_enter();
+	ulDecoded = xLive.events + xLive.lost;
+	host_critical_exit();
+	return ulDecoded;
+}
+
+static void prvDrain( void )
+{
+	while( prvDecoded() < ulPut )
+		usleep( 1000 );
+}
+
+/* A record, from a task or an interrupt, with interrupts disabled as on the AVR. */
+static void prvPut( uint8_t ucEvent, uint8_t ucId )
+{
+	host_critical_enter();
+	vTraceRecord( ucEvent, ucId );
+	host_critical_exit();
+
+	if( ++ulPut % TEST_DRAIN == 0 )
+		prvDrain();
+}
+
+static uint64_t prvAdvance( uint32_t ulCounts )
+{
+	ulClock += ulCounts;
+	return ulCounts;
+}
+
+static unsigned prvBin( uint64_t ullCounts )
+{
+	unsigned long ulMicroseconds = (unsigned long)( ullCounts / ( TEST_HZ / 1000000 ) );
+	unsigned uxBin = ulMicroseconds ? 32 - __builtin_clz( ulMicroseconds ) : 0;
+
+	return uxBin < TRACE_DECODE_BINS ? uxBin : TRACE_DECODE_BINS - 1;
+}
+
+static void prvIsrDone( unsigned uxIsr, uint64_t ullTime )
+{
+	++ulIsrCount[ uxIsr ];
+	++ulIsrBins[ uxIsr ][ prvBin( ullTime ) ];
+	if( ullTime > ullIsrMax[ uxIsr ] )
+		ullIsrMax[ uxIsr ] = ullTime;
+	ullInterrupts += ullTime;
+}
+
+static uint8_t prvSwitch( uint8_t ucCurrent, uint64_t * pullTime )
+{
+	uint8_t ucNext = 1 + prvRandom() % TEST_TASKS;
+
+	prvPut( TRACE_EVENT_TASK_SWITCHED_OUT, ucCurrent );
+	*pullTime += prvAdvance( 8 + prvRandom() % 8 );
+	prvPut( TRACE_EVENT_TASK_SWITCHED_IN, ucNext );
+
+	if( ucNext != ucCurrent )
+		++ulSwitches;
+	++ulSwitchedIn[ ucNext ];
+	return ucNext;
+}
+
+static void prvSchedule( void )
+{
+	uint64_t ullElapsed = 0, ullTickDue = TEST_TICK, ullTime, ullIsr;
+	uint8_t ucCurrent = 1;
+
+	prvPut( TRACE_EVENT_TASK_SWITCHED_IN, ucCurrent );
+	ulSwitches = 1;
+	ulSwitchedIn[ ucCurrent ] = 1;
+
+	while( ullElapsed < TEST_SECONDS * (uint64_t)TEST_HZ )
+	{
+		ullTime = prvAdvance( 20 + prvRandom() % 2000 );
+		ullRun[ ucCurrent ] += ullTime;
+		ullElapsed += ullTime;
+
+		if( ullElapsed >= ullTickDue )
+		{
+			prvPut( TRACE_EVENT_ISR_ENTER, TRACE_ISR_TICK );
+			ullIsr = prvAdvance( 10 + prvRandom() % 40 );
+			if( prvRandom() % 3 == 0 )
+				ucCurrent = prvSwitch( ucCurrent, &ullIsr );
+			ullIsr += prvAdvance( 8 );
+			prvPut( TRACE_EVENT_ISR_EXIT, TRACE_ISR_TICK );
+
+			prvIsrDone( TRACE_ISR_TICK, ullIsr );
+			ullElapsed += ullIsr;
+			ullTickDue += TEST_TICK;
+		}
+		else if( prvRandom() % 8 < 3 )
+		{
+			prvPut( TRACE_EVENT_ISR_ENTER, TRACE_ISR_USART0_RX );
+			ullIsr = prvAdvance( 4 + prvRandom() % 60 );
+			prvPut( TRACE_EVENT_ISR_EXIT, TRACE_ISR_USART0_RX );
+
+			prvIsrDone( TRACE_ISR_USART0_RX, ullIsr );
+			ullElapsed += ullIsr;
+		}
+		else if( prvRandom() % 8 == 0 )
+		{
+			ullTime = 0;
+			ucCurrent = prvSwitch( ucCurrent, &ullTime );	// a task yields, and the switch is in no task.
+			ullOther += ullTime;
+			ullElapsed += ullTime;
+		}
+	}
+
+	prvPut( TRACE_EVENT_TASK_SWITCHED_OUT, ucCurrent );
+	prvDrain();
+}
+
+/* The decoder found what was scripted. */
+static void prvCheck( const xTraceDecoder * d )
+{
+	unsigned i, b;
+
+	for( i = 1; i <= TEST_TASKS; ++i )
+	{
+		assert( strcmp( d->task[ i ].name, pcTaskName[ i ] ) == 0 );
+		assert( d->task[ i ].run == ullRun[ i ] && d->task[ i ].switchedIn == ulSwitchedIn[ i ] );
+	}
+	assert( d->interrupts == ullInterrupts && d->other == ullOther && d->switches == ulSwitches );
+
+	for( i = 0; i < 2; ++i )
+	{
+		assert( d->isr[ i ].count == ulIsrCount[ i ] && d->isr[ i ].max == ullIsrMax[ i ] );
+		for( b = 0; b < TRACE_DECODE_BINS; ++b )
+			assert( d->isr[ i ].bins[ b ] == ulIsrBins[ i ][ b ] );
+	}
+	assert( d->hz == TEST_HZ && d->lost == 0 && d->resyncs == 0 );
+}
+
+static void prvTestRejoin( void )
+{
+	static xTraceDecoder xDecoder;
+	static uint8_t ucBroken[ sizeof( ucCapture ) ];
+	size_t uxDone, uxChunk, uxRecord;
+
+	/* Joined three bytes into the first record, which is the timebase, and in random chunks. */
+	vTraceDecodeInit( &xDecoder );
+	for( uxDone = 3; uxDone < uxCaptured; uxDone += uxChunk )
+	{
+		uxChunk = 1 + prvRandom() % 40;
+		if( uxChunk > uxCaptured - uxDone )
+			uxChunk = uxCaptured - uxDone;
+		vTraceDecode( &xDecoder, ucCapture + uxDone, uxChunk );
+	}
+	assert( ucCapture[ 1 ] == TRACE_EVENT_TIMEBASE && xDecoder.skipped == 4 );
+	assert( xDecoder.events == xLive.events && xDecoder.records == xLive.records - 1 );
+	prvCheck( &xDecoder );
+
+	/* A task switch record half way has its sync byte broken. It is lost, and the stream joined again. */
+	memcpy( ucBroken, ucCapture, uxCaptured );
+	for( uxRecord = uxCaptured / TRACE_RECORD_SIZE / 2; ucBroken[ uxRecord * TRACE_RECORD_SIZE + 1 ] != TRACE_EVENT_TASK_SWITCHED_IN; ++uxRecord )
+		;
+	ucBroken[ uxRecord * TRACE_RECORD_SIZE ] = 0x00;
+
+	vTraceDecodeInit( &xDecoder );
+	vTraceDecode( &xDecoder, ucBroken, uxCaptured );
+	assert( xDecoder.resyncs == 1 && xDecoder.events == xLive.events - 1 );
+}
+
+/* Records put while the buffer is full are counted, and the count sent with the next one that fits. */
+static void prvTestOverrun( void )
+{
+	unsigned i;
+
+	host_critical_enter();		// so the stream task cannot send any.
+	for( i = 0; i < TEST_OVERRUN; ++i )
+	{
+		ulClock += 10;
+		vTraceRecord( TRACE_EVENT_ISR_ENTER + i % 2, TRACE_ISR_USER );
+	}
+	host_critical_exit();
+	ulPut += TEST_OVERRUN;
+
+	usleep( 50000 );
+	prvPut( TRACE_EVENT_TASK_SWITCHED_IN, 1 );
+	prvDrain();
+
+	/* The stream task may have had its timebase and names lost too, if it put them while the buffer was full. */
+	assert( xLive.lost != 0 && xLive.events + xLive.lost >= ulPut && xLive.events + xLive.lost <= ulPut + 1 + 2 * TEST_TASKS );
+	printf( "  %u records put at once: %lu sent, %lu counted lost\n", TEST_OVERRUN, TEST_OVERRUN - xLive.lost, xLive.lost );
+}
+
+int main( void )
+{
+	static xComPortHandle xPort;
+	pthread_t xThread;
+
+	vTraceDecodeInit( &xLive );
+	pthread_create( &xThread, NULL, prvStream, &xPort );
+
+	/* Wait for the stream task to send the timebase and the task names. */
+	while( ( host_critical_enter(), xLive.records ) < 1 + 2 * TEST_TASKS )
+	{
+		host_critical_exit();
+		usleep( 1000 );
+	}
+	host_critical_exit();
+
+	prvSchedule();
+
+	host_critical_enter();
+	printf( "Scripted schedule, decoded from the stream as it was sent\n" );
+	vTraceDecodeReport( &xLive, stdout );
+	prvCheck( &xLive );
+	host_critical_exit();
+
+	prvTestRejoin();
+	prvTestOverrun();
+
+	printf( "PASS\n" );
+	return 0;
+}
@@ -0,0 +1,411 @@
+/*
+ * Host test and benchmark for the W5100 buffer transfers in lib_iinchip/w5100.c, built as for the ATmega328P.
+ *
+ * A model W5100 sits on the simulated SPI bus with its whole register file and buffer memory, and decodes
+ * the 4 byte SPI frames (0xF0 write or 0x0F read, address high, address low, data) byte by byte. Any other
+ * op code, or a byte sent while the Wiznet is not the only device selected, is an error.
+ *
+ * WIZCHIP_write_buf() / read_buf() are checked directly, and WIZCHIP_write_data() / read_data() are checked
+ * at every offset class into the socket rings, with lengths that wrap around the end of the ring, so each
+ * byte must land at its masked address and nothing else may change. send / recv_data_processing() are
+ * checked to move the ring pointers.
+ *
+ * Then TCP sized payloads are moved through the current transfers, and through the previous ones, which
+ * entered a critical section for each byte and selected the bus once for each half of a wrapped transfer.
+ * Time is kept in AVR clock cycles, counted as the SPI bus clocks each byte takes at the loaded divider,
+ * plus an estimate for each critical section and each bus selection, counted by wrapping those calls.
+ */
+
+#include <assert.h>
+
+#include <avr/io.h>
+
+#include "spi.h"
+#include "w5100.h"
+
+#define TEST_CPU_HZ				16000000ULL
+#define TEST_CRITICAL_CYCLES	8				// AVR cycles to save SREG, disable interrupts, and restore them.
+#define TEST_SELECT_CYCLES		120				// AVR cycles for spiSelect() and spiDeselect(), with the semaphore free.
+
+#define TEST_SOCKET				1
+#define TEST_PAYLOAD			1460			// one TCP segment, at the usual MSS.
+#define TEST_ROUNDS				2000
+
+typedef struct
+{
+	uint8_t memory[ 0x10000 ];	// the register file, and the Tx and Rx buffer memory.
+	uint8_t frame[ 4 ];
+	uint8_t position;			// of the next byte in the frame.
+
+	unsigned long writes;
+	unsigned long reads;
+	unsigned long errors;		// bad op codes, and bytes with the wrong devices selected.
+} xW5100;
+
+static xW5100 xChip;
+static uint8_t ucShadow[ 0x10000 ];	// what the memory should hold.
+
+static const uint8_t ucDivider[ 8 ] = { 4, 16, 64, 128, 2, 8, 32, 64 };
+
+static uint64_t ullCycles;			// AVR clock cycles, since the start.
+static unsigned long ulCriticals;
+static unsigned long ulSelects;
+
+/* The critical sections and selections the driver makes, counted and costed in AVR cycles. */
+void __real_host_critical_enter( void );
+void __wrap_host_critical_enter( void )
+{
+	++ulCriticals;
+	ullCycles += TEST_CRITICAL_CYCLES;
+	__real_host_critical_enter();
+}
+
+uint8_t __real_spiSelect( SPI_SLAVE_SELECT SS_pin );
+uint8_t __wrap_spiSelect( SPI_SLAVE_SELECT SS_pin )
+{
+	++ulSelects;
+	ullCycles += TEST_SELECT_CYCLES;
+	return __real_spiSelect( SS_pin );
+}
+
+static uint8_t prvDevice( uint8_t ucSent )
+{
+	uint16_t uxAddress;
+	uint8_t ucReply = 0x00;
+
+	ullCycles += 8 * ucDivider[ ( SPCR & SPI_CLOCK_MASK ) | ( ( SPSR & SPI_2XCLOCK_MASK ) << 2 ) ];
+
+	if( ( PORTB & SPI_BIT_SS_WIZNET ) || !( PORTD & SPI_BIT_SS_SD ) || !( PORTB & SPI_BIT_SS_G2 ) )
+	{
+		++xChip.errors;		// the W5100 is not selected, or is not the only device selected.
+		return 0xFF;
+	}
+
+	xChip.frame[ xChip.position ] = ucSent;
+
+	switch( xChip.position )
+	{
+	case 0:
+		if( ucSent != 0xF0 && ucSent != 0x0F )
+			++xChip.errors;
+		ucReply = 0x00;		// the W5100 answers 0x00, 0x01, 0x02 during a frame.
+		break;
+	case 1:
+	case 2:
+		ucReply = xChip.position;
+		break;
+	case 3:
+		uxAddress = ( (uint16_t)xChip.frame[ 1 ] << 8 ) | xChip.frame[ 2 ];
+		if( xChip.frame[ 0 ] == 0xF0 )
+		{
+			xChip.memory[ uxAddress ] = ucSent;
+			++xChip.writes;
+			ucReply = 0x03;
+		}
+		else
+		{
+			ucReply = xChip.memory[ uxAddress ];
+			++xChip.reads;
+		}
+		break;
+	}
+	xChip.position = ( xChip.position + 1 ) & 0x03;
+
+	return ucReply;
+}
+
+/* The previous transfers, with a critical section for each byte, and a bus selection for each half of a wrap. */
+static uint16_t prvWriteBufBefore( uint16_t addr, uint8_t * buf, uint16_t len )
+{
+	uint8_t TxByte;
+	uint16_t i;
+
+	if( len == 0 )
+		return 0;
+
+	spiSelect( Wiznet );
+
+	for( i = 0; i < len; ++i )
+	{
+		portENTER_CRITICAL();
+
+		SPI_PORT &= ~SPI_BIT_SS_WIZNET;
+
+		SPDR = 0xF0;
+		TxByte = ( ( ( addr + i ) & 0xFF00 ) >> 8 );
+		while( !( SPSR & _BV(SPIF) ) );
+
+		SPDR = TxByte;
+		TxByte = ( ( addr + i ) & 0x00FF );
+		while( !( SPSR & _BV(SPIF) ) );
+
+		SPDR = TxByte;
+		TxByte = buf[ i ];
+		while( !( SPSR & _BV(SPIF) ) );
+
+		SPDR = TxByte;
+		while( !( SPSR & _BV(SPIF) ) );
+
+		SPI_PORT |= SPI_BIT_SS_WIZNET;
+
+		portEXIT_CRITICAL();
+	}
+
+	spiDeselect( Wiznet );
+	return len;
+}
+
+static uint16_t prvReadBufBefore( uint16_t addr, uint8_t * buf, uint16_t len )
+{
+	uint8_t RxByte;
+	uint16_t i;
+
+	spiSelect( Wiznet );
+
+	for( i = 0; i < len; ++i )
+	{
+		portENTER_CRITICAL();
+
+		SPI_PORT &= ~SPI_BIT_SS_WIZNET;
+
+		SPDR = 0x0F;
+		RxByte = ( ( ( addr + i ) & 0xFF00 ) >> 8 );
+		while( !( SPSR & _BV(SPIF) ) );
+
+		SPDR = RxByte;
+		RxByte = ( ( addr + i ) & 0x00FF );
+		while( !( SPSR & _BV(SPIF) ) );
+
+		SPDR = RxByte;
+		RxByte = 0xFF;
+		while( !( SPSR & _BV(SPIF) ) );
+
+		SPDR = RxByte;
+		while( !( SPSR & _BV(SPIF) ) );
+
+		buf[ i ] = (uint8_t)SPDR;
+
+		SPI_PORT |= SPI_BIT_SS_WIZNET;
+
+		portEXIT_CRITICAL();
+	}
+
+	spiDeselect( Wiznet );
+	return len;
+}
+
+static void prvWriteDataBefore( SOCKET s, uint8_t * src, uint16_t dst, uint16_t len )
+{
+	uint16_t size, dst_mask = dst & WIZCHIP_getTxMASK( s );
+
+	if( dst_mask + len > WIZCHIP_getTxMAX( s ) )
+	{
+		size = WIZCHIP_getTxMAX( s ) - dst_mask;
+		prvWriteBufBefore( WIZCHIP_getTxBASE( s ) + dst_mask, src, size );
+		prvWriteBufBefore( WIZCHIP_getTxBASE( s ), src + size, len - size );
+	}
+	else
+		prvWriteBufBefore( WIZCHIP_getTxBASE( s ) + dst_mask, src, len );
+}
+
+static void prvReadDataBefore( SOCKET s, uint16_t src, uint8_t * dst, uint16_t len )
+{
+	uint16_t size, src_mask = src & WIZCHIP_getRxMASK( s );
+
+	if( src_mask + len > WIZCHIP_getRxMAX( s ) )
+	{
+		size = WIZCHIP_getRxMAX( s ) - src_mask;
+		prvReadBufBefore( WIZCHIP_getRxBASE( s ) + src_mask, dst, size );
+		prvReadBufBefore( WIZCHIP_getRxBASE( s ), dst + size, len - size );
+	}
+	else
+		prvReadBufBefore( WIZCHIP_getRxBASE( s ) + src_mask, dst, len );
+}
+
+static uint32_t ulSeed = 1;
+
+static uint16_t prvRandom( void )
+{
+	ulSeed = ulSeed * 1103515245UL + 12345UL;
+	return (uint16_t)( ulSeed >> 16 );
+}
+
+static void prvFill( uint8_t * pucData, uint16_t uxLength )
+{
+	while( uxLength-- )
+		*pucData++ = (uint8_t)prvRandom();
+}
+
+static void prvCheckMemory( void )
+{
+	assert( memcmp( xChip.memory, ucShadow, sizeof( ucShadow ) ) == 0 );
+	assert( xChip.position == 0 && xChip.errors == 0 );
+}
+
+static void prvTestBuf( void )
+{
+	uint8_t ucData[ 300 ], ucBack[ 300 ];
+	uint16_t uxAddress = __DEF_WIZCHIP_MAP_TXBUF__ + 0x123;
+
+	prvFill( ucData, sizeof( ucData ) );
+
+	assert( WIZCHIP_write_buf( uxAddress, ucData, sizeof( ucData ) ) == sizeof( ucData ) );
+	memcpy( ucShadow + uxAddress, ucData, sizeof( ucData ) );
+	prvCheckMemory();
+
+	assert( WIZCHIP_read_buf( uxAddress, ucBack, sizeof( ucBack ) ) == sizeof( ucBack ) );
+	assert( memcmp( ucData, ucBack, sizeof( ucData ) ) == 0 );
+
+	assert( WIZCHIP_write_buf( uxAddress, ucData, 0 ) == 0 );
+	assert( WIZCHIP_read_buf( uxAddress, ucBack, 0 ) == 0 );
+	prvCheckMemory();
+
+	/* A disabled SPI module is refused, and the bus released for the next caller. */
+	SPCR &= ~_BV(SPE);
+	assert( WIZCHIP_write_buf( uxAddress, ucData, sizeof( ucData ) ) == 0 );
+	SPCR |= _BV(SPE);
+	assert( WIZCHIP_write_buf( uxAddress, ucData, 1 ) == 1 );
+	prvCheckMemory();
+}
+
+/* Every length up to more than the ring, from offsets near and away from the end, so most wrap. */
+static void prvTestRings( void )
+{
+	static uint8_t ucData[ 2048 ], ucBack[ 2048 ];
+	uint16_t uxMax = WIZCHIP_getTxMAX( TEST_SOCKET ), uxOffset, uxLength, i;
+	unsigned uxRound;
+
+	assert( uxMax == 2048 && WIZCHIP_getRxMAX( TEST_SOCKET ) == 2048 );
+
+	for( uxRound = 0; uxRound < 400; ++uxRound )
+	{
+		uxLength = 1 + prvRandom() % uxMax;
+		uxOffset = uxRound & 1 ? uxMax - prvRandom() % 64 : prvRandom();	// the free running pointer, not yet masked.
+		prvFill( ucData, uxLength );
+
+		WIZCHIP_write_data( TEST_SOCKET, ucData, (uint8_t *)(uintptr_t)uxOffset, uxLength );
+		for( i = 0; i < uxLength; ++i )
+			ucShadow[ WIZCHIP_getTxBASE( TEST_SOCKET ) + ( ( uxOffset + i ) & WIZCHIP_getTxMASK( TEST_SOCKET ) ) ] = ucData[ i ];
+		prvCheckMemory();
+
+		/* Put the same bytes in the Rx ring, as the W5100 would, and read them back. */
+		for( i = 0; i < uxLength; ++i )
+			xChip.memory[ WIZCHIP_getRxBASE( TEST_SOCKET ) + ( ( uxOffset + i ) & WIZCHIP_getRxMASK( TEST_SOCKET ) ) ] =
+				ucShadow[ WIZCHIP_getRxBASE( TEST_SOCKET ) + ( ( uxOffset + i ) & WIZCHIP_getRxMASK( TEST_SOCKET ) ) ] = ucData[ i ];
+
+		memset( ucBack, 0, sizeof( ucBack ) );
+		WIZCHIP_read_data( TEST_SOCKET, (uint8_t *)(uintptr_t)uxOffset, ucBack, uxLength );
+		assert( memcmp( ucData, ucBack, uxLength ) == 0 );
+		assert( ucBack[ uxLength ] == 0 || uxLength == sizeof( ucBack ) );
+		prvCheckMemory();
+	}
+}
+
+/* The ring pointers are read, and moved on past the data, high byte first. */
+static void prvTestProcessing( void )
+{
+	uint8_t ucData[ 100 ], ucBack[ 100 ];
+	uint16_t uxPointer = 0xFFE0, i;
+
+	prvFill( ucData, sizeof( ucData ) );
+
+	ucShadow[ Sn_TX_WR0( TEST_SOCKET ) ] = xChip.memory[ Sn_TX_WR0( TEST_SOCKET ) ] = uxPointer >> 8;
+	ucShadow[ Sn_TX_WR1( TEST_SOCKET ) ] = xChip.memory[ Sn_TX_WR1( TEST_SOCKET ) ] = (uint8_t)uxPointer;
+
+	WIZCHIP_send_data_processing( TEST_SOCKET, ucData, sizeof( ucData ) );
+	for( i = 0; i < sizeof( ucData ); ++i )
+		ucShadow[ WIZCHIP_getTxBASE( TEST_SOCKET ) + ( ( uxPointer + i ) & WIZCHIP_getTxMASK( TEST_SOCKET ) ) ] = ucData[ i ];
+	ucShadow[ Sn_TX_WR0( TEST_SOCKET ) ] = (uint16_t)( uxPointer + sizeof( ucData ) ) >> 8;
+	ucShadow[ Sn_TX_WR1( TEST_SOCKET ) ] = (uint8_t)( uxPointer + sizeof( ucData ) );
+	prvCheckMemory();
+
+	ucShadow[ Sn_RX_RD0( TEST_SOCKET ) ] = xChip.memory[ Sn_RX_RD0( TEST_SOCKET ) ] = uxPointer >> 8;
+	ucShadow[ Sn_RX_RD1( TEST_SOCKET ) ] = xChip.memory[ Sn_RX_RD1( TEST_SOCKET ) ] = (uint8_t)uxPointer;
+	for( i = 0; i < sizeof( ucData ); ++i )
+		xChip.memory[ WIZCHIP_getRxBASE( TEST_SOCKET ) + ( ( uxPointer + i ) & WIZCHIP_getRxMASK( TEST_SOCKET ) ) ] =
+			ucShadow[ WIZCHIP_getRxBASE( TEST_SOCKET ) + ( ( uxPointer + i ) & WIZCHIP_getRxMASK( TEST_SOCKET ) ) ] = ucData[ i ];
+
+	WIZCHIP_recv_data_processing( TEST_SOCKET, ucBack, sizeof( ucBack ) );
+	assert( memcmp( ucData, ucBack, sizeof( ucData ) ) == 0 );
+	ucShadow[ Sn_RX_RD0( TEST_SOCKET ) ] = (uint16_t)( uxPointer + sizeof( ucData ) ) >> 8;
+	ucShadow[ Sn_RX_RD1( TEST_SOCKET ) ] = (uint8_t)( uxPointer + sizeof( ucData ) );
+	prvCheckMemory();
+}
+
+enum { RUN_AFTER, RUN_BEFORE };
+
+static void prvRun( const char * pcName, int xRun, int xRead )
+{
+	static uint8_t ucData[ TEST_PAYLOAD ];
+	uint64_t ullStartCycles = ullCycles, ullStart = host_nanoseconds(), ullHost;
+	unsigned long ulStartCriticals = ulCriticals, ulStartSelects = ulSelects;
+	uint16_t uxPointer = 0;
+	unsigned uxRound;
+
+	prvFill( ucData, sizeof( ucData ) );
+
+	for( uxRound = 0; uxRound < TEST_ROUNDS; ++uxRound, uxPointer += TEST_PAYLOAD )	// most segments wrap the 2kB ring.
+	{
+		if( xRun == RUN_AFTER )
+		{
+			if( xRead )
+				WIZCHIP_read_data( TEST_SOCKET, (uint8_t *)(uintptr_t)uxPointer, ucData, TEST_PAYLOAD );
+			else
+				WIZCHIP_write_data( TEST_SOCKET, ucData, (uint8_t *)(uintptr_t)uxPointer, TEST_PAYLOAD );
+		}
+		else
+		{
+			if( xRead )
+				prvReadDataBefore( TEST_SOCKET, uxPointer, ucData, TEST_PAYLOAD );
+			else
+				prvWriteDataBefore( TEST_SOCKET, ucData, uxPointer, TEST_PAYLOAD );
+		}
+	}
+	ullHost = host_nanoseconds() - ullStart;
+
+	printf( "  %-26s %6.1f kB/s on the AVR, %5.2f selects and %6.1f critical sections a segment, host %5.1f ns/byte\n",
+			pcName,
+			(double)TEST_ROUNDS * TEST_PAYLOAD * TEST_CPU_HZ / 1000.0 / (double)( ullCycles - ullStartCycles ),
+			(double)( ulSelects - ulStartSelects ) / TEST_ROUNDS,
+			(double)( ulCriticals - ulStartCriticals ) / TEST_ROUNDS,
+			(double)ullHost / ( (double)TEST_ROUNDS * TEST_PAYLOAD ) );
+}
+
+static void prvBenchmark( void )
+{
+	printf( "W5100 buffer transfers of %u byte segments through a 2kB socket ring, SPI at clock / %u\n",
+			TEST_PAYLOAD, ucDivider[ _WIZCHIP_SPI_DIVIDER ] );
+	prvRun( "write_data (before)", RUN_BEFORE, 0 );
+	prvRun( "write_data (after)", RUN_AFTER, 0 );
+	prvRun( "read_data (before)", RUN_BEFORE, 1 );
+	prvRun( "read_data (after)", RUN_AFTER, 1 );
+	printf( "  the bus alone allows %.1f kB/s, at 4 SPI bytes for each byte moved\n",
+			(double)TEST_CPU_HZ / ( 4.0 * 8 * ucDivider[ _WIZCHIP_SPI_DIVIDER ] ) / 1000.0 );
+}
+
+int main( void )
+{
+	host_spi_device = prvDevice;
+
+	spiBegin( SDCard );
+	spiBegin( Gameduino2 );
+
+	WIZCHIP_init();
+	WIZCHIP_sysinit( 0x55, 0x55 );	// 2kB Tx and Rx rings for each socket.
+	memcpy( ucShadow, xChip.memory, sizeof( ucShadow ) );
+	prvCheckMemory();
+
+	prvTestBuf();
+	prvTestRings();
+	prvTestProcessing();
+
+	prvBenchmark();
+
+	if( xChip.errors )
+	{
+		printf( "FAIL: %lu bad frames\n", xChip.errors );
+		return 1;
+	}
+	printf( "PASS\n" );
+	return 0;
+}
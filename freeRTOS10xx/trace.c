@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2018 Phillip Stevens  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * 1 tab == 4 spaces!
+ *
+ * This file is NOT part of the FreeRTOS distribution.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <util/atomic.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "ringBuffer.h"
+#include "serial.h"
+
+#include "trace.h"
+
+#if ( configUSE_TRACE_RECORDER == 1 )
+
+#if ( configGENERATE_RUN_TIME_STATS != 1 ) || ( configUSE_TRACE_FACILITY != 1 )
+	#error "The trace recorder needs configGENERATE_RUN_TIME_STATS and configUSE_TRACE_FACILITY set to 1."
+#endif
+
+/*-----------------------------------------------------------*/
+
+static uint8_t ucTraceStorage[ TRACE_BUFFER_SIZE ];
+
+/* Records are put by tasks and interrupts, always with interrupts disabled, and only the stream task takes them. */
+static ringBufferSPSC_t xTraceBuffer = { 0, 0, ucTraceStorage, TRACE_BUFFER_SIZE - 1, TRACE_BUFFER_SIZE };
+
+/* Number of records lost since the last one that fitted. */
+static uint8_t ucTraceDropped;
+
+/*-----------------------------------------------------------*/
+
+static void prvTracePut( uint8_t ucEvent, uint8_t ucId, uint32_t ulValue ) __attribute__ ((hot));
+
+static void prvTraceTaskNames( void );
+
+static void prvTraceWriteComplete( void * pvContext );
+
+/*-----------------------------------------------------------*/
+
+void vTraceRecord( uint8_t ucEvent, uint8_t ucId )
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)	// so the time stamps are in order on the buffer.
+	{
+		prvTracePut( ucEvent, ucId, ulPortGetRunTimeCounterValue() );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvTracePut( uint8_t ucEvent, uint8_t ucId, uint32_t ulValue )
+{
+	/* Called with interrupts disabled. Only whole records are put, so the stream stays aligned. */
+
+	uint8_t pucRecord[ TRACE_RECORD_SIZE ];
+	uint16_t uxFree = ringBufferSPSC_GetFreeCount( &xTraceBuffer );
+
+	pucRecord[0] = TRACE_SYNC;
+	memcpy( &pucRecord[3], &ulValue, sizeof(uint32_t) );	// little endian, as is the AVR.
+
+	if( ucTraceDropped )
+	{
+		if( uxFree < 2 * TRACE_RECORD_SIZE )
+		{
+			if( ucTraceDropped < UINT8_MAX )
+				++ucTraceDropped;
+			return;
+		}
+
+		pucRecord[1] = TRACE_EVENT_OVERFLOW;
+		pucRecord[2] = ucTraceDropped;
+		ringBufferSPSC_PokeN( &xTraceBuffer, pucRecord, TRACE_RECORD_SIZE );
+
+		ucTraceDropped = 0;
+	}
+	else if( uxFree < TRACE_RECORD_SIZE )
+	{
+		ucTraceDropped = 1;
+		return;
+	}
+
+	pucRecord[1] = ucEvent;
+	pucRecord[2] = ucId;
+	ringBufferSPSC_PokeN( &xTraceBuffer, pucRecord, TRACE_RECORD_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvTraceTaskNames( void )
+{
+	/* Put the timebase, and the names of all the tasks, four characters to a record. */
+
+	TaskStatus_t * pxTaskStatusArray;
+	UBaseType_t uxArraySize;
+	UBaseType_t uxTask;
+	uint8_t ucFragment;
+	uint32_t ulChars;
+
+	portENTER_CRITICAL();
+	prvTracePut( TRACE_EVENT_TIMEBASE, 0, configCPU_CLOCK_HZ / 8 );
+	portEXIT_CRITICAL();
+
+	uxArraySize = uxTaskGetNumberOfTasks();
+
+	if( (pxTaskStatusArray = (TaskStatus_t *)pvPortMalloc( uxArraySize * sizeof(TaskStatus_t) )) == NULL )
+		return;
+
+	uxArraySize = uxTaskGetSystemState( pxTaskStatusArray, uxArraySize, NULL );
+
+	for( uxTask = 0; uxTask < uxArraySize; ++uxTask )
+	{
+		for( ucFragment = 0; ucFragment < (configMAX_TASK_NAME_LEN + 3) / 4; ++ucFragment )
+		{
+			ulChars = 0;
+			memcpy( &ulChars, pxTaskStatusArray[uxTask].pcTaskName + ucFragment * 4,
+					strnlen( pxTaskStatusArray[uxTask].pcTaskName + ucFragment * 4, 4 ) );	// the rest stays NUL.
+
+			portENTER_CRITICAL();
+			prvTracePut( TRACE_EVENT_TASK_NAME + ucFragment, (uint8_t)pxTaskStatusArray[uxTask].xTaskNumber, ulChars );
+			portEXIT_CRITICAL();
+
+			if( ((char *)&ulChars)[3] == '\0' )
+				break;	// the rest of the name is NUL.
+		}
+	}
+
+	vPortFree( pxTaskStatusArray );
+}
+/*-----------------------------------------------------------*/
+
+static void prvTraceWriteComplete( void * pvContext )
+{
+	/* Called from the UDRE ISR once the span has been sent. The stream task is low priority,
+	 * so it can wait until the next tick to run, rather than yield from here. */
+
+	vTaskNotifyGiveFromISR( (TaskHandle_t)pvContext, NULL );
+}
+/*-----------------------------------------------------------*/
+
+void vTraceStreamTask( void *pvParameters )
+{
+	/* Send the records straight from the trace buffer, a contiguous span at a time,
+	 * and only release each span once the UDRE ISR has sent it. */
+
+	const xComPortHandlePtr pxPort = (xComPortHandlePtr)pvParameters;
+
+	TickType_t xLastNames = xTaskGetTickCount() - TRACE_NAME_PERIOD;
+	uint8_t * pucSpan;
+	uint16_t uxSpan;
+
+	for(;;)
+	{
+		if( (TickType_t)(xTaskGetTickCount() - xLastNames) >= TRACE_NAME_PERIOD )
+		{
+			xLastNames = xTaskGetTickCount();
+			prvTraceTaskNames();
+		}
+
+		if( (uxSpan = ringBufferSPSC_GetLinearSpan( &xTraceBuffer, &pucSpan )) )
+		{
+			xSerialWrite( pxPort, pucSpan, uxSpan, prvTraceWriteComplete, xTaskGetCurrentTaskHandle() );
+			ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+			ringBufferSPSC_Discard( &xTraceBuffer, uxSpan );
+		}
+		else
+		{
+			vTaskDelay( 1 );
+		}
+	}
+}
+
+#endif /* configUSE_TRACE_RECORDER == 1 */
@@ -30,12 +30,16 @@
 
 // extern xComPortHandle xSerialPort;				// Create a handle for the serial port.
 
+static DRESULT disk_last_command_result[CLIENTS];	// hold the result of the last disk command here, for client to query.
+
 /*--------------Tasks ------------------------------*/
 
 static void TaskBlinkRedLED(void *pvParameters);	// Main Arduino Mega 2560, Freetronics EtherMega (Red) LED Blink
 
 static void TaskRAMFSManager(void *pvParameters);	// RAMFS Manager.
 
+static void prvRAMFSServeClient( uint8_t arduinoBank );	// Serve one Client request.
+
 /*-----------------------------------------------------------*/
 
 /* Main program loop */
@@ -118,13 +122,6 @@ static void TaskRAMFSManager(void *pvParameters) // RAMFS Manager
 	API function. */
 //	xLastWakeTime = xTaskGetTickCount();
 
-	xRAMFSarray activeRAMFSblock;	// Establish a CMD block so we know where to put the RAM we read in.
-	uint8_t * pActiveRAMFSblock;	// and a pointer to it.
-
-	pActiveRAMFSblock = (uint8_t *) &activeRAMFSblock; // make this cast to serialise the command structure.
-
-	DRESULT disk_last_command_result[CLIENTS];		// hold the result of the last disk command here, for client to query.
-
 	// create a queue for the PCINT pin results to be pushed onto by the Interrupt routines. uint16_t covers 16 clients.
 	xRAMFSCallQueue = xQueueCreate( RAMFSCALLQUEUEDEPTH, sizeof( uint16_t) );  // queue for calls on RAMFS
 
@@ -144,242 +141,281 @@ static void TaskRAMFSManager(void *pvParameters) // RAMFS Manager
     {
     	uint8_t		arduinoBank;
     	uint16_t	ISRrequest;
+    	uint16_t	nextRequest;
 
-    	arduinoBank = 0x00;
     	ISRrequest = 0x0000;
 
 		PORTB &= ~_BV(PORTB6);       // activity (IO_B6) LED off.
 
 		if( xQueueReceive( xRAMFSCallQueue, &ISRrequest, 1000 / portTICK_PERIOD_MS) == pdTRUE )// block, until there is a request on the queue to grab.
 		{
-			uint8_t i;
-			uint8_t pin;
-
 	    	PORTB |=  _BV(PORTB6);       // activity (IO_B6) LED on.
 
-			i = 0;
-			while( (ISRrequest >> i++ & 0x0001) == 0x0000) // shift through the RAM banks (one each Arduino) until we find a request match.
-			{
-				arduinoBank = i;
-			}
+			while( xQueueReceive( xRAMFSCallQueue, &nextRequest, ( TickType_t ) 0 ) == pdTRUE )
+				ISRrequest |= nextRequest;	// collect any other requests already queued, which catches simultaneous Client requests.
 
-//			xSerialPrintf_P(PSTR("Interrupt: %4x, Bank: %2u"), ISRrequest, arduinoBank);	// may see multiple signals here on Interrupts.
-																							// But just the lowest Arduino bank request will be found.
+//			xSerialPrintf_P(PSTR("Interrupt: %4x"), ISRrequest);	// may see multiple signals here on Interrupts.
 
-			if( (ISRrequest ^ 0x0001<<arduinoBank) != 0x0000) // check if there are any more requests, that didn't get their own interrupt.
+			for( arduinoBank = 0; arduinoBank < CLIENTS; ++arduinoBank ) // shift through the RAM banks (one each Arduino), and serve every request in one pass.
 			{
-				ISRrequest ^= 0x0001<<arduinoBank;
-				xQueueSendToFront( xRAMFSCallQueue, &ISRrequest, ( TickType_t ) 0 );	// push remainder of this request back onto the front of the queue,
-																						// but don't wait about.
-																						// This catches simultaneous Client requests.
+				if( ISRrequest & (0x0001<<arduinoBank) )
+					prvRAMFSServeClient( arduinoBank );
 			}
+		}
+//		xSerialPrintf_P(PSTR("RAMFS HighWater @ %u\r\n"), uxTaskGetStackHighWaterMark(NULL));
+//		vTaskDelayUntil( &xLastWakeTime, ( 50 / portTICK_RATE_MS ) );
+    }
+}
 
-			setMemoryBank(arduinoBank, false);		// set the RAMFS bank for the Arduino for usage.
-
-            // here goes the SPI bus stuff...
-
-			// First job is to work out which is the SS pin we need to use.
-			// But this is just the pin that the interrupt came in on, so it is easy.
-
-			// Then disable PCINT for the relevant Client SS line (pin) while SPI bus is in use.
-			// Don't want interrupts triggering because we're driving it.
+/*---------------------------------------------------------------------------*/
 
-			// then we set the relevant Client SS line output and LOW to select the Arduino SPI interface.
+static void prvRAMFSServeClient( uint8_t arduinoBank ) // Serve one Client request, in one SS session.
+{
+	uint8_t i;
+	uint16_t count;
+	uint8_t pin;
 
-            if( (0x0001<<arduinoBank) && 0x00FF != 0x0000)
-            {
-            	pin = (uint8_t)(((0x0001<<arduinoBank) & 0xFF00)>>8); // use the upper 8 bits for Port K.
+	xRAMFSarray activeRAMFSblock;	// Establish a CMD block so we know where to put the RAM we read in.
+	uint8_t * pActiveRAMFSblock;	// and a pointer to it.
+	xRAMFSop activeRAMFSop;			// Establish an operation block for each operation of a Batch.
 
-//            	xSerialPrintf_P(PSTR(", K Pin: %2x\r\n"), pin);
+	pActiveRAMFSblock = (uint8_t *) &activeRAMFSblock; // make this cast to serialise the command structure.
 
-				PCMSK2 &= ~pin;			// set the Interrupt mask to exclude current SS pin. PCINT23 - PCINT16
+	setMemoryBank(arduinoBank, false);		// set the RAMFS bank for the Arduino for usage.
 
-            	DDRK = pin;				// one pin set as output (SS). All the rest as input.
-            	PORTK = ~pin;				// output pin driven low. All other input pins pulled high,
-            }
+    // here goes the SPI bus stuff...
 
-#if defined (ARDUSAT_HARDWARE) // Most of the PCINT1 pins are unavailable on the Mega2650.
-            else
-            {
-            	pin = (uint8_t)((0x0001<<arduinoBank) & 0x00FF); // use the lower 8 bits for Port J and Port E
+	// First job is to work out which is the SS pin we need to use.
+	// But this is just the pin that the interrupt came in on, so it is easy.
 
-//            	xSerialPrintf_P(PSTR(", J Pin: %2x\r\n"), pin);
+	// Then disable PCINT for the relevant Client SS line (pin) while SPI bus is in use.
+	// Don't want interrupts triggering because we're driving it.
 
-    			PCMSK1 &= ~(pin);				// set the Interrupt mask to exclude current SS pin. PCINT15 - PCINT8
+	// then we set the relevant Client SS line output and LOW to select the Arduino SPI interface.
 
-            	DDRJ &= pin>>1 | _BV(DDJ7);		// one pin set as output (SS). the rest as input.
-            	PORTJ &= ~(pin>>1) | _BV(PJ7);	// output pin driven low. All other input pins pulled high. Except PJ7. We might be using it elsewhere.
-            	DDRE &= pin & _BV(DDE0);		// and same on PE0.
-            	PORTE &= ~(pin & _BV(PE0));
-            }
-#endif
+    if( (0x0001<<arduinoBank) && 0x00FF != 0x0000)
+    {
+    	pin = (uint8_t)(((0x0001<<arduinoBank) & 0xFF00)>>8); // use the upper 8 bits for Port K.
 
-            _delay_us(25);						// put in a delay here. It seems the Slave can't be ready in time.
-            									// Sometimes it takes 16us to respond to SS line and begin enabling SPI
+//            	xSerialPrintf_P(PSTR(", K Pin: %2x\r\n"), pin);
 
-            i = 0;
-            while( (spiTransfer(0xA5) != 0x5A) )// repeatedly send a dummy byte until we get the Arduino client SPI Slave to respond correctly
-            {
-            	if (!( ++i) ) break;			// if we don't hear back from SPI slave, then bail out of this loop.
-            }									// this means it has enabled SPI slave and responded to the PCINT interrupt.
+		PCMSK2 &= ~pin;			// set the Interrupt mask to exclude current SS pin. PCINT23 - PCINT16
 
-            // Get the command structure, so we know what we're going to be doing.
-            if( !spiMultiByteRx( pActiveRAMFSblock, (uint16_t) sizeof(xRAMFSarray) ) ) break; // command structure
+    	DDRK = pin;				// one pin set as output (SS). All the rest as input.
+    	PORTK = ~pin;				// output pin driven low. All other input pins pulled high,
+    }
 
-            if( (activeRAMFSblock.ram_addr < (size_t)XRAMSTART) || (activeRAMFSblock.ram_size > (size_t)XRAMEND - activeRAMFSblock.ram_addr) ) // check we're not being fed a phony address, or size
-            	activeRAMFSblock.ram_cmd = Huh;
+#if defined (ARDUSAT_HARDWARE) // Most of the PCINT1 pins are unavailable on the Mega2650.
+    else
+    {
+    	pin = (uint8_t)((0x0001<<arduinoBank) & 0x00FF); // use the lower 8 bits for Port J and Port E
 
-            switch (activeRAMFSblock.ram_cmd)
-            {
+//            	xSerialPrintf_P(PSTR(", J Pin: %2x\r\n"), pin);
 
-				case Read : // read from RAMFS - write to SPI bus
-					if( !spiMultiByteTx( (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.ram_size )) break;
-		            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
-		        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
-					break;
+		PCMSK1 &= ~(pin);				// set the Interrupt mask to exclude current SS pin. PCINT15 - PCINT8
 
-				case Write : // write to RAMFS - read on SPI bus
-					if( !spiMultiByteRx( (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.ram_size )) break;
-		            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
-		        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
-					break;
+    	DDRJ &= pin>>1 | _BV(DDJ7);		// one pin set as output (SS). the rest as input.
+    	PORTJ &= ~(pin>>1) | _BV(PJ7);	// output pin driven low. All other input pins pulled high. Except PJ7. We might be using it elsewhere.
+    	DDRE &= pin & _BV(DDE0);		// and same on PE0.
+    	PORTE &= ~(pin & _BV(PE0));
+    }
+#endif
 
-				case Swap :	// swap the contents of RAMFS - bidirectional transfer "FASTEST THROUGHPUT" (simultaneous Read & Write)
-					if( !spiMultiByteTransfer( (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.ram_size )) break;
-		            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
-		        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
-					break;
+    _delay_us(25);						// put in a delay here. It seems the Slave can't be ready in time.
+    									// Sometimes it takes 16us to respond to SS line and begin enabling SPI
 
+    i = 0;
+    while( (spiTransfer(0xA5) != 0x5A) )// repeatedly send a dummy byte until we get the Arduino client SPI Slave to respond correctly
+    {
+    	if (!( ++i) ) break;			// if we don't hear back from SPI slave, then bail out of this loop.
+    }									// this means it has enabled SPI slave and responded to the PCINT interrupt.
 
-				case Disk_Status : // get remote disk status (from RAM)
-					spiTransfer( (uint8_t)disk_status(0) ); 						// transfer the disk status
-		            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
-		        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
-					break;
+    // Get the command structure, so we know what we're going to be doing.
+    if( !spiMultiByteRx( pActiveRAMFSblock, (uint16_t) sizeof(xRAMFSarray) ) ) // command structure
+    {
+    	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+    	return;
+    }
 
-				case Disk_Init : // initialise the remote disk
-					if ( disk_status(0) && (STA_NOINIT | STA_NODISK))
-					{
-						// initialise the disk if it needs to be so.
-						spiTransfer( (uint8_t)disk_status(0) );						// transfer the disk status
-			            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
-			        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+    if( (activeRAMFSblock.ram_addr < (size_t)XRAMSTART) || (activeRAMFSblock.ram_size > (size_t)XRAMEND - activeRAMFSblock.ram_addr) ) // check we're not being fed a phony address, or size
+    	activeRAMFSblock.ram_cmd = Huh;
 
-			            // Start the Disk operations.
-			            spiDeselect (Default);				// Deselect the SPI bus (to make sure we can take the semaphore in disk_initialise)
+    switch (activeRAMFSblock.ram_cmd)
+    {
 
-			            disk_last_command_result[arduinoBank] = disk_initialize((uint8_t) 0);
+		case Read : // read from RAMFS - write to SPI bus
+			if( !spiMultiByteTx( (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.ram_size )) break;
+            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
+        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+			break;
+
+		case Write : // write to RAMFS - read on SPI bus
+			if( !spiMultiByteRx( (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.ram_size )) break;
+            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
+        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+			break;
+
+		case Swap :	// swap the contents of RAMFS - bidirectional transfer "FASTEST THROUGHPUT" (simultaneous Read & Write)
+			if( !spiMultiByteTransfer( (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.ram_size )) break;
+            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
+        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+			break;
+
+
+		case Disk_Status : // get remote disk status (from RAM)
+			spiTransfer( (uint8_t)disk_status(0) ); 						// transfer the disk status
+            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
+        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+			break;
+
+		case Disk_Init : // initialise the remote disk
+			if ( disk_status(0) && (STA_NOINIT | STA_NODISK))
+			{
+				// initialise the disk if it needs to be so.
+				spiTransfer( (uint8_t)disk_status(0) );						// transfer the disk status
+	            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
+	        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
 
-			        	spiSetClockDivider(SPI_CLOCK_DIV8); // hopefully we can go faster than DIV8, later. But for now, it is robust.
-			        	spiSelect (Default);				// Select that we're using the SPI bus (in case there are multiple SPI tasks)
+	            // Start the Disk operations.
+	            spiDeselect (Default);				// Deselect the SPI bus (to make sure we can take the semaphore in disk_initialise)
 
-					}else{
-						// otherwise just report its condition.
-						spiTransfer( (uint8_t)disk_status(0) );						// transfer the disk status
-			            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
-			        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
-					}
-					break;
+	            disk_last_command_result[arduinoBank] = disk_initialize((uint8_t) 0);
 
-				case Disk_Read : // read from the disk
-					spiTransfer( (uint8_t)disk_status(0) ); 						// transfer the disk status
-					spiTransfer( (uint8_t)disk_last_command_result[arduinoBank]);	// send the status so that the Read can be properly handled
+	        	spiSetClockDivider(SPI_CLOCK_DIV8); // hopefully we can go faster than DIV8, later. But for now, it is robust.
+	        	spiSelect (Default);				// Select that we're using the SPI bus (in case there are multiple SPI tasks)
 
-					if( disk_last_command_result[arduinoBank] == RES_PENDING )
-					{
-						if( !spiMultiByteTx( (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.ram_size )) break;
-			            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
-			        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+			}else{
+				// otherwise just report its condition.
+				spiTransfer( (uint8_t)disk_status(0) );						// transfer the disk status
+	            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
+	        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+			}
+			break;
 
-			            disk_last_command_result[arduinoBank] = RES_OK;
-					}
-					else
-					{
+		case Disk_Read : // read from the disk
+			spiTransfer( (uint8_t)disk_status(0) ); 						// transfer the disk status
+			spiTransfer( (uint8_t)disk_last_command_result[arduinoBank]);	// send the status so that the Read can be properly handled
 
-			            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
-			        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+			if( disk_last_command_result[arduinoBank] == RES_PENDING )
+			{
+				if( !spiMultiByteTx( (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.ram_size )) break;
+	            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
+	        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
 
-			            // Start the Disk operations.
-			            spiDeselect (Default);				// Deselect the SPI bus (to make sure we can take the semaphore in disk_read)
-			        	spiSetClockDivider(SPI_CLOCK_DIV2); // SD Card can go at full speed.
+	            disk_last_command_result[arduinoBank] = RES_OK;
+			}
+			else
+			{
 
-			            disk_last_command_result[arduinoBank] = disk_read( (uint8_t) 0, (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.disk_sector , activeRAMFSblock.disk_sector_count );
+	            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
+	        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
 
-			        	spiSetClockDivider(SPI_CLOCK_DIV8); // hopefully we can go faster than DIV8, later. But for now, it is robust.
-			        	spiSelect (Default);				// Select that we're using the SPI bus (in case there are multiple SPI tasks)
+	            // Start the Disk operations.
+	            spiDeselect (Default);				// Deselect the SPI bus (to make sure we can take the semaphore in disk_read)
+	        	spiSetClockDivider(SPI_CLOCK_DIV2); // SD Card can go at full speed.
 
-			        	if (disk_last_command_result[arduinoBank] == RES_OK)
-			        		disk_last_command_result[arduinoBank] = RES_PENDING;
-					}
+	            disk_last_command_result[arduinoBank] = disk_read( (uint8_t) 0, (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.disk_sector , activeRAMFSblock.disk_sector_count );
 
-					break;
+	        	spiSetClockDivider(SPI_CLOCK_DIV8); // hopefully we can go faster than DIV8, later. But for now, it is robust.
+	        	spiSelect (Default);				// Select that we're using the SPI bus (in case there are multiple SPI tasks)
 
-				case Disk_Write : // write to the disk
-					if( !spiMultiByteRx( (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.ram_size )) break;
-		            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
-		        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+	        	if (disk_last_command_result[arduinoBank] == RES_OK)
+	        		disk_last_command_result[arduinoBank] = RES_PENDING;
+			}
 
-		            // Start the Disk operations.
-		            spiDeselect (Default);				// Deselect the SPI bus (to make sure we can take the semaphore in disk_write)
-		        	spiSetClockDivider(SPI_CLOCK_DIV2); // SD Card can go at full speed.
+			break;
 
-		            disk_last_command_result[arduinoBank] = disk_write( (uint8_t) 0, (const uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.disk_sector , activeRAMFSblock.disk_sector_count );
+		case Disk_Write : // write to the disk
+			if( !spiMultiByteRx( (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.ram_size )) break;
+            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
+        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
 
-		        	spiSetClockDivider(SPI_CLOCK_DIV8); // hopefully we can go faster than DIV8, later. But for now, it is robust.
-		        	spiSelect (Default);				// Select that we're using the SPI bus (in case there are multiple SPI tasks)
+            // Start the Disk operations.
+            spiDeselect (Default);				// Deselect the SPI bus (to make sure we can take the semaphore in disk_write)
+        	spiSetClockDivider(SPI_CLOCK_DIV2); // SD Card can go at full speed.
 
-					break;
+            disk_last_command_result[arduinoBank] = disk_write( (uint8_t) 0, (const uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.disk_sector , activeRAMFSblock.disk_sector_count );
 
-				case Disk_IOCtl : // do some IO control on the disk.
-					spiTransfer( (uint8_t)disk_status(0) ); 						// transfer the disk status
-					spiTransfer( (uint8_t)disk_last_command_result[arduinoBank]);	// send the status so that the IOCtl can be properly handled
+        	spiSetClockDivider(SPI_CLOCK_DIV8); // hopefully we can go faster than DIV8, later. But for now, it is robust.
+        	spiSelect (Default);				// Select that we're using the SPI bus (in case there are multiple SPI tasks)
 
-					if( disk_last_command_result[arduinoBank] == RES_PENDING )
-					{
-						if( !spiMultiByteTx( (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.ram_size )) break;
-			            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
-			        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+			break;
 
-			            disk_last_command_result[arduinoBank] = RES_OK;
-					}
-					else
-					{
+		case Disk_IOCtl : // do some IO control on the disk.
+			spiTransfer( (uint8_t)disk_status(0) ); 						// transfer the disk status
+			spiTransfer( (uint8_t)disk_last_command_result[arduinoBank]);	// send the status so that the IOCtl can be properly handled
 
-			            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
-			        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+			if( disk_last_command_result[arduinoBank] == RES_PENDING )
+			{
+				if( !spiMultiByteTx( (uint8_t *)(activeRAMFSblock.ram_addr), activeRAMFSblock.ram_size )) break;
+	            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
+	        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
 
-			            // Start the Disk operations.
-			            spiDeselect (Default);				// Deselect the SPI bus (to make sure we can take the semaphore in disk_ioctl)
-			        	spiSetClockDivider(SPI_CLOCK_DIV2); // SD Card can go at full speed.
+	            disk_last_command_result[arduinoBank] = RES_OK;
+			}
+			else
+			{
 
-			            disk_last_command_result[arduinoBank] = disk_ioctl( (uint8_t) 0, activeRAMFSblock.disk_sector_count, (uint8_t *)(activeRAMFSblock.ram_addr) );
-			            									// using activeRAMFSblock.disk_sector_count for the IOCtl cmd just to make things tricky.
+	            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we finished OK.
+	        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
 
-			        	spiSetClockDivider(SPI_CLOCK_DIV8); // hopefully we can go faster than DIV8, later. But for now, it is robust.
-			        	spiSelect (Default);				// Select that we're using the SPI bus (in case there are multiple SPI tasks)
+	            // Start the Disk operations.
+	            spiDeselect (Default);				// Deselect the SPI bus (to make sure we can take the semaphore in disk_ioctl)
+	        	spiSetClockDivider(SPI_CLOCK_DIV2); // SD Card can go at full speed.
 
-			        	if (disk_last_command_result[arduinoBank] == RES_OK)
-			        		disk_last_command_result[arduinoBank] = RES_PENDING;
-					}
-					break;
+	            disk_last_command_result[arduinoBank] = disk_ioctl( (uint8_t) 0, activeRAMFSblock.disk_sector_count, (uint8_t *)(activeRAMFSblock.ram_addr) );
+	            									// using activeRAMFSblock.disk_sector_count for the IOCtl cmd just to make things tricky.
 
-				case Test :
-		            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we're OK.
-		        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
-					break;
+	        	spiSetClockDivider(SPI_CLOCK_DIV8); // hopefully we can go faster than DIV8, later. But for now, it is robust.
+	        	spiSelect (Default);				// Select that we're using the SPI bus (in case there are multiple SPI tasks)
 
-				case Huh :				// just break out of here, if the Client doesn't really want us to talk to it.
-		        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
-					break;
+	        	if (disk_last_command_result[arduinoBank] == RES_OK)
+	        		disk_last_command_result[arduinoBank] = RES_PENDING;
+			}
+			break;
 
-				default :
-		        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+		case Batch : // a vector of Read / Write / Swap operations, with ram_size being the number of operations.
+			for( count = activeRAMFSblock.ram_size; count != 0; --count )
+			{
+				// Get the next operation, so we know what we're going to be doing.
+				if( !spiMultiByteRx( (uint8_t *) &activeRAMFSop, (uint16_t) sizeof(xRAMFSop) ) ) break;
+
+				if( (activeRAMFSop.ram_size == 0) || (activeRAMFSop.ram_addr < (size_t)XRAMSTART) || (activeRAMFSop.ram_size > (size_t)XRAMEND - activeRAMFSop.ram_addr) )
+					break;		// check we're not being fed a phony address, or size. If so, abandon the Batch.
+
+				if( activeRAMFSop.ram_cmd == Read )
+				{
+					if( !spiMultiByteTx( (uint8_t *)(activeRAMFSop.ram_addr), activeRAMFSop.ram_size )) break;
+				}
+				else if( activeRAMFSop.ram_cmd == Write )
+				{
+					if( !spiMultiByteRx( (uint8_t *)(activeRAMFSop.ram_addr), activeRAMFSop.ram_size )) break;
+				}
+				else if( activeRAMFSop.ram_cmd == Swap )
+				{
+					if( !spiMultiByteTransfer( (uint8_t *)(activeRAMFSop.ram_addr), activeRAMFSop.ram_size )) break;
+				}
+				else
 					break;
 			}
-		}
-//		xSerialPrintf_P(PSTR("RAMFS HighWater @ %u\r\n"), uxTaskGetStackHighWaterMark(NULL));
-//		vTaskDelayUntil( &xLastWakeTime, ( 50 / portTICK_RATE_MS ) );
-    }
+			if( count == 0 )
+				spiTransfer(0x5A);	// give back one check byte for the whole Batch, so the Arduino Client SPI Slave knows we finished OK.
+			init16PCINTpins();		// reset PCINT pins, to allow Clients to signal their requests. Releases the SS line if we abandoned the Batch.
+			break;
+
+		case Test :
+            spiTransfer(0x5A);	// give back the check byte so the Arduino Client SPI Slave knows we're OK.
+        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+			break;
+
+		case Huh :				// just break out of here, if the Client doesn't really want us to talk to it.
+        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+			break;
+
+		default :
+        	init16PCINTpins();	// reset PCINT pins, to allow Clients to signal their requests.
+			break;
+	}
 }
 
 